@@ -16,6 +16,17 @@
  * Debug-mode:
  *   cl -W4 -Od -Z7 -FC -MTd -nologo -TC -DCDS_SPLINE_TEST /Fetest_cds_spline.exe cds_spline.h
  *
+ * For benchmarks, build the same way with -DCDS_SPLINE_BENCH and optimizations enabled:
+ *   cc -O2 -march=native -x c -DCDS_SPLINE_BENCH -o bench_cds_spline.exe cds_spline.h -lm
+ *   cl -O2 -nologo -TC -DCDS_SPLINE_BENCH /Febench_cds_spline.exe cds_spline.h
+ * Add -DCDS_SPLINE_INSTRUMENT to either build to enable the hot-path counters and hooks.
+ * Add -DCDS_SPLINE_FAST_MATH to replace pow() with a float approximation when computing
+ * centripetal Catmull-Rom splines whose alpha (tension) is not 0, 0.5 or 1.
+ * Add -DCDS_SPLINE_THREADS (and -pthread on gcc/Clang) to enable the built-in thread pool and
+ * shared splines, and with them the parallel scaling and shared spline benchmarks. Run with --suite to only run the per-operation
+ * regression suite, whose results are CSV (or JSON, with --json) for tracking over time:
+ *   bench_cds_spline.exe --suite > results.csv
+ *
  * LICENSE:
  * This software is in the public domain. Where that dedication is not
  * recognized, you are granted a perpetual, irrevocable license to
@@ -76,12 +87,14 @@
     typedef BYTE  cds_spline_u8;
     typedef LONG  cds_spline_s32;
     typedef DWORD cds_spline_u32;
+    typedef unsigned __int64 cds_spline_u64;
 #else
 #   include <stdint.h>
     typedef  int8_t  cds_spline_s8;
     typedef uint8_t  cds_spline_u8;
     typedef  int32_t cds_spline_s32;
     typedef uint32_t cds_spline_u32;
+    typedef uint64_t cds_spline_u64;
 #endif
 
 typedef float  cds_spline_r32;
@@ -158,10 +171,10 @@ cds_spline_init_vec4(cds_spline_r32 x, cds_spline_r32 y, cds_spline_r32 z, cds_s
     return v;
 }
 
-extern union cds_spline_mat14;
-extern union cds_spline_mat24;
-extern union cds_spline_mat34;
-extern union cds_spline_mat44;
+union cds_spline_mat14;
+union cds_spline_mat24;
+union cds_spline_mat34;
+union cds_spline_mat44;
 #ifdef CDS_SPLINE_COMPILER_MSVC
 #   pragma warning(pop)
 #endif
@@ -193,6 +206,15 @@ typedef enum cds_spline_interp_style {
     kCdsSplineInterpStyleCentripetalCatmullRom = 4, /** Use difference between neighboring points as the tangent, avoiding cusps and self-intersection. */
 } cds_spline_interp_style;
 
+/** Number of consecutive knots that define one segment, and the number of segments in a spline with
+ *  numKnots knots. Both are constant expressions for a constant style. */
+#define CDS_SPLINE_KNOTS_PER_SEGMENT(interpStyle)                                                          \
+    (((interpStyle) == kCdsSplineInterpStyleCardinal ||                                                    \
+      (interpStyle) == kCdsSplineInterpStyleCentripetalCatmullRom) ? 4 : 2)
+#define CDS_SPLINE_SEGMENT_COUNT(interpStyle, numKnots)                                                    \
+    (((numKnots) >= CDS_SPLINE_KNOTS_PER_SEGMENT(interpStyle)) ?                                           \
+        (numKnots) - CDS_SPLINE_KNOTS_PER_SEGMENT(interpStyle) + 1 : 0)
+
 typedef enum cds_spline_error_t {
     kCdsSplineErrorNone                   = 0x00000000,
 
@@ -200,55 +222,1128 @@ typedef enum cds_spline_error_t {
 
     kCdsSplineErrorInsertKnot_KnotIndex   = 0x80010001,
     kCdsSplineErrorInsertKnot_MaxNumKnots = 0x80010002,
+    kCdsSplineErrorInsertKnot_ReadOnly    = 0x80010003,
 
     kCdsSplineErrorSetKnot_KnotIndex      = 0x80020001,
+    kCdsSplineErrorSetKnot_ReadOnly       = 0x80020002,
 
     kCdsSplineErrorRemoveKnot_KnotIndex   = 0x80030001,
+    kCdsSplineErrorRemoveKnot_ReadOnly    = 0x80030002,
+
+    kCdsSplineErrorTessellate_StepCount   = 0x80040001,
+    kCdsSplineErrorTessellate_BufferSize  = 0x80040002,
+    kCdsSplineErrorTessellate_Tolerance   = 0x80040003,
+
+    kCdsSplineErrorAppendKnots_KnotCount    = 0x80050001,
+    kCdsSplineErrorAppendKnots_MaxNumKnots  = 0x80050002,
+    kCdsSplineErrorAppendKnots_ReadOnly     = 0x80050003,
+
+    kCdsSplineErrorEndEdit_NoBatch          = 0x80060001,
+
+    kCdsSplineErrorBankInit_Dimension       = 0x80070001,
+    kCdsSplineErrorBankInit_BufferSize      = 0x80070002,
+
+    kCdsSplineErrorBankSetTrack_TrackIndex  = 0x80080001,
+
+    kCdsSplineErrorThreadPoolInit_WorkerCount = 0x80090001,
+    kCdsSplineErrorThreadPoolInit_BufferSize  = 0x80090002,
+    kCdsSplineErrorThreadPoolInit_Thread      = 0x80090003,
+
+    kCdsSplineErrorSetKnotTimes_Flags         = 0x800A0001,
+    kCdsSplineErrorSetKnotTimes_KnotRange     = 0x800A0002,
+    kCdsSplineErrorSetKnotTimes_Order         = 0x800A0003,
+    kCdsSplineErrorSetKnotTimes_ReadOnly      = 0x800A0004,
+
+    kCdsSplineErrorSweepInit_RingsPerSegment  = 0x800B0001,
+    kCdsSplineErrorSweepInit_VertsPerRing     = 0x800B0002,
+
+    kCdsSplineErrorSweepNext_BufferSize       = 0x800C0001,
+
+    kCdsSplineErrorFitterInit_InterpStyle     = 0x800D0001,
+    kCdsSplineErrorFitterInit_WindowSize      = 0x800D0002,
+    kCdsSplineErrorFitterInit_MaxError        = 0x800D0003,
+    kCdsSplineErrorFitterInit_BufferSize      = 0x800D0004,
+    kCdsSplineErrorFitterInit_ReadOnly        = 0x800D0005,
+
+    kCdsSplineErrorFitterPush_MaxNumKnots     = 0x800E0001,
+    kCdsSplineErrorFitterPush_Time            = 0x800E0002,
+
+    kCdsSplineErrorWriteBlob_BufferSize       = 0x800F0001,
+
+    kCdsSplineErrorBindBlob_Alignment         = 0x80100001,
+    kCdsSplineErrorBindBlob_BlobSize          = 0x80100002,
+    kCdsSplineErrorBindBlob_Magic             = 0x80100003,
+    kCdsSplineErrorBindBlob_ByteOrder         = 0x80100004,
+    kCdsSplineErrorBindBlob_Version           = 0x80100005,
+    kCdsSplineErrorBindBlob_Dimension         = 0x80100006,
+    kCdsSplineErrorBindBlob_Header            = 0x80100007,
+
+    kCdsSplineErrorSetTension_ReadOnly        = 0x80110001,
+
+    kCdsSplineErrorIntersect_Direction        = 0x80120001,
+    kCdsSplineErrorIntersect_Radius           = 0x80120002,
+    kCdsSplineErrorIntersect_BufferSize       = 0x80120003,
+
+    kCdsSplineErrorRingInit_BufferSize        = 0x80130001,
+
+    kCdsSplineErrorRingPushBack_MaxNumKnots   = 0x80140001,
+
+    kCdsSplineErrorRingPopFront_KnotCount     = 0x80150001,
+
+    kCdsSplineErrorSharedInit_BufferSize      = 0x80160001,
+    kCdsSplineErrorSharedInit_Flags           = 0x80160002,
+
+    kCdsSplineErrorSharedBeginWrite_Writing   = 0x80170001,
+
+    kCdsSplineErrorSharedPublish_NoWrite      = 0x80180001,
+
+    kCdsSplineErrorPoolInit_Flags             = 0x80190001,
+
+    kCdsSplineErrorPoolAddSlab_BufferSize     = 0x801A0001,
+
+    kCdsSplineErrorPoolAlloc_MaxKnotCount     = 0x801B0001,
+    kCdsSplineErrorPoolAlloc_OutOfMemory      = 0x801B0002,
+
+    kCdsSplineErrorPoolGrow_MaxKnotCount      = 0x801C0001,
+    kCdsSplineErrorPoolGrow_OutOfMemory       = 0x801C0002,
+
+    kCdsSplineErrorTimingInit_SegmentCount    = 0x801D0001,
+    kCdsSplineErrorTimingInit_Tolerance       = 0x801D0002,
+    kCdsSplineErrorTimingInit_BufferSize      = 0x801D0003,
+    kCdsSplineErrorTimingInit_NotMonotonic    = 0x801D0004,
+
+    kCdsSplineErrorBake_SegmentCount          = 0x801E0001,
+    kCdsSplineErrorBake_Tolerance             = 0x801E0002,
+    kCdsSplineErrorBake_BufferSize            = 0x801E0003,
+
+    kCdsSplineErrorBakedEval_Stale            = 0x801F0001,
 } cds_spline_error_t;
 
-typedef struct cds_spline3 {
-    union cds_spline_mat34 *segmentMatrices;
-    cds_spline_interp_style interpStyle;
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/** Optional features, selected at init time. Each one may increase the required buffer size. */
+typedef enum cds_spline_flags {
+    kCdsSplineFlagNone           = 0x00000000,
+    kCdsSplineFlagArcLengthTable = 0x00000001, /** Maintain per-segment arc lengths for distance-based queries */
+    kCdsSplineFlagBoundingVolumes = 0x00000002, /** Maintain a bounding volume hierarchy over the segments for spatial queries */
+    kCdsSplineFlagBlockedSegments = 0x00000004, /** Give each segment matrix its own cache-line-aligned slot (see derivation.txt) */
+    kCdsSplineFlagDeferredUpdates = 0x00000008, /** Edits only mark segments dirty; they are rebuilt by the next query or cds_splineN_flush() */
+    kCdsSplineFlagKnotTimes       = 0x00000010, /** Store a time per knot for the _at_time queries; see cds_splineN_set_knot_times() */
+    kCdsSplineFlagReadOnly        = 0x00000020, /** Set by cds_splineN_bind_blob(): the spline's arrays are not writable, so every edit fails */
+} cds_spline_flags;
+
+/** Knot times. With kCdsSplineFlagKnotTimes, each knot carries a time value, and the _at_time
+ *  queries map a time to the segment whose knots bracket it (for cardinal and Catmull-Rom
+ *  splines, segment i runs from knot i+1 to knot i+2) and to u by linear interpolation between
+ *  their times. Times only change how the curve is traversed, not its shape; derivatives from
+ *  the _at_time queries are taken with respect to time. Without the flag, time and t are the same.
+ *
+ *  Times must be non-decreasing. Inserted and appended knots get a default time one unit past
+ *  their predecessor (or, when inserted between two knots, halfway between them); call
+ *  cds_splineN_set_knot_times() afterwards to set the real ones.
+ *
+ *  A cursor remembers the segment found by the previous lookup. If the next time is in the
+ *  same or the following segment (forward playback) no search is needed; otherwise the lookup
+ *  falls back to a binary search. Zero-initialize a cursor before its first use; it stays valid
+ *  across edits, since it is only a hint. Pass a NULL cursor to always search. */
+typedef struct cds_spline_cursor {
+    cds_spline_s32 segment;
+} cds_spline_cursor;
+
+/** Binary spline blobs. cds_splineN_write_blob() serializes a spline -- its knots, its computed
+ *  segment matrices, its interpolation style and tension, and its arc length tables, bounding
+ *  volumes and knot times if it has them -- into one contiguous blob. cds_splineN_bind_blob()
+ *  later points a spline at a blob's arrays in place, after checking its header: no copy and no
+ *  recomputation, so binding costs the same for any knot count. The blob may be a memory-mapped
+ *  file; the bound spline is read-only (kCdsSplineFlagReadOnly) and never writes to it.
+ *
+ *  A blob is a cds_spline_blob_header followed by the arrays, each starting at an offset that is
+ *  a multiple of CDS_SPLINE_BLOB_ALIGNMENT, and the blob itself must start at such an address
+ *  (memory-mapped files always do; allocate in-memory blobs aligned). Values are stored in the
+ *  writer's native byte order and float format: build blobs for the platform that loads them.
+ *  A blob in the other byte order is detected by its magic number and refused. */
+#define CDS_SPLINE_BLOB_MAGIC 0x42534443 /* "CDSB" on little-endian machines */
+#define CDS_SPLINE_BLOB_VERSION 1
+#define CDS_SPLINE_BLOB_ALIGNMENT 64
+
+typedef struct cds_spline_blob_header {
+    cds_spline_u32 magic; /** CDS_SPLINE_BLOB_MAGIC */
+    cds_spline_u32 version; /** CDS_SPLINE_BLOB_VERSION */
+    cds_spline_u32 blobSize; /** In bytes, including this header */
+    cds_spline_u32 dimension; /** N of the cds_splineN it holds */
+    cds_spline_u32 interpStyle;
+    cds_spline_u32 flags; /** Which optional arrays are present, and the segment layout */
     cds_spline_r32 tension;
+    cds_spline_s32 numKnots;
+    cds_spline_s32 numSegments;
+    cds_spline_s32 segmentStride;
+    cds_spline_s32 boundsLeafCount;
+    /* Offsets of the arrays from the start of the blob; 0 for arrays the spline does not have */
+    cds_spline_u32 segmentMatricesOffset;
+    cds_spline_u32 knotsOffset;
+    cds_spline_u32 segmentLengthsOffset;
+    cds_spline_u32 arcLengthsOffset;
+    cds_spline_u32 segmentBoundsOffset;
+    cds_spline_u32 knotTimesOffset;
+} cds_spline_blob_header;
+
+/* The spline types and their core API are generated for each dimension N in [1..4] from the
+ * single definition below. For each N this declares:
+ *
+ *   typedef struct cds_spline_aabbN { cds_spline_vecN min, max; } cds_spline_aabbN;
+ *   typedef struct cds_splineN { ... } cds_splineN;
+ *
+ *   size_t             cds_splineN_buffer_size(interpStyle, maxKnotCount);
+ *   cds_spline_error_t cds_splineN_init(outSpline, interpStyle, maxKnotCount, buffer, bufferSize);
+ *   size_t             cds_splineN_buffer_size_ex(interpStyle, maxKnotCount, flags);
+ *   cds_spline_error_t cds_splineN_init_ex(outSpline, interpStyle, maxKnotCount, flags, buffer, bufferSize);
+ *   cds_spline_error_t cds_splineN_init_from_knots(outSpline, interpStyle, maxKnotCount, flags, knots, knotCount, buffer, bufferSize);
+ *   cds_spline_error_t cds_splineN_set_tension(outSpline, tension);
+ *   cds_spline_error_t cds_splineN_insert_knot(outSpline, knotIndex, knot);
+ *   cds_spline_error_t cds_splineN_append_knots(outSpline, knots, knotCount);
+ *   cds_spline_error_t cds_splineN_set_knot(outSpline, knotIndex, knot);
+ *   cds_spline_error_t cds_splineN_remove_knot(outSpline, knotIndex);
+ *   cds_spline_error_t cds_splineN_set_knot_times(outSpline, firstKnot, times, timeCount);
+ *   cds_spline_error_t cds_splineN_flush(outSpline);
+ *   cds_spline_error_t cds_splineN_begin_edit(outSpline);
+ *   cds_spline_error_t cds_splineN_end_edit(outSpline);
+ *   cds_spline_vecN    cds_splineN_eval(spline, t);
+ *   cds_spline_vecN    cds_splineN_evald(spline, t);
+ *   cds_spline_vecN    cds_splineN_evaldd(spline, t);
+ *   cds_spline_r32     cds_splineN_time_to_t(spline, cursor, time);
+ *   cds_spline_vecN    cds_splineN_eval_at_time(spline, cursor, time);
+ *   cds_spline_vecN    cds_splineN_evald_at_time(spline, cursor, time);
+ *   cds_spline_vecN    cds_splineN_evaldd_at_time(spline, cursor, time);
+ *   size_t             cds_splineN_blob_size(spline);
+ *   cds_spline_error_t cds_splineN_write_blob(spline, buffer, bufferSize);
+ *   cds_spline_error_t cds_splineN_bind_blob(outSpline, blob, blobSize);
+ */
+#define CDS_SPLINE__DECLARE(N)                                                                                          \
+typedef struct cds_spline_aabb##N {                                                                                     \
+    cds_spline_vec##N min;                                                                                              \
+    cds_spline_vec##N max;                                                                                              \
+} cds_spline_aabb##N;                                                                                                   \
+                                                                                                                        \
+typedef struct cds_spline##N {                                                                                          \
+    union cds_spline_mat##N##4 *segmentMatrices;                                                                        \
+    cds_spline_interp_style interpStyle;                                                                                \
+    cds_spline_r32 tension;                                                                                             \
+                                                                                                                        \
+    cds_spline_knot##N *knots;                                                                                          \
+    cds_spline_s32 numKnots;                                                                                            \
+    cds_spline_s32 maxNumKnots;                                                                                         \
+    cds_spline_s32 numSegments; /** Automatically kept up to date based on interpStyle and numKnots */                  \
+                                                                                                                        \
+    cds_spline_u32 flags;                                                                                               \
+    cds_spline_r32 *segmentLengths; /** kCdsSplineFlagArcLengthTable only: arc length of each segment */                \
+    cds_spline_r32 *arcLengths; /** kCdsSplineFlagArcLengthTable only: arc length from t=0 to t=i, for i in [0..numSegments] */ \
+    cds_spline_aabb##N *segmentBounds; /** kCdsSplineFlagBoundingVolumes only: implicit binary tree. Node i's children are \
+                                         * 2i and 2i+1 (node 0 is unused); segment i's exact bounds are in node boundsLeafCount+i. */ \
+    cds_spline_s32 boundsLeafCount; /** power of two >= the maximum segment count */                                    \
+    cds_spline_s32 segmentStride; /** Bytes between consecutive entries of segmentMatrices; see kCdsSplineFlagBlockedSegments */ \
+    cds_spline_r32 *knotTimes; /** kCdsSplineFlagKnotTimes only: non-decreasing time of each knot */                    \
+                                                                                                                        \
+    cds_spline_s32 dirtyFirst, dirtyLast; /** Segments whose matrices are stale; empty unless updates are deferred */   \
+    cds_spline_s32 changedFirst, changedLast; /** Segments whose arc length / bounds tables are stale; a superset of the dirty range */ \
+    cds_spline_s32 editBatchDepth; /** Number of open cds_splineN_begin_edit() calls */                                 \
+    cds_spline_s32 writtenFirst, writtenLast; /** Knots written since the range was last reset; see cds_spline_shared3 */ \
+    cds_spline_u32 editCount; /** Bumped by every applied edit that moves the curve, so tables built from it can tell they are stale */ \
+} cds_spline##N;                                                                                                        \
+                                                                                                                        \
+CDS_SPLINE_DEF size_t                                                                                                   \
+cds_spline##N##_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount);                          \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_init(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,        \
+    void *buffer, size_t bufferSize);                                                                                   \
+                                                                                                                        \
+CDS_SPLINE_DEF size_t                                                                                                   \
+cds_spline##N##_buffer_size_ex(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, cds_spline_u32 flags); \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_init_ex(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,     \
+    cds_spline_u32 flags, void *buffer, size_t bufferSize);                                                             \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_init_from_knots(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, \
+    cds_spline_u32 flags, const cds_spline_knot##N *knots, cds_spline_s32 knotCount, void *buffer, size_t bufferSize);  \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_set_tension(cds_spline##N *outSpline, cds_spline_r32 tension);                                          \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_insert_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex, cds_spline_knot##N knot);               \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_append_knots(cds_spline##N *outSpline, const cds_spline_knot##N *knots, cds_spline_s32 knotCount);      \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_set_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex, cds_spline_knot##N knot);                  \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_remove_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex);                                        \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_set_knot_times(cds_spline##N *outSpline, cds_spline_s32 firstKnot, const cds_spline_r32 *times,         \
+    cds_spline_s32 timeCount);                                                                                          \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_flush(cds_spline##N *outSpline);                                                                        \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_begin_edit(cds_spline##N *outSpline);                                                                   \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_end_edit(cds_spline##N *outSpline);                                                                     \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_eval(const cds_spline##N *spline, cds_spline_r32 t);                                                    \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_evald(const cds_spline##N *spline, cds_spline_r32 t);                                                   \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_evaldd(const cds_spline##N *spline, cds_spline_r32 t);                                                  \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_r32                                                                                           \
+cds_spline##N##_time_to_t(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time);                 \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_eval_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time);              \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_evald_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time);             \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_vec##N                                                                                        \
+cds_spline##N##_evaldd_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time);            \
+                                                                                                                        \
+CDS_SPLINE_DEF size_t                                                                                                   \
+cds_spline##N##_blob_size(const cds_spline##N *spline);                                                                 \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_write_blob(const cds_spline##N *spline, void *buffer, size_t bufferSize);                               \
+                                                                                                                        \
+CDS_SPLINE_DEF cds_spline_error_t                                                                                       \
+cds_spline##N##_bind_blob(cds_spline##N *outSpline, const void *blob, size_t blobSize);
+
+CDS_SPLINE__DECLARE(1)
+CDS_SPLINE__DECLARE(2)
+CDS_SPLINE__DECLARE(3)
+CDS_SPLINE__DECLARE(4)
+
+/** Batch evaluation. Equivalent to calling cds_spline3_eval[d[d]] once for each of the tCount
+ *  entries in t[], but runs of t values that land in the same segment are evaluated several
+ *  at a time using SIMD (SSE or AVX, depending on the target). Sorted or mostly-sorted t arrays
+ *  get the most benefit. The _soa variants write each component to its own array. */
+CDS_SPLINE_DEF void
+cds_spline3_eval_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos);
+
+CDS_SPLINE_DEF void
+cds_spline3_evald_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDPos);
+
+CDS_SPLINE_DEF void
+cds_spline3_evaldd_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDDPos);
+
+CDS_SPLINE_DEF void
+cds_spline3_eval_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ);
+
+CDS_SPLINE_DEF void
+cds_spline3_evald_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ);
+
+CDS_SPLINE_DEF void
+cds_spline3_evaldd_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ);
+
+/** Fused evaluation. One segment lookup yields the position and first and second derivatives at
+ *  t, bit-identical to cds_spline3_eval(), _evald() and _evaldd(), plus whichever of the unit
+ *  tangent, curvature and torsion the fields mask asks for; fields that were not asked for are
+ *  zero. Curvature is |d x dd| / |d|^3 and torsion is (d x dd).ddd / |d x dd|^2, both with
+ *  respect to arc length; where the curve stops (d = 0) the tangent and curvature are zero, and
+ *  where it is locally straight (d x dd = 0) the torsion is zero. */
+typedef enum cds_spline_point_fields {
+    kCdsSplinePointTangent   = 0x1,
+    kCdsSplinePointCurvature = 0x2,
+    kCdsSplinePointTorsion   = 0x4,
+    kCdsSplinePointAll       = 0x7,
+} cds_spline_point_fields;
+
+typedef struct cds_spline_point3 {
+    cds_spline_vec3 position;
+    cds_spline_vec3 d; /** First derivative with respect to t */
+    cds_spline_vec3 dd; /** Second derivative with respect to t */
+    cds_spline_vec3 tangent; /** kCdsSplinePointTangent only: d normalized */
+    cds_spline_r32 curvature; /** kCdsSplinePointCurvature only */
+    cds_spline_r32 torsion; /** kCdsSplinePointTorsion only */
+} cds_spline_point3;
+
+CDS_SPLINE_DEF cds_spline_point3
+cds_spline3_eval_point(const cds_spline3 *spline, cds_spline_r32 t, cds_spline_u32 fields);
+
+/** Equivalent to cds_spline3_eval_point() for each of the tCount entries in t[]. Consecutive t
+ *  values in the same segment reuse its coefficients, so sorted t arrays get the most benefit. */
+CDS_SPLINE_DEF void
+cds_spline3_eval_points(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_u32 fields, cds_spline_point3 *outPoints);
+
+/** Number of vertices written by cds_spline3_tessellate_uniform(): stepsPerSegment per segment,
+ *  plus the final endpoint. */
+CDS_SPLINE_DEF cds_spline_s32
+cds_spline3_tessellate_uniform_vertex_count(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment);
+
+/** Samples the spline at t = i/stepsPerSegment for i in [0..numSegments*stepsPerSegment], using
+ *  forward differencing within each segment (three adds per component per vertex).
+ *  The differences are recomputed exactly at the start of each segment and every reanchorInterval
+ *  steps within a segment; pass 0 to only re-anchor at segment starts.
+ *
+ *  Error bound: let K be the number of steps between anchors (reanchorInterval, or stepsPerSegment
+ *  if that is smaller or reanchorInterval is 0), and S the sum of the absolute values of one
+ *  component's four power-basis coefficients for a segment. Each component of each vertex is then
+ *  within (8*K + 16) * 2^-24 * S of cds_spline3_eval() at the same t (for t exactly representable
+ *  as a float, e.g. power-of-two stepsPerSegment). */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_tessellate_uniform(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment, cds_spline_s32 reanchorInterval,
+    cds_spline_vec3 *outVerts, cds_spline_s32 maxVerts, cds_spline_s32 *outVertCount);
+
+typedef struct cds_spline_sample3 {
+    cds_spline_r32 t;
+    cds_spline_vec3 position;
+} cds_spline_sample3;
+
+/** Adaptive tessellation: emits the fewest samples (found by bisection) such that the polyline
+ *  through them stays within tolerance of the spline. Each segment is bisected until the bound
+ *  (du^2 / 8) * max|p''| over the piece is at most tolerance; p'' is linear in u, so its maximum
+ *  comes from the endpoints and the bound is exact, with no extra sampling. Straight stretches
+ *  therefore produce one sample per segment, and tight bends as many as they need. Pieces
+ *  are never split below 2^-CDS_SPLINE_ADAPTIVE_MAX_DEPTH of a segment.
+ *
+ *  Samples are written in increasing t, from t=0 through t=numSegments. The subdivision runs
+ *  on a fixed-size stack and never allocates. *outSampleCount is always set to the number of
+ *  samples the tolerance requires. Pass NULL outSamples to query that count only; if maxSamples
+ *  is smaller, the first maxSamples samples are written and kCdsSplineErrorTessellate_BufferSize
+ *  is returned. */
+#define CDS_SPLINE_ADAPTIVE_MAX_DEPTH 16
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_tessellate_adaptive(const cds_spline3 *spline, cds_spline_r32 tolerance, cds_spline_sample3 *outSamples,
+    cds_spline_s32 maxSamples, cds_spline_s32 *outSampleCount);
+
+/** Arc-length queries. These require a spline initialized with kCdsSplineFlagArcLengthTable.
+ *  Segment lengths are computed with 5-point Gauss-Legendre quadrature whenever a segment matrix
+ *  is recomputed; queries are a binary search over the cumulative table plus a few Newton steps,
+ *  and never allocate. Distances are clamped to [0..cds_spline3_arc_length()]. */
+CDS_SPLINE_DEF cds_spline_r32
+cds_spline3_arc_length(const cds_spline3 *spline);
+
+CDS_SPLINE_DEF cds_spline_r32
+cds_spline3_t_to_distance(const cds_spline3 *spline, cds_spline_r32 t);
+
+CDS_SPLINE_DEF cds_spline_r32
+cds_spline3_distance_to_t(const cds_spline3 *spline, cds_spline_r32 distance);
+
+CDS_SPLINE_DEF cds_spline_vec3
+cds_spline3_eval_by_distance(const cds_spline3 *spline, cds_spline_r32 distance);
+
+typedef struct cds_spline_closest_point3 {
+    cds_spline_r32 t;
+    cds_spline_vec3 position;
+    cds_spline_r32 distance;
+} cds_spline_closest_point3;
+
+/** Finds the point on the spline closest to queryPoint. With kCdsSplineFlagBoundingVolumes, segments
+ *  are culled by walking the segment bounding volume hierarchy; otherwise every segment is tested.
+ *  The batched variant seeds each query with the previous query's segment, so spatially coherent
+ *  query points cull more aggressively. */
+CDS_SPLINE_DEF cds_spline_closest_point3
+cds_spline3_find_closest_point(const cds_spline3 *spline, cds_spline_vec3 queryPoint);
+
+CDS_SPLINE_DEF void
+cds_spline3_find_closest_points(const cds_spline3 *spline, const cds_spline_vec3 *queryPoints, cds_spline_s32 queryCount,
+    cds_spline_closest_point3 *outResults);
+
+/** An orthonormal frame at a point on the spline. tangent is the unit direction of travel;
+ *  binormal = tangent x normal. */
+typedef struct cds_spline_frame3 {
+    cds_spline_vec3 position;
+    cds_spline_vec3 tangent;
+    cds_spline_vec3 normal;
+    cds_spline_vec3 binormal;
+} cds_spline_frame3;
+
+/** Streaming sweep along a spline: rotation-minimizing (parallel-transport) frames at
+ *  t = i/ringsPerSegment for i in [0..numSegments*ringsPerSegment], and optionally a tube of
+ *  vertsPerRing vertices per ring around them. Each frame is carried to the next ring by the
+ *  double-reflection method (Wang et al. 2008, "Computation of rotation minimizing frames"),
+ *  so the tube does not twist except where the spline itself does.
+ *
+ *  The sweep is an iterator: each _next call generates as many rings as fit in the caller's
+ *  buffers and picks up where the previous call stopped, so a tube of any length can be built
+ *  with fixed-size buffers. Position and tangent for each ring come from one segment matrix,
+ *  with no per-ring segment search. The spline must not be edited while a sweep is in progress.
+ *
+ *  Pass NULL initialNormal to pick an arbitrary normal for the first frame; otherwise its
+ *  component perpendicular to the first tangent is used. */
+typedef struct cds_spline_sweep3 {
+    const cds_spline3 *spline;
+    cds_spline_r32 radius;
+    cds_spline_s32 ringsPerSegment;
+    cds_spline_s32 vertsPerRing;
+    cds_spline_s32 ringCount; /** Total number of rings in the sweep */
+    cds_spline_s32 nextRing; /** Number of rings generated so far */
+    cds_spline_vec3 initialNormal;
+    cds_spline_frame3 frame; /** Frame of ring nextRing-1 */
+} cds_spline_sweep3;
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_sweep_init(cds_spline_sweep3 *outSweep, const cds_spline3 *spline, cds_spline_s32 ringsPerSegment,
+    cds_spline_s32 vertsPerRing, cds_spline_r32 radius, const cds_spline_vec3 *initialNormal);
+
+/** Writes the next frames, up to maxFrames of them. *outFrameCount is 0 once the sweep is done. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_sweep_next_frames(cds_spline_sweep3 *sweep, cds_spline_frame3 *outFrames, cds_spline_s32 maxFrames,
+    cds_spline_s32 *outFrameCount);
+
+/** Writes the next chunk of tube mesh: ring vertex positions and unit normals (outNormals may be
+ *  NULL), and 6*vertsPerRing triangle-list indices between each pair of consecutive rings, wound
+ *  counter-clockwise seen from outside the tube. Each chunk is self-contained: its indices
+ *  refer to its own vertices, and every chunk after the first starts by repeating the previous
+ *  chunk's last ring. A chunk of R rings uses R*vertsPerRing vertices and (R-1)*6*vertsPerRing
+ *  indices; buffers must hold at least two rings. *outVertCount is 0 once the sweep is done. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_sweep_next(cds_spline_sweep3 *sweep, cds_spline_vec3 *outPositions, cds_spline_vec3 *outNormals,
+    cds_spline_s32 maxVerts, cds_spline_u32 *outIndices, cds_spline_s32 maxIndices, cds_spline_s32 *outVertCount,
+    cds_spline_s32 *outIndexCount);
+
+/** A point where a plane or ray query meets the spline, at t = segment + u. */
+typedef struct cds_spline_hit3 {
+    cds_spline_s32 segment;
+    cds_spline_r32 u;
+    cds_spline_vec3 position;
+    cds_spline_r32 distance; /** Ray queries: distance from position to the ray; 0 for plane crossings */
+    cds_spline_r32 rayDistance; /** Ray queries: distance along the ray to the point nearest position; 0 for plane crossings */
+} cds_spline_hit3;
+
+/** Finds every point where the spline crosses or touches the plane dot(planeNormal, x) = planeOffset.
+ *  planeNormal need not be unit length. Each segment's signed distance to the plane is a cubic in u;
+ *  the candidate segments (culled by the bounding volume hierarchy with kCdsSplineFlagBoundingVolumes)
+ *  are solved CDS_SPLINE_CUBIC_BATCH at a time with SIMD: the roots of each cubic's derivative split
+ *  [0..1] into monotone pieces, and each piece that changes sign is solved by Newton's method,
+ *  falling back to bisection when a step would leave the piece. A crossing exactly at a knot may
+ *  be reported by the segments on both sides of it.
+ *
+ *  Hits are written in increasing t. *outHitCount is always set to the number of hits. Pass NULL
+ *  outHits to query that count only; if maxHits is smaller, the first maxHits hits are written and
+ *  kCdsSplineErrorIntersect_BufferSize is returned. */
+#define CDS_SPLINE_CUBIC_BATCH 4
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_intersect_plane(const cds_spline3 *spline, cds_spline_vec3 planeNormal, cds_spline_r32 planeOffset,
+    cds_spline_hit3 *outHits, cds_spline_s32 maxHits, cds_spline_s32 *outHitCount);
 
-    cds_spline_knot3 *knots;
+/** Finds where the spline passes within radius of the ray from rayOrigin along rayDirection (which
+ *  need not be unit length): the local minima of the distance between the spline and the ray's
+ *  line that are within radius and in front of rayOrigin, one hit for each pass of the spline by
+ *  the ray. The squared distance to the line is a degree 6 polynomial in u; its minima are found
+ *  from the sign changes of its derivative at CDS_SPLINE_RAY_SAMPLES points per segment, so two
+ *  minima closer together than that may be missed. Segments are culled against the ray with the
+ *  bounding volume hierarchy (each box grown by radius) when the spline has one. Output is as for
+ *  cds_spline3_intersect_plane(). */
+#define CDS_SPLINE_RAY_SAMPLES 16
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_intersect_ray(const cds_spline3 *spline, cds_spline_vec3 rayOrigin, cds_spline_vec3 rayDirection,
+    cds_spline_r32 radius, cds_spline_hit3 *outHits, cds_spline_s32 maxHits, cds_spline_s32 *outHitCount);
+
+/** Online spline fitting: builds a Hermite spline through a stream of points with as few knots
+ *  as the error bound allows. Knots are placed at samples. The last two segments stay open: the
+ *  knot between them sits about halfway along them (a Hermite knot's tangent is shared by the
+ *  segments on either side, and fits both best when they are of similar length), and the open
+ *  knots' tangents are a joint least-squares fit to the samples along both segments, refined by
+ *  reparameterizing the samples to their nearest points on the fit and refitting. Each pushed
+ *  sample moves the last knot to it and refits. When no fit keeps every sample within maxError,
+ *  the middle knot is committed and the fit restarts from it.
+ *
+ *  Only the samples along the open segments are kept, in a window of at most windowSize
+ *  samples; a full window commits early. So each push costs O(windowSize), and the fitter runs
+ *  online: after every push, every sample so far is within maxError of the spline. Committed
+ *  knots never change. Larger windows allow longer segments, so fewer knots.
+ *
+ *  If the spline has kCdsSplineFlagKnotTimes, each knot's time is its sample's time, so times
+ *  must be non-decreasing. The spline must use kCdsSplineInterpStyleHermite; if it already has
+ *  knots, fitting continues from its last knot, keeping that knot's tangent. Edit the spline
+ *  only through the fitter while it is in use. */
+typedef struct cds_spline_fitter3 {
+    cds_spline3 *spline;
+    cds_spline_vec3 *samples; /** The window: samples[0] is the last committed knot */
+    cds_spline_r32 *times; /** Times of the window's samples, if the spline has knot times */
+    cds_spline_r32 *params; /** Each window sample's u within its segment (scratch) */
+    cds_spline_r32 maxError;
+    cds_spline_s32 windowSize;
+    cds_spline_s32 sampleCount;
+    cds_spline_s32 midIndex; /** Window index of the knot between the two open segments; 0 if only one is open */
+    cds_spline_s32 anchorKnot; /** Index in the spline of samples[0]'s knot */
+    cds_spline_bool32_t anchorTangentFixed; /** False until the first knot is committed */
+    cds_spline_vec3 anchorTangent; /** Committed tangent of samples[0]'s knot, once anchorTangentFixed */
+} cds_spline_fitter3;
+
+CDS_SPLINE_DEF size_t
+cds_spline3_fitter_buffer_size(cds_spline_s32 windowSize);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_fitter_init(cds_spline_fitter3 *outFitter, cds_spline3 *spline, cds_spline_r32 maxError,
+    cds_spline_s32 windowSize, void *buffer, size_t bufferSize);
+
+/** Adds one sample. time is ignored unless the spline has knot times. A push adds at most one
+ *  knot, and fails if the spline has no room for one. On error, nothing changes. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_fitter_push(cds_spline_fitter3 *fitter, cds_spline_vec3 point, cds_spline_r32 time);
+
+/** Adds pointCount samples; times may be NULL. Stops at the first sample that fails to push,
+ *  returning its error. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_fitter_push_many(cds_spline_fitter3 *fitter, const cds_spline_vec3 *points, const cds_spline_r32 *times,
+    cds_spline_s32 pointCount);
+
+/** A sliding-window spline, for trails that grow at the back and are trimmed at the front. Knots
+ *  and segment matrices live in fixed rings, so nothing is ever shifted: pushing a knot computes
+ *  only the one new segment at the back (no other segment depends on the new knot), and popping
+ *  knots only advances the front. Both are O(1). Memory comes from a caller-provided buffer, as
+ *  for cds_spline3_init().
+ *
+ *  t in the ring's queries is relative to the current front: t = 0 is the start of the oldest
+ *  remaining segment, so popping a knot moves every remaining point of the curve one unit down
+ *  in t. origin counts the knots popped so far; (origin + t) names the same point for as long as
+ *  it stays in the ring, but keep it in integer and float parts to avoid losing precision. */
+typedef struct cds_spline_ring3 {
+    union cds_spline_mat34 *segmentMatrices; /** maxNumKnots slots; segment i is in slot (firstSlot + i) % maxNumKnots */
+    cds_spline_knot3 *knots; /** maxNumKnots slots; knot i is in slot (firstSlot + i) % maxNumKnots */
+    cds_spline_interp_style interpStyle;
+    cds_spline_r32 tension;
     cds_spline_s32 numKnots;
     cds_spline_s32 maxNumKnots;
-    cds_spline_s32 numSegments; /** Automatically kept up to date based on interpStyle and numKnots */
-} cds_spline3;
+    cds_spline_s32 numSegments;
+    cds_spline_s32 firstSlot;
+    cds_spline_u64 origin; /** Number of knots popped since init */
+} cds_spline_ring3;
 
 CDS_SPLINE_DEF size_t
-cds_spline3_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount);
+cds_spline3_ring_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount);
 
 CDS_SPLINE_DEF cds_spline_error_t
-cds_spline3_init(cds_spline3 *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
+cds_spline3_ring_init(cds_spline_ring3 *outRing, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
     void *buffer, size_t bufferSize);
 
+/** Recomputes every segment. */
 CDS_SPLINE_DEF cds_spline_error_t
-cds_spline3_set_tension(cds_spline3 *outSpline, cds_spline_r32 tension);
+cds_spline3_ring_set_tension(cds_spline_ring3 *ring, cds_spline_r32 tension);
 
 CDS_SPLINE_DEF cds_spline_error_t
-cds_spline3_insert_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex, cds_spline_knot3 knot);
+cds_spline3_ring_push_back(cds_spline_ring3 *ring, cds_spline_knot3 knot);
 
+/** Drops the knotCount oldest knots. */
 CDS_SPLINE_DEF cds_spline_error_t
-cds_spline3_set_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex, cds_spline_knot3 knot);
+cds_spline3_ring_pop_front(cds_spline_ring3 *ring, cds_spline_s32 knotCount);
 
-CDS_SPLINE_DEF cds_spline_error_t
-cds_spline3_remove_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex);
+/** Knot knotIndex, counted from the front. */
+CDS_SPLINE_DEF const cds_spline_knot3*
+cds_spline3_ring_knot(const cds_spline_ring3 *ring, cds_spline_s32 knotIndex);
+
+CDS_SPLINE_DEF cds_spline_vec3
+cds_spline3_ring_eval(const cds_spline_ring3 *ring, cds_spline_r32 t);
 
 CDS_SPLINE_DEF cds_spline_vec3
-cds_spline3_eval(const cds_spline3 *spline, cds_spline_r32 t);
+cds_spline3_ring_evald(const cds_spline_ring3 *ring, cds_spline_r32 t);
 
 CDS_SPLINE_DEF cds_spline_vec3
-cds_spline3_evald(const cds_spline3 *spline, cds_spline_r32 t);
+cds_spline3_ring_evaldd(const cds_spline_ring3 *ring, cds_spline_r32 t);
+
+/** Spline pools. A pool carves the buffers of many small cds_spline3s out of a few large slabs
+ *  supplied by the caller, instead of one allocation per spline. Buffers come in size classes
+ *  of CDS_SPLINE_POOL_MIN_KNOTS << i knots; a spline gets the smallest class that fits, and its
+ *  maxNumKnots is that class's full capacity. Freed buffers go on a free list per class and are
+ *  reused first, so creating and destroying splines does not fragment anything. Every spline in
+ *  a pool has the pool's flags; any interpolation style fits in any buffer.
+ *
+ *  Slabs are used in the order they were added; when they are all full, allocation fails until
+ *  another slab is added. cds_spline_pool_reset() frees every spline at once and makes all the
+ *  slabs reusable; after it (or once the pool's splines are no longer needed), the caller may
+ *  free the slabs' memory. The pool itself never allocates. */
+#define CDS_SPLINE_POOL_MIN_KNOTS 4
+#define CDS_SPLINE_POOL_CLASS_COUNT 12 /* so the largest class holds 8192 knots */
+
+typedef struct cds_spline_pool {
+    struct cds_spline_pool__slab *firstSlab;
+    struct cds_spline_pool__slab *lastSlab;
+    struct cds_spline_pool__slab *currentSlab; /** The slab new buffers are carved from; earlier ones are full */
+    void *freeLists[CDS_SPLINE_POOL_CLASS_COUNT]; /** Freed buffers of each class, linked through their first bytes */
+    size_t blockSizes[CDS_SPLINE_POOL_CLASS_COUNT]; /** Buffer size of each class, a multiple of the cache line size */
+    cds_spline_u32 flags;
+    cds_spline_s32 liveSplines; /** Splines allocated and not yet freed */
+} cds_spline_pool;
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline_pool_init(cds_spline_pool *outPool, cds_spline_u32 flags);
+
+/** Hands bufferSize bytes at buffer to the pool. A small part of each slab is used for
+ *  bookkeeping, and slabs are best made much larger than the largest class in use. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline_pool_add_slab(cds_spline_pool *pool, void *buffer, size_t bufferSize);
+
+/** Frees every spline in the pool and rewinds all of its slabs. */
+CDS_SPLINE_DEF void
+cds_spline_pool_reset(cds_spline_pool *pool);
+
+/** Initializes *outSpline with a pooled buffer for at least maxKnotCount knots. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_pool_alloc(cds_spline_pool *pool, cds_spline3 *outSpline, cds_spline_interp_style interpStyle,
+    cds_spline_s32 maxKnotCount);
+
+/** Moves a pooled spline to a buffer for at least maxKnotCount knots, keeping its knots, knot
+ *  times, tension and computed segments, and frees its old buffer. Pending edits are flushed
+ *  first. Does nothing if the spline already has room; on failure the spline is unchanged. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_pool_grow(cds_spline_pool *pool, cds_spline3 *spline, cds_spline_s32 maxKnotCount);
+
+CDS_SPLINE_DEF void
+cds_spline3_pool_free(cds_spline_pool *pool, cds_spline3 *spline);
+
+/** Timing curves. A 2D spline whose x never decreases along the curve (time on x, value on y,
+ *  usually Bezier knots with x-monotone control points) can be evaluated by x instead of by t.
+ *  A timing table samples x CDS_SPLINE_TIMING_SAMPLES times per segment; each query binary
+ *  searches the samples for a bracket and an initial guess, then refines it with Newton steps,
+ *  falling back to bisection whenever a step leaves the bracket or fails to halve it.
+ *
+ *  The bracket therefore at least halves every two iterations, which gives a fixed iteration
+ *  count after which x(t) is guaranteed to be within the tolerance of the requested x (float
+ *  precision permitting). init computes that count; most queries stop long before it. The table
+ *  refers to the spline's segments and must be rebuilt after the spline is edited. */
+#define CDS_SPLINE_TIMING_SAMPLES 8
+
+typedef struct cds_spline_timing2 {
+    const cds_spline2 *spline;
+    cds_spline_r32 *sampleX; /** x at u = i/CDS_SPLINE_TIMING_SAMPLES within each segment, then at the end; non-decreasing */
+    cds_spline_s32 sampleCount;
+    cds_spline_r32 tolerance;
+    cds_spline_s32 maxIterations; /** Refinement steps needed to guarantee the tolerance on every segment */
+} cds_spline_timing2;
+
+CDS_SPLINE_DEF size_t
+cds_spline2_timing_buffer_size(const cds_spline2 *spline);
+
+/** Builds a timing table for spline, flushing its pending edits. Fails with NotMonotonic if x
+ *  decreases anywhere along the curve. tolerance is in units of x. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline2_timing_init(cds_spline_timing2 *outTiming, const cds_spline2 *spline, cds_spline_r32 tolerance,
+    void *buffer, size_t bufferSize);
+
+/** The spline parameter t at which the curve reaches x. x is clamped to the curve's range; where
+ *  the curve is flat in x, any t on the flat part may be returned. */
+CDS_SPLINE_DEF cds_spline_r32
+cds_spline2_timing_solve(const cds_spline_timing2 *timing, cds_spline_r32 x);
+
+/** The curve's y where it reaches x. */
+CDS_SPLINE_DEF cds_spline_r32
+cds_spline2_timing_eval(const cds_spline_timing2 *timing, cds_spline_r32 x);
+
+/** Solves xCount values at once, writing t and/or y (either output may be NULL). Consecutive x
+ *  values that fall near each other, as successive animation frames do, skip the search. */
+CDS_SPLINE_DEF void
+cds_spline2_timing_eval_many(const cds_spline_timing2 *timing, const cds_spline_r32 *x, cds_spline_s32 xCount,
+    cds_spline_r32 *outT, cds_spline_r32 *outY);
+
+/** Baked splines. Baking samples a spline's positions into a dense, cache-line aligned table, at
+ *  the fewest samples per segment that keep interpolating between them within tolerance of the
+ *  curve; evaluating the table then costs a few loads and multiply-adds. Quadratic interpolation
+ *  needs far fewer samples than linear for tight tolerances (its error shrinks with the cube of
+ *  the sample spacing rather than the square), at a few more operations per evaluation.
+ *
+ *  errorBound is a strict bound on the distance between a baked evaluation and cds_spline3_eval()
+ *  at the same t, including float rounding: it is the analytic interpolation error (at most the
+ *  tolerance) plus a few ulps of the spline's coordinates.
+ *
+ *  The table remembers the spline's edit count. Once the spline is edited, the table is stale:
+ *  cds_spline3_baked_is_current() returns false, eval asserts, and eval_many fails. The table is
+ *  indexed by t, so cds_spline3_set_knot_times() alone does not make it stale. */
+typedef enum cds_spline_bake_interp {
+    kCdsSplineBakeLinear    = 1,
+    kCdsSplineBakeQuadratic = 2, /** Through three consecutive samples */
+} cds_spline_bake_interp;
+
+#define CDS_SPLINE_BAKE_MAX_SAMPLES_PER_SEGMENT 65536
+
+typedef struct cds_spline_baked3 {
+    const cds_spline3 *spline;
+    cds_spline_vec3 *samples; /** samplesPerSegment per segment at u = i/samplesPerSegment, then the end of the spline */
+    cds_spline_s32 samplesPerSegment; /** Even for quadratic interpolation */
+    cds_spline_s32 sampleCount;
+    cds_spline_s32 numSegments;
+    cds_spline_bake_interp interp;
+    cds_spline_r32 errorBound;
+    cds_spline_u32 editCount; /** The spline's editCount when it was baked */
+} cds_spline_baked3;
+
+/** Returns 0 if tolerance is not positive, or needs more than CDS_SPLINE_BAKE_MAX_SAMPLES_PER_SEGMENT. */
+CDS_SPLINE_DEF size_t
+cds_spline3_bake_buffer_size(const cds_spline3 *spline, cds_spline_bake_interp interp, cds_spline_r32 tolerance);
+
+/** Flushes the spline's pending edits and bakes it. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_bake(cds_spline_baked3 *outBaked, const cds_spline3 *spline, cds_spline_bake_interp interp,
+    cds_spline_r32 tolerance, void *buffer, size_t bufferSize);
+
+CDS_SPLINE_DEF cds_spline_bool32_t
+cds_spline3_baked_is_current(const cds_spline_baked3 *baked);
 
 CDS_SPLINE_DEF cds_spline_vec3
-cds_spline3_evaldd(const cds_spline3 *spline, cds_spline_r32 t);
+cds_spline3_baked_eval(const cds_spline_baked3 *baked, cds_spline_r32 t);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_baked_eval_many(const cds_spline_baked3 *baked, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos);
+
+/** A spline bank holds trackCount independent splines ("tracks") that share a dimension,
+ *  interpolation style and knot count, so that all of them can be evaluated at one shared t with
+ *  a single segment lookup. Each segment's coefficients are stored as [row][component][track]
+ *  (the rows of a cds_spline_matN4, interleaved across tracks), so evaluation streams through
+ *  one contiguous block and runs SIMD across tracks. */
+typedef struct cds_spline_bank {
+    cds_spline_r32 *coefs;
+    cds_spline_interp_style interpStyle;
+    cds_spline_r32 tension; /** Used by Cardinal tracks; takes effect for tracks set after it changes */
+    cds_spline_s32 dim;
+    cds_spline_s32 numKnots;
+    cds_spline_s32 numSegments;
+    cds_spline_s32 trackCount;
+    cds_spline_s32 trackStride; /** trackCount rounded up to a whole number of SIMD registers */
+} cds_spline_bank;
+
+CDS_SPLINE_DEF size_t
+cds_spline_bank_buffer_size(cds_spline_s32 dim, cds_spline_interp_style interpStyle, cds_spline_s32 numKnots,
+    cds_spline_s32 trackCount);
+
+/** Every track starts out as the zero curve. */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline_bank_init(cds_spline_bank *outBank, cds_spline_s32 dim, cds_spline_interp_style interpStyle,
+    cds_spline_s32 numKnots, cds_spline_s32 trackCount, void *buffer, size_t bufferSize);
+
+/** Sets one track from numKnots knots of the bank's dimension, laid out as an array of
+ *  cds_spline_knotN (for example, pass (const cds_spline_r32*)knots for a cds_spline_knot3 array). */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline_bank_set_track(cds_spline_bank *outBank, cds_spline_s32 trackIndex, const cds_spline_r32 *knots);
+
+/** Evaluates every track at t. Component c of track i is written to out[c*trackCount + i]. */
+CDS_SPLINE_DEF void
+cds_spline_bank_eval(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out);
+
+CDS_SPLINE_DEF void
+cds_spline_bank_evald(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out);
+
+CDS_SPLINE_DEF void
+cds_spline_bank_evaldd(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out);
+
+/** Parallel evaluation. Work is split into tasks that each cover a contiguous range of segments
+ *  (or of t values) and write to their own slice of one caller-allocated output array, so tasks
+ *  never share output and need no locks. The task boundaries fall where the serial code already
+ *  restarts its computation, so the output is bit-identical to the serial function's, regardless
+ *  of executor, worker count, or the order in which tasks run.
+ *
+ *  An executor runs taskCount tasks, calling task(taskData, i) exactly once for each i in
+ *  [0..taskCount-1] on any thread, and returns when all of them have finished. concurrency is
+ *  the number of threads it is expected to use, and only affects how finely work is split.
+ *  Pass a NULL executor to run all tasks on the calling thread.
+ *
+ *  Pending edits are flushed on the calling thread before any task starts. The spline must not
+ *  be modified until the call returns. */
+typedef void (*cds_spline_task_func)(void *taskData, cds_spline_s32 taskIndex);
+
+typedef struct cds_spline_executor {
+    void (*parallelFor)(void *context, cds_spline_task_func task, void *taskData, cds_spline_s32 taskCount);
+    void *context;
+    cds_spline_s32 concurrency;
+} cds_spline_executor;
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_tessellate_uniform_parallel(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment,
+    cds_spline_s32 reanchorInterval, cds_spline_vec3 *outVerts, cds_spline_s32 maxVerts, cds_spline_s32 *outVertCount,
+    const cds_spline_executor *executor);
+
+CDS_SPLINE_DEF void
+cds_spline3_eval_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos, const cds_spline_executor *executor);
+
+CDS_SPLINE_DEF void
+cds_spline3_evald_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDPos, const cds_spline_executor *executor);
+
+CDS_SPLINE_DEF void
+cds_spline3_evaldd_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDDPos, const cds_spline_executor *executor);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_baked_eval_many_parallel(const cds_spline_baked3 *baked, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos, const cds_spline_executor *executor);
+
+#if defined(CDS_SPLINE_THREADS)
+/** Built-in thread pool (define CDS_SPLINE_THREADS and link with pthreads on POSIX). Workers
+ *  sleep on a condition variable between batches, and the thread that submits a batch runs tasks
+ *  too, so a pool with workerCount workers has a concurrency of workerCount+1. A pool with zero
+ *  workers is valid and runs everything on the caller. Batches submitted from several threads
+ *  at once are run one after another. */
+typedef struct cds_spline_thread_pool cds_spline_thread_pool;
+
+CDS_SPLINE_DEF size_t
+cds_spline_thread_pool_buffer_size(cds_spline_s32 workerCount);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline_thread_pool_init(cds_spline_thread_pool **outPool, cds_spline_s32 workerCount, void *buffer, size_t bufferSize);
+
+/** Stops and joins the worker threads. The buffer may be freed afterwards. */
+CDS_SPLINE_DEF void
+cds_spline_thread_pool_destroy(cds_spline_thread_pool *pool);
+
+CDS_SPLINE_DEF cds_spline_executor
+cds_spline_thread_pool_executor(cds_spline_thread_pool *pool);
+
+/** Shared splines: one writer thread edits a spline while other threads evaluate it, without
+ *  locks on the read side. A cds_spline_shared3 holds two copies of the spline. Readers call
+ *  cds_spline3_shared_acquire() to get the published copy, query it with the usual const
+ *  functions (cds_spline3_eval() and so on), and hand it back with cds_spline3_shared_release();
+ *  the copy they hold never changes in between, so every query sees one consistent version.
+ *
+ *  The writer edits the other copy, between cds_spline3_shared_begin_write() and
+ *  cds_spline3_shared_publish(). Publishing flushes the edits and swaps the two copies with one
+ *  atomic store, so later acquires see the new version while current holders keep the old one.
+ *  The next begin_write() waits (yielding) until the old copy has no holders, then brings it up
+ *  to date by copying only the knots the last publish wrote, the segment matrices that depend
+ *  on them, and the table entries they changed. Readers never wait and never retry more than
+ *  once per concurrent publish; keep acquisitions short (one frame, one batch) so the writer is
+ *  not held up. Only one thread may write at a time.
+ *
+ *  The two copies are initialized with the same interpStyle, maxKnotCount and flags
+ *  (kCdsSplineFlagReadOnly is not allowed), and start out empty and published. */
+typedef struct cds_spline_shared3 {
+    cds_spline3 copies[2];
+    cds_spline_s32 published; /** Index of the copy that readers acquire; written atomically */
+    cds_spline_s32 writing; /** Nonzero between begin_write() and publish() */
+    cds_spline_s32 pendingFirst, pendingLast; /** Knots the unpublished copy has not caught up on yet */
+    cds_spline_u32 version; /** Number of publishes so far */
+    cds_spline_u32 versions[2]; /** The version each copy holds */
+    cds_spline_s32 readerCounts[2][16]; /** Readers holding each copy; one cache line per counter */
+} cds_spline_shared3;
+
+CDS_SPLINE_DEF size_t
+cds_spline3_shared_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, cds_spline_u32 flags);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_shared_init(cds_spline_shared3 *outShared, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
+    cds_spline_u32 flags, void *buffer, size_t bufferSize);
+
+/** Returns the published copy and registers the calling thread as one of its holders. If
+ *  outVersion is not NULL, it receives the copy's version: equal versions mean equal contents. */
+CDS_SPLINE_DEF const cds_spline3*
+cds_spline3_shared_acquire(cds_spline_shared3 *shared, cds_spline_u32 *outVersion);
+
+CDS_SPLINE_DEF void
+cds_spline3_shared_release(cds_spline_shared3 *shared, const cds_spline3 *snapshot);
+
+/** Returns the unpublished copy in *outSpline, up to date with the published one, for editing
+ *  with the usual cds_spline3 functions. An edit batch stays open on it until publish(). */
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_shared_begin_write(cds_spline_shared3 *shared, cds_spline3 **outSpline);
+
+CDS_SPLINE_DEF cds_spline_error_t
+cds_spline3_shared_publish(cds_spline_shared3 *shared);
+#endif
+
+#if defined(CDS_SPLINE_INSTRUMENT)
+/** Instrumentation (define CDS_SPLINE_INSTRUMENT in the implementation file). The library keeps
+ *  one set of global counters, shared by every spline and bank; without the define, neither the
+ *  counters nor the hook calls are compiled in. Counters are updated with relaxed atomic adds,
+ *  so they are safe to use from several threads, and each read is a snapshot of each counter
+ *  (but not of all of them at once). */
+typedef struct cds_spline_stats {
+    cds_spline_u64 segmentRecomputes[kCdsSplineInterpStyleCentripetalCatmullRom+1]; /** Segment matrices computed, indexed by interpStyle */
+    cds_spline_u64 recomputePasses; /** Non-empty batches of recomputed segments; one hook call pair each */
+    cds_spline_u64 evalCalls; /** cds_splineN_eval(), cds_splineN_eval_at_time() and cds_spline3_ring_eval() */
+    cds_spline_u64 evaldCalls; /** cds_splineN_evald(), cds_splineN_evald_at_time() and cds_spline3_ring_evald() */
+    cds_spline_u64 evalddCalls; /** cds_splineN_evaldd(), cds_splineN_evaldd_at_time() and cds_spline3_ring_evaldd() */
+    cds_spline_u64 knotShifts; /** Knots moved up or down one slot by insert_knot()/remove_knot() */
+    cds_spline_u64 segmentShifts; /** Segment matrices moved along with them */
+    cds_spline_u64 clampedT; /** t values outside [0..numSegments] that were clamped to an end of the spline */
+} cds_spline_stats;
+
+/** Called around each recompute pass, on the thread doing the edit (or the flush). dim is the
+ *  spline's dimension, and the pass computes segmentCount matrices of the given style. */
+typedef void (*cds_spline_recompute_hook)(void *userData, cds_spline_s32 dim, cds_spline_interp_style interpStyle,
+    cds_spline_s32 segmentCount);
+
+typedef struct cds_spline_hooks {
+    cds_spline_recompute_hook beginRecompute; /** May be NULL */
+    cds_spline_recompute_hook endRecompute; /** May be NULL */
+    void *userData;
+} cds_spline_hooks;
+
+CDS_SPLINE_DEF void
+cds_spline_get_stats(cds_spline_stats *outStats);
+
+CDS_SPLINE_DEF void
+cds_spline_reset_stats(void);
+
+/** Installs a copy of *hooks; NULL removes them. Not synchronized with recompute passes running
+ *  on other threads, so set hooks up before editing splines from more than one thread. */
+CDS_SPLINE_DEF void
+cds_spline_set_hooks(const cds_spline_hooks *hooks);
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+/* C++ wrapper: cds::spline<N, Style> is a cds_splineN whose dimension and interpolation style are
+ * part of the type. The C functions it forwards to are already generated per dimension, so the
+ * wrapper only adds compile-time constants and type safety; it has no state beyond the C struct.
+ * Style still reaches the C functions at run time, as it does from C: evaluation only reads the
+ * segment matrices, which do not depend on the style, and edits switch on it once per recompute
+ * pass, outside the per-segment loop.
+ */
+namespace cds {
+
+template<int N> struct spline_traits;
+
+#define CDS_SPLINE__DECLARE_TRAITS(N)                                                                                   \
+template<> struct spline_traits<N> {                                                                                    \
+    typedef cds_spline##N c_type;                                                                                       \
+    typedef cds_spline_knot##N knot_type;                                                                               \
+    typedef cds_spline_vec##N vec_type;                                                                                 \
+    static size_t buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, cds_spline_u32 flags) { \
+        return cds_spline##N##_buffer_size_ex(interpStyle, maxKnotCount, flags);                                        \
+    }                                                                                                                   \
+    static cds_spline_error_t init(c_type *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, \
+        cds_spline_u32 flags, void *buffer, size_t bufferSize) {                                                        \
+        return cds_spline##N##_init_ex(outSpline, interpStyle, maxKnotCount, flags, buffer, bufferSize);                \
+    }                                                                                                                   \
+    static cds_spline_error_t set_tension(c_type *outSpline, cds_spline_r32 tension) {                                  \
+        return cds_spline##N##_set_tension(outSpline, tension);                                                         \
+    }                                                                                                                   \
+    static cds_spline_error_t insert_knot(c_type *outSpline, cds_spline_s32 knotIndex, const knot_type &knot) {         \
+        return cds_spline##N##_insert_knot(outSpline, knotIndex, knot);                                                 \
+    }                                                                                                                   \
+    static cds_spline_error_t append_knots(c_type *outSpline, const knot_type *knots, cds_spline_s32 knotCount) {       \
+        return cds_spline##N##_append_knots(outSpline, knots, knotCount);                                               \
+    }                                                                                                                   \
+    static cds_spline_error_t set_knot(c_type *outSpline, cds_spline_s32 knotIndex, const knot_type &knot) {            \
+        return cds_spline##N##_set_knot(outSpline, knotIndex, knot);                                                    \
+    }                                                                                                                   \
+    static cds_spline_error_t remove_knot(c_type *outSpline, cds_spline_s32 knotIndex) {                                \
+        return cds_spline##N##_remove_knot(outSpline, knotIndex);                                                       \
+    }                                                                                                                   \
+    static cds_spline_error_t set_knot_times(c_type *outSpline, cds_spline_s32 firstKnot, const cds_spline_r32 *times,  \
+        cds_spline_s32 timeCount) {                                                                                     \
+        return cds_spline##N##_set_knot_times(outSpline, firstKnot, times, timeCount);                                  \
+    }                                                                                                                   \
+    static cds_spline_error_t flush(c_type *outSpline) { return cds_spline##N##_flush(outSpline); }                     \
+    static cds_spline_error_t begin_edit(c_type *outSpline) { return cds_spline##N##_begin_edit(outSpline); }           \
+    static cds_spline_error_t end_edit(c_type *outSpline) { return cds_spline##N##_end_edit(outSpline); }               \
+    static vec_type eval(const c_type *spline, cds_spline_r32 t) { return cds_spline##N##_eval(spline, t); }            \
+    static vec_type evald(const c_type *spline, cds_spline_r32 t) { return cds_spline##N##_evald(spline, t); }          \
+    static vec_type evaldd(const c_type *spline, cds_spline_r32 t) { return cds_spline##N##_evaldd(spline, t); }        \
+    static cds_spline_r32 time_to_t(const c_type *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {             \
+        return cds_spline##N##_time_to_t(spline, cursor, time);                                                         \
+    }                                                                                                                   \
+    static vec_type eval_at_time(const c_type *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {                \
+        return cds_spline##N##_eval_at_time(spline, cursor, time);                                                      \
+    }                                                                                                                   \
+    static vec_type evald_at_time(const c_type *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {               \
+        return cds_spline##N##_evald_at_time(spline, cursor, time);                                                     \
+    }                                                                                                                   \
+    static vec_type evaldd_at_time(const c_type *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {              \
+        return cds_spline##N##_evaldd_at_time(spline, cursor, time);                                                    \
+    }                                                                                                                   \
+};
+
+CDS_SPLINE__DECLARE_TRAITS(1)
+CDS_SPLINE__DECLARE_TRAITS(2)
+CDS_SPLINE__DECLARE_TRAITS(3)
+CDS_SPLINE__DECLARE_TRAITS(4)
+#undef CDS_SPLINE__DECLARE_TRAITS
+
+template<int N, cds_spline_interp_style Style>
+class spline {
+public:
+    static_assert(N >= 1 && N <= 4, "cds::spline supports dimensions 1 through 4");
+    typedef spline_traits<N> traits;
+    typedef typename traits::c_type c_type;
+    typedef typename traits::knot_type knot_type;
+    typedef typename traits::vec_type vec_type;
+
+    static constexpr int dimension = N;
+    static constexpr cds_spline_interp_style interp_style = Style;
+    /** Number of consecutive knots that define one segment */
+    static constexpr cds_spline_s32 knots_per_segment = CDS_SPLINE_KNOTS_PER_SEGMENT(Style);
+
+    static constexpr cds_spline_s32 segment_count(cds_spline_s32 numKnots) {
+        return CDS_SPLINE_SEGMENT_COUNT(Style, numKnots);
+    }
+    static size_t buffer_size(cds_spline_s32 maxKnotCount, cds_spline_u32 flags = kCdsSplineFlagNone) {
+        return traits::buffer_size(Style, maxKnotCount, flags);
+    }
+
+    cds_spline_error_t init(cds_spline_s32 maxKnotCount, void *buffer, size_t bufferSize,
+        cds_spline_u32 flags = kCdsSplineFlagNone) {
+        return traits::init(&m_spline, Style, maxKnotCount, flags, buffer, bufferSize);
+    }
+    /** Initializes the spline and appends knots[0..knotCount-1]; see cds_splineN_init_from_knots() */
+    cds_spline_error_t init(cds_spline_s32 maxKnotCount, const knot_type *knots, cds_spline_s32 knotCount,
+        void *buffer, size_t bufferSize, cds_spline_u32 flags = kCdsSplineFlagNone) {
+        cds_spline_error_t error = traits::init(&m_spline, Style, maxKnotCount, flags, buffer, bufferSize);
+        return (error != kCdsSplineErrorNone) ? error : traits::append_knots(&m_spline, knots, knotCount);
+    }
+    cds_spline_error_t set_tension(cds_spline_r32 tension) { return traits::set_tension(&m_spline, tension); }
+    cds_spline_error_t insert_knot(cds_spline_s32 knotIndex, const knot_type &knot) { return traits::insert_knot(&m_spline, knotIndex, knot); }
+    cds_spline_error_t append_knots(const knot_type *knots, cds_spline_s32 knotCount) { return traits::append_knots(&m_spline, knots, knotCount); }
+    cds_spline_error_t set_knot(cds_spline_s32 knotIndex, const knot_type &knot) { return traits::set_knot(&m_spline, knotIndex, knot); }
+    cds_spline_error_t remove_knot(cds_spline_s32 knotIndex) { return traits::remove_knot(&m_spline, knotIndex); }
+    cds_spline_error_t set_knot_times(cds_spline_s32 firstKnot, const cds_spline_r32 *times, cds_spline_s32 timeCount) {
+        return traits::set_knot_times(&m_spline, firstKnot, times, timeCount);
+    }
+    cds_spline_error_t flush() { return traits::flush(&m_spline); }
+    cds_spline_error_t begin_edit() { return traits::begin_edit(&m_spline); }
+    cds_spline_error_t end_edit() { return traits::end_edit(&m_spline); }
+
+    vec_type eval(cds_spline_r32 t) const { return traits::eval(&m_spline, t); }
+    vec_type evald(cds_spline_r32 t) const { return traits::evald(&m_spline, t); }
+    vec_type evaldd(cds_spline_r32 t) const { return traits::evaldd(&m_spline, t); }
+    cds_spline_r32 time_to_t(cds_spline_r32 time, cds_spline_cursor *cursor = nullptr) const { return traits::time_to_t(&m_spline, cursor, time); }
+    vec_type eval_at_time(cds_spline_r32 time, cds_spline_cursor *cursor = nullptr) const { return traits::eval_at_time(&m_spline, cursor, time); }
+    vec_type evald_at_time(cds_spline_r32 time, cds_spline_cursor *cursor = nullptr) const { return traits::evald_at_time(&m_spline, cursor, time); }
+    vec_type evaldd_at_time(cds_spline_r32 time, cds_spline_cursor *cursor = nullptr) const { return traits::evaldd_at_time(&m_spline, cursor, time); }
+
+    cds_spline_s32 num_knots() const { return m_spline.numKnots; }
+    cds_spline_s32 num_segments() const { return m_spline.numSegments; }
+    const c_type &c_spline() const { return m_spline; }
+    c_type &c_spline() { return m_spline; }
+
+private:
+    c_type m_spline;
+};
+
+} /* namespace cds */
+#endif
 
 #endif /*-------------- end header file ------------------------*/
 
 /*-------------------- begin implementation --------------------*/
-#if defined(CDS_SPLINE_TEST)
+#if defined(CDS_SPLINE_TEST) && defined(CDS_SPLINE_BENCH)
+#   error CDS_SPLINE_TEST and CDS_SPLINE_BENCH each provide main(); define only one
+#endif
+#if defined(CDS_SPLINE_TEST) || defined(CDS_SPLINE_BENCH)
 #   define CDS_SPLINE_IMPLEMENTATION
 #endif
 #if defined(CDS_SPLINE_IMPLEMENTATION)
@@ -262,9 +1357,109 @@ cds_spline3_evaldd(const cds_spline3 *spline, cds_spline_r32 t);
 
 #include <math.h>
 
+/* SIMD kernels are selected from the target flags; define CDS_SPLINE_NO_SIMD to force the
+ * scalar code paths. */
+#if !defined(CDS_SPLINE_NO_SIMD)
+#   if defined(__AVX__)
+#       define CDS_SPLINE__SIMD_AVX
+#   endif
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define CDS_SPLINE__SIMD_SSE
+#   endif
+#endif
+#if defined(CDS_SPLINE__SIMD_AVX) || defined(CDS_SPLINE__SIMD_SSE)
+#   include <immintrin.h>
+#endif
+
+#if defined(CDS_SPLINE_THREADS)
+#   if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+#       include <windows.h>
+#   else
+#       include <pthread.h>
+#       include <sched.h>
+#   endif
+#endif
+
 #define CDS_SPLINE_MIN(x,y) ((x)<(y) ? (x) : (y))
 #define CDS_SPLINE_MAX(x,y) ((x)>(y) ? (x) : (y))
 
+/* CDS_SPLINE__STAT_ADD(field, n) adds n to a cds_spline_stats counter, and CDS_SPLINE__HOOK(name,
+ * args) calls an installed hook. Both are statements that compile to nothing unless
+ * CDS_SPLINE_INSTRUMENT is defined. */
+#if defined(CDS_SPLINE_INSTRUMENT)
+static cds_spline_stats cds_spline__stats;
+static cds_spline_hooks cds_spline__hooks;
+#   if defined(CDS_SPLINE_COMPILER_MSVC)
+#       include <intrin.h>
+#       define CDS_SPLINE__ATOMIC_ADD_U64(p, n) _InterlockedExchangeAdd64((volatile __int64*)(p), (__int64)(n))
+#       define CDS_SPLINE__ATOMIC_LOAD_U64(p) ((cds_spline_u64)_InterlockedOr64((volatile __int64*)(p), 0))
+#       define CDS_SPLINE__ATOMIC_STORE_U64(p, v) _InterlockedExchange64((volatile __int64*)(p), (__int64)(v))
+#   else
+#       define CDS_SPLINE__ATOMIC_ADD_U64(p, n) __atomic_fetch_add((p), (cds_spline_u64)(n), __ATOMIC_RELAXED)
+#       define CDS_SPLINE__ATOMIC_LOAD_U64(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#       define CDS_SPLINE__ATOMIC_STORE_U64(p, v) __atomic_store_n((p), (cds_spline_u64)(v), __ATOMIC_RELAXED)
+#   endif
+#   define CDS_SPLINE__STAT_ADD(field, n) ((void)CDS_SPLINE__ATOMIC_ADD_U64(&cds_spline__stats.field, (n)))
+#   define CDS_SPLINE__HOOK(name, args) \
+        do { if (cds_spline__hooks.name != NULL) cds_spline__hooks.name args; } while(0)
+#else
+#   define CDS_SPLINE__STAT_ADD(field, n) ((void)0)
+#   define CDS_SPLINE__HOOK(name, args) ((void)0)
+#endif
+
+/* Wraps a pass that computes segmentCount matrices of one style; see cds_spline_hooks. */
+#define CDS_SPLINE__BEGIN_RECOMPUTE(dim, interpStyle, segmentCount)                                   \
+    CDS_SPLINE__HOOK(beginRecompute, (cds_spline__hooks.userData, (dim), (interpStyle), (segmentCount)))
+#define CDS_SPLINE__END_RECOMPUTE(dim, interpStyle, segmentCount)                                     \
+    do {                                                                                              \
+        CDS_SPLINE__STAT_ADD(segmentRecomputes[(interpStyle)], (segmentCount));                       \
+        CDS_SPLINE__STAT_ADD(recomputePasses, 1);                                                     \
+        CDS_SPLINE__HOOK(endRecompute, (cds_spline__hooks.userData, (dim), (interpStyle), (segmentCount))); \
+    } while(0)
+
+#if defined(CDS_SPLINE_INSTRUMENT)
+void
+cds_spline_get_stats(cds_spline_stats *outStats) {
+    cds_spline_s32 iStyle;
+    for(iStyle=0; iStyle<=kCdsSplineInterpStyleCentripetalCatmullRom; iStyle += 1) {
+        outStats->segmentRecomputes[iStyle] = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.segmentRecomputes[iStyle]);
+    }
+    outStats->recomputePasses = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.recomputePasses);
+    outStats->evalCalls = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.evalCalls);
+    outStats->evaldCalls = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.evaldCalls);
+    outStats->evalddCalls = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.evalddCalls);
+    outStats->knotShifts = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.knotShifts);
+    outStats->segmentShifts = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.segmentShifts);
+    outStats->clampedT = CDS_SPLINE__ATOMIC_LOAD_U64(&cds_spline__stats.clampedT);
+}
+
+void
+cds_spline_reset_stats(void) {
+    cds_spline_s32 iStyle;
+    for(iStyle=0; iStyle<=kCdsSplineInterpStyleCentripetalCatmullRom; iStyle += 1) {
+        CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.segmentRecomputes[iStyle], 0);
+    }
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.recomputePasses, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.evalCalls, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.evaldCalls, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.evalddCalls, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.knotShifts, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.segmentShifts, 0);
+    CDS_SPLINE__ATOMIC_STORE_U64(&cds_spline__stats.clampedT, 0);
+}
+
+void
+cds_spline_set_hooks(const cds_spline_hooks *hooks) {
+    if (hooks != NULL) {
+        cds_spline__hooks = *hooks;
+    } else {
+        cds_spline__hooks.beginRecompute = NULL;
+        cds_spline__hooks.endRecompute = NULL;
+        cds_spline__hooks.userData = NULL;
+    }
+}
+#endif
+
 #ifdef CDS_SPLINE_COMPILER_MSVC
 #   pragma warning(push)
 #   pragma warning(disable:4201) /* nameless struct/union */
@@ -322,14 +1517,19 @@ cds_spline__roundf(cds_spline_r32 x) {
     return result;
 }
 
+/* t runs from 0 to numSegments; segment i covers [i..i+1]. */
 static CDS_SPLINE_INLINE void
-cds_spline__get_int_and_frac(cds_spline_s32 numKnots, cds_spline_r32 t, cds_spline_s32 *outInt, cds_spline_r32 *outFrac) {
-    cds_spline_r32 tMax = (cds_spline_r32)(numKnots-1);
-    if (numKnots < 2 || t <= 0) {
+cds_spline__get_int_and_frac(cds_spline_s32 numSegments, cds_spline_r32 t, cds_spline_s32 *outInt, cds_spline_r32 *outFrac) {
+    cds_spline_r32 tMax = (cds_spline_r32)numSegments;
+    if (numSegments < 1 || t <= 0) {
+        if (t < 0)
+            CDS_SPLINE__STAT_ADD(clampedT, 1);
         *outInt  = 0;
         *outFrac = 0.0f;
     } else if (t >= tMax) {
-        *outInt = numKnots-2;
+        if (t > tMax)
+            CDS_SPLINE__STAT_ADD(clampedT, 1);
+        *outInt = numSegments-1;
         *outFrac = 1.0f;
     } else {
         cds_spline_r32 tFloor = cds_spline__roundf(t);
@@ -338,316 +1538,6675 @@ cds_spline__get_int_and_frac(cds_spline_s32 numKnots, cds_spline_r32 t, cds_spli
     }
 }
 
-static CDS_SPLINE_INLINE void
-cds_spline3__compute_segment_matrix(cds_spline3 *outSpline, cds_spline_s32 segmentIndex) {
-    if (segmentIndex >= 0 && segmentIndex < outSpline->numSegments) {
-        cds_spline_mat34 *m = outSpline->segmentMatrices+segmentIndex;
-        switch(outSpline->interpStyle) {
-        case kCdsSplineInterpStyleHermite: {
-            const cds_spline_vec3 *p0 = &outSpline->knots[segmentIndex+0].position;
-            const cds_spline_vec3 *p1 = &outSpline->knots[segmentIndex+1].position;
-            const cds_spline_vec3 *t0 = &outSpline->knots[segmentIndex+0].tangent;
-            const cds_spline_vec3 *t1 = &outSpline->knots[segmentIndex+1].tangent;
-            m->m00 = p0->x;
-            m->m01 = p0->y;
-            m->m02 = p0->z;
-            m->m10 = t0->x;
-            m->m11 = t0->y;
-            m->m12 = t0->z;
-            m->m20 = (-3)*p0->x +  (3)*p1->x + (-2)*t0->x + (-1)*t1->x;
-            m->m21 = (-3)*p0->y +  (3)*p1->y + (-2)*t0->y + (-1)*t1->y;
-            m->m22 = (-3)*p0->z +  (3)*p1->z + (-2)*t0->z + (-1)*t1->z;
-            m->m30 =  (2)*p0->x + (-2)*p1->x +      t0->x +      t1->x;
-            m->m31 =  (2)*p0->y + (-2)*p1->y +      t0->y +      t1->y;
-            m->m32 =  (2)*p0->z + (-2)*p1->z +      t0->z +      t1->z;
-            break;
-        }
-        case kCdsSplineInterpStyleBezier: {
-            const cds_spline_vec3 *p0 = &outSpline->knots[segmentIndex+0].position;
-            const cds_spline_vec3 *p3 = &outSpline->knots[segmentIndex+1].tangent;
-            cds_spline_vec3 p1, p2;
-            p1.x = p0->x + outSpline->knots[segmentIndex+0].tangent.x;
-            p1.y = p0->y + outSpline->knots[segmentIndex+0].tangent.y;
-            p1.z = p0->z + outSpline->knots[segmentIndex+0].tangent.z;
-            p2.x = p3->x - outSpline->knots[segmentIndex+1].tangent.x;
-            p2.y = p3->y - outSpline->knots[segmentIndex+1].tangent.y;
-            p2.z = p3->z - outSpline->knots[segmentIndex+1].tangent.z;
-            m->m00 = p0->x;
-            m->m01 = p0->y;
-            m->m02 = p0->z;
-            m->m10 = (-3)*p0->x + ( 3)*p1.x;
-            m->m11 = (-3)*p0->y + ( 3)*p1.y;
-            m->m12 = (-3)*p0->z + ( 3)*p1.z;
-            m->m20 = ( 3)*p0->x + (-6)*p1.x + ( 3)*p2.x;
-            m->m21 = ( 3)*p0->y + (-6)*p1.y + ( 3)*p2.y;
-            m->m22 = ( 3)*p0->z + (-6)*p1.z + ( 3)*p2.z;
-            m->m30 = (-1)*p0->x + ( 3)*p1.x + (-3)*p2.x + p3->x;
-            m->m31 = (-1)*p0->y + ( 3)*p1.y + (-3)*p2.y + p3->y;
-            m->m32 = (-1)*p0->z + ( 3)*p1.z + (-3)*p2.z + p3->z;
-            break;
+/* Index of the knot at which segment 0 starts */
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline__segment_knot_offset(cds_spline_interp_style interpStyle) {
+    return (interpStyle == kCdsSplineInterpStyleCardinal ||
+        interpStyle == kCdsSplineInterpStyleCentripetalCatmullRom) ? 1 : 0;
+}
+
+/* Opens a slot for a new knot's time at knotIndex in times[0..numKnots-1], and fills it with a
+ * default that keeps the times ordered. */
+static void
+cds_spline__insert_knot_time(cds_spline_r32 *times, cds_spline_s32 numKnots, cds_spline_s32 knotIndex) {
+    cds_spline_s32 iKnot;
+    for(iKnot=numKnots; iKnot>knotIndex; iKnot -= 1) {
+        times[iKnot] = times[iKnot-1];
+    }
+    if (numKnots == 0)
+        times[knotIndex] = 0;
+    else if (knotIndex == numKnots)
+        times[knotIndex] = times[knotIndex-1] + 1.0f;
+    else if (knotIndex == 0)
+        times[knotIndex] = times[knotIndex+1] - 1.0f;
+    else
+        times[knotIndex] = 0.5f * (times[knotIndex-1] + times[knotIndex+1]);
+}
+
+/* Validates the whole range against its neighbors before writing anything. */
+static cds_spline_error_t
+cds_spline__set_knot_times(cds_spline_r32 *times, cds_spline_s32 numKnots, cds_spline_s32 firstKnot,
+    const cds_spline_r32 *newTimes, cds_spline_s32 timeCount) {
+    cds_spline_s32 iTime;
+    for(iTime=0; iTime<timeCount; iTime += 1) {
+        const cds_spline_s32 iKnot = firstKnot + iTime;
+        const cds_spline_r32 prev = (iTime > 0) ? newTimes[iTime-1] : (iKnot > 0) ? times[iKnot-1] : newTimes[iTime];
+        if (!(newTimes[iTime] >= prev))
+            return kCdsSplineErrorSetKnotTimes_Order;
+    }
+    if (timeCount > 0 && firstKnot + timeCount < numKnots && !(times[firstKnot + timeCount] >= newTimes[timeCount-1]))
+        return kCdsSplineErrorSetKnotTimes_Order;
+    for(iTime=0; iTime<timeCount; iTime += 1) {
+        times[firstKnot + iTime] = newTimes[iTime];
+    }
+    return kCdsSplineErrorNone;
+}
+
+/* Finds the segment containing time, where segment i covers [segmentTimes[i]..segmentTimes[i+1]].
+ * Times outside the spline clamp to its ends, as in cds_spline__get_int_and_frac(). The cursor's
+ * segment and its successor are tried first; the fallback is a binary search whose loop body
+ * compiles to a conditional move rather than a branch. */
+static void
+cds_spline__locate_time(const cds_spline_r32 *segmentTimes, cds_spline_s32 numSegments, cds_spline_cursor *cursor,
+    cds_spline_r32 time, cds_spline_s32 *outSegment, cds_spline_r32 *outU, cds_spline_r32 *outInvDuration) {
+    cds_spline_s32 segment = -1;
+    cds_spline_r32 duration, u;
+    if (cursor != NULL) {
+        const cds_spline_s32 hint = CDS_SPLINE_MIN(CDS_SPLINE_MAX(cursor->segment, 0), numSegments-1);
+        if (time >= segmentTimes[hint]) {
+            if (hint == numSegments-1 || time < segmentTimes[hint+1])
+                segment = hint;
+            else if (hint+1 == numSegments-1 || time < segmentTimes[hint+2])
+                segment = hint+1;
+        } else if (hint == 0) {
+            segment = 0;
         }
-        case kCdsSplineInterpStyleCardinal: {
-            const cds_spline_vec3 *p0 = &outSpline->knots[segmentIndex+0].position;
-            const cds_spline_vec3 *p1 = &outSpline->knots[segmentIndex+1].position;
-            const cds_spline_vec3 *p2 = &outSpline->knots[segmentIndex+2].tangent;
-            const cds_spline_vec3 *p3 = &outSpline->knots[segmentIndex+3].tangent;
-            const cds_spline_r32 tau = outSpline->tension;
-            m->m00 = p1->x;
-            m->m01 = p1->y;
-            m->m02 = p1->z;
-            m->m10 =  (-tau)*p0->x +   (tau)*p2->x;
-            m->m11 =  (-tau)*p0->y +   (tau)*p2->y;
-            m->m12 =  (-tau)*p0->z +   (tau)*p2->z;
-            m->m20 = (2*tau)*p0->x + (tau-3)*p1->x + (3-2*tau)*p2->x + (-tau)*p3->x;
-            m->m21 = (2*tau)*p0->y + (tau-3)*p1->y + (3-2*tau)*p2->y + (-tau)*p3->y;
-            m->m22 = (2*tau)*p0->z + (tau-3)*p1->z + (3-2*tau)*p2->z + (-tau)*p3->z;
-            m->m30 =  (-tau)*p0->x + (2-tau)*p1->x +   (tau-2)*p2->x +  (tau)*p3->x;
-            m->m31 =  (-tau)*p0->y + (2-tau)*p1->y +   (tau-2)*p2->y +  (tau)*p3->y;
-            m->m32 =  (-tau)*p0->z + (2-tau)*p1->z +   (tau-2)*p2->z +  (tau)*p3->z;
-            break;
+    }
+    if (segment < 0) {
+        const cds_spline_r32 *base = segmentTimes;
+        cds_spline_s32 count = numSegments;
+        while(count > 1) {
+            const cds_spline_s32 half = count / 2;
+            base = (base[half] <= time) ? base + half : base;
+            count -= half;
+        }
+        segment = (cds_spline_s32)(base - segmentTimes);
+    }
+    if (cursor != NULL)
+        cursor->segment = segment;
+    duration = segmentTimes[segment+1] - segmentTimes[segment];
+    *outInvDuration = (duration > 0) ? 1.0f / duration : 0.0f;
+    u = (time - segmentTimes[segment]) * *outInvDuration;
+    *outSegment = segment;
+    *outU = CDS_SPLINE_MIN(CDS_SPLINE_MAX(u, 0.0f), 1.0f);
+}
+
+/* Dimension-generic kernels. Knots are read as 2*dim floats (position, then tangent) and segment
+ * matrices as 4 rows of dim floats, matching the cds_spline_knotN and cds_spline_matN4 layouts.
+ * The per-dimension functions generated by CDS_SPLINE__DEFINE() always pass a literal dim (and,
+ * where it matters, a literal interpStyle), so the loops and switches below fold away. */
+
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline__segment_count(cds_spline_interp_style interpStyle, cds_spline_s32 numKnots) {
+    return CDS_SPLINE_SEGMENT_COUNT(interpStyle, numKnots);
+}
+
+/* The range of segments whose matrices depend on a given knot. May extend past either end of the
+ * spline; __recompute_segments() clamps it. */
+static CDS_SPLINE_INLINE void
+cds_spline__knot_segment_range(cds_spline_interp_style interpStyle, cds_spline_s32 knotIndex,
+    cds_spline_s32 *outFirstSegment, cds_spline_s32 *outLastSegment) {
+    switch(interpStyle) {
+    case kCdsSplineInterpStyleCardinal:
+    case kCdsSplineInterpStyleCentripetalCatmullRom:
+        *outFirstSegment = knotIndex-3;
+        *outLastSegment = knotIndex;
+        break;
+    case kCdsSplineInterpStyleHermite:
+    case kCdsSplineInterpStyleBezier:
+    default:
+        *outFirstSegment = knotIndex-1;
+        *outLastSegment = knotIndex;
+        break;
+    }
+}
+
+#if defined(CDS_SPLINE_FAST_MATH)
+/* Float approximation of x^y for x >= 0, as 2^(y*log2(x)): log2 of the mantissa from the
+ * atanh series (4 terms), 2^frac from a degree 5 Taylor polynomial on [-0.5..0.5]. Relative error
+ * is below 1e-5 for the exponents and ranges a chord parameter sees. */
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline__fast_powf(cds_spline_r32 x, cds_spline_r32 y) {
+    union { cds_spline_r32 f; cds_spline_u32 u; } bits;
+    cds_spline_r32 mantissa, s, s2, log2x, z, f, p;
+    cds_spline_s32 exponent, i;
+    if (x <= 0)
+        return (y == 0) ? 1.0f : 0.0f;
+    bits.f = x;
+    exponent = (cds_spline_s32)((bits.u >> 23) & 0xFF) - 127;
+    bits.u = (bits.u & 0x007FFFFF) | 0x3F800000;
+    mantissa = bits.f; /* [1..2) */
+    s = (mantissa - 1.0f) / (mantissa + 1.0f);
+    s2 = s*s;
+    log2x = (cds_spline_r32)exponent + 2.8853900817779268f * s * (1.0f + s2*(1.0f/3 + s2*(1.0f/5 + s2*(1.0f/7))));
+    z = y * log2x;
+    if (z < -126.0f)
+        return 0.0f;
+    if (z > 127.0f)
+        z = 127.0f;
+    i = (cds_spline_s32)floor(z + 0.5f);
+    f = (z - (cds_spline_r32)i) * 0.69314718055994531f; /* e^f == 2^(z-i) */
+    p = 1.0f + f*(1.0f + f*(1.0f/2 + f*(1.0f/6 + f*(1.0f/24 + f*(1.0f/120)))));
+    bits.u = (cds_spline_u32)(i + 127) << 23;
+    return p * bits.f;
+}
+#endif
+
+/* Centripetal Catmull-Rom knot spacing: |pos1 - pos0|^alpha. The common alphas (0: uniform,
+ * 0.5: centripetal, 1: chordal) avoid pow() entirely. Define CDS_SPLINE_FAST_MATH to use
+ * cds_spline__fast_powf() for the others; this changes the curve by roughly 1e-5 relative. */
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline__chord_param(cds_spline_s32 dim, const cds_spline_r32 *pos0, const cds_spline_r32 *pos1,
+    cds_spline_r32 alpha) {
+    cds_spline_r32 distSq = 0;
+    cds_spline_s32 c;
+    if (alpha == 0.0f)
+        return 1.0f;
+    for(c=0; c<dim; c += 1) {
+        distSq += (pos1[c] - pos0[c])*(pos1[c] - pos0[c]);
+    }
+    if (alpha == 0.5f)
+        return (cds_spline_r32)sqrt(sqrt(distSq));
+    if (alpha == 1.0f)
+        return (cds_spline_r32)sqrt(distSq);
+#if defined(CDS_SPLINE_FAST_MATH)
+    return cds_spline__fast_powf(distSq, alpha*0.5f);
+#else
+    return (cds_spline_r32)pow(distSq, alpha*0.5f);
+#endif
+}
+
+/* Centripetal Catmull-Rom segment matrix from its four knots and the chord parameters of the
+ * three knot pairs, chords[i] = |P[i+1] - P[i]|^alpha. The pairs are shared with the neighboring
+ * segments, so callers computing a run of segments pass each one along rather than recomputing it.
+ *
+ * Simplification: reduce centripetal Catmull-Rom to Hermite, as described in
+ * https://stackoverflow.com/questions/9489736/catmull-rom-curve-with-no-cusps-and-no-self-intersections/23980479#23980479
+ * Basically, given P0,P1,P2,P3 and t0,t1,t2,t3, compute tangents at P1 and P2:
+ *   tan1 = (P1 - P0) / (t1 - t0) - (P2 - P0) / (t2 - t0) + (P2 - P1) / (t2 - t1)
+ *   tan2 = (P2 - P1) / (t2 - t1) - (P3 - P1) / (t3 - t1) + (P3 - P2) / (t3 - t2)
+ * And plug into the standard Hermite basis matrix. If evaluating the segment from
+ * P1 to P2, the tangents must be scaled by (t2-t1) to put them in the appropriate range.
+ * Each (t_j - t_i) is a sum of chords, and is inverted once for all components.
+ */
+static CDS_SPLINE_INLINE void
+cds_spline__compute_centripetal_matrix(cds_spline_s32 dim, const cds_spline_r32 *knots, const cds_spline_r32 chords[3],
+    cds_spline_r32 *m) {
+    const cds_spline_s32 knotStride = 2*dim;
+    const cds_spline_r32 *pos0 = knots, *pos1 = knots + knotStride;
+    const cds_spline_r32 *pos2 = knots + 2*knotStride, *pos3 = knots + 3*knotStride;
+    const cds_spline_r32 inv01 = 1.0f / chords[0], inv12 = 1.0f / chords[1], inv23 = 1.0f / chords[2];
+    const cds_spline_r32 inv02 = 1.0f / (chords[0] + chords[1]), inv13 = 1.0f / (chords[1] + chords[2]);
+    cds_spline_s32 c;
+    for(c=0; c<dim; c += 1) {
+        const cds_spline_r32 p0 = pos0[c], p1 = pos1[c], p2 = pos2[c], p3 = pos3[c];
+        const cds_spline_r32 tanA = ((p1 - p0)*inv01 - (p2 - p0)*inv02 + (p2 - p1)*inv12) * chords[1];
+        const cds_spline_r32 tanB = ((p2 - p1)*inv12 - (p3 - p1)*inv13 + (p3 - p2)*inv23) * chords[1];
+        m[0*dim+c] = p1;
+        m[1*dim+c] = tanA;
+        m[2*dim+c] = (-3)*p1 + ( 3)*p2 + (-2)*tanA + (-1)*tanB;
+        m[3*dim+c] = ( 2)*p1 + (-2)*p2 +      tanA +      tanB;
+    }
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline__compute_segment_matrix(cds_spline_s32 dim, cds_spline_interp_style interpStyle, cds_spline_r32 tension,
+    const cds_spline_r32 *knots, cds_spline_r32 *m) {
+    const cds_spline_s32 knotStride = 2*dim;
+    const cds_spline_r32 *pos0 = knots + 0*knotStride, *tan0 = pos0 + dim;
+    const cds_spline_r32 *pos1 = knots + 1*knotStride, *tan1 = pos1 + dim;
+    cds_spline_s32 c;
+    switch(interpStyle) {
+    case kCdsSplineInterpStyleHermite:
+        for(c=0; c<dim; c += 1) {
+            const cds_spline_r32 p0 = pos0[c], p1 = pos1[c], t0 = tan0[c], t1 = tan1[c];
+            m[0*dim+c] = p0;
+            m[1*dim+c] = t0;
+            m[2*dim+c] = (-3)*p0 +  (3)*p1 + (-2)*t0 + (-1)*t1;
+            m[3*dim+c] =  (2)*p0 + (-2)*p1 +      t0 +      t1;
+        }
+        break;
+    case kCdsSplineInterpStyleBezier:
+        for(c=0; c<dim; c += 1) {
+            const cds_spline_r32 p0 = pos0[c], p3 = pos1[c];
+            const cds_spline_r32 p1 = p0 + tan0[c];
+            const cds_spline_r32 p2 = p3 - tan1[c];
+            m[0*dim+c] = p0;
+            m[1*dim+c] = (-3)*p0 + ( 3)*p1;
+            m[2*dim+c] = ( 3)*p0 + (-6)*p1 + ( 3)*p2;
+            m[3*dim+c] = (-1)*p0 + ( 3)*p1 + (-3)*p2 + p3;
+        }
+        break;
+    case kCdsSplineInterpStyleCardinal: {
+        const cds_spline_r32 *pos2 = knots + 2*knotStride, *pos3 = knots + 3*knotStride;
+        const cds_spline_r32 tau = tension;
+        for(c=0; c<dim; c += 1) {
+            const cds_spline_r32 p0 = pos0[c], p1 = pos1[c], p2 = pos2[c], p3 = pos3[c];
+            m[0*dim+c] = p1;
+            m[1*dim+c] =  (-tau)*p0 +   (tau)*p2;
+            m[2*dim+c] = (2*tau)*p0 + (tau-3)*p1 + (3-2*tau)*p2 + (-tau)*p3;
+            m[3*dim+c] =  (-tau)*p0 + (2-tau)*p1 +   (tau-2)*p2 +  (tau)*p3;
+        }
+        break;
+    }
+    case kCdsSplineInterpStyleCentripetalCatmullRom: {
+        cds_spline_r32 chords[3];
+        chords[0] = cds_spline__chord_param(dim, pos0, pos1, tension);
+        chords[1] = cds_spline__chord_param(dim, pos1, knots + 2*knotStride, tension);
+        chords[2] = cds_spline__chord_param(dim, knots + 2*knotStride, knots + 3*knotStride, tension);
+        cds_spline__compute_centripetal_matrix(dim, knots, chords, m);
+        break;
+    }
+    }
+}
+
+/* A 4D segment matrix is four 16-byte rows, so each Horner step below is a single SIMD
+ * multiply-add across all four components. */
+static CDS_SPLINE_INLINE void
+cds_spline__eval_segment(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 u, cds_spline_r32 *out) {
+    cds_spline_s32 c;
+#if defined(CDS_SPLINE__SIMD_SSE)
+    if (dim == 4) {
+        const __m128 vU = _mm_set1_ps(u);
+        __m128 v = _mm_loadu_ps(m+12);
+        v = _mm_add_ps(_mm_mul_ps(v, vU), _mm_loadu_ps(m+8));
+        v = _mm_add_ps(_mm_mul_ps(v, vU), _mm_loadu_ps(m+4));
+        v = _mm_add_ps(_mm_mul_ps(v, vU), _mm_loadu_ps(m+0));
+        _mm_storeu_ps(out, v);
+        return;
+    }
+#endif
+    for(c=0; c<dim; c += 1) {
+        out[c] = ((m[3*dim+c]*u + m[2*dim+c])*u + m[1*dim+c])*u + m[0*dim+c];
+    }
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline__evald_segment(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 u, cds_spline_r32 *out) {
+    cds_spline_s32 c;
+#if defined(CDS_SPLINE__SIMD_SSE)
+    if (dim == 4) {
+        const __m128 vU = _mm_set1_ps(u);
+        __m128 v = _mm_mul_ps(_mm_set1_ps(3), _mm_loadu_ps(m+12));
+        v = _mm_add_ps(_mm_mul_ps(v, vU), _mm_mul_ps(_mm_set1_ps(2), _mm_loadu_ps(m+8)));
+        v = _mm_add_ps(_mm_mul_ps(v, vU), _mm_loadu_ps(m+4));
+        _mm_storeu_ps(out, v);
+        return;
+    }
+#endif
+    for(c=0; c<dim; c += 1) {
+        out[c] = (3*m[3*dim+c]*u + 2*m[2*dim+c])*u + m[1*dim+c];
+    }
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline__evaldd_segment(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 u, cds_spline_r32 *out) {
+    cds_spline_s32 c;
+#if defined(CDS_SPLINE__SIMD_SSE)
+    if (dim == 4) {
+        __m128 v = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(6), _mm_loadu_ps(m+12)), _mm_set1_ps(u));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(2), _mm_loadu_ps(m+8)));
+        _mm_storeu_ps(out, v);
+        return;
+    }
+#endif
+    for(c=0; c<dim; c += 1) {
+        out[c] = 6*m[3*dim+c]*u + 2*m[2*dim+c];
+    }
+}
+
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline__segment_speed(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 u) {
+    cds_spline_r32 dpos[4], lengthSq = 0;
+    cds_spline_s32 c;
+    cds_spline__evald_segment(dim, m, u, dpos);
+    for(c=0; c<dim; c += 1) {
+        lengthSq += dpos[c]*dpos[c];
+    }
+    return (cds_spline_r32)sqrt(lengthSq);
+}
+
+/* Arc length of a segment from 0 to u, using 5-point Gauss-Legendre quadrature over [0..u] */
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline__segment_length(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 u) {
+    static const cds_spline_r32 nodes[5] = {
+        -0.9061798459386640f, -0.5384693101056831f, 0.0f, 0.5384693101056831f, 0.9061798459386640f,
+    };
+    static const cds_spline_r32 weights[5] = {
+        0.2369268850561891f, 0.4786286704993665f, 0.5688888888888889f, 0.4786286704993665f, 0.2369268850561891f,
+    };
+    cds_spline_r32 halfU = 0.5f*u, sum = 0;
+    cds_spline_s32 i;
+    for(i=0; i<5; i += 1) {
+        sum += weights[i] * cds_spline__segment_speed(dim, m, halfU*(nodes[i] + 1.0f));
+    }
+    return sum * halfU;
+}
+
+/* With kCdsSplineFlagBlockedSegments, each segment matrix is padded to the next power of two no
+ * larger than a cache line (16/32/64/64 bytes for 1D-4D) and the array starts on a cache line
+ * boundary, so no matrix straddles two lines. Four consecutive 3D segments are then a fixed 64
+ * bytes apart, which lets the batch kernels load and transpose them as a group. */
+#define CDS_SPLINE__CACHE_LINE_SIZE 64
+
+/* Empty dirty ranges are [EMPTY_RANGE_FIRST..-1], so that MIN/MAX merges need no special case. */
+#define CDS_SPLINE__EMPTY_RANGE_FIRST 0x7FFFFFFF
+
+static CDS_SPLINE_INLINE size_t
+cds_spline__segment_stride(size_t matrixSize, cds_spline_u32 flags) {
+    size_t stride = 16;
+    if (!(flags & kCdsSplineFlagBlockedSegments))
+        return matrixSize;
+    while(stride < matrixSize)
+        stride *= 2;
+    CDS_SPLINE_ASSERT(stride <= CDS_SPLINE__CACHE_LINE_SIZE);
+    return stride;
+}
+
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline__bounds_leaf_count(cds_spline_s32 maxKnotCount) {
+    cds_spline_s32 leafCount = 1;
+    while(leafCount < maxKnotCount-1)
+        leafCount *= 2;
+    return leafCount;
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline__clear_bounds(cds_spline_s32 dim, cds_spline_r32 *outMin, cds_spline_r32 *outMax) {
+    cds_spline_s32 c;
+    for(c=0; c<dim; c += 1) {
+        outMin[c] =  3.0e38f;
+        outMax[c] = -3.0e38f;
+    }
+}
+
+/* Exact bounds of a segment: the extremes of each component are at u=0, u=1, or at a root of
+ * that component's derivative b + 2c*u + 3d*u^2 inside [0..1]. */
+static CDS_SPLINE_INLINE void
+cds_spline__compute_segment_bounds(cds_spline_s32 dim, const cds_spline_r32 *m, cds_spline_r32 *outMin, cds_spline_r32 *outMax) {
+    cds_spline_s32 iComp, iRoot, numRoots;
+    for(iComp=0; iComp<dim; iComp += 1) {
+        const cds_spline_r32 a = m[0*dim+iComp], b = m[1*dim+iComp];
+        const cds_spline_r32 c = m[2*dim+iComp], d = m[3*dim+iComp];
+        const cds_spline_r32 qa = 3*d, qb = 2*c, qc = b;
+        cds_spline_r32 roots[2], lo = a, hi = a + b + c + d;
+        if (lo > hi) {
+            cds_spline_r32 tmp = lo;
+            lo = hi;
+            hi = tmp;
+        }
+        numRoots = 0;
+        if (fabs(qa) < 1e-12f) {
+            if (fabs(qb) >= 1e-12f)
+                roots[numRoots++] = -qc / qb;
+        } else {
+            cds_spline_r32 disc = qb*qb - 4*qa*qc;
+            if (disc >= 0) {
+                cds_spline_r32 sq = (cds_spline_r32)sqrt(disc);
+                roots[numRoots++] = (-qb + sq) / (2*qa);
+                roots[numRoots++] = (-qb - sq) / (2*qa);
+            }
+        }
+        for(iRoot=0; iRoot<numRoots; iRoot += 1) {
+            cds_spline_r32 u = roots[iRoot];
+            if (u > 0 && u < 1) {
+                cds_spline_r32 v = ((d*u + c)*u + b)*u + a;
+                lo = CDS_SPLINE_MIN(lo, v);
+                hi = CDS_SPLINE_MAX(hi, v);
+            }
+        }
+        outMin[iComp] = lo;
+        outMax[iComp] = hi;
+    }
+}
+
+/* The flags a blob keeps: which arrays it has, and how the segment matrices are laid out */
+#define CDS_SPLINE__BLOB_FLAGS (kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes | \
+    kCdsSplineFlagBlockedSegments | kCdsSplineFlagKnotTimes)
+
+static void
+cds_spline__copy_bytes(void *dst, const void *src, size_t size) {
+    cds_spline_u8 *d = (cds_spline_u8*)dst;
+    const cds_spline_u8 *s = (const cds_spline_u8*)src;
+    size_t i;
+    for(i=0; i<size; i += 1) {
+        d[i] = s[i];
+    }
+}
+
+static void
+cds_spline__zero_bytes(void *dst, size_t size) {
+    cds_spline_u8 *d = (cds_spline_u8*)dst;
+    size_t i;
+    for(i=0; i<size; i += 1) {
+        d[i] = 0;
+    }
+}
+
+/* Sets a blob header's array offsets from its counts and flags, and returns the blob size they
+ * add up to (which the caller stores in blobSize, or checks against it). Writing and binding
+ * both lay blobs out with this, so a blob only binds if its offsets are exactly these. */
+static cds_spline_u64
+cds_spline__blob_layout(cds_spline_blob_header *header, size_t knotSize, size_t aabbSize) {
+    const cds_spline_u64 numKnots = (cds_spline_u64)header->numKnots, numSegments = (cds_spline_u64)header->numSegments;
+    cds_spline_u64 offset = CDS_SPLINE_ALIGN_TO((cds_spline_u64)sizeof(cds_spline_blob_header), CDS_SPLINE_BLOB_ALIGNMENT);
+    header->segmentMatricesOffset = (cds_spline_u32)offset;
+    offset = CDS_SPLINE_ALIGN_TO(offset + numSegments*(cds_spline_u64)header->segmentStride, CDS_SPLINE_BLOB_ALIGNMENT);
+    header->knotsOffset = (cds_spline_u32)offset;
+    offset = CDS_SPLINE_ALIGN_TO(offset + numKnots*knotSize, CDS_SPLINE_BLOB_ALIGNMENT);
+    header->segmentLengthsOffset = header->arcLengthsOffset = 0;
+    if (header->flags & kCdsSplineFlagArcLengthTable) {
+        header->segmentLengthsOffset = (cds_spline_u32)offset;
+        offset = CDS_SPLINE_ALIGN_TO(offset + numSegments*sizeof(cds_spline_r32), CDS_SPLINE_BLOB_ALIGNMENT);
+        header->arcLengthsOffset = (cds_spline_u32)offset;
+        offset = CDS_SPLINE_ALIGN_TO(offset + (numSegments+1)*sizeof(cds_spline_r32), CDS_SPLINE_BLOB_ALIGNMENT);
+    }
+    header->segmentBoundsOffset = 0;
+    if (header->flags & kCdsSplineFlagBoundingVolumes) {
+        header->segmentBoundsOffset = (cds_spline_u32)offset;
+        offset = CDS_SPLINE_ALIGN_TO(offset + 2*(cds_spline_u64)header->boundsLeafCount*aabbSize, CDS_SPLINE_BLOB_ALIGNMENT);
+    }
+    header->knotTimesOffset = 0;
+    if (header->flags & kCdsSplineFlagKnotTimes) {
+        header->knotTimesOffset = (cds_spline_u32)offset;
+        offset += numKnots*sizeof(cds_spline_r32);
+    }
+    header->blobSize = (cds_spline_u32)offset;
+    return offset;
+}
+
+/* Validates a blob for cds_splineN_bind_blob(); the sizes are those of the dimension's types. */
+static cds_spline_error_t
+cds_spline__check_blob(const void *blob, size_t blobSize, cds_spline_u32 dim, size_t knotSize, size_t matrixSize,
+    size_t aabbSize) {
+    const cds_spline_blob_header *header = (const cds_spline_blob_header*)blob;
+    const cds_spline_u32 magic = CDS_SPLINE_BLOB_MAGIC;
+    const cds_spline_u32 swappedMagic = (magic >> 24) | ((magic >> 8) & 0xFF00) | ((magic << 8) & 0xFF0000) | (magic << 24);
+    cds_spline_blob_header expected;
+    if (((intptr_t)blob & (CDS_SPLINE_BLOB_ALIGNMENT-1)) != 0)
+        return kCdsSplineErrorBindBlob_Alignment;
+    if (blobSize < sizeof(cds_spline_blob_header))
+        return kCdsSplineErrorBindBlob_BlobSize;
+    if (header->magic == swappedMagic)
+        return kCdsSplineErrorBindBlob_ByteOrder;
+    if (header->magic != magic)
+        return kCdsSplineErrorBindBlob_Magic;
+    if (header->version != CDS_SPLINE_BLOB_VERSION)
+        return kCdsSplineErrorBindBlob_Version;
+    if (header->dimension != dim)
+        return kCdsSplineErrorBindBlob_Dimension;
+    if (header->blobSize > blobSize)
+        return kCdsSplineErrorBindBlob_BlobSize;
+    /* everything else must be exactly what writing a valid spline with these counts gives */
+    if (header->interpStyle < kCdsSplineInterpStyleHermite || header->interpStyle > kCdsSplineInterpStyleCentripetalCatmullRom ||
+        (header->flags & ~(cds_spline_u32)CDS_SPLINE__BLOB_FLAGS) != 0 || header->numKnots < 0 ||
+        header->numSegments != cds_spline__segment_count((cds_spline_interp_style)header->interpStyle, header->numKnots) ||
+        header->segmentStride != (cds_spline_s32)cds_spline__segment_stride(matrixSize, header->flags))
+        return kCdsSplineErrorBindBlob_Header;
+    if (header->flags & kCdsSplineFlagBoundingVolumes) {
+        const cds_spline_s32 leafCount = header->boundsLeafCount;
+        if (leafCount < 1 || (leafCount & (leafCount-1)) != 0 || leafCount < header->numSegments)
+            return kCdsSplineErrorBindBlob_Header;
+    } else if (header->boundsLeafCount != 0) {
+        return kCdsSplineErrorBindBlob_Header;
+    }
+    expected = *header;
+    if (cds_spline__blob_layout(&expected, knotSize, aabbSize) != header->blobSize ||
+        expected.segmentMatricesOffset != header->segmentMatricesOffset || expected.knotsOffset != header->knotsOffset ||
+        expected.segmentLengthsOffset != header->segmentLengthsOffset || expected.arcLengthsOffset != header->arcLengthsOffset ||
+        expected.segmentBoundsOffset != header->segmentBoundsOffset || expected.knotTimesOffset != header->knotTimesOffset)
+        return kCdsSplineErrorBindBlob_Header;
+    return kCdsSplineErrorNone;
+}
+
+/* Per-dimension implementation; see CDS_SPLINE__DECLARE() for the API it provides. */
+#define CDS_SPLINE__DEFINE(N)                                                                                           \
+/* Segment matrices are addressed through the stride so that the blocked layout                                         \
+ * (kCdsSplineFlagBlockedSegments) is transparent to everything else. */                                                \
+static CDS_SPLINE_INLINE cds_spline_mat##N##4 *                                                                         \
+cds_spline##N##__segment(const cds_spline##N *spline, cds_spline_s32 segmentIndex) {                                    \
+    return (cds_spline_mat##N##4*)((cds_spline_u8*)spline->segmentMatrices + segmentIndex*spline->segmentStride);       \
+}                                                                                                                       \
+                                                                                                                        \
+static CDS_SPLINE_INLINE cds_spline_vec##N                                                                              \
+cds_spline##N##__eval_segment(const cds_spline_mat##N##4 *m, cds_spline_r32 u) {                                        \
+    cds_spline_vec##N pos;                                                                                              \
+    cds_spline__eval_segment(N, m->elems, u, pos.elems);                                                                \
+    return pos;                                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+static CDS_SPLINE_INLINE cds_spline_vec##N                                                                              \
+cds_spline##N##__evald_segment(const cds_spline_mat##N##4 *m, cds_spline_r32 u) {                                       \
+    cds_spline_vec##N dpos;                                                                                             \
+    cds_spline__evald_segment(N, m->elems, u, dpos.elems);                                                              \
+    return dpos;                                                                                                        \
+}                                                                                                                       \
+                                                                                                                        \
+static CDS_SPLINE_INLINE cds_spline_vec##N                                                                              \
+cds_spline##N##__evaldd_segment(const cds_spline_mat##N##4 *m, cds_spline_r32 u) {                                      \
+    cds_spline_vec##N ddpos;                                                                                            \
+    cds_spline__evaldd_segment(N, m->elems, u, ddpos.elems);                                                            \
+    return ddpos;                                                                                                       \
+}                                                                                                                       \
+                                                                                                                        \
+static CDS_SPLINE_INLINE cds_spline_r32                                                                                 \
+cds_spline##N##__segment_length(const cds_spline_mat##N##4 *m, cds_spline_r32 u) {                                      \
+    return cds_spline__segment_length(N, m->elems, u);                                                                  \
+}                                                                                                                       \
+                                                                                                                        \
+/* Rebuilds the cumulative arc length table from firstSegment onwards. Only the prefix sums are                         \
+ * redone here; segment lengths are kept current by __compute_segment_matrix(). */                                      \
+static void                                                                                                             \
+cds_spline##N##__update_arc_lengths(cds_spline##N *outSpline, cds_spline_s32 firstSegment) {                            \
+    cds_spline_s32 iSeg;                                                                                                \
+    if (outSpline->arcLengths == NULL)                                                                                  \
+        return;                                                                                                         \
+    firstSegment = CDS_SPLINE_MAX(firstSegment, 0);                                                                     \
+    outSpline->arcLengths[0] = 0;                                                                                       \
+    for(iSeg=firstSegment; iSeg<outSpline->numSegments; iSeg += 1) {                                                    \
+        outSpline->arcLengths[iSeg+1] = outSpline->arcLengths[iSeg] + outSpline->segmentLengths[iSeg];                  \
+    }                                                                                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Clears leaves for unused segments in [firstSegment..lastSegment], then refits every ancestor of                      \
+ * that range, level by level. Leaves of live segments are kept current by                                              \
+ * __compute_segment_matrix(). */                                                                                       \
+static void                                                                                                             \
+cds_spline##N##__update_bounds(cds_spline##N *outSpline, cds_spline_s32 firstSegment, cds_spline_s32 lastSegment) {     \
+    cds_spline_aabb##N *nodes = outSpline->segmentBounds;                                                               \
+    cds_spline_s32 iSeg, iNode, iComp, lo, hi;                                                                          \
+    if (nodes == NULL)                                                                                                  \
+        return;                                                                                                         \
+    firstSegment = CDS_SPLINE_MAX(firstSegment, 0);                                                                     \
+    lastSegment = CDS_SPLINE_MIN(lastSegment, outSpline->boundsLeafCount-1);                                            \
+    if (firstSegment > lastSegment)                                                                                     \
+        return;                                                                                                         \
+    for(iSeg=CDS_SPLINE_MAX(firstSegment, outSpline->numSegments); iSeg<=lastSegment; iSeg += 1) {                      \
+        cds_spline__clear_bounds(N, nodes[outSpline->boundsLeafCount + iSeg].min.elems,                                 \
+            nodes[outSpline->boundsLeafCount + iSeg].max.elems);                                                        \
+    }                                                                                                                   \
+    lo = (outSpline->boundsLeafCount + firstSegment) / 2;                                                               \
+    hi = (outSpline->boundsLeafCount + lastSegment) / 2;                                                                \
+    for(; lo >= 1; lo /= 2, hi /= 2) {                                                                                  \
+        for(iNode=lo; iNode<=hi; iNode += 1) {                                                                          \
+            const cds_spline_aabb##N *left = nodes + 2*iNode, *right = nodes + 2*iNode + 1;                             \
+            for(iComp=0; iComp<N; iComp += 1) {                                                                         \
+                nodes[iNode].min.elems[iComp] = CDS_SPLINE_MIN(left->min.elems[iComp], right->min.elems[iComp]);        \
+                nodes[iNode].max.elems[iComp] = CDS_SPLINE_MAX(left->max.elems[iComp], right->max.elems[iComp]);        \
+            }                                                                                                           \
+        }                                                                                                               \
+    }                                                                                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Updates any per-segment derived data after a segment's matrix was recomputed */                                      \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__segment_matrix_changed(cds_spline##N *outSpline, cds_spline_s32 segmentIndex) {                        \
+    const cds_spline_mat##N##4 *m = cds_spline##N##__segment(outSpline, segmentIndex);                                  \
+    if (outSpline->segmentLengths != NULL) {                                                                            \
+        outSpline->segmentLengths[segmentIndex] = cds_spline##N##__segment_length(m, 1.0f);                             \
+    }                                                                                                                   \
+    if (outSpline->segmentBounds != NULL) {                                                                             \
+        cds_spline_aabb##N *leaf = outSpline->segmentBounds + outSpline->boundsLeafCount + segmentIndex;                \
+        cds_spline__compute_segment_bounds(N, m->elems, leaf->min.elems, leaf->max.elems);                              \
+    }                                                                                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Recomputes a segment's matrix and any per-segment derived data. interpStyle is passed in                             \
+ * (rather than read from outSpline) so that callers looping over many segments can hoist the                           \
+ * style switch out of the loop; see __recompute_segments(). */                                                         \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__compute_segment_matrix(cds_spline##N *outSpline, cds_spline_s32 segmentIndex,                          \
+    cds_spline_interp_style interpStyle) {                                                                              \
+    cds_spline_mat##N##4 *m = cds_spline##N##__segment(outSpline, segmentIndex);                                        \
+    cds_spline__compute_segment_matrix(N, interpStyle, outSpline->tension,                                              \
+        (const cds_spline_r32*)(outSpline->knots + segmentIndex), m->elems);                                            \
+    cds_spline##N##__segment_matrix_changed(outSpline, segmentIndex);                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Centripetal Catmull-Rom segments [firstSegment..lastSegment]. Consecutive segments share two                         \
+ * of their three knot pairs, so each pair's chord parameter is computed once per pass. */                              \
+static void                                                                                                             \
+cds_spline##N##__compute_centripetal_segments(cds_spline##N *outSpline, cds_spline_s32 firstSegment,                    \
+    cds_spline_s32 lastSegment) {                                                                                       \
+    const cds_spline_r32 *knots = (const cds_spline_r32*)outSpline->knots;                                              \
+    const cds_spline_r32 alpha = outSpline->tension;                                                                    \
+    cds_spline_r32 chords[3];                                                                                           \
+    cds_spline_s32 iSeg;                                                                                                \
+    chords[1] = cds_spline__chord_param(N, knots + (firstSegment+0)*2*N, knots + (firstSegment+1)*2*N, alpha);          \
+    chords[2] = cds_spline__chord_param(N, knots + (firstSegment+1)*2*N, knots + (firstSegment+2)*2*N, alpha);          \
+    for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1) {                                                              \
+        chords[0] = chords[1];                                                                                          \
+        chords[1] = chords[2];                                                                                          \
+        chords[2] = cds_spline__chord_param(N, knots + (iSeg+2)*2*N, knots + (iSeg+3)*2*N, alpha);                      \
+        cds_spline__compute_centripetal_matrix(N, knots + iSeg*2*N, chords,                                             \
+            cds_spline##N##__segment(outSpline, iSeg)->elems);                                                          \
+        cds_spline##N##__segment_matrix_changed(outSpline, iSeg);                                                       \
+    }                                                                                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Recomputes segments [firstSegment..lastSegment], clamped to the live segments. */                                    \
+static void                                                                                                             \
+cds_spline##N##__recompute_segments(cds_spline##N *outSpline, cds_spline_s32 firstSegment, cds_spline_s32 lastSegment) { \
+    cds_spline_s32 iSeg;                                                                                                \
+    firstSegment = CDS_SPLINE_MAX(firstSegment, 0);                                                                     \
+    lastSegment = CDS_SPLINE_MIN(lastSegment, outSpline->numSegments-1);                                                \
+    if (firstSegment > lastSegment)                                                                                     \
+        return;                                                                                                         \
+    CDS_SPLINE__BEGIN_RECOMPUTE(N, outSpline->interpStyle, lastSegment-firstSegment+1);                                 \
+    switch(outSpline->interpStyle) {                                                                                    \
+    case kCdsSplineInterpStyleHermite:                                                                                  \
+        for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1)                                                            \
+            cds_spline##N##__compute_segment_matrix(outSpline, iSeg, kCdsSplineInterpStyleHermite);                     \
+        break;                                                                                                          \
+    case kCdsSplineInterpStyleBezier:                                                                                   \
+        for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1)                                                            \
+            cds_spline##N##__compute_segment_matrix(outSpline, iSeg, kCdsSplineInterpStyleBezier);                      \
+        break;                                                                                                          \
+    case kCdsSplineInterpStyleCardinal:                                                                                 \
+        for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1)                                                            \
+            cds_spline##N##__compute_segment_matrix(outSpline, iSeg, kCdsSplineInterpStyleCardinal);                    \
+        break;                                                                                                          \
+    case kCdsSplineInterpStyleCentripetalCatmullRom:                                                                    \
+        cds_spline##N##__compute_centripetal_segments(outSpline, firstSegment, lastSegment);                            \
+        break;                                                                                                          \
+    }                                                                                                                   \
+    CDS_SPLINE__END_RECOMPUTE(N, outSpline->interpStyle, lastSegment-firstSegment+1);                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Copies a segment's matrix and any per-segment derived data to another slot */                                        \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__move_segment(cds_spline##N *outSpline, cds_spline_s32 dstSegment, cds_spline_s32 srcSegment) {         \
+    *cds_spline##N##__segment(outSpline, dstSegment) = *cds_spline##N##__segment(outSpline, srcSegment);                \
+    if (outSpline->segmentLengths != NULL)                                                                              \
+        outSpline->segmentLengths[dstSegment] = outSpline->segmentLengths[srcSegment];                                  \
+    if (outSpline->segmentBounds != NULL) {                                                                             \
+        outSpline->segmentBounds[outSpline->boundsLeafCount + dstSegment] =                                             \
+            outSpline->segmentBounds[outSpline->boundsLeafCount + srcSegment];                                          \
+    }                                                                                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+/* Updates the aggregate per-spline tables after the segments in [firstSegment..lastSegment] were                       \
+ * recomputed, moved, or removed. */                                                                                    \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__segments_changed(cds_spline##N *outSpline, cds_spline_s32 firstSegment, cds_spline_s32 lastSegment) {  \
+    cds_spline##N##__update_arc_lengths(outSpline, firstSegment);                                                       \
+    cds_spline##N##__update_bounds(outSpline, firstSegment, lastSegment);                                               \
+}                                                                                                                       \
+                                                                                                                        \
+/* Records that segments [firstSegment..lastSegment] need new matrices and that the tables over                         \
+ * [firstSegment..lastChanged] need refreshing. Unless updates are deferred (by                                         \
+ * kCdsSplineFlagDeferredUpdates or an open edit batch) the work is done immediately. Both ranges                       \
+ * are kept as single conservative intervals, so a flush is always one pass over each. */                               \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__invalidate(cds_spline##N *outSpline, cds_spline_s32 firstSegment, cds_spline_s32 lastSegment,          \
+    cds_spline_s32 lastChanged) {                                                                                       \
+    outSpline->dirtyFirst = CDS_SPLINE_MIN(outSpline->dirtyFirst, firstSegment);                                        \
+    outSpline->dirtyLast = CDS_SPLINE_MAX(outSpline->dirtyLast, lastSegment);                                           \
+    outSpline->changedFirst = CDS_SPLINE_MIN(outSpline->changedFirst, firstSegment);                                    \
+    outSpline->changedLast = CDS_SPLINE_MAX(outSpline->changedLast, lastChanged);                                       \
+    if (!(outSpline->flags & kCdsSplineFlagDeferredUpdates) && outSpline->editBatchDepth == 0)                          \
+        cds_spline##N##_flush(outSpline);                                                                               \
+}                                                                                                                       \
+                                                                                                                        \
+/* Keeps the dirty range attached to the same matrices when segments at or after pivot move by                          \
+ * delta slots. Only the matrix range needs this: every edit that moves segments also marks the                         \
+ * tables changed through the end of the spline. */                                                                     \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__shift_dirty_range(cds_spline##N *outSpline, cds_spline_s32 pivot, cds_spline_s32 delta) {              \
+    if (outSpline->dirtyFirst > outSpline->dirtyLast)                                                                   \
+        return;                                                                                                         \
+    if (outSpline->dirtyFirst >= pivot)                                                                                 \
+        outSpline->dirtyFirst += delta;                                                                                 \
+    if (outSpline->dirtyLast >= pivot)                                                                                  \
+        outSpline->dirtyLast += delta;                                                                                  \
+}                                                                                                                       \
+                                                                                                                        \
+/* Widens the range of knots (and knot times) written by edits. Knots that an edit shifts count as                      \
+ * written, and so does every knot when the tension changes. */                                                         \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__times_written(cds_spline##N *outSpline, cds_spline_s32 firstKnot, cds_spline_s32 lastKnot) {           \
+    outSpline->writtenFirst = CDS_SPLINE_MIN(outSpline->writtenFirst, firstKnot);                                       \
+    outSpline->writtenLast = CDS_SPLINE_MAX(outSpline->writtenLast, lastKnot);                                          \
+}                                                                                                                       \
+                                                                                                                        \
+/* As __times_written(), for edits that move the curve; these also bump editCount. Every such edit                      \
+ * comes through here once it has been applied (never for a rejected call). Knot times alone leave                      \
+ * the curve unchanged at every t, so they do not count. */                                                             \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__knots_written(cds_spline##N *outSpline, cds_spline_s32 firstKnot, cds_spline_s32 lastKnot) {           \
+    cds_spline##N##__times_written(outSpline, firstKnot, lastKnot);                                                     \
+    outSpline->editCount += 1;                                                                                          \
+}                                                                                                                       \
+                                                                                                                        \
+/* Queries take a const spline, but with deferred updates they must apply pending edits first.                          \
+ * Splines live in caller-owned mutable buffers, so the cast is safe; it does mean that a spline                        \
+ * with pending edits must not be queried from several threads at once. */                                              \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__flush_pending(const cds_spline##N *spline) {                                                           \
+    if (spline->changedFirst <= spline->changedLast)                                                                    \
+        cds_spline##N##_flush((cds_spline##N*)spline);                                                                  \
+}                                                                                                                       \
+                                                                                                                        \
+size_t                                                                                                                  \
+cds_spline##N##_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount) {                         \
+    return cds_spline##N##_buffer_size_ex(interpStyle, maxKnotCount, kCdsSplineFlagNone);                               \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_init(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,        \
+    void *buffer, size_t bufferSize) {                                                                                  \
+    return cds_spline##N##_init_ex(outSpline, interpStyle, maxKnotCount, kCdsSplineFlagNone, buffer, bufferSize);       \
+}                                                                                                                       \
+                                                                                                                        \
+size_t                                                                                                                  \
+cds_spline##N##_buffer_size_ex(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, cds_spline_u32 flags) { \
+    size_t size;                                                                                                        \
+    cds_spline_s32 maxSegmentCount;                                                                                     \
+    if (maxKnotCount <= 0)                                                                                              \
+        return 0;                                                                                                       \
+    /* one matrix per segment the spline can have: cardinal and Catmull-Rom splines need two                            \
+     * fewer than Hermite and Bezier splines */                                                                         \
+    maxSegmentCount = cds_spline__segment_count(interpStyle, maxKnotCount);                                             \
+    size = maxKnotCount*sizeof(cds_spline_knot##N) + maxSegmentCount*cds_spline__segment_stride(sizeof(cds_spline_mat##N##4), flags); \
+    if (flags & kCdsSplineFlagBlockedSegments)                                                                          \
+        size += CDS_SPLINE__CACHE_LINE_SIZE-1; /* slack to align the segment array */                                   \
+    if (flags & kCdsSplineFlagArcLengthTable)                                                                           \
+        size += maxSegmentCount*sizeof(cds_spline_r32) + (maxSegmentCount+1)*sizeof(cds_spline_r32);                    \
+    if (flags & kCdsSplineFlagBoundingVolumes)                                                                          \
+        size += 2*cds_spline__bounds_leaf_count(maxKnotCount)*sizeof(cds_spline_aabb##N);                               \
+    if (flags & kCdsSplineFlagKnotTimes)                                                                                \
+        size += maxKnotCount*sizeof(cds_spline_r32);                                                                    \
+    return size;                                                                                                        \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_init_ex(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,     \
+    cds_spline_u32 flags, void *buffer, size_t bufferSize) {                                                            \
+    size_t minBufferSize = cds_spline##N##_buffer_size_ex(interpStyle, maxKnotCount, flags);                            \
+    cds_spline_u8 *bufferNext = (cds_spline_u8*)buffer;                                                                 \
+    cds_spline_s32 maxSegmentCount = cds_spline__segment_count(interpStyle, maxKnotCount), iNode;                       \
+    if (bufferSize < minBufferSize)                                                                                     \
+        return kCdsSplineErrorInit_BufferSize;                                                                          \
+                                                                                                                        \
+    outSpline->segmentStride = (cds_spline_s32)cds_spline__segment_stride(sizeof(cds_spline_mat##N##4), flags);         \
+    if (flags & kCdsSplineFlagBlockedSegments) {                                                                        \
+        cds_spline_u8 *aligned = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)bufferNext, CDS_SPLINE__CACHE_LINE_SIZE); \
+        minBufferSize -= CDS_SPLINE__CACHE_LINE_SIZE-1 - (aligned - bufferNext);                                        \
+        bufferNext = aligned;                                                                                           \
+    }                                                                                                                   \
+    outSpline->segmentMatrices = (cds_spline_mat##N##4*)bufferNext;                                                     \
+    bufferNext += maxSegmentCount*outSpline->segmentStride;                                                             \
+    outSpline->knots = (cds_spline_knot##N*)bufferNext;                                                                 \
+    bufferNext += maxKnotCount*sizeof(cds_spline_knot##N);                                                              \
+    outSpline->segmentLengths = NULL;                                                                                   \
+    outSpline->arcLengths = NULL;                                                                                       \
+    if (flags & kCdsSplineFlagArcLengthTable) {                                                                         \
+        outSpline->segmentLengths = (cds_spline_r32*)bufferNext;                                                        \
+        bufferNext += maxSegmentCount*sizeof(cds_spline_r32);                                                           \
+        outSpline->arcLengths = (cds_spline_r32*)bufferNext;                                                            \
+        bufferNext += (maxSegmentCount+1)*sizeof(cds_spline_r32);                                                       \
+        outSpline->arcLengths[0] = 0;                                                                                   \
+    }                                                                                                                   \
+    outSpline->segmentBounds = NULL;                                                                                    \
+    outSpline->boundsLeafCount = 0;                                                                                     \
+    if (flags & kCdsSplineFlagBoundingVolumes) {                                                                        \
+        outSpline->segmentBounds = (cds_spline_aabb##N*)bufferNext;                                                     \
+        outSpline->boundsLeafCount = cds_spline__bounds_leaf_count(maxKnotCount);                                       \
+        bufferNext += 2*outSpline->boundsLeafCount*sizeof(cds_spline_aabb##N);                                          \
+        for(iNode=0; iNode<2*outSpline->boundsLeafCount; iNode += 1) {                                                  \
+            cds_spline__clear_bounds(N, outSpline->segmentBounds[iNode].min.elems, outSpline->segmentBounds[iNode].max.elems); \
+        }                                                                                                               \
+    }                                                                                                                   \
+    outSpline->knotTimes = NULL;                                                                                        \
+    if (flags & kCdsSplineFlagKnotTimes) {                                                                              \
+        outSpline->knotTimes = (cds_spline_r32*)bufferNext;                                                             \
+        bufferNext += maxKnotCount*sizeof(cds_spline_r32);                                                              \
+    }                                                                                                                   \
+    CDS_SPLINE_ASSERT( (intptr_t)bufferNext - (intptr_t)buffer == (intptr_t)minBufferSize );                            \
+                                                                                                                        \
+    outSpline->interpStyle = interpStyle;                                                                               \
+    outSpline->tension = 0.5;                                                                                           \
+    outSpline->numKnots = 0;                                                                                            \
+    outSpline->maxNumKnots = maxKnotCount;                                                                              \
+    outSpline->numSegments = 0;                                                                                         \
+    outSpline->flags = flags;                                                                                           \
+    outSpline->dirtyFirst = outSpline->changedFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;                                    \
+    outSpline->dirtyLast = outSpline->changedLast = -1;                                                                 \
+    outSpline->editBatchDepth = 0;                                                                                      \
+    outSpline->writtenFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;                                                            \
+    outSpline->writtenLast = -1;                                                                                        \
+    outSpline->editCount = 0;                                                                                           \
+                                                                                                                        \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_init_from_knots(cds_spline##N *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, \
+    cds_spline_u32 flags, const cds_spline_knot##N *knots, cds_spline_s32 knotCount, void *buffer, size_t bufferSize) { \
+    cds_spline_error_t error = cds_spline##N##_init_ex(outSpline, interpStyle, maxKnotCount, flags, buffer, bufferSize); \
+    if (error != kCdsSplineErrorNone)                                                                                   \
+        return error;                                                                                                   \
+    return cds_spline##N##_append_knots(outSpline, knots, knotCount);                                                   \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_set_tension(cds_spline##N *outSpline, cds_spline_r32 tension) {                                         \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorSetTension_ReadOnly;                                                                      \
+    if (outSpline->tension != tension) {                                                                                \
+        outSpline->tension = tension;                                                                                   \
+        cds_spline##N##__knots_written(outSpline, 0, outSpline->numKnots-1);                                            \
+        cds_spline##N##__invalidate(outSpline, 0, outSpline->numSegments-1, outSpline->numSegments-1);                  \
+    }                                                                                                                   \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_insert_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex, cds_spline_knot##N knot) {              \
+    cds_spline_s32 iKnot, iSeg, firstSegment, lastSegment;                                                              \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorInsertKnot_ReadOnly;                                                                      \
+    if (outSpline->numKnots == outSpline->maxNumKnots)                                                                  \
+        return kCdsSplineErrorInsertKnot_MaxNumKnots;                                                                   \
+    if (knotIndex < 0 || knotIndex > outSpline->numKnots)                                                               \
+        return kCdsSplineErrorInsertKnot_KnotIndex;                                                                     \
+    CDS_SPLINE__STAT_ADD(knotShifts, outSpline->numKnots - knotIndex);                                                  \
+    CDS_SPLINE__STAT_ADD(segmentShifts, CDS_SPLINE_MAX(outSpline->numSegments - knotIndex, 0));                         \
+    for(iKnot=outSpline->numKnots; iKnot>knotIndex; iKnot -= 1) {                                                       \
+        outSpline->knots[iKnot] = outSpline->knots[iKnot-1];                                                            \
+    }                                                                                                                   \
+    if (outSpline->knotTimes != NULL)                                                                                   \
+        cds_spline__insert_knot_time(outSpline->knotTimes, outSpline->numKnots, knotIndex);                             \
+    /* Segments starting at or after the new knot move up one slot; the ones whose control                              \
+     * points changed are recomputed below. */                                                                          \
+    for(iSeg=outSpline->numSegments-1; iSeg>=knotIndex; iSeg -= 1) {/* TODO: adjust copy bounds; we're overwriting some of these anyway. */ \
+        cds_spline##N##__move_segment(outSpline, iSeg+1, iSeg);                                                         \
+    }                                                                                                                   \
+    cds_spline##N##__shift_dirty_range(outSpline, knotIndex, 1);                                                        \
+    outSpline->numKnots += 1;                                                                                           \
+    outSpline->numSegments = cds_spline__segment_count(outSpline->interpStyle, outSpline->numKnots);                    \
+    outSpline->knots[knotIndex] = knot;                                                                                 \
+    cds_spline##N##__knots_written(outSpline, knotIndex, outSpline->numKnots-1);                                        \
+    cds_spline__knot_segment_range(outSpline->interpStyle, knotIndex, &firstSegment, &lastSegment);                     \
+    cds_spline##N##__invalidate(outSpline, firstSegment, lastSegment, outSpline->numSegments-1);                        \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+/* Appending never changes the control points of an existing segment, so only the new segments are                      \
+ * computed, each exactly once, in one style-specialized pass. */                                                       \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_append_knots(cds_spline##N *outSpline, const cds_spline_knot##N *knots, cds_spline_s32 knotCount) {     \
+    cds_spline_s32 iKnot, firstSegment;                                                                                 \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorAppendKnots_ReadOnly;                                                                     \
+    if (knotCount < 0)                                                                                                  \
+        return kCdsSplineErrorAppendKnots_KnotCount;                                                                    \
+    if (knotCount > outSpline->maxNumKnots - outSpline->numKnots)                                                       \
+        return kCdsSplineErrorAppendKnots_MaxNumKnots;                                                                  \
+    for(iKnot=0; iKnot<knotCount; iKnot += 1) {                                                                         \
+        outSpline->knots[outSpline->numKnots + iKnot] = knots[iKnot];                                                   \
+        if (outSpline->knotTimes != NULL)                                                                               \
+            cds_spline__insert_knot_time(outSpline->knotTimes, outSpline->numKnots + iKnot, outSpline->numKnots + iKnot); \
+    }                                                                                                                   \
+    cds_spline##N##__knots_written(outSpline, outSpline->numKnots, outSpline->numKnots + knotCount-1);                  \
+    firstSegment = outSpline->numSegments;                                                                              \
+    outSpline->numKnots += knotCount;                                                                                   \
+    outSpline->numSegments = cds_spline__segment_count(outSpline->interpStyle, outSpline->numKnots);                    \
+    if (outSpline->numSegments > firstSegment) {                                                                        \
+        cds_spline##N##__invalidate(outSpline, firstSegment, outSpline->numSegments-1, outSpline->numSegments-1);       \
+    }                                                                                                                   \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_set_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex, cds_spline_knot##N knot) {                 \
+    cds_spline_s32 firstSegment, lastSegment;                                                                           \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorSetKnot_ReadOnly;                                                                         \
+    if (knotIndex < 0 || knotIndex >= outSpline->numKnots)                                                              \
+        return kCdsSplineErrorSetKnot_KnotIndex;                                                                        \
+    outSpline->knots[knotIndex] = knot;                                                                                 \
+    cds_spline##N##__knots_written(outSpline, knotIndex, knotIndex);                                                    \
+    cds_spline__knot_segment_range(outSpline->interpStyle, knotIndex, &firstSegment, &lastSegment);                     \
+    cds_spline##N##__invalidate(outSpline, firstSegment, lastSegment, lastSegment);                                     \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_remove_knot(cds_spline##N *outSpline, cds_spline_s32 knotIndex) {                                       \
+    cds_spline_s32 iKnot, iSeg, firstSegment, lastSegment, oldNumSegments;                                              \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorRemoveKnot_ReadOnly;                                                                      \
+    if (knotIndex < 0 || knotIndex >= outSpline->numKnots)                                                              \
+        return kCdsSplineErrorRemoveKnot_KnotIndex;                                                                     \
+    CDS_SPLINE__STAT_ADD(knotShifts, outSpline->numKnots-1 - knotIndex);                                                \
+    CDS_SPLINE__STAT_ADD(segmentShifts, CDS_SPLINE_MAX(outSpline->numSegments-1 - knotIndex, 0));                       \
+    for(iKnot=knotIndex; iKnot<outSpline->numKnots-1; iKnot += 1) {                                                     \
+        outSpline->knots[iKnot] = outSpline->knots[iKnot+1];                                                            \
+        if (outSpline->knotTimes != NULL)                                                                               \
+            outSpline->knotTimes[iKnot] = outSpline->knotTimes[iKnot+1];                                                \
+    }                                                                                                                   \
+    for(iSeg=knotIndex; iSeg<outSpline->numSegments-1; iSeg += 1) { /* TODO: adjust copy bounds; we're overwriting mat[ki+1] anyway */ \
+        cds_spline##N##__move_segment(outSpline, iSeg, iSeg+1);                                                         \
+    }                                                                                                                   \
+    cds_spline##N##__shift_dirty_range(outSpline, knotIndex+1, -1);                                                     \
+    cds_spline##N##__knots_written(outSpline, knotIndex, outSpline->numKnots-1);                                        \
+    oldNumSegments = outSpline->numSegments;                                                                            \
+    outSpline->numKnots -= 1;                                                                                           \
+    outSpline->numSegments = cds_spline__segment_count(outSpline->interpStyle, outSpline->numKnots);                    \
+    cds_spline__knot_segment_range(outSpline->interpStyle, knotIndex, &firstSegment, &lastSegment);                     \
+    /* include the segment slot that was just vacated */                                                                \
+    cds_spline##N##__invalidate(outSpline, firstSegment, lastSegment, oldNumSegments-1);                                \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+/* Knot times only reparameterize the curve, so no segment needs recomputing. */                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_set_knot_times(cds_spline##N *outSpline, cds_spline_s32 firstKnot, const cds_spline_r32 *times,         \
+    cds_spline_s32 timeCount) {                                                                                         \
+    cds_spline_error_t error;                                                                                           \
+    if (outSpline->knotTimes == NULL)                                                                                   \
+        return kCdsSplineErrorSetKnotTimes_Flags;                                                                       \
+    if (outSpline->flags & kCdsSplineFlagReadOnly)                                                                      \
+        return kCdsSplineErrorSetKnotTimes_ReadOnly;                                                                    \
+    if (firstKnot < 0 || timeCount < 0 || timeCount > outSpline->numKnots - firstKnot)                                  \
+        return kCdsSplineErrorSetKnotTimes_KnotRange;                                                                   \
+    error = cds_spline__set_knot_times(outSpline->knotTimes, outSpline->numKnots, firstKnot, times, timeCount);          \
+    /* only times actually written count; a rejected call leaves the spline untouched */                                \
+    if (error == kCdsSplineErrorNone && timeCount > 0)                                                                  \
+        cds_spline##N##__times_written(outSpline, firstKnot, firstKnot + timeCount-1);                                  \
+    return error;                                                                                                       \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_flush(cds_spline##N *outSpline) {                                                                       \
+    if (outSpline->changedFirst <= outSpline->changedLast) {                                                            \
+        cds_spline##N##__recompute_segments(outSpline, outSpline->dirtyFirst, outSpline->dirtyLast);                    \
+        cds_spline##N##__segments_changed(outSpline, outSpline->changedFirst, outSpline->changedLast);                  \
+        outSpline->dirtyFirst = outSpline->changedFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;                                \
+        outSpline->dirtyLast = outSpline->changedLast = -1;                                                             \
+    }                                                                                                                   \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_begin_edit(cds_spline##N *outSpline) {                                                                  \
+    outSpline->editBatchDepth += 1;                                                                                     \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_end_edit(cds_spline##N *outSpline) {                                                                    \
+    if (outSpline->editBatchDepth == 0)                                                                                 \
+        return kCdsSplineErrorEndEdit_NoBatch;                                                                          \
+    outSpline->editBatchDepth -= 1;                                                                                     \
+    if (outSpline->editBatchDepth == 0)                                                                                 \
+        cds_spline##N##_flush(outSpline);                                                                               \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_eval(const cds_spline##N *spline, cds_spline_r32 t) {                                                   \
+    cds_spline_s32 segment;                                                                                             \
+    cds_spline_r32 u;                                                                                                   \
+    CDS_SPLINE__STAT_ADD(evalCalls, 1);                                                                                 \
+    cds_spline##N##__flush_pending(spline);                                                                             \
+    cds_spline__get_int_and_frac(spline->numSegments, t, &segment, &u);                                                 \
+    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);                                                   \
+    return cds_spline##N##__eval_segment(cds_spline##N##__segment(spline, segment), u);                                 \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_evald(const cds_spline##N *spline, cds_spline_r32 t) {                                                  \
+    cds_spline_s32 segment;                                                                                             \
+    cds_spline_r32 u;                                                                                                   \
+    CDS_SPLINE__STAT_ADD(evaldCalls, 1);                                                                                \
+    cds_spline##N##__flush_pending(spline);                                                                             \
+    cds_spline__get_int_and_frac(spline->numSegments, t, &segment, &u);                                                 \
+    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);                                                   \
+    return cds_spline##N##__evald_segment(cds_spline##N##__segment(spline, segment), u);                                \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_evaldd(const cds_spline##N *spline, cds_spline_r32 t) {                                                 \
+    cds_spline_s32 segment;                                                                                             \
+    cds_spline_r32 u;                                                                                                   \
+    CDS_SPLINE__STAT_ADD(evalddCalls, 1);                                                                               \
+    cds_spline##N##__flush_pending(spline);                                                                             \
+    cds_spline__get_int_and_frac(spline->numSegments, t, &segment, &u);                                                 \
+    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);                                                   \
+    return cds_spline##N##__evaldd_segment(cds_spline##N##__segment(spline, segment), u);                               \
+}                                                                                                                       \
+                                                                                                                        \
+/* Finds the segment and u for a time, and the factor (dt/du)^-1 that converts u-derivatives to                         \
+ * time derivatives. Without knot times, time and t are the same thing. */                                              \
+static CDS_SPLINE_INLINE void                                                                                           \
+cds_spline##N##__locate_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time,               \
+    cds_spline_s32 *outSegment, cds_spline_r32 *outU, cds_spline_r32 *outInvDuration) {                                 \
+    cds_spline##N##__flush_pending(spline);                                                                             \
+    if (spline->knotTimes == NULL) {                                                                                    \
+        cds_spline__get_int_and_frac(spline->numSegments, time, outSegment, outU);                                      \
+        *outInvDuration = 1.0f;                                                                                         \
+        if (cursor != NULL)                                                                                             \
+            cursor->segment = *outSegment;                                                                              \
+    } else {                                                                                                            \
+        cds_spline__locate_time(spline->knotTimes + cds_spline__segment_knot_offset(spline->interpStyle),               \
+            spline->numSegments, cursor, time, outSegment, outU, outInvDuration);                                       \
+    }                                                                                                                   \
+    CDS_SPLINE_ASSERT(*outSegment >= 0 && *outSegment < spline->numSegments);                                           \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_r32                                                                                                          \
+cds_spline##N##_time_to_t(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {                \
+    cds_spline_s32 segment;                                                                                             \
+    cds_spline_r32 u, invDuration;                                                                                      \
+    cds_spline##N##__locate_time(spline, cursor, time, &segment, &u, &invDuration);                                     \
+    return (cds_spline_r32)segment + u;                                                                                 \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_eval_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {             \
+    cds_spline_s32 segment;                                                                                             \
+    cds_spline_r32 u, invDuration;                                                                                      \
+    CDS_SPLINE__STAT_ADD(evalCalls, 1);                                                                                 \
+    cds_spline##N##__locate_time(spline, cursor, time, &segment, &u, &invDuration);                                     \
+    return cds_spline##N##__eval_segment(cds_spline##N##__segment(spline, segment), u);                                 \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_evald_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {            \
+    cds_spline_s32 segment, iComp;                                                                                      \
+    cds_spline_r32 u, invDuration;                                                                                      \
+    cds_spline_vec##N dpos;                                                                                             \
+    CDS_SPLINE__STAT_ADD(evaldCalls, 1);                                                                                \
+    cds_spline##N##__locate_time(spline, cursor, time, &segment, &u, &invDuration);                                     \
+    dpos = cds_spline##N##__evald_segment(cds_spline##N##__segment(spline, segment), u);                                \
+    for(iComp=0; iComp<N; iComp += 1) {                                                                                 \
+        dpos.elems[iComp] *= invDuration;                                                                               \
+    }                                                                                                                   \
+    return dpos;                                                                                                        \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_vec##N                                                                                                       \
+cds_spline##N##_evaldd_at_time(const cds_spline##N *spline, cds_spline_cursor *cursor, cds_spline_r32 time) {           \
+    cds_spline_s32 segment, iComp;                                                                                      \
+    cds_spline_r32 u, invDuration;                                                                                      \
+    cds_spline_vec##N ddpos;                                                                                            \
+    CDS_SPLINE__STAT_ADD(evalddCalls, 1);                                                                               \
+    cds_spline##N##__locate_time(spline, cursor, time, &segment, &u, &invDuration);                                     \
+    ddpos = cds_spline##N##__evaldd_segment(cds_spline##N##__segment(spline, segment), u);                              \
+    for(iComp=0; iComp<N; iComp += 1) {                                                                                 \
+        ddpos.elems[iComp] *= invDuration*invDuration;                                                                  \
+    }                                                                                                                   \
+    return ddpos;                                                                                                       \
+}                                                                                                                       \
+                                                                                                                        \
+static void                                                                                                             \
+cds_spline##N##__blob_header(const cds_spline##N *spline, cds_spline_blob_header *outHeader) {                          \
+    outHeader->magic = CDS_SPLINE_BLOB_MAGIC;                                                                           \
+    outHeader->version = CDS_SPLINE_BLOB_VERSION;                                                                       \
+    outHeader->dimension = N;                                                                                           \
+    outHeader->interpStyle = (cds_spline_u32)spline->interpStyle;                                                       \
+    outHeader->flags = spline->flags & CDS_SPLINE__BLOB_FLAGS;                                                          \
+    outHeader->tension = spline->tension;                                                                               \
+    outHeader->numKnots = spline->numKnots;                                                                             \
+    outHeader->numSegments = spline->numSegments;                                                                       \
+    outHeader->segmentStride = spline->segmentStride;                                                                   \
+    outHeader->boundsLeafCount = spline->boundsLeafCount;                                                               \
+    cds_spline__blob_layout(outHeader, sizeof(cds_spline_knot##N), sizeof(cds_spline_aabb##N));                         \
+}                                                                                                                       \
+                                                                                                                        \
+size_t                                                                                                                  \
+cds_spline##N##_blob_size(const cds_spline##N *spline) {                                                                \
+    cds_spline_blob_header header;                                                                                      \
+    cds_spline##N##__blob_header(spline, &header);                                                                      \
+    return header.blobSize;                                                                                             \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_write_blob(const cds_spline##N *spline, void *buffer, size_t bufferSize) {                              \
+    cds_spline_u8 *blob = (cds_spline_u8*)buffer;                                                                       \
+    cds_spline_blob_header header;                                                                                      \
+    cds_spline##N##__flush_pending(spline);                                                                             \
+    cds_spline##N##__blob_header(spline, &header);                                                                      \
+    if (bufferSize < header.blobSize)                                                                                   \
+        return kCdsSplineErrorWriteBlob_BufferSize;                                                                     \
+    /* zero the padding too, so that equal splines give identical blobs */                                              \
+    cds_spline__zero_bytes(blob, header.blobSize);                                                                      \
+    cds_spline__copy_bytes(blob, &header, sizeof(header));                                                              \
+    cds_spline__copy_bytes(blob + header.segmentMatricesOffset, spline->segmentMatrices,                                \
+        (size_t)spline->numSegments * spline->segmentStride);                                                           \
+    cds_spline__copy_bytes(blob + header.knotsOffset, spline->knots, spline->numKnots * sizeof(cds_spline_knot##N));    \
+    if (header.segmentLengthsOffset != 0) {                                                                             \
+        cds_spline__copy_bytes(blob + header.segmentLengthsOffset, spline->segmentLengths,                              \
+            spline->numSegments * sizeof(cds_spline_r32));                                                              \
+        cds_spline__copy_bytes(blob + header.arcLengthsOffset, spline->arcLengths,                                      \
+            (spline->numSegments+1) * sizeof(cds_spline_r32));                                                          \
+    }                                                                                                                   \
+    if (header.segmentBoundsOffset != 0) {                                                                              \
+        cds_spline__copy_bytes(blob + header.segmentBoundsOffset, spline->segmentBounds,                                \
+            2*spline->boundsLeafCount * sizeof(cds_spline_aabb##N));                                                    \
+    }                                                                                                                   \
+    if (header.knotTimesOffset != 0)                                                                                    \
+        cds_spline__copy_bytes(blob + header.knotTimesOffset, spline->knotTimes, spline->numKnots * sizeof(cds_spline_r32)); \
+    return kCdsSplineErrorNone;                                                                                         \
+}                                                                                                                       \
+                                                                                                                        \
+cds_spline_error_t                                                                                                      \
+cds_spline##N##_bind_blob(cds_spline##N *outSpline, const void *blob, size_t blobSize) {                                \
+    const cds_spline_blob_header *header = (const cds_spline_blob_header*)blob;                                         \
+    /* the spline's pointers are not const, but it is read-only, so nothing writes through them */                      \
+    cds_spline_u8 *base = (cds_spline_u8*)blob;                                                                         \
+    cds_spline_error_t error = cds_spline__check_blob(blob, blobSize, N, sizeof(cds_spline_knot##N),                    \
+        sizeof(cds_spline_mat##N##4), sizeof(cds_spline_aabb##N));                                                      \
+    if (error != kCdsSplineErrorNone)                                                                                   \
+        return error;                                                                                                   \
+    outSpline->segmentMatrices = (cds_spline_mat##N##4*)(base + header->segmentMatricesOffset);                         \
+    outSpline->interpStyle = (cds_spline_interp_style)header->interpStyle;                                              \
+    outSpline->tension = header->tension;                                                                               \
+    outSpline->knots = (cds_spline_knot##N*)(base + header->knotsOffset);                                               \
+    outSpline->numKnots = header->numKnots;                                                                             \
+    outSpline->maxNumKnots = header->numKnots;                                                                          \
+    outSpline->numSegments = header->numSegments;                                                                       \
+    outSpline->flags = header->flags | kCdsSplineFlagReadOnly;                                                          \
+    outSpline->segmentLengths = NULL;                                                                                   \
+    outSpline->arcLengths = NULL;                                                                                       \
+    if (header->segmentLengthsOffset != 0) {                                                                            \
+        outSpline->segmentLengths = (cds_spline_r32*)(base + header->segmentLengthsOffset);                             \
+        outSpline->arcLengths = (cds_spline_r32*)(base + header->arcLengthsOffset);                                     \
+    }                                                                                                                   \
+    outSpline->segmentBounds = (header->segmentBoundsOffset != 0) ?                                                     \
+        (cds_spline_aabb##N*)(base + header->segmentBoundsOffset) : NULL;                                               \
+    outSpline->boundsLeafCount = header->boundsLeafCount;                                                               \
+    outSpline->segmentStride = header->segmentStride;                                                                   \
+    outSpline->knotTimes = (header->knotTimesOffset != 0) ? (cds_spline_r32*)(base + header->knotTimesOffset) : NULL;   \
+    outSpline->dirtyFirst = outSpline->changedFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;                                    \
+    outSpline->dirtyLast = outSpline->changedLast = -1;                                                                 \
+    outSpline->editBatchDepth = 0;                                                                                      \
+    outSpline->writtenFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;                                                            \
+    outSpline->writtenLast = -1;                                                                                        \
+    outSpline->editCount = 0;                                                                                           \
+    return kCdsSplineErrorNone;                                                                                         \
+}
+
+CDS_SPLINE__DEFINE(1)
+CDS_SPLINE__DEFINE(2)
+CDS_SPLINE__DEFINE(3)
+CDS_SPLINE__DEFINE(4)
+
+/* Writes the power-basis coefficients of the order'th derivative of a segment, lowest degree
+ * first, and returns the resulting polynomial degree. The rows are pre-scaled exactly as the
+ * scalar eval functions scale them, so Horner evaluation of the result matches them bit for bit.
+ */
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline3__derivative_coefs(const cds_spline_mat34 *m, cds_spline_s32 order, cds_spline_vec3 outCoefs[4]) {
+    cds_spline_s32 iComp;
+    switch(order) {
+    case 0:
+        outCoefs[0] = m->rows[0];
+        outCoefs[1] = m->rows[1];
+        outCoefs[2] = m->rows[2];
+        outCoefs[3] = m->rows[3];
+        return 3;
+    case 1:
+        for(iComp=0; iComp<3; iComp += 1) {
+            outCoefs[0].elems[iComp] =   m->rows[1].elems[iComp];
+            outCoefs[1].elems[iComp] = 2*m->rows[2].elems[iComp];
+            outCoefs[2].elems[iComp] = 3*m->rows[3].elems[iComp];
+        }
+        return 2;
+    default:
+        CDS_SPLINE_ASSERT(order == 2);
+        for(iComp=0; iComp<3; iComp += 1) {
+            outCoefs[0].elems[iComp] = 2*m->rows[2].elems[iComp];
+            outCoefs[1].elems[iComp] = 6*m->rows[3].elems[iComp];
+        }
+        return 1;
+    }
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline3__eval_one(const cds_spline3 *spline, cds_spline_s32 order, cds_spline_s32 segment, cds_spline_r32 u,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ) {
+    cds_spline_vec3 coefs[4], result;
+    cds_spline_s32 degree = cds_spline3__derivative_coefs(cds_spline3__segment(spline, segment), order, coefs);
+    cds_spline_s32 iComp, iDeg;
+    for(iComp=0; iComp<3; iComp += 1) {
+        result.elems[iComp] = coefs[degree].elems[iComp];
+        for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+            result.elems[iComp] = result.elems[iComp]*u + coefs[iDeg].elems[iComp];
         }
-        case kCdsSplineInterpStyleCentripetalCatmullRom: {
-            const cds_spline_r32 alpha = outSpline->tension;
-            const cds_spline_vec3 *p0 = &outSpline->knots[segmentIndex+0].position;
-            const cds_spline_vec3 *p1 = &outSpline->knots[segmentIndex+1].position;
-            const cds_spline_vec3 *p2 = &outSpline->knots[segmentIndex+2].position;
-            const cds_spline_vec3 *p3 = &outSpline->knots[segmentIndex+3].position;
-            const cds_spline_r32 t0 = 0.0f;
-            const cds_spline_r32 t1 = t0 + (cds_spline_r32)pow(
-                (p1->x - p0->x)*(p1->x - p0->x) +
-                (p1->y - p0->y)*(p1->y - p0->y) +
-                (p1->z - p0->z)*(p1->z - p0->z),
-                alpha*0.5f );
-            const cds_spline_r32 t2 = t1 + (cds_spline_r32)pow(
-                (p2->x - p1->x)*(p2->x - p1->x) +
-                (p2->y - p1->y)*(p2->y - p1->y) +
-                (p2->z - p1->z)*(p2->z - p1->z),
-                alpha*0.5f );
-            const cds_spline_r32 t3 = t2 + (cds_spline_r32)pow(
-                (p3->x - p2->x)*(p3->x - p2->x) +
-                (p3->y - p2->y)*(p3->y - p2->y) +
-                (p3->z - p2->z)*(p3->z - p2->z),
-                alpha*0.5f );
-            /* Simplification: reduce centripetal Catmull-Rom to Hermite, as described in
-             * https://stackoverflow.com/questions/9489736/catmull-rom-curve-with-no-cusps-and-no-self-intersections/23980479#23980479
-             * Basically, given P0,P1,P2,P3 and t0,t1,t2,t3, compute tangents at P1 and P2:
-             *   tan1 = (P1 - P0) / (t1 - t0) - (P2 - P0) / (t2 - t0) + (P2 - P1) / (t2 - t1)
-             *   tan2 = (P2 - P1) / (t2 - t1) - (P3 - P1) / (t3 - t1) + (P3 - P2) / (t3 - t2)
-             * And plug into the standard Hermite basis matrix. If evaluating the segment from
-             * P1 to P2, the tangents must be scaled by (t2-t1) to put them in the appropriate range.
-             */
-            cds_spline_vec3 tan1, tan2;
-            tan1.x = (p1->x - p0->x)/(t1-t0) - (p2->x - p0->x)/(t2-t0) + (p2->x - p1->x)/(t2-t1);
-            tan1.y = (p1->y - p0->y)/(t1-t0) - (p2->y - p0->y)/(t2-t0) + (p2->y - p1->y)/(t2-t1);
-            tan1.z = (p1->z - p0->z)/(t1-t0) - (p2->z - p0->z)/(t2-t0) + (p2->z - p1->z)/(t2-t1);
-            tan2.x = (p2->x - p1->x)/(t2-t1) - (p3->x - p1->x)/(t3-t1) + (p3->x - p2->x)/(t3-t2);
-            tan2.y = (p2->y - p1->y)/(t2-t1) - (p3->y - p1->y)/(t3-t1) + (p3->y - p2->y)/(t3-t2);
-            tan2.z = (p2->z - p1->z)/(t2-t1) - (p3->z - p1->z)/(t3-t1) + (p3->z - p2->z)/(t3-t2);
-            tan1.x *= (t2-t1);
-            tan1.y *= (t2-t1);
-            tan1.z *= (t2-t1);
-            tan2.x *= (t2-t1);
-            tan2.y *= (t2-t1);
-            tan2.z *= (t2-t1);
-            m->m00 = p1->x;
-            m->m01 = p1->y;
-            m->m02 = p1->z;
-            m->m10 = tan1.x;
-            m->m11 = tan1.y;
-            m->m12 = tan1.z;
-            m->m20 = (-3)*p1->x + ( 3)*p2->x + (-2)*tan1.x + (-1)*tan2.x;
-            m->m21 = (-3)*p1->y + ( 3)*p2->y + (-2)*tan1.y + (-1)*tan2.y;
-            m->m22 = (-3)*p1->z + ( 3)*p2->z + (-2)*tan1.z + (-1)*tan2.z;
-            m->m30 = ( 2)*p1->x + (-2)*p2->x +      tan1.x +      tan2.x;
-            m->m31 = ( 2)*p1->y + (-2)*p2->y +      tan1.y +      tan2.y;
-            m->m32 = ( 2)*p1->z + (-2)*p2->z +      tan1.z +      tan2.z;
+    }
+    *outX = result.x;
+    *outY = result.y;
+    *outZ = result.z;
+}
+
+#if defined(CDS_SPLINE__SIMD_SSE)
+/* With random t, batch evaluation of a spline that does not fit in cache is bound by misses on
+ * the segment matrices. The wide loops prefetch the first and last byte of the segments needed
+ * PREFETCH_DISTANCE samples ahead, so that several misses are in flight at once; in the blocked
+ * layout both land in the same cache line. Smaller splines skip the prefetches, which would only
+ * cost issue slots. */
+#define CDS_SPLINE__PREFETCH_DISTANCE 32
+#define CDS_SPLINE__PREFETCH_MIN_BYTES (256*1024)
+
+/* Evaluates four lanes that may fall in different segments, writing lanes [i..i+3] of the output.
+ * Only valid for the blocked layout: each matrix row is loaded as four floats, and the extra float
+ * after the last row lands in the slot's padding. Transposing each row of the four segments gives
+ * one register per coefficient and component, so the Horner chain runs exactly as it does when all
+ * lanes share a segment. */
+static void
+cds_spline3__eval_gather4(const cds_spline3 *spline, cds_spline_s32 order, const cds_spline_r32 laneSeg[4], __m128 vU,
+    cds_spline_r32 *outs[3], cds_spline_s32 i, cds_spline_s32 outStride) {
+    const cds_spline_r32 *m0 = cds_spline3__segment(spline, (cds_spline_s32)laneSeg[0])->elems;
+    const cds_spline_r32 *m1 = cds_spline3__segment(spline, (cds_spline_s32)laneSeg[1])->elems;
+    const cds_spline_r32 *m2 = cds_spline3__segment(spline, (cds_spline_s32)laneSeg[2])->elems;
+    const cds_spline_r32 *m3 = cds_spline3__segment(spline, (cds_spline_s32)laneSeg[3])->elems;
+    __m128 rows[4][4], coefs[4];
+    cds_spline_r32 laneOut[4];
+    cds_spline_s32 iRow, iComp, iDeg, iLane, degree;
+    CDS_SPLINE_ASSERT(spline->segmentStride == CDS_SPLINE__CACHE_LINE_SIZE);
+    for(iRow=0; iRow<4; iRow += 1) {
+        rows[iRow][0] = _mm_loadu_ps(m0 + 3*iRow);
+        rows[iRow][1] = _mm_loadu_ps(m1 + 3*iRow);
+        rows[iRow][2] = _mm_loadu_ps(m2 + 3*iRow);
+        rows[iRow][3] = _mm_loadu_ps(m3 + 3*iRow);
+        _MM_TRANSPOSE4_PS(rows[iRow][0], rows[iRow][1], rows[iRow][2], rows[iRow][3]);
+    }
+    for(iComp=0; iComp<3; iComp += 1) {
+        /* Same scaling as cds_spline3__derivative_coefs() */
+        switch(order) {
+        case 0:
+            coefs[0] = rows[0][iComp];
+            coefs[1] = rows[1][iComp];
+            coefs[2] = rows[2][iComp];
+            coefs[3] = rows[3][iComp];
+            degree = 3;
             break;
+        case 1:
+            coefs[0] = rows[1][iComp];
+            coefs[1] = _mm_mul_ps(_mm_set1_ps(2), rows[2][iComp]);
+            coefs[2] = _mm_mul_ps(_mm_set1_ps(3), rows[3][iComp]);
+            degree = 2;
+            break;
+        default:
+            coefs[0] = _mm_mul_ps(_mm_set1_ps(2), rows[2][iComp]);
+            coefs[1] = _mm_mul_ps(_mm_set1_ps(6), rows[3][iComp]);
+            degree = 1;
+            break;
+        }
+        for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+            coefs[degree] = _mm_add_ps(_mm_mul_ps(coefs[degree], vU), coefs[iDeg]);
+        }
+        if (outStride == 1) {
+            _mm_storeu_ps(outs[iComp]+i, coefs[degree]);
+        } else {
+            _mm_storeu_ps(laneOut, coefs[degree]);
+            for(iLane=0; iLane<4; iLane += 1) {
+                outs[iComp][(i+iLane)*outStride] = laneOut[iLane];
+            }
+        }
+    }
+}
+#endif
+
+/* Shared body of the batch evaluation functions. Output component c of sample i is written to
+ * out[c][i*outStride], which covers both AoS (stride 3) and SoA (stride 1) output.
+ *
+ * The wide kernels clamp and split a full register of t values at once. When every lane falls in
+ * the same segment, the segment's coefficients are broadcast and each component is evaluated for
+ * all lanes with one Horner chain ("go wide on u" in derivation.txt). Lanes that straddle a
+ * segment boundary gather their segments with cds_spline3__eval_gather4() in the blocked layout,
+ * and otherwise fall back to the scalar path, reusing the segment/u values already computed.
+ */
+static void
+cds_spline3__eval_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_s32 order, cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ, cds_spline_s32 outStride) {
+    cds_spline_s32 i = 0, segment;
+    cds_spline_r32 u;
+#if defined(CDS_SPLINE__SIMD_SSE)
+    const cds_spline_bool32_t prefetch =
+        (size_t)spline->numSegments * (size_t)spline->segmentStride >= CDS_SPLINE__PREFETCH_MIN_BYTES;
+#endif
+    CDS_SPLINE_ASSERT(spline->numSegments > 0);
+    cds_spline3__flush_pending(spline);
+#if defined(CDS_SPLINE__SIMD_AVX)
+    {
+        const __m256 vZero = _mm256_setzero_ps();
+        const __m256 vTMax = _mm256_set1_ps((cds_spline_r32)spline->numSegments);
+        const __m256 vLastSeg = _mm256_set1_ps((cds_spline_r32)(spline->numSegments-1));
+        cds_spline_s32 iLane, iComp, iDeg, degree;
+        cds_spline_vec3 coefs[4];
+        cds_spline_r32 laneSeg[8], laneU[8], laneOut[8];
+        cds_spline_s32 prefetchSeg[8];
+        cds_spline_r32 *outs[3];
+        outs[0] = outX;
+        outs[1] = outY;
+        outs[2] = outZ;
+        for(; i+8 <= tCount; i += 8) {
+            __m256 vT;
+#if defined(CDS_SPLINE__SIMD_SSE)
+            if (prefetch && i+CDS_SPLINE__PREFETCH_DISTANCE+8 <= tCount) {
+                vT = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(t+i+CDS_SPLINE__PREFETCH_DISTANCE), vZero), vLastSeg);
+                _mm256_storeu_si256((__m256i*)prefetchSeg, _mm256_cvttps_epi32(vT));
+                for(iLane=0; iLane<8; iLane += 1) {
+                    const char *m = (const char*)cds_spline3__segment(spline, prefetchSeg[iLane]);
+                    _mm_prefetch(m, _MM_HINT_T0);
+                    _mm_prefetch(m + sizeof(cds_spline_mat34) - 1, _MM_HINT_T0);
+                }
+            }
+#endif
+            vT = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(t+i), vZero), vTMax);
+            __m256 vSeg = _mm256_min_ps(_mm256_cvtepi32_ps(_mm256_cvttps_epi32(vT)), vLastSeg);
+            __m256 vU = _mm256_sub_ps(vT, vSeg);
+            _mm256_storeu_ps(laneSeg, vSeg);
+            if (_mm256_movemask_ps(_mm256_cmp_ps(vSeg, _mm256_set1_ps(laneSeg[0]), _CMP_EQ_OQ)) == 0xFF) {
+                degree = cds_spline3__derivative_coefs(cds_spline3__segment(spline, (cds_spline_s32)laneSeg[0]), order, coefs);
+                for(iComp=0; iComp<3; iComp += 1) {
+                    __m256 vAcc = _mm256_set1_ps(coefs[degree].elems[iComp]);
+                    for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+                        vAcc = _mm256_add_ps(_mm256_mul_ps(vAcc, vU), _mm256_set1_ps(coefs[iDeg].elems[iComp]));
+                    }
+                    if (outStride == 1) {
+                        _mm256_storeu_ps(outs[iComp]+i, vAcc);
+                    } else {
+                        _mm256_storeu_ps(laneOut, vAcc);
+                        for(iLane=0; iLane<8; iLane += 1) {
+                            outs[iComp][(i+iLane)*outStride] = laneOut[iLane];
+                        }
+                    }
+                }
+            }
+#if defined(CDS_SPLINE__SIMD_SSE)
+            else if (spline->segmentStride == CDS_SPLINE__CACHE_LINE_SIZE) {
+                cds_spline3__eval_gather4(spline, order, laneSeg,   _mm256_castps256_ps128(vU),   outs, i,   outStride);
+                cds_spline3__eval_gather4(spline, order, laneSeg+4, _mm256_extractf128_ps(vU, 1), outs, i+4, outStride);
+            }
+#endif
+            else {
+                _mm256_storeu_ps(laneU, vU);
+                for(iLane=0; iLane<8; iLane += 1) {
+                    cds_spline3__eval_one(spline, order, (cds_spline_s32)laneSeg[iLane], laneU[iLane],
+                        outX + (i+iLane)*outStride, outY + (i+iLane)*outStride, outZ + (i+iLane)*outStride);
+                }
+            }
         }
+    }
+#endif
+#if defined(CDS_SPLINE__SIMD_SSE)
+    {
+        const __m128 vZero = _mm_setzero_ps();
+        const __m128 vTMax = _mm_set1_ps((cds_spline_r32)spline->numSegments);
+        const __m128 vLastSeg = _mm_set1_ps((cds_spline_r32)(spline->numSegments-1));
+        cds_spline_s32 iLane, iComp, iDeg, degree;
+        cds_spline_vec3 coefs[4];
+        cds_spline_r32 laneSeg[4], laneU[4], laneOut[4];
+        cds_spline_s32 prefetchSeg[4];
+        cds_spline_r32 *outs[3];
+        outs[0] = outX;
+        outs[1] = outY;
+        outs[2] = outZ;
+        for(; i+4 <= tCount; i += 4) {
+            __m128 vT;
+            if (prefetch && i+CDS_SPLINE__PREFETCH_DISTANCE+4 <= tCount) {
+                vT = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(t+i+CDS_SPLINE__PREFETCH_DISTANCE), vZero), vLastSeg);
+                _mm_storeu_si128((__m128i*)prefetchSeg, _mm_cvttps_epi32(vT));
+                for(iLane=0; iLane<4; iLane += 1) {
+                    const char *m = (const char*)cds_spline3__segment(spline, prefetchSeg[iLane]);
+                    _mm_prefetch(m, _MM_HINT_T0);
+                    _mm_prefetch(m + sizeof(cds_spline_mat34) - 1, _MM_HINT_T0);
+                }
+            }
+            vT = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(t+i), vZero), vTMax);
+            __m128 vSeg = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(vT)), vLastSeg);
+            __m128 vU = _mm_sub_ps(vT, vSeg);
+            _mm_storeu_ps(laneSeg, vSeg);
+            if (_mm_movemask_ps(_mm_cmpeq_ps(vSeg, _mm_set1_ps(laneSeg[0]))) == 0xF) {
+                degree = cds_spline3__derivative_coefs(cds_spline3__segment(spline, (cds_spline_s32)laneSeg[0]), order, coefs);
+                for(iComp=0; iComp<3; iComp += 1) {
+                    __m128 vAcc = _mm_set1_ps(coefs[degree].elems[iComp]);
+                    for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+                        vAcc = _mm_add_ps(_mm_mul_ps(vAcc, vU), _mm_set1_ps(coefs[iDeg].elems[iComp]));
+                    }
+                    if (outStride == 1) {
+                        _mm_storeu_ps(outs[iComp]+i, vAcc);
+                    } else {
+                        _mm_storeu_ps(laneOut, vAcc);
+                        for(iLane=0; iLane<4; iLane += 1) {
+                            outs[iComp][(i+iLane)*outStride] = laneOut[iLane];
+                        }
+                    }
+                }
+            } else if (spline->segmentStride == CDS_SPLINE__CACHE_LINE_SIZE) {
+                cds_spline3__eval_gather4(spline, order, laneSeg, vU, outs, i, outStride);
+            } else {
+                _mm_storeu_ps(laneU, vU);
+                for(iLane=0; iLane<4; iLane += 1) {
+                    cds_spline3__eval_one(spline, order, (cds_spline_s32)laneSeg[iLane], laneU[iLane],
+                        outX + (i+iLane)*outStride, outY + (i+iLane)*outStride, outZ + (i+iLane)*outStride);
+                }
+            }
         }
     }
+#endif
+    /* Scalar fallback, and the tail of the wide loops */
+    for(; i<tCount; i += 1) {
+        cds_spline__get_int_and_frac(spline->numSegments, t[i], &segment, &u);
+        cds_spline3__eval_one(spline, order, segment, u,
+            outX + i*outStride, outY + i*outStride, outZ + i*outStride);
+    }
+}
+
+void
+cds_spline3_eval_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos) {
+    cds_spline3__eval_many(spline, t, tCount, 0, &outPos->x, &outPos->y, &outPos->z, 3);
+}
+
+void
+cds_spline3_evald_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDPos) {
+    cds_spline3__eval_many(spline, t, tCount, 1, &outDPos->x, &outDPos->y, &outDPos->z, 3);
+}
+
+void
+cds_spline3_evaldd_many(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDDPos) {
+    cds_spline3__eval_many(spline, t, tCount, 2, &outDDPos->x, &outDDPos->y, &outDDPos->z, 3);
+}
+
+void
+cds_spline3_eval_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ) {
+    cds_spline3__eval_many(spline, t, tCount, 0, outX, outY, outZ, 1);
+}
+
+void
+cds_spline3_evald_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ) {
+    cds_spline3__eval_many(spline, t, tCount, 1, outX, outY, outZ, 1);
+}
+
+void
+cds_spline3_evaldd_many_soa(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_r32 *outX, cds_spline_r32 *outY, cds_spline_r32 *outZ) {
+    cds_spline3__eval_many(spline, t, tCount, 2, outX, outY, outZ, 1);
+}
+
+/* Tracks are padded to a multiple of 8 so that every coefficient row is a whole number of AVX
+ * registers; the padding lanes hold zeros and are never written to the output. */
+#define CDS_SPLINE__BANK_TRACK_ALIGN 8
+
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline_bank__track_stride(cds_spline_s32 trackCount) {
+    return (cds_spline_s32)CDS_SPLINE_ALIGN_TO(trackCount, CDS_SPLINE__BANK_TRACK_ALIGN);
 }
 
 size_t
-cds_spline3_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount) {
-    (void)interpStyle;
-    if (maxKnotCount <= 0)
+cds_spline_bank_buffer_size(cds_spline_s32 dim, cds_spline_interp_style interpStyle, cds_spline_s32 numKnots,
+    cds_spline_s32 trackCount) {
+    cds_spline_s32 numSegments = cds_spline__segment_count(interpStyle, numKnots);
+    if (dim < 1 || dim > 4 || numSegments < 1 || trackCount < 1)
+        return 0;
+    return (size_t)numSegments * 4 * dim * cds_spline_bank__track_stride(trackCount) * sizeof(cds_spline_r32)
+        + CDS_SPLINE__CACHE_LINE_SIZE-1;
+}
+
+cds_spline_error_t
+cds_spline_bank_init(cds_spline_bank *outBank, cds_spline_s32 dim, cds_spline_interp_style interpStyle,
+    cds_spline_s32 numKnots, cds_spline_s32 trackCount, void *buffer, size_t bufferSize) {
+    size_t minBufferSize = cds_spline_bank_buffer_size(dim, interpStyle, numKnots, trackCount);
+    size_t coefCount;
+    cds_spline_u8 *aligned = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)buffer, CDS_SPLINE__CACHE_LINE_SIZE);
+    size_t iCoef;
+    if (dim < 1 || dim > 4)
+        return kCdsSplineErrorBankInit_Dimension;
+    if (minBufferSize == 0 || bufferSize < minBufferSize)
+        return kCdsSplineErrorBankInit_BufferSize;
+    outBank->coefs = (cds_spline_r32*)aligned;
+    outBank->interpStyle = interpStyle;
+    outBank->tension = 0.5f;
+    outBank->dim = dim;
+    outBank->numKnots = numKnots;
+    outBank->numSegments = cds_spline__segment_count(interpStyle, numKnots);
+    outBank->trackCount = trackCount;
+    outBank->trackStride = cds_spline_bank__track_stride(trackCount);
+    coefCount = (size_t)outBank->numSegments * 4 * dim * outBank->trackStride;
+    for(iCoef=0; iCoef<coefCount; iCoef += 1) {
+        outBank->coefs[iCoef] = 0;
+    }
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline_bank_set_track(cds_spline_bank *outBank, cds_spline_s32 trackIndex, const cds_spline_r32 *knots) {
+    const cds_spline_s32 dim = outBank->dim, stride = outBank->trackStride;
+    const cds_spline_bool32_t centripetal = (outBank->interpStyle == kCdsSplineInterpStyleCentripetalCatmullRom);
+    cds_spline_r32 m[16], chords[3] = {0, 0, 0};
+    cds_spline_s32 iSeg, iRow, iComp;
+    if (trackIndex < 0 || trackIndex >= outBank->trackCount)
+        return kCdsSplineErrorBankSetTrack_TrackIndex;
+    CDS_SPLINE__BEGIN_RECOMPUTE(dim, outBank->interpStyle, outBank->numSegments);
+    if (centripetal && outBank->numSegments > 0) {
+        /* As in cds_splineN__compute_centripetal_segments(), each knot pair's chord is computed once */
+        chords[1] = cds_spline__chord_param(dim, knots, knots + 2*dim, outBank->tension);
+        chords[2] = cds_spline__chord_param(dim, knots + 2*dim, knots + 4*dim, outBank->tension);
+    }
+    for(iSeg=0; iSeg<outBank->numSegments; iSeg += 1) {
+        cds_spline_r32 *block = outBank->coefs + (size_t)iSeg*4*dim*stride;
+        if (centripetal) {
+            chords[0] = chords[1];
+            chords[1] = chords[2];
+            chords[2] = cds_spline__chord_param(dim, knots + (iSeg+2)*2*dim, knots + (iSeg+3)*2*dim, outBank->tension);
+            cds_spline__compute_centripetal_matrix(dim, knots + iSeg*2*dim, chords, m);
+        } else {
+            cds_spline__compute_segment_matrix(dim, outBank->interpStyle, outBank->tension, knots + iSeg*2*dim, m);
+        }
+        for(iRow=0; iRow<4; iRow += 1) {
+            for(iComp=0; iComp<dim; iComp += 1) {
+                block[(iRow*dim + iComp)*stride + trackIndex] = m[iRow*dim + iComp];
+            }
+        }
+    }
+    CDS_SPLINE__END_RECOMPUTE(dim, outBank->interpStyle, outBank->numSegments);
+    return kCdsSplineErrorNone;
+}
+
+/* Shared body of the bank evaluation functions. The segment lookup happens once; then each
+ * component is one Horner chain per register of tracks. Derivatives scale row k+order by
+ * kScales[order][k], as cds_spline__evald_segment() and cds_spline__evaldd_segment() do. */
+static void
+cds_spline_bank__eval(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_s32 order, cds_spline_r32 *out) {
+    static const cds_spline_r32 kScales[3][4] = { {1,1,1,1}, {1,2,3,0}, {2,6,0,0} };
+    const cds_spline_s32 dim = bank->dim, stride = bank->trackStride, trackCount = bank->trackCount;
+    const cds_spline_s32 degree = 3 - order;
+    const cds_spline_r32 *scales = kScales[order];
+    const cds_spline_r32 *block, *rows[4];
+    cds_spline_s32 segment, iComp, iDeg, iTrack;
+    cds_spline_r32 u;
+    cds_spline__get_int_and_frac(bank->numSegments, t, &segment, &u);
+    block = bank->coefs + (size_t)segment*4*dim*stride;
+    for(iComp=0; iComp<dim; iComp += 1) {
+        cds_spline_r32 *outComp = out + iComp*trackCount;
+        for(iDeg=0; iDeg<=degree; iDeg += 1) {
+            rows[iDeg] = block + ((iDeg+order)*dim + iComp)*stride;
+        }
+        iTrack = 0;
+#if defined(CDS_SPLINE__SIMD_AVX)
+        {
+            const __m256 vU = _mm256_set1_ps(u);
+            for(; iTrack+8 <= trackCount; iTrack += 8) {
+                __m256 vAcc = _mm256_load_ps(rows[degree] + iTrack);
+                if (order > 0)
+                    vAcc = _mm256_mul_ps(_mm256_set1_ps(scales[degree]), vAcc);
+                for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+                    __m256 vCoef = _mm256_load_ps(rows[iDeg] + iTrack);
+                    if (order > 0)
+                        vCoef = _mm256_mul_ps(_mm256_set1_ps(scales[iDeg]), vCoef);
+                    vAcc = _mm256_add_ps(_mm256_mul_ps(vAcc, vU), vCoef);
+                }
+                _mm256_storeu_ps(outComp + iTrack, vAcc);
+            }
+        }
+#endif
+#if defined(CDS_SPLINE__SIMD_SSE)
+        {
+            const __m128 vU = _mm_set1_ps(u);
+            for(; iTrack+4 <= trackCount; iTrack += 4) {
+                __m128 vAcc = _mm_load_ps(rows[degree] + iTrack);
+                if (order > 0)
+                    vAcc = _mm_mul_ps(_mm_set1_ps(scales[degree]), vAcc);
+                for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+                    __m128 vCoef = _mm_load_ps(rows[iDeg] + iTrack);
+                    if (order > 0)
+                        vCoef = _mm_mul_ps(_mm_set1_ps(scales[iDeg]), vCoef);
+                    vAcc = _mm_add_ps(_mm_mul_ps(vAcc, vU), vCoef);
+                }
+                _mm_storeu_ps(outComp + iTrack, vAcc);
+            }
+        }
+#endif
+        for(; iTrack<trackCount; iTrack += 1) {
+            cds_spline_r32 acc = scales[degree] * rows[degree][iTrack];
+            for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+                acc = acc*u + scales[iDeg]*rows[iDeg][iTrack];
+            }
+            outComp[iTrack] = acc;
+        }
+    }
+}
+
+void
+cds_spline_bank_eval(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out) {
+    cds_spline_bank__eval(bank, t, 0, out);
+}
+
+void
+cds_spline_bank_evald(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out) {
+    cds_spline_bank__eval(bank, t, 1, out);
+}
+
+void
+cds_spline_bank_evaldd(const cds_spline_bank *bank, cds_spline_r32 t, cds_spline_r32 *out) {
+    cds_spline_bank__eval(bank, t, 2, out);
+}
+
+/* Forward-differences segments [firstSegment..lastSegment), writing stepsPerSegment vertices per
+ * segment (the segment's end point is the next segment's first vertex). With h = 1/steps and
+ * segment coefficients a,b,c,d, the differences anchored at u0 are:
+ *   D1 = p(u0+h) - p(u0) = (b + c*(2*u0 + h) + d*(3*u0^2 + 3*u0*h + h^2)) * h
+ *   D2 = (2*c + 6*d*(u0 + h)) * h^2
+ *   D3 = 6*d*h^3
+ */
+static void
+cds_spline3__tessellate_segments(const cds_spline3 *spline, cds_spline_s32 firstSegment, cds_spline_s32 lastSegment,
+    cds_spline_s32 stepsPerSegment, cds_spline_s32 reanchorInterval, cds_spline_vec3 *outVerts) {
+    const cds_spline_r32 h = 1.0f / (cds_spline_r32)stepsPerSegment;
+    cds_spline_s32 iSeg, iStep, iComp;
+    cds_spline_vec3 pos, d1, d2, d3;
+    if (reanchorInterval <= 0 || reanchorInterval > stepsPerSegment)
+        reanchorInterval = stepsPerSegment;
+    for(iSeg=firstSegment; iSeg<lastSegment; iSeg += 1) {
+        const cds_spline_mat34 *m = cds_spline3__segment(spline, iSeg);
+        for(iComp=0; iComp<3; iComp += 1) {
+            d3.elems[iComp] = 6*m->rows[3].elems[iComp]*h*h*h;
+        }
+        for(iStep=0; iStep<stepsPerSegment; iStep += 1) {
+            if (iStep % reanchorInterval == 0) {
+                const cds_spline_r32 u0 = (cds_spline_r32)iStep * h;
+                for(iComp=0; iComp<3; iComp += 1) {
+                    const cds_spline_r32 a = m->rows[0].elems[iComp], b = m->rows[1].elems[iComp];
+                    const cds_spline_r32 c = m->rows[2].elems[iComp], d = m->rows[3].elems[iComp];
+                    pos.elems[iComp] = ((d*u0 + c)*u0 + b)*u0 + a;
+                    d1.elems[iComp] = (b + c*(2*u0 + h) + d*((3*u0 + 3*h)*u0 + h*h)) * h;
+                    d2.elems[iComp] = (2*c + 6*d*(u0 + h)) * h*h;
+                }
+            }
+            *outVerts++ = pos;
+            for(iComp=0; iComp<3; iComp += 1) {
+                pos.elems[iComp] += d1.elems[iComp];
+                d1.elems[iComp] += d2.elems[iComp];
+                d2.elems[iComp] += d3.elems[iComp];
+            }
+        }
+    }
+}
+
+cds_spline_s32
+cds_spline3_tessellate_uniform_vertex_count(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment) {
+    if (spline->numSegments < 1 || stepsPerSegment < 1)
+        return 0;
+    return spline->numSegments*stepsPerSegment + 1;
+}
+
+cds_spline_error_t
+cds_spline3_tessellate_uniform(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment, cds_spline_s32 reanchorInterval,
+    cds_spline_vec3 *outVerts, cds_spline_s32 maxVerts, cds_spline_s32 *outVertCount) {
+    cds_spline_s32 vertCount;
+    *outVertCount = 0;
+    if (stepsPerSegment < 1)
+        return kCdsSplineErrorTessellate_StepCount;
+    vertCount = cds_spline3_tessellate_uniform_vertex_count(spline, stepsPerSegment);
+    if (vertCount == 0)
+        return kCdsSplineErrorNone;
+    if (maxVerts < vertCount)
+        return kCdsSplineErrorTessellate_BufferSize;
+    cds_spline3__flush_pending(spline);
+    cds_spline3__tessellate_segments(spline, 0, spline->numSegments, stepsPerSegment, reanchorInterval, outVerts);
+    outVerts[vertCount-1] = cds_spline3_eval(spline, (cds_spline_r32)spline->numSegments);
+    *outVertCount = vertCount;
+    return kCdsSplineErrorNone;
+}
+
+/* Squared length of p''(u) = 2*c + 6*d*u */
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline3__second_derivative_sq(const cds_spline_mat34 *m, cds_spline_r32 u) {
+    cds_spline_r32 lengthSq = 0;
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; iComp += 1) {
+        const cds_spline_r32 dd = 2*m->rows[2].elems[iComp] + 6*m->rows[3].elems[iComp]*u;
+        lengthSq += dd*dd;
+    }
+    return lengthSq;
+}
+
+cds_spline_error_t
+cds_spline3_tessellate_adaptive(const cds_spline3 *spline, cds_spline_r32 tolerance, cds_spline_sample3 *outSamples,
+    cds_spline_s32 maxSamples, cds_spline_s32 *outSampleCount) {
+    /* A piece is (u0, depth), covering [u0..u0 + 2^-depth). Splitting pops one piece and pushes
+     * two, so the stack holds at most one pending right half per level. */
+    cds_spline_r32 stackU[CDS_SPLINE_ADAPTIVE_MAX_DEPTH+1];
+    cds_spline_s32 stackDepth[CDS_SPLINE_ADAPTIVE_MAX_DEPTH+1];
+    cds_spline_s32 stackSize, sampleCount = 0, iSeg;
+    /* compare du^4/64 * max|p''|^2 against tolerance^2, avoiding a sqrt per piece */
+    const cds_spline_r32 limitSq = 64.0f * tolerance * tolerance;
+    *outSampleCount = 0;
+    if (!(tolerance > 0))
+        return kCdsSplineErrorTessellate_Tolerance;
+    if (spline->numSegments < 1)
+        return kCdsSplineErrorNone;
+    cds_spline3__flush_pending(spline);
+    if (outSamples != NULL && maxSamples > 0) {
+        outSamples[0].t = 0;
+        outSamples[0].position = cds_spline3__eval_segment(cds_spline3__segment(spline, 0), 0);
+    }
+    sampleCount = 1;
+    for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+        const cds_spline_mat34 *m = cds_spline3__segment(spline, iSeg);
+        stackU[0] = 0;
+        stackDepth[0] = 0;
+        stackSize = 1;
+        while(stackSize > 0) {
+            const cds_spline_r32 u0 = stackU[stackSize-1];
+            const cds_spline_s32 depth = stackDepth[stackSize-1];
+            const cds_spline_r32 du = 1.0f / (cds_spline_r32)(1 << depth);
+            const cds_spline_r32 ddSq = CDS_SPLINE_MAX(cds_spline3__second_derivative_sq(m, u0),
+                cds_spline3__second_derivative_sq(m, u0 + du));
+            stackSize -= 1;
+            if (depth < CDS_SPLINE_ADAPTIVE_MAX_DEPTH && du*du*du*du*ddSq > limitSq) {
+                CDS_SPLINE_ASSERT(stackSize+2 <= CDS_SPLINE_ADAPTIVE_MAX_DEPTH+1);
+                stackU[stackSize] = u0 + 0.5f*du; /* right half first, so the left half is popped next */
+                stackDepth[stackSize] = depth + 1;
+                stackU[stackSize+1] = u0;
+                stackDepth[stackSize+1] = depth + 1;
+                stackSize += 2;
+            } else {
+                if (outSamples != NULL && sampleCount < maxSamples) {
+                    outSamples[sampleCount].t = (cds_spline_r32)iSeg + u0 + du;
+                    outSamples[sampleCount].position = cds_spline3__eval_segment(m, u0 + du);
+                }
+                sampleCount += 1;
+            }
+        }
+    }
+    *outSampleCount = sampleCount;
+    if (outSamples != NULL && sampleCount > maxSamples)
+        return kCdsSplineErrorTessellate_BufferSize;
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_r32
+cds_spline3_arc_length(const cds_spline3 *spline) {
+    CDS_SPLINE_ASSERT(spline->arcLengths != NULL);
+    cds_spline3__flush_pending(spline);
+    return spline->arcLengths[spline->numSegments];
+}
+
+cds_spline_r32
+cds_spline3_t_to_distance(const cds_spline3 *spline, cds_spline_r32 t) {
+    cds_spline_s32 segment;
+    cds_spline_r32 u;
+    CDS_SPLINE_ASSERT(spline->arcLengths != NULL);
+    if (spline->numSegments < 1)
         return 0;
-    /* TODO: cardinal and catmull-rom splines need two fewer segment matrices */
-    return maxKnotCount*sizeof(cds_spline_knot3) + (maxKnotCount-1)*sizeof(cds_spline_mat34);
+    cds_spline3__flush_pending(spline);
+    cds_spline__get_int_and_frac(spline->numSegments, t, &segment, &u);
+    return spline->arcLengths[segment] + cds_spline3__segment_length(cds_spline3__segment(spline, segment), u);
+}
+
+cds_spline_r32
+cds_spline3_distance_to_t(const cds_spline3 *spline, cds_spline_r32 distance) {
+    const cds_spline_r32 *arcLengths = spline->arcLengths;
+    const cds_spline_mat34 *m;
+    cds_spline_s32 lo, hi, iIter;
+    cds_spline_r32 segDistance, segLength, u, uMin, uMax;
+    CDS_SPLINE_ASSERT(arcLengths != NULL);
+    if (spline->numSegments < 1 || distance <= 0)
+        return 0;
+    cds_spline3__flush_pending(spline);
+    if (distance >= arcLengths[spline->numSegments])
+        return (cds_spline_r32)spline->numSegments;
+    /* Find the last segment whose starting distance is <= distance */
+    lo = 0;
+    hi = spline->numSegments-1;
+    while(lo < hi) {
+        cds_spline_s32 mid = (lo + hi + 1) / 2;
+        if (arcLengths[mid] <= distance)
+            lo = mid;
+        else
+            hi = mid-1;
+    }
+    m = cds_spline3__segment(spline, lo);
+    segDistance = distance - arcLengths[lo];
+    segLength = spline->segmentLengths[lo];
+    if (segLength <= 0)
+        return (cds_spline_r32)lo;
+    /* Newton's method on f(u) = length(0..u) - segDistance, with f'(u) = |p'(u)|. Falls back to
+     * bisection whenever a step would leave the bracketing interval. */
+    u = segDistance / segLength;
+    uMin = 0;
+    uMax = 1;
+    for(iIter=0; iIter<8; iIter += 1) {
+        cds_spline_r32 f = cds_spline3__segment_length(m, u) - segDistance;
+        cds_spline_r32 speed = cds_spline__segment_speed(3, m->elems, u);
+        cds_spline_r32 uNext;
+        if (fabs(f) <= 1e-6f * (segLength + 1.0f))
+            break;
+        if (f > 0)
+            uMax = u;
+        else
+            uMin = u;
+        uNext = (speed > 0) ? u - f / speed : uMin - 1;
+        if (uNext <= uMin || uNext >= uMax)
+            uNext = 0.5f * (uMin + uMax);
+        u = uNext;
+    }
+    return (cds_spline_r32)lo + u;
+}
+
+cds_spline_vec3
+cds_spline3_eval_by_distance(const cds_spline3 *spline, cds_spline_r32 distance) {
+    return cds_spline3_eval(spline, cds_spline3_distance_to_t(spline, distance));
+}
+
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline3__distance_sq(cds_spline_vec3 a, cds_spline_vec3 b) {
+    return (a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z);
+}
+
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline3__bounds_distance_sq(const cds_spline_aabb3 *bounds, cds_spline_vec3 p) {
+    cds_spline_r32 distSq = 0;
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; iComp += 1) {
+        cds_spline_r32 d = CDS_SPLINE_MAX(CDS_SPLINE_MAX(bounds->min.elems[iComp] - p.elems[iComp], 0),
+            p.elems[iComp] - bounds->max.elems[iComp]);
+        distSq += d*d;
+    }
+    return distSq;
+}
+
+/* Closest point on a single segment. Samples the segment coarsely, then polishes the best sample
+ * with Newton's method on f(u) = (p(u)-q).p'(u), whose roots are the local extrema of the distance.
+ * Updates *inOutBest if the result is closer. */
+static void
+cds_spline3__closest_point_on_segment(const cds_spline3 *spline, cds_spline_s32 segment, cds_spline_vec3 q,
+    cds_spline_s32 *outBestSegment, cds_spline_r32 *outBestU, cds_spline_r32 *inOutBestDistSq) {
+    enum { kNumSamples = 8 };
+    const cds_spline_mat34 *m = cds_spline3__segment(spline, segment);
+    cds_spline_r32 u, bestU = 0, bestDistSq = 3.0e38f, distSq;
+    cds_spline_s32 iSamp, iIter;
+    for(iSamp=0; iSamp<=kNumSamples; iSamp += 1) {
+        u = (cds_spline_r32)iSamp / (cds_spline_r32)kNumSamples;
+        distSq = cds_spline3__distance_sq(cds_spline3__eval_segment(m, u), q);
+        if (distSq < bestDistSq) {
+            bestDistSq = distSq;
+            bestU = u;
+        }
+    }
+    u = bestU;
+    for(iIter=0; iIter<8; iIter += 1) {
+        cds_spline_vec3 pos = cds_spline3__eval_segment(m, u);
+        cds_spline_vec3 dpos = cds_spline3__evald_segment(m, u);
+        cds_spline_vec3 ddpos = cds_spline3__evaldd_segment(m, u);
+        cds_spline_vec3 diff;
+        cds_spline_r32 f, df, uNext;
+        diff.x = pos.x - q.x;
+        diff.y = pos.y - q.y;
+        diff.z = pos.z - q.z;
+        f  = diff.x*dpos.x + diff.y*dpos.y + diff.z*dpos.z;
+        df = dpos.x*dpos.x + dpos.y*dpos.y + dpos.z*dpos.z + diff.x*ddpos.x + diff.y*ddpos.y + diff.z*ddpos.z;
+        if (df <= 0)
+            break;
+        uNext = CDS_SPLINE_MIN(CDS_SPLINE_MAX(u - f/df, 0.0f), 1.0f);
+        if (fabs(uNext - u) < 1e-7f)
+            break;
+        u = uNext;
+    }
+    distSq = cds_spline3__distance_sq(cds_spline3__eval_segment(m, u), q);
+    if (distSq > bestDistSq) {
+        distSq = bestDistSq;
+        u = bestU;
+    }
+    if (distSq < *inOutBestDistSq) {
+        *inOutBestDistSq = distSq;
+        *outBestSegment = segment;
+        *outBestU = u;
+    }
+}
+
+static cds_spline_closest_point3
+cds_spline3__find_closest_point(const cds_spline3 *spline, cds_spline_vec3 q, cds_spline_s32 seedSegment) {
+    cds_spline_closest_point3 result;
+    cds_spline_s32 bestSegment = 0, iSeg;
+    cds_spline_r32 bestU = 0, bestDistSq = 3.0e38f;
+    CDS_SPLINE_ASSERT(spline->numSegments > 0);
+    cds_spline3__flush_pending(spline);
+    if (seedSegment >= 0 && seedSegment < spline->numSegments) {
+        cds_spline3__closest_point_on_segment(spline, seedSegment, q, &bestSegment, &bestU, &bestDistSq);
+    }
+    if (spline->segmentBounds != NULL) {
+        /* Depth-first, nearer child first. The tree depth is at most 32, and each level pushes at
+         * most one extra entry, so the stack cannot overflow. */
+        const cds_spline_aabb3 *nodes = spline->segmentBounds;
+        const cds_spline_s32 leafCount = spline->boundsLeafCount;
+        cds_spline_s32 stack[64], stackSize = 0;
+        stack[stackSize++] = 1;
+        while(stackSize > 0) {
+            cds_spline_s32 iNode = stack[--stackSize];
+            if (cds_spline3__bounds_distance_sq(nodes + iNode, q) >= bestDistSq)
+                continue;
+            if (iNode >= leafCount) {
+                iSeg = iNode - leafCount;
+                if (iSeg != seedSegment && iSeg < spline->numSegments)
+                    cds_spline3__closest_point_on_segment(spline, iSeg, q, &bestSegment, &bestU, &bestDistSq);
+            } else {
+                cds_spline_r32 leftDistSq  = cds_spline3__bounds_distance_sq(nodes + 2*iNode,   q);
+                cds_spline_r32 rightDistSq = cds_spline3__bounds_distance_sq(nodes + 2*iNode+1, q);
+                cds_spline_s32 nearChild = (leftDistSq <= rightDistSq) ? 2*iNode : 2*iNode+1;
+                cds_spline_r32 farDistSq = CDS_SPLINE_MAX(leftDistSq, rightDistSq);
+                CDS_SPLINE_ASSERT(stackSize+2 <= (cds_spline_s32)(sizeof(stack)/sizeof(stack[0])));
+                if (farDistSq < bestDistSq)
+                    stack[stackSize++] = (nearChild ^ 1);
+                stack[stackSize++] = nearChild;
+            }
+        }
+    } else {
+        for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+            if (iSeg != seedSegment)
+                cds_spline3__closest_point_on_segment(spline, iSeg, q, &bestSegment, &bestU, &bestDistSq);
+        }
+    }
+    result.t = (cds_spline_r32)bestSegment + bestU;
+    result.position = cds_spline3__eval_segment(cds_spline3__segment(spline, bestSegment), bestU);
+    result.distance = (cds_spline_r32)sqrt(bestDistSq);
+    return result;
+}
+
+cds_spline_closest_point3
+cds_spline3_find_closest_point(const cds_spline3 *spline, cds_spline_vec3 queryPoint) {
+    return cds_spline3__find_closest_point(spline, queryPoint, -1);
+}
+
+void
+cds_spline3_find_closest_points(const cds_spline3 *spline, const cds_spline_vec3 *queryPoints, cds_spline_s32 queryCount,
+    cds_spline_closest_point3 *outResults) {
+    cds_spline_s32 iQuery, seedSegment = -1;
+    for(iQuery=0; iQuery<queryCount; iQuery += 1) {
+        outResults[iQuery] = cds_spline3__find_closest_point(spline, queryPoints[iQuery], seedSegment);
+        seedSegment = CDS_SPLINE_MIN((cds_spline_s32)outResults[iQuery].t, spline->numSegments-1);
+    }
+}
+
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline3__dot(cds_spline_vec3 a, cds_spline_vec3 b) {
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+static CDS_SPLINE_INLINE cds_spline_vec3
+cds_spline3__cross(cds_spline_vec3 a, cds_spline_vec3 b) {
+    return cds_spline_init_vec3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+}
+
+/* a - s*b */
+static CDS_SPLINE_INLINE cds_spline_vec3
+cds_spline3__sub_scaled(cds_spline_vec3 a, cds_spline_r32 s, cds_spline_vec3 b) {
+    return cds_spline_init_vec3(a.x - s*b.x, a.y - s*b.y, a.z - s*b.z);
+}
+
+/* a + s*b */
+static CDS_SPLINE_INLINE cds_spline_vec3
+cds_spline3__add_scaled(cds_spline_vec3 a, cds_spline_r32 s, cds_spline_vec3 b) {
+    return cds_spline_init_vec3(a.x + s*b.x, a.y + s*b.y, a.z + s*b.z);
+}
+
+/* Returns 0 (and leaves *v alone) if v is too short to normalize. */
+static CDS_SPLINE_INLINE cds_spline_bool32_t
+cds_spline3__normalize(cds_spline_vec3 *v) {
+    const cds_spline_r32 lengthSq = cds_spline3__dot(*v, *v);
+    cds_spline_r32 invLength;
+    if (!(lengthSq > 1e-24f))
+        return 0;
+    invLength = 1.0f / (cds_spline_r32)sqrt(lengthSq);
+    v->x *= invLength;
+    v->y *= invLength;
+    v->z *= invLength;
+    return 1;
+}
+
+/* Power-basis coefficients of a segment in the form the fused evaluation uses: with
+ * p(u) = ((a*u + b)*u + c)*u + d, it also keeps the derivative coefficients 3a, 2b and 6a, which
+ * are computed once per segment rather than once per derivative per t. The three polynomials
+ * below are written exactly as in __eval_segment(), __evald_segment() and __evaldd_segment(),
+ * so they round the same way (with or without contraction to FMA), and 6a is also the constant
+ * third derivative that torsion needs. */
+typedef struct cds_spline3__point_coefs {
+    cds_spline_vec3 a, b, c, d, a3, b2, a6;
+} cds_spline3__point_coefs;
+
+static CDS_SPLINE_INLINE void
+cds_spline3__load_point_coefs(const cds_spline_mat34 *m, cds_spline3__point_coefs *out) {
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; iComp += 1) {
+        out->d.elems[iComp] = m->elems[0*3 + iComp];
+        out->c.elems[iComp] = m->elems[1*3 + iComp];
+        out->b.elems[iComp] = m->elems[2*3 + iComp];
+        out->a.elems[iComp] = m->elems[3*3 + iComp];
+        out->a3.elems[iComp] = 3*out->a.elems[iComp];
+        out->b2.elems[iComp] = 2*out->b.elems[iComp];
+        out->a6.elems[iComp] = 6*out->a.elems[iComp];
+    }
+}
+
+static CDS_SPLINE_INLINE cds_spline_point3
+cds_spline3__eval_point(const cds_spline3__point_coefs *k, cds_spline_r32 u, cds_spline_u32 fields) {
+    cds_spline_point3 p;
+    cds_spline_vec3 dxdd;
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; iComp += 1) {
+        p.position.elems[iComp] = ((k->a.elems[iComp]*u + k->b.elems[iComp])*u + k->c.elems[iComp])*u + k->d.elems[iComp];
+        p.d.elems[iComp] = (k->a3.elems[iComp]*u + k->b2.elems[iComp])*u + k->c.elems[iComp];
+        p.dd.elems[iComp] = k->a6.elems[iComp]*u + k->b2.elems[iComp];
+    }
+    p.tangent = cds_spline_init_vec3(0, 0, 0);
+    p.curvature = 0;
+    p.torsion = 0;
+    if (fields & (kCdsSplinePointTangent | kCdsSplinePointCurvature)) {
+        const cds_spline_r32 speedSq = cds_spline3__dot(p.d, p.d);
+        if (speedSq > 1e-24f) {
+            const cds_spline_r32 invSpeed = 1.0f / (cds_spline_r32)sqrt(speedSq);
+            if (fields & kCdsSplinePointTangent) {
+                p.tangent = cds_spline_init_vec3(p.d.x*invSpeed, p.d.y*invSpeed, p.d.z*invSpeed);
+            }
+            if (fields & kCdsSplinePointCurvature) {
+                dxdd = cds_spline3__cross(p.d, p.dd);
+                p.curvature = (cds_spline_r32)sqrt(cds_spline3__dot(dxdd, dxdd)) * invSpeed*invSpeed*invSpeed;
+            }
+        }
+    }
+    if (fields & kCdsSplinePointTorsion) {
+        cds_spline_r32 crossSq;
+        dxdd = cds_spline3__cross(p.d, p.dd);
+        crossSq = cds_spline3__dot(dxdd, dxdd);
+        if (crossSq > 1e-24f) {
+            p.torsion = cds_spline3__dot(dxdd, k->a6) / crossSq;
+        }
+    }
+    return p;
+}
+
+cds_spline_point3
+cds_spline3_eval_point(const cds_spline3 *spline, cds_spline_r32 t, cds_spline_u32 fields) {
+    cds_spline3__point_coefs coefs;
+    cds_spline_s32 segment;
+    cds_spline_r32 u;
+    cds_spline3__flush_pending(spline);
+    cds_spline__get_int_and_frac(spline->numSegments, t, &segment, &u);
+    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);
+    cds_spline3__load_point_coefs(cds_spline3__segment(spline, segment), &coefs);
+    return cds_spline3__eval_point(&coefs, u, fields);
+}
+
+void
+cds_spline3_eval_points(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_u32 fields, cds_spline_point3 *outPoints) {
+    cds_spline3__point_coefs coefs;
+    cds_spline_s32 i, segment, loadedSegment = -1;
+    cds_spline_r32 u;
+    cds_spline3__flush_pending(spline);
+    for(i=0; i<tCount; i += 1) {
+        cds_spline__get_int_and_frac(spline->numSegments, t[i], &segment, &u);
+        CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);
+        if (segment != loadedSegment) {
+            cds_spline3__load_point_coefs(cds_spline3__segment(spline, segment), &coefs);
+            loadedSegment = segment;
+        }
+        outPoints[i] = cds_spline3__eval_point(&coefs, u, fields);
+    }
+}
+
+/* Generates frame nextRing from frame nextRing-1 (or from the initial normal, for ring 0). */
+static void
+cds_spline3__sweep_advance(cds_spline_sweep3 *sweep) {
+    const cds_spline3 *spline = sweep->spline;
+    const cds_spline_s32 ring = sweep->nextRing;
+    const cds_spline_s32 segment = CDS_SPLINE_MIN(ring / sweep->ringsPerSegment, spline->numSegments-1);
+    const cds_spline_r32 u = (cds_spline_r32)(ring - segment*sweep->ringsPerSegment) / (cds_spline_r32)sweep->ringsPerSegment;
+    const cds_spline_mat34 *m = cds_spline3__segment(spline, segment);
+    cds_spline_frame3 *frame = &sweep->frame;
+    cds_spline_vec3 position = cds_spline3__eval_segment(m, u), tangent = cds_spline3__evald_segment(m, u), normal;
+    CDS_SPLINE_ASSERT(ring < sweep->ringCount);
+    if (ring == 0) {
+        if (!cds_spline3__normalize(&tangent))
+            tangent = cds_spline_init_vec3(1, 0, 0);
+        normal = cds_spline3__sub_scaled(sweep->initialNormal, cds_spline3__dot(sweep->initialNormal, tangent), tangent);
+        if (!cds_spline3__normalize(&normal)) {
+            /* cross the tangent with the axis it is least aligned with */
+            const cds_spline_r32 ax = (cds_spline_r32)fabs(tangent.x), ay = (cds_spline_r32)fabs(tangent.y),
+                az = (cds_spline_r32)fabs(tangent.z);
+            const cds_spline_vec3 axis = (ax <= ay && ax <= az) ? cds_spline_init_vec3(1,0,0) :
+                (ay <= az) ? cds_spline_init_vec3(0,1,0) : cds_spline_init_vec3(0,0,1);
+            normal = cds_spline3__cross(tangent, axis);
+            cds_spline3__normalize(&normal);
+        }
+    } else {
+        /* Double reflection: reflect the previous frame across the bisector plane of the chord
+         * to the new point, then across the plane that maps the reflected tangent onto the
+         * new tangent. Either step is skipped when its reflection vector vanishes. */
+        const cds_spline_vec3 v1 = cds_spline3__sub_scaled(position, 1.0f, frame->position);
+        const cds_spline_r32 c1 = cds_spline3__dot(v1, v1);
+        cds_spline_vec3 reflectedNormal = frame->normal, reflectedTangent = frame->tangent, v2;
+        cds_spline_r32 c2;
+        if (!cds_spline3__normalize(&tangent))
+            tangent = frame->tangent;
+        if (c1 > 1e-24f) {
+            reflectedNormal = cds_spline3__sub_scaled(reflectedNormal, 2.0f/c1 * cds_spline3__dot(v1, reflectedNormal), v1);
+            reflectedTangent = cds_spline3__sub_scaled(reflectedTangent, 2.0f/c1 * cds_spline3__dot(v1, reflectedTangent), v1);
+        }
+        v2 = cds_spline3__sub_scaled(tangent, 1.0f, reflectedTangent);
+        c2 = cds_spline3__dot(v2, v2);
+        normal = (c2 > 1e-24f) ? cds_spline3__sub_scaled(reflectedNormal, 2.0f/c2 * cds_spline3__dot(v2, reflectedNormal), v2)
+            : reflectedNormal;
+        /* re-orthonormalize so float error cannot accumulate along long sweeps */
+        normal = cds_spline3__sub_scaled(normal, cds_spline3__dot(normal, tangent), tangent);
+        if (!cds_spline3__normalize(&normal))
+            normal = frame->normal;
+    }
+    frame->position = position;
+    frame->tangent = tangent;
+    frame->normal = normal;
+    frame->binormal = cds_spline3__cross(tangent, normal);
+    sweep->nextRing += 1;
+}
+
+cds_spline_error_t
+cds_spline3_sweep_init(cds_spline_sweep3 *outSweep, const cds_spline3 *spline, cds_spline_s32 ringsPerSegment,
+    cds_spline_s32 vertsPerRing, cds_spline_r32 radius, const cds_spline_vec3 *initialNormal) {
+    if (ringsPerSegment < 1)
+        return kCdsSplineErrorSweepInit_RingsPerSegment;
+    if (vertsPerRing < 3)
+        return kCdsSplineErrorSweepInit_VertsPerRing;
+    cds_spline3__flush_pending(spline);
+    outSweep->spline = spline;
+    outSweep->radius = radius;
+    outSweep->ringsPerSegment = ringsPerSegment;
+    outSweep->vertsPerRing = vertsPerRing;
+    outSweep->ringCount = (spline->numSegments > 0) ? spline->numSegments*ringsPerSegment + 1 : 0;
+    outSweep->nextRing = 0;
+    outSweep->initialNormal = (initialNormal != NULL) ? *initialNormal : cds_spline_init_vec3(0, 0, 0);
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_sweep_next_frames(cds_spline_sweep3 *sweep, cds_spline_frame3 *outFrames, cds_spline_s32 maxFrames,
+    cds_spline_s32 *outFrameCount) {
+    const cds_spline_s32 frameCount = CDS_SPLINE_MIN(CDS_SPLINE_MAX(maxFrames, 0), sweep->ringCount - sweep->nextRing);
+    cds_spline_s32 iFrame;
+    for(iFrame=0; iFrame<frameCount; iFrame += 1) {
+        cds_spline3__sweep_advance(sweep);
+        outFrames[iFrame] = sweep->frame;
+    }
+    *outFrameCount = frameCount;
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_sweep_next(cds_spline_sweep3 *sweep, cds_spline_vec3 *outPositions, cds_spline_vec3 *outNormals,
+    cds_spline_s32 maxVerts, cds_spline_u32 *outIndices, cds_spline_s32 maxIndices, cds_spline_s32 *outVertCount,
+    cds_spline_s32 *outIndexCount) {
+    const cds_spline_s32 vertsPerRing = sweep->vertsPerRing;
+    /* every chunk after the first repeats the last ring of the previous one */
+    const cds_spline_s32 repeatRing = (sweep->nextRing > 0) ? 1 : 0;
+    const cds_spline_r32 angleStep = 6.283185307f / (cds_spline_r32)vertsPerRing;
+    const cds_spline_r32 cosStep = (cds_spline_r32)cos(angleStep), sinStep = (cds_spline_r32)sin(angleStep);
+    cds_spline_s32 ringCount, iRing, iVert, indexCount = 0;
+    *outVertCount = 0;
+    *outIndexCount = 0;
+    if (sweep->nextRing == sweep->ringCount)
+        return kCdsSplineErrorNone;
+    ringCount = CDS_SPLINE_MIN(maxVerts / vertsPerRing, maxIndices / (6*vertsPerRing) + 1);
+    if (ringCount < 2)
+        return kCdsSplineErrorSweepNext_BufferSize;
+    ringCount = CDS_SPLINE_MIN(ringCount, sweep->ringCount - sweep->nextRing + repeatRing);
+    for(iRing=0; iRing<ringCount; iRing += 1) {
+        const cds_spline_u32 base = (cds_spline_u32)(iRing*vertsPerRing);
+        const cds_spline_frame3 *frame = &sweep->frame;
+        /* cos/sin of the vertex angle, advanced by a rotation and restarted every ring */
+        cds_spline_r32 c = 1, s = 0;
+        if (iRing >= repeatRing)
+            cds_spline3__sweep_advance(sweep);
+        for(iVert=0; iVert<vertsPerRing; iVert += 1) {
+            const cds_spline_vec3 dir = cds_spline_init_vec3(c*frame->normal.x + s*frame->binormal.x,
+                c*frame->normal.y + s*frame->binormal.y, c*frame->normal.z + s*frame->binormal.z);
+            const cds_spline_r32 nextC = c*cosStep - s*sinStep;
+            s = s*cosStep + c*sinStep;
+            c = nextC;
+            outPositions[base + iVert] = cds_spline_init_vec3(frame->position.x + sweep->radius*dir.x,
+                frame->position.y + sweep->radius*dir.y, frame->position.z + sweep->radius*dir.z);
+            if (outNormals != NULL)
+                outNormals[base + iVert] = dir;
+        }
+        if (iRing > 0) {
+            const cds_spline_u32 prev = base - (cds_spline_u32)vertsPerRing;
+            for(iVert=0; iVert<vertsPerRing; iVert += 1) {
+                const cds_spline_u32 next = (iVert+1 < vertsPerRing) ? (cds_spline_u32)(iVert+1) : 0;
+                outIndices[indexCount++] = prev + iVert;
+                outIndices[indexCount++] = prev + next;
+                outIndices[indexCount++] = base + iVert;
+                outIndices[indexCount++] = prev + next;
+                outIndices[indexCount++] = base + next;
+                outIndices[indexCount++] = base + iVert;
+            }
+        }
+    }
+    *outVertCount = ringCount*vertsPerRing;
+    *outIndexCount = indexCount;
+    return kCdsSplineErrorNone;
+}
+
+/* Roots of polynomials in [0..1], for the intersection queries. Each root is bracketed by a piece
+ * [lo..hi] on which the polynomial changes sign, and found by Newton's method, falling back to
+ * bisection whenever a step would leave the bracket. */
+#define CDS_SPLINE__ROOT_ITERATIONS 24
+#define CDS_SPLINE__ROOT_TOLERANCE 1e-7f
+
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline__eval_poly(const cds_spline_r32 *coefs, cds_spline_s32 degree, cds_spline_r32 u) {
+    cds_spline_r32 result = coefs[degree];
+    cds_spline_s32 iDeg;
+    for(iDeg=degree-1; iDeg>=0; iDeg -= 1) {
+        result = result*u + coefs[iDeg];
+    }
+    return result;
+}
+
+/* Requires f(lo) and f(hi) to differ in sign (or one of them to be zero); dcoefs are f's derivative. */
+static cds_spline_r32
+cds_spline__poly_root(const cds_spline_r32 *coefs, const cds_spline_r32 *dcoefs, cds_spline_s32 degree,
+    cds_spline_r32 lo, cds_spline_r32 hi, cds_spline_r32 flo, cds_spline_r32 fhi) {
+    cds_spline_r32 x = 0.5f*(lo + hi);
+    cds_spline_s32 iIter;
+    if (flo == 0)
+        return lo;
+    if (fhi == 0)
+        return hi;
+    for(iIter=0; iIter<CDS_SPLINE__ROOT_ITERATIONS; iIter += 1) {
+        const cds_spline_r32 fx = cds_spline__eval_poly(coefs, degree, x);
+        const cds_spline_r32 dfx = cds_spline__eval_poly(dcoefs, degree-1, x);
+        cds_spline_r32 next;
+        if (fx == 0)
+            break;
+        if ((fx < 0) == (flo < 0))
+            lo = x;
+        else
+            hi = x;
+        next = x - fx/dfx;
+        if (!(next > lo && next < hi))
+            next = 0.5f*(lo + hi);
+        if (fabs(next - x) <= CDS_SPLINE__ROOT_TOLERANCE) {
+            x = next;
+            break;
+        }
+        x = next;
+    }
+    return x;
+}
+
+/* Adds root to a lane's sorted roots, unless it repeats the last one (a touching root is found by
+ * the pieces on both sides of the extremum it sits at). */
+static CDS_SPLINE_INLINE void
+cds_spline__add_root(cds_spline_r32 *roots, cds_spline_s32 *inOutCount, cds_spline_r32 root) {
+    if (*inOutCount > 0 && root <= roots[*inOutCount-1] + 1e-6f)
+        return;
+    roots[(*inOutCount)++] = root;
+}
+
+#if defined(CDS_SPLINE__SIMD_SSE)
+/* mask ? a : b, per lane */
+static CDS_SPLINE_INLINE __m128
+cds_spline__select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+/* Solves CDS_SPLINE_CUBIC_BATCH cubics at once. coefs[k*CDS_SPLINE_CUBIC_BATCH + lane] is the u^k
+ * coefficient of lane's cubic. Writes each lane's roots in [0..1], in increasing order, to
+ * outRoots[lane*3 + i], and their number to outRootCounts[lane].
+ *
+ * The extrema of a cubic are the roots of its derivative, a quadratic solved in closed form (in
+ * the form that stays accurate when one root is tiny, and degrades to the linear case when the
+ * leading coefficient is zero). Clamped to [0..1], they split it into three monotone pieces, some
+ * possibly empty; each piece holds at most one root. */
+static void
+cds_spline__solve_cubics(const cds_spline_r32 *coefs, cds_spline_r32 *outRoots, cds_spline_s32 *outRootCounts) {
+    cds_spline_s32 iLane, iPiece;
+#if defined(CDS_SPLINE__SIMD_SSE)
+    const __m128 vZero = _mm_setzero_ps(), vOne = _mm_set1_ps(1), vHalf = _mm_set1_ps(0.5f);
+    const __m128 vSignMask = _mm_set1_ps(-0.0f), vTolerance = _mm_set1_ps(CDS_SPLINE__ROOT_TOLERANCE);
+    const __m128 c0 = _mm_loadu_ps(coefs+0), c1 = _mm_loadu_ps(coefs+4), c2 = _mm_loadu_ps(coefs+8), c3 = _mm_loadu_ps(coefs+12);
+    const __m128 d0 = c1, d1 = _mm_mul_ps(_mm_set1_ps(2), c2), d2 = _mm_mul_ps(_mm_set1_ps(3), c3);
+    const __m128 disc = _mm_sub_ps(_mm_mul_ps(d1, d1), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4), d2), d0));
+    const __m128 hasExtrema = _mm_cmpgt_ps(disc, vZero);
+    /* q = -(d1 + sign(d1)*sqrt(disc))/2; the roots are q/d2 and d0/q */
+    const __m128 q = _mm_mul_ps(_mm_set1_ps(-0.5f),
+        _mm_add_ps(d1, _mm_or_ps(_mm_sqrt_ps(_mm_max_ps(disc, vZero)), _mm_and_ps(d1, vSignMask))));
+    /* _mm_max_ps returns its second operand when the first is NaN, so 0/0 clamps to 0 */
+    __m128 r1 = _mm_min_ps(_mm_max_ps(_mm_div_ps(q, d2), vZero), vOne);
+    __m128 r2 = _mm_min_ps(_mm_max_ps(_mm_div_ps(d0, q), vZero), vOne);
+    __m128 bounds[4], values[4];
+    cds_spline_r32 laneRoots[4];
+    r1 = _mm_and_ps(hasExtrema, r1);
+    r2 = _mm_and_ps(hasExtrema, r2);
+    bounds[0] = vZero;
+    bounds[1] = _mm_min_ps(r1, r2);
+    bounds[2] = _mm_max_ps(r1, r2);
+    bounds[3] = vOne;
+    for(iPiece=0; iPiece<4; iPiece += 1) {
+        const __m128 u = bounds[iPiece];
+        values[iPiece] = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c3, u), c2), u), c1), u), c0);
+    }
+    for(iLane=0; iLane<4; iLane += 1) {
+        outRootCounts[iLane] = 0;
+    }
+    for(iPiece=0; iPiece<3; iPiece += 1) {
+        __m128 lo = bounds[iPiece], hi = bounds[iPiece+1];
+        const __m128 flo = values[iPiece], fhi = values[iPiece+1];
+        const __m128 loNegative = _mm_cmplt_ps(flo, vZero);
+        const __m128 hasRoot = _mm_or_ps(_mm_and_ps(_mm_cmple_ps(flo, vZero), _mm_cmpge_ps(fhi, vZero)),
+            _mm_and_ps(_mm_cmpge_ps(flo, vZero), _mm_cmple_ps(fhi, vZero)));
+        const __m128 loIsRoot = _mm_cmpeq_ps(flo, vZero), hiIsRoot = _mm_andnot_ps(loIsRoot, _mm_cmpeq_ps(fhi, vZero));
+        __m128 done = _mm_or_ps(_mm_andnot_ps(hasRoot, _mm_castsi128_ps(_mm_set1_epi32(-1))), _mm_or_ps(loIsRoot, hiIsRoot));
+        __m128 x = _mm_mul_ps(vHalf, _mm_add_ps(lo, hi));
+        const cds_spline_s32 rootMask = _mm_movemask_ps(hasRoot);
+        cds_spline_s32 iIter;
+        if (rootMask == 0)
+            continue;
+        x = cds_spline__select4(loIsRoot, lo, cds_spline__select4(hiIsRoot, hi, x));
+        for(iIter=0; iIter<CDS_SPLINE__ROOT_ITERATIONS && _mm_movemask_ps(done) != 0xF; iIter += 1) {
+            const __m128 fx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c3, x), c2), x), c1), x), c0);
+            const __m128 dfx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(d2, x), d1), x), d0);
+            /* lanes whose x has the same sign as lo move lo; the rest move hi */
+            const __m128 moveLo = _mm_andnot_ps(_mm_xor_ps(_mm_cmplt_ps(fx, vZero), loNegative), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+            __m128 next, inside, converged;
+            done = _mm_or_ps(done, _mm_cmpeq_ps(fx, vZero));
+            lo = cds_spline__select4(_mm_andnot_ps(done, moveLo), x, lo);
+            hi = cds_spline__select4(_mm_andnot_ps(done, _mm_andnot_ps(moveLo, _mm_castsi128_ps(_mm_set1_epi32(-1)))), x, hi);
+            next = _mm_sub_ps(x, _mm_div_ps(fx, dfx));
+            inside = _mm_and_ps(_mm_cmpgt_ps(next, lo), _mm_cmplt_ps(next, hi));
+            next = cds_spline__select4(inside, next, _mm_mul_ps(vHalf, _mm_add_ps(lo, hi)));
+            converged = _mm_cmple_ps(_mm_andnot_ps(vSignMask, _mm_sub_ps(next, x)), vTolerance);
+            x = cds_spline__select4(done, x, next);
+            done = _mm_or_ps(done, converged);
+        }
+        _mm_storeu_ps(laneRoots, x);
+        for(iLane=0; iLane<4; iLane += 1) {
+            if (rootMask & (1 << iLane))
+                cds_spline__add_root(outRoots + 3*iLane, outRootCounts + iLane, laneRoots[iLane]);
+        }
+    }
+#else
+    for(iLane=0; iLane<CDS_SPLINE_CUBIC_BATCH; iLane += 1) {
+        cds_spline_r32 c[4], d[3], bounds[4], values[4], disc, q, r1, r2;
+        for(iPiece=0; iPiece<4; iPiece += 1) {
+            c[iPiece] = coefs[iPiece*CDS_SPLINE_CUBIC_BATCH + iLane];
+        }
+        d[0] = c[1];
+        d[1] = 2*c[2];
+        d[2] = 3*c[3];
+        disc = d[1]*d[1] - 4*d[2]*d[0];
+        r1 = r2 = 0;
+        if (disc > 0) {
+            q = -0.5f*(d[1] + ((d[1] < 0) ? -(cds_spline_r32)sqrt(disc) : (cds_spline_r32)sqrt(disc)));
+            if (d[2] != 0)
+                r1 = CDS_SPLINE_MIN(CDS_SPLINE_MAX(q/d[2], 0.0f), 1.0f);
+            if (q != 0)
+                r2 = CDS_SPLINE_MIN(CDS_SPLINE_MAX(d[0]/q, 0.0f), 1.0f);
+        }
+        bounds[0] = 0;
+        bounds[1] = CDS_SPLINE_MIN(r1, r2);
+        bounds[2] = CDS_SPLINE_MAX(r1, r2);
+        bounds[3] = 1;
+        for(iPiece=0; iPiece<4; iPiece += 1) {
+            values[iPiece] = cds_spline__eval_poly(c, 3, bounds[iPiece]);
+        }
+        outRootCounts[iLane] = 0;
+        for(iPiece=0; iPiece<3; iPiece += 1) {
+            const cds_spline_r32 flo = values[iPiece], fhi = values[iPiece+1];
+            if ((flo <= 0 && fhi >= 0) || (flo >= 0 && fhi <= 0)) {
+                cds_spline__add_root(outRoots + 3*iLane, outRootCounts + iLane,
+                    cds_spline__poly_root(c, d, 3, bounds[iPiece], bounds[iPiece+1], flo, fhi));
+            }
+        }
+    }
+#endif
+}
+
+/* Appends a hit, or only counts it once outHits is full. */
+static CDS_SPLINE_INLINE void
+cds_spline3__add_hit(cds_spline_hit3 *outHits, cds_spline_s32 maxHits, cds_spline_s32 *inOutHitCount,
+    cds_spline_s32 segment, cds_spline_r32 u, cds_spline_vec3 position, cds_spline_r32 distance, cds_spline_r32 rayDistance) {
+    if (outHits != NULL && *inOutHitCount < maxHits) {
+        cds_spline_hit3 *hit = outHits + *inOutHitCount;
+        hit->segment = segment;
+        hit->u = u;
+        hit->position = position;
+        hit->distance = distance;
+        hit->rayDistance = rayDistance;
+    }
+    *inOutHitCount += 1;
+}
+
+/* A batch of segments for cds_spline__solve_cubics(), with its lanes' segment indices. */
+typedef struct cds_spline3__plane_batch {
+    cds_spline_r32 coefs[4*CDS_SPLINE_CUBIC_BATCH];
+    cds_spline_s32 segments[CDS_SPLINE_CUBIC_BATCH];
+    cds_spline_s32 laneCount;
+} cds_spline3__plane_batch;
+
+static void
+cds_spline3__solve_plane_batch(const cds_spline3 *spline, cds_spline3__plane_batch *batch, cds_spline_hit3 *outHits,
+    cds_spline_s32 maxHits, cds_spline_s32 *inOutHitCount) {
+    cds_spline_r32 roots[3*CDS_SPLINE_CUBIC_BATCH];
+    cds_spline_s32 rootCounts[CDS_SPLINE_CUBIC_BATCH], iLane, iRoot, iDeg;
+    /* unused lanes hold the constant 1, which has no roots */
+    for(iLane=batch->laneCount; iLane<CDS_SPLINE_CUBIC_BATCH; iLane += 1) {
+        for(iDeg=0; iDeg<4; iDeg += 1) {
+            batch->coefs[iDeg*CDS_SPLINE_CUBIC_BATCH + iLane] = (iDeg == 0) ? 1.0f : 0.0f;
+        }
+    }
+    cds_spline__solve_cubics(batch->coefs, roots, rootCounts);
+    for(iLane=0; iLane<batch->laneCount; iLane += 1) {
+        const cds_spline_mat34 *m = cds_spline3__segment(spline, batch->segments[iLane]);
+        for(iRoot=0; iRoot<rootCounts[iLane]; iRoot += 1) {
+            const cds_spline_r32 u = roots[3*iLane + iRoot];
+            cds_spline3__add_hit(outHits, maxHits, inOutHitCount, batch->segments[iLane], u,
+                cds_spline3__eval_segment(m, u), 0, 0);
+        }
+    }
+    batch->laneCount = 0;
+}
+
+static CDS_SPLINE_INLINE void
+cds_spline3__add_plane_segment(const cds_spline3 *spline, cds_spline_s32 segment, cds_spline_vec3 normal,
+    cds_spline_r32 offset, cds_spline3__plane_batch *batch, cds_spline_hit3 *outHits, cds_spline_s32 maxHits,
+    cds_spline_s32 *inOutHitCount) {
+    const cds_spline_r32 *m = cds_spline3__segment(spline, segment)->elems;
+    const cds_spline_s32 lane = batch->laneCount;
+    cds_spline_s32 iDeg;
+    for(iDeg=0; iDeg<4; iDeg += 1) {
+        batch->coefs[iDeg*CDS_SPLINE_CUBIC_BATCH + lane] = normal.x*m[3*iDeg+0] + normal.y*m[3*iDeg+1] + normal.z*m[3*iDeg+2];
+    }
+    batch->coefs[lane] -= offset;
+    batch->segments[lane] = segment;
+    batch->laneCount += 1;
+    if (batch->laneCount == CDS_SPLINE_CUBIC_BATCH)
+        cds_spline3__solve_plane_batch(spline, batch, outHits, maxHits, inOutHitCount);
+}
+
+cds_spline_error_t
+cds_spline3_intersect_plane(const cds_spline3 *spline, cds_spline_vec3 planeNormal, cds_spline_r32 planeOffset,
+    cds_spline_hit3 *outHits, cds_spline_s32 maxHits, cds_spline_s32 *outHitCount) {
+    cds_spline3__plane_batch batch;
+    cds_spline_s32 hitCount = 0, iSeg;
+    *outHitCount = 0;
+    if (!(cds_spline3__dot(planeNormal, planeNormal) > 0))
+        return kCdsSplineErrorIntersect_Direction;
+    cds_spline3__flush_pending(spline);
+    batch.laneCount = 0;
+    if (spline->segmentBounds != NULL) {
+        /* Depth-first, left child first, so segments come out in order. A node is skipped when
+         * its box lies entirely on one side of the plane. */
+        const cds_spline_aabb3 *nodes = spline->segmentBounds;
+        const cds_spline_s32 leafCount = spline->boundsLeafCount;
+        cds_spline_s32 stack[64], stackSize = 0, iComp;
+        stack[stackSize++] = 1;
+        while(stackSize > 0) {
+            const cds_spline_s32 iNode = stack[--stackSize];
+            cds_spline_r32 nearest = 0, farthest = 0;
+            for(iComp=0; iComp<3; iComp += 1) {
+                const cds_spline_r32 n = planeNormal.elems[iComp];
+                nearest  += n * ((n > 0) ? nodes[iNode].min.elems[iComp] : nodes[iNode].max.elems[iComp]);
+                farthest += n * ((n > 0) ? nodes[iNode].max.elems[iComp] : nodes[iNode].min.elems[iComp]);
+            }
+            if (nearest > planeOffset || farthest < planeOffset)
+                continue;
+            if (iNode >= leafCount) {
+                iSeg = iNode - leafCount;
+                if (iSeg < spline->numSegments)
+                    cds_spline3__add_plane_segment(spline, iSeg, planeNormal, planeOffset, &batch, outHits, maxHits, &hitCount);
+            } else {
+                CDS_SPLINE_ASSERT(stackSize+2 <= (cds_spline_s32)(sizeof(stack)/sizeof(stack[0])));
+                stack[stackSize++] = 2*iNode+1;
+                stack[stackSize++] = 2*iNode;
+            }
+        }
+    } else {
+        for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+            cds_spline3__add_plane_segment(spline, iSeg, planeNormal, planeOffset, &batch, outHits, maxHits, &hitCount);
+        }
+    }
+    if (batch.laneCount > 0)
+        cds_spline3__solve_plane_batch(spline, &batch, outHits, maxHits, &hitCount);
+    *outHitCount = hitCount;
+    if (outHits != NULL && hitCount > maxHits)
+        return kCdsSplineErrorIntersect_BufferSize;
+    return kCdsSplineErrorNone;
+}
+
+/* Slab test of a ray (with unit direction) against a box grown by radius on every side. */
+static CDS_SPLINE_INLINE cds_spline_bool32_t
+cds_spline3__ray_hits_bounds(const cds_spline_aabb3 *bounds, cds_spline_vec3 origin, cds_spline_vec3 dir,
+    cds_spline_r32 radius) {
+    cds_spline_r32 tMin = 0, tMax = 3.0e38f;
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; iComp += 1) {
+        const cds_spline_r32 lo = bounds->min.elems[iComp] - radius, hi = bounds->max.elems[iComp] + radius;
+        const cds_spline_r32 o = origin.elems[iComp], d = dir.elems[iComp];
+        if (fabs(d) < 1e-12f) {
+            if (o < lo || o > hi)
+                return 0;
+        } else {
+            const cds_spline_r32 t0 = (lo - o) / d, t1 = (hi - o) / d;
+            tMin = CDS_SPLINE_MAX(tMin, CDS_SPLINE_MIN(t0, t1));
+            tMax = CDS_SPLINE_MIN(tMax, CDS_SPLINE_MAX(t0, t1));
+            if (tMin > tMax)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/* The squared distance from a segment to the ray's line is h(u) = |w(u)|^2, where w is the part of
+ * p(u) - origin perpendicular to the ray; w is a cubic, so h's coefficients are sums of dot products
+ * of w's. Local minima of h are where h' changes sign from negative to positive, and at the ends of
+ * the spline where h' points outwards. */
+static void
+cds_spline3__intersect_ray_segment(const cds_spline3 *spline, cds_spline_s32 segment, cds_spline_vec3 origin,
+    cds_spline_vec3 dir, cds_spline_r32 radius, cds_spline_hit3 *outHits, cds_spline_s32 maxHits,
+    cds_spline_s32 *inOutHitCount) {
+    const cds_spline_mat34 *m = cds_spline3__segment(spline, segment);
+    cds_spline_vec3 w[4];
+    cds_spline_r32 h[7], dh[6], ddh[5], minima[CDS_SPLINE_RAY_SAMPLES+2], prevU = 0, prevSlope;
+    cds_spline_s32 iDeg, jDeg, iSamp, minimumCount = 0;
+    for(iDeg=0; iDeg<4; iDeg += 1) {
+        cds_spline_vec3 row = cds_spline_init_vec3(m->elems[3*iDeg+0], m->elems[3*iDeg+1], m->elems[3*iDeg+2]);
+        if (iDeg == 0)
+            row = cds_spline3__sub_scaled(row, 1.0f, origin);
+        w[iDeg] = cds_spline3__sub_scaled(row, cds_spline3__dot(row, dir), dir);
+    }
+    for(iDeg=0; iDeg<7; iDeg += 1) {
+        h[iDeg] = 0;
+    }
+    for(iDeg=0; iDeg<4; iDeg += 1) {
+        for(jDeg=0; jDeg<4; jDeg += 1) {
+            h[iDeg+jDeg] += cds_spline3__dot(w[iDeg], w[jDeg]);
+        }
+    }
+    for(iDeg=1; iDeg<7; iDeg += 1) {
+        dh[iDeg-1] = (cds_spline_r32)iDeg * h[iDeg];
+    }
+    for(iDeg=1; iDeg<6; iDeg += 1) {
+        ddh[iDeg-1] = (cds_spline_r32)iDeg * dh[iDeg];
+    }
+    prevSlope = cds_spline__eval_poly(dh, 5, 0);
+    if (segment == 0 && prevSlope > 0)
+        minima[minimumCount++] = 0;
+    for(iSamp=1; iSamp<=CDS_SPLINE_RAY_SAMPLES; iSamp += 1) {
+        const cds_spline_r32 u = (cds_spline_r32)iSamp / (cds_spline_r32)CDS_SPLINE_RAY_SAMPLES;
+        const cds_spline_r32 slope = cds_spline__eval_poly(dh, 5, u);
+        if (prevSlope < 0 && slope >= 0)
+            minima[minimumCount++] = cds_spline__poly_root(dh, ddh, 5, prevU, u, prevSlope, slope);
+        prevU = u;
+        prevSlope = slope;
+    }
+    if (segment == spline->numSegments-1 && prevSlope < 0)
+        minima[minimumCount++] = 1;
+    for(iSamp=0; iSamp<minimumCount; iSamp += 1) {
+        const cds_spline_r32 u = minima[iSamp];
+        const cds_spline_vec3 position = cds_spline3__eval_segment(m, u);
+        const cds_spline_vec3 rel = cds_spline3__sub_scaled(position, 1.0f, origin);
+        const cds_spline_r32 along = cds_spline3__dot(rel, dir);
+        const cds_spline_vec3 perp = cds_spline3__sub_scaled(rel, along, dir);
+        const cds_spline_r32 distance = (cds_spline_r32)sqrt(cds_spline3__dot(perp, perp));
+        if (along >= 0 && distance <= radius)
+            cds_spline3__add_hit(outHits, maxHits, inOutHitCount, segment, u, position, distance, along);
+    }
+}
+
+cds_spline_error_t
+cds_spline3_intersect_ray(const cds_spline3 *spline, cds_spline_vec3 rayOrigin, cds_spline_vec3 rayDirection,
+    cds_spline_r32 radius, cds_spline_hit3 *outHits, cds_spline_s32 maxHits, cds_spline_s32 *outHitCount) {
+    cds_spline_s32 hitCount = 0, iSeg;
+    *outHitCount = 0;
+    if (!cds_spline3__normalize(&rayDirection))
+        return kCdsSplineErrorIntersect_Direction;
+    if (!(radius >= 0))
+        return kCdsSplineErrorIntersect_Radius;
+    cds_spline3__flush_pending(spline);
+    if (spline->segmentBounds != NULL) {
+        const cds_spline_aabb3 *nodes = spline->segmentBounds;
+        const cds_spline_s32 leafCount = spline->boundsLeafCount;
+        cds_spline_s32 stack[64], stackSize = 0;
+        stack[stackSize++] = 1;
+        while(stackSize > 0) {
+            const cds_spline_s32 iNode = stack[--stackSize];
+            if (!cds_spline3__ray_hits_bounds(nodes + iNode, rayOrigin, rayDirection, radius))
+                continue;
+            if (iNode >= leafCount) {
+                iSeg = iNode - leafCount;
+                if (iSeg < spline->numSegments)
+                    cds_spline3__intersect_ray_segment(spline, iSeg, rayOrigin, rayDirection, radius, outHits, maxHits, &hitCount);
+            } else {
+                CDS_SPLINE_ASSERT(stackSize+2 <= (cds_spline_s32)(sizeof(stack)/sizeof(stack[0])));
+                stack[stackSize++] = 2*iNode+1;
+                stack[stackSize++] = 2*iNode;
+            }
+        }
+    } else {
+        for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+            cds_spline3__intersect_ray_segment(spline, iSeg, rayOrigin, rayDirection, radius, outHits, maxHits, &hitCount);
+        }
+    }
+    *outHitCount = hitCount;
+    if (outHits != NULL && hitCount > maxHits)
+        return kCdsSplineErrorIntersect_BufferSize;
+    return kCdsSplineErrorNone;
+}
+
+size_t
+cds_spline3_fitter_buffer_size(cds_spline_s32 windowSize) {
+    if (windowSize < 3)
+        return 0;
+    return (size_t)windowSize * (sizeof(cds_spline_vec3) + 2*sizeof(cds_spline_r32));
+}
+
+cds_spline_error_t
+cds_spline3_fitter_init(cds_spline_fitter3 *outFitter, cds_spline3 *spline, cds_spline_r32 maxError,
+    cds_spline_s32 windowSize, void *buffer, size_t bufferSize) {
+    if (spline->interpStyle != kCdsSplineInterpStyleHermite)
+        return kCdsSplineErrorFitterInit_InterpStyle;
+    if (spline->flags & kCdsSplineFlagReadOnly)
+        return kCdsSplineErrorFitterInit_ReadOnly;
+    if (windowSize < 3)
+        return kCdsSplineErrorFitterInit_WindowSize;
+    if (!(maxError >= 0))
+        return kCdsSplineErrorFitterInit_MaxError;
+    if (bufferSize < cds_spline3_fitter_buffer_size(windowSize))
+        return kCdsSplineErrorFitterInit_BufferSize;
+    outFitter->spline = spline;
+    outFitter->samples = (cds_spline_vec3*)buffer;
+    outFitter->times = (cds_spline_r32*)(outFitter->samples + windowSize);
+    outFitter->params = outFitter->times + windowSize;
+    outFitter->maxError = maxError;
+    outFitter->windowSize = windowSize;
+    outFitter->sampleCount = 0;
+    outFitter->midIndex = 0;
+    outFitter->anchorKnot = 0;
+    outFitter->anchorTangentFixed = 0;
+    outFitter->anchorTangent = cds_spline_init_vec3(0, 0, 0);
+    if (spline->numKnots > 0) {
+        /* continue from the last knot, as if it had just been committed */
+        const cds_spline_knot3 *last = spline->knots + spline->numKnots-1;
+        outFitter->samples[0] = last->position;
+        outFitter->times[0] = (spline->knotTimes != NULL) ? spline->knotTimes[spline->numKnots-1] : 0;
+        outFitter->sampleCount = 1;
+        outFitter->anchorKnot = spline->numKnots-1;
+        outFitter->anchorTangentFixed = 1;
+        outFitter->anchorTangent = last->tangent;
+    }
+    return kCdsSplineErrorNone;
+}
+
+/* Writes each window sample's chord length from the window's first sample to params, and
+ * returns the window's total. */
+static cds_spline_r32
+cds_spline3__fitter_measure(cds_spline_fitter3 *fitter) {
+    cds_spline_s32 i;
+    fitter->params[0] = 0;
+    for(i=1; i<fitter->sampleCount; i += 1) {
+        fitter->params[i] = fitter->params[i-1] +
+            (cds_spline_r32)sqrt(cds_spline3__distance_sq(fitter->samples[i], fitter->samples[i-1]));
+    }
+    return fitter->params[fitter->sampleCount-1];
+}
+
+/* Index of the window sample closest to halfway along the window by chord length, for the
+ * middle knot. A knot's tangent is shared by the segments on either side of it, so it fits both
+ * best when they are of similar length. */
+static cds_spline_s32
+cds_spline3__fitter_pick_mid(cds_spline_fitter3 *fitter) {
+    const cds_spline_s32 last = fitter->sampleCount-1;
+    const cds_spline_r32 *measure = fitter->params;
+    const cds_spline_r32 target = 0.5f * cds_spline3__fitter_measure(fitter);
+    cds_spline_s32 mid = 1;
+    CDS_SPLINE_ASSERT(last >= 2);
+    while (mid < last-1 && measure[mid] < target)
+        mid += 1;
+    /* mid is the first sample at or past the target; the one before it may be closer */
+    if (mid > 1 && measure[mid] - target > target - measure[mid-1])
+        mid -= 1;
+    return mid;
+}
+
+/* Sets each window sample strictly inside [first..last] to its normalized chord length u along
+ * that segment, or to uniform spacing if the samples all coincide. */
+static void
+cds_spline3__fitter_params(cds_spline_fitter3 *fitter, cds_spline_s32 first, cds_spline_s32 last) {
+    cds_spline_r32 *u = fitter->params;
+    cds_spline_r32 total = 0;
+    cds_spline_s32 i;
+    for(i=first+1; i<=last; i += 1) {
+        total += (cds_spline_r32)sqrt(cds_spline3__distance_sq(fitter->samples[i], fitter->samples[i-1]));
+        u[i] = total;
+    }
+    for(i=first+1; i<last; i += 1) {
+        u[i] = (total > 0) ? u[i] / total : (cds_spline_r32)(i - first) / (cds_spline_r32)(last - first);
+    }
+}
+
+/* Moves each window sample strictly inside [first..last] to the parameter of the nearest point on
+ * the Hermite segment (p0, t0, p1, t1), by one Gauss-Newton step from its current u (kept if the
+ * step does not help), and returns the largest squared distance between a sample and the segment
+ * at its u. Each distance is to some point of the curve, so this bounds the true deviation. */
+static cds_spline_r32
+cds_spline3__fitter_project(cds_spline_fitter3 *fitter, cds_spline_s32 first, cds_spline_s32 last,
+    cds_spline_vec3 t0, cds_spline_vec3 t1) {
+    const cds_spline_vec3 p0 = fitter->samples[first], p1 = fitter->samples[last];
+    const cds_spline_vec3 zero = {{0, 0, 0}};
+    cds_spline_r32 maxErrorSq = 0;
+    cds_spline_s32 i, iStep;
+    for(i=first+1; i<last; i += 1) {
+        cds_spline_r32 u1 = fitter->params[i], errorSq = 0;
+        for(iStep=0; iStep<2; iStep += 1) {
+            const cds_spline_r32 u2 = u1*u1, u3 = u2*u1;
+            cds_spline_vec3 p = cds_spline3__add_scaled(zero, 2*u3 - 3*u2 + 1, p0), d;
+            cds_spline_r32 dd;
+            p = cds_spline3__add_scaled(p, u3 - 2*u2 + u1, t0);
+            p = cds_spline3__add_scaled(p, -2*u3 + 3*u2, p1);
+            p = cds_spline3__add_scaled(p, u3 - u2, t1);
+            p = cds_spline3__sub_scaled(p, 1.0f, fitter->samples[i]);
+            if (iStep == 1) {
+                /* keep the step only if it got closer */
+                if (cds_spline3__dot(p, p) < errorSq) {
+                    fitter->params[i] = u1;
+                    errorSq = cds_spline3__dot(p, p);
+                }
+                break;
+            }
+            errorSq = cds_spline3__dot(p, p);
+            d = cds_spline3__add_scaled(zero, 6*u2 - 6*u1, p0);
+            d = cds_spline3__add_scaled(d, 3*u2 - 4*u1 + 1, t0);
+            d = cds_spline3__add_scaled(d, -6*u2 + 6*u1, p1);
+            d = cds_spline3__add_scaled(d, 3*u2 - 2*u1, t1);
+            dd = cds_spline3__dot(d, d);
+            if (!(dd > 0))
+                break;
+            u1 = CDS_SPLINE_MIN(CDS_SPLINE_MAX(u1 - cds_spline3__dot(p, d) / dd, 0.0f), 1.0f);
+        }
+        maxErrorSq = CDS_SPLINE_MAX(maxErrorSq, errorSq);
+    }
+    return maxErrorSq;
+}
+
+/* Weight pulling each free tangent toward its initial estimate, so that the fit stays well-posed
+ * when a segment has few or no interior samples. Small next to a single interior sample's weight
+ * (which is at least 0.02 in the middle of a segment). */
+#define CDS_SPLINE__FITTER_DAMPING 1e-5f
+/* Rounds of fitting tangents to the samples' parameters, then moving the parameters to the
+ * nearest points of the fit */
+#define CDS_SPLINE__FITTER_ITERATIONS 3
+
+/* Solves the least-squares system for the free tangents of the open knots (see fitter_solve). */
+static void
+cds_spline3__fitter_least_squares(cds_spline_fitter3 *fitter, const cds_spline_s32 knotSample[3],
+    cds_spline_s32 mid, cds_spline_vec3 tangents[3]) {
+    const cds_spline_vec3 *samples = fitter->samples;
+    cds_spline_s32 row[3]; /* each knot's row in the system, or -1 if its tangent is fixed */
+    cds_spline_r32 m[3][3];
+    cds_spline_vec3 rhs[3];
+    cds_spline_s32 rowCount = 0, iSeg, i, j, k;
+    row[0] = fitter->anchorTangentFixed ? -1 : rowCount++;
+    row[1] = (mid > 0) ? rowCount++ : -1;
+    row[2] = rowCount++;
+    for(i=0; i<3; i += 1) {
+        if (row[i] < 0)
+            continue;
+        for(j=0; j<rowCount; j += 1) {
+            m[row[i]][j] = (j == row[i]) ? CDS_SPLINE__FITTER_DAMPING : 0;
+        }
+        rhs[row[i]] = cds_spline3__add_scaled(cds_spline_init_vec3(0, 0, 0), CDS_SPLINE__FITTER_DAMPING, tangents[i]);
+    }
+    for(iSeg=(mid > 0) ? 0 : 1; iSeg<2; iSeg += 1) {
+        const cds_spline_s32 k0 = (iSeg == 0 || mid == 0) ? 0 : 1, k1 = (iSeg == 0) ? 1 : 2;
+        const cds_spline_s32 first = knotSample[k0], end = knotSample[k1], r0 = row[k0], r1 = row[k1];
+        for(i=first+1; i<end; i += 1) {
+            const cds_spline_r32 u1 = fitter->params[i], u2 = u1*u1, u3 = u2*u1;
+            const cds_spline_r32 h10 = u3 - 2*u2 + u1, h11 = u3 - u2;
+            cds_spline_vec3 r = cds_spline3__sub_scaled(samples[i], 2*u3 - 3*u2 + 1, samples[first]);
+            r = cds_spline3__sub_scaled(r, -2*u3 + 3*u2, samples[end]);
+            if (r0 < 0) {
+                r = cds_spline3__sub_scaled(r, h10, tangents[k0]);
+            } else {
+                m[r0][r0] += h10*h10;
+                m[r0][r1] += h10*h11;
+                m[r1][r0] += h10*h11;
+                rhs[r0] = cds_spline3__add_scaled(rhs[r0], h10, r);
+            }
+            m[r1][r1] += h11*h11;
+            rhs[r1] = cds_spline3__add_scaled(rhs[r1], h11, r);
+        }
+    }
+    /* Gaussian elimination; the system is positive definite, so no pivoting is needed */
+    for(i=0; i<rowCount; i += 1) {
+        for(j=i+1; j<rowCount; j += 1) {
+            const cds_spline_r32 f = m[j][i] / m[i][i];
+            for(k=i; k<rowCount; k += 1) {
+                m[j][k] -= f*m[i][k];
+            }
+            rhs[j] = cds_spline3__sub_scaled(rhs[j], f, rhs[i]);
+        }
+    }
+    for(i=rowCount-1; i>=0; i -= 1) {
+        for(j=i+1; j<rowCount; j += 1) {
+            rhs[i] = cds_spline3__sub_scaled(rhs[i], m[i][j], rhs[j]);
+        }
+        rhs[i] = cds_spline3__add_scaled(cds_spline_init_vec3(0, 0, 0), 1.0f / m[i][i], rhs[i]);
+    }
+    for(i=0; i<3; i += 1) {
+        if (row[i] >= 0)
+            tangents[i] = rhs[row[i]];
+    }
+}
+
+/* Fits the free tangents of the open knots, with the middle knot at window sample mid (0 for a
+ * single open segment), and returns the largest squared distance from a window sample to the
+ * fit. tangents[] holds the first, middle and last knots' tangents; free ones start as estimates
+ * and are overwritten. In the Hermite basis, p(u) = h00*P0 + h10*T0 + h01*P1 + h11*T1 is linear
+ * in the tangents, so for fixed sample parameters u the least-squares tangents solve a symmetric
+ * system of up to 3x3, shared by all components. Starting from chord-length u, each round fits
+ * the tangents and then reparameterizes: moves each u to the nearest point of the fit. */
+static cds_spline_r32
+cds_spline3__fitter_solve(cds_spline_fitter3 *fitter, cds_spline_s32 mid, cds_spline_vec3 tangents[3]) {
+    const cds_spline_s32 last = fitter->sampleCount-1;
+    cds_spline_s32 knotSample[3], iIter;
+    cds_spline_r32 errorSq = 0;
+    CDS_SPLINE_ASSERT(last >= 1 && mid < last);
+    knotSample[0] = 0;
+    knotSample[1] = mid;
+    knotSample[2] = last;
+    if (fitter->anchorTangentFixed)
+        tangents[0] = fitter->anchorTangent;
+    if (mid > 0)
+        cds_spline3__fitter_params(fitter, 0, mid);
+    cds_spline3__fitter_params(fitter, mid, last);
+    for(iIter=0; iIter<CDS_SPLINE__FITTER_ITERATIONS; iIter += 1) {
+        cds_spline3__fitter_least_squares(fitter, knotSample, mid, tangents);
+        if (mid == 0) {
+            errorSq = cds_spline3__fitter_project(fitter, 0, last, tangents[0], tangents[2]);
+        } else {
+            errorSq = CDS_SPLINE_MAX(cds_spline3__fitter_project(fitter, 0, mid, tangents[0], tangents[1]),
+                cds_spline3__fitter_project(fitter, mid, last, tangents[1], tangents[2]));
+        }
+    }
+    return errorSq;
+}
+
+/* Initial tangent estimates for a fit with the middle knot at window sample mid: each knot's
+ * neighbouring chords. */
+static void
+cds_spline3__fitter_estimate(const cds_spline_fitter3 *fitter, cds_spline_s32 mid, cds_spline_vec3 outTangents[3]) {
+    const cds_spline_vec3 *samples = fitter->samples;
+    const cds_spline_s32 last = fitter->sampleCount-1;
+    outTangents[0] = cds_spline3__sub_scaled(samples[mid > 0 ? mid : last], 1.0f, samples[0]);
+    outTangents[1] = cds_spline3__add_scaled(cds_spline_init_vec3(0, 0, 0), 0.5f,
+        cds_spline3__sub_scaled(samples[last], 1.0f, samples[0]));
+    outTangents[2] = cds_spline3__sub_scaled(samples[last], 1.0f, samples[mid]);
+}
+
+/* Commits the middle knot: it becomes the window's first sample, with its tangent fixed. */
+static void
+cds_spline3__fitter_commit(cds_spline_fitter3 *fitter) {
+    const cds_spline_s32 mid = fitter->midIndex;
+    cds_spline_s32 i;
+    CDS_SPLINE_ASSERT(mid > 0);
+    for(i=mid; i<fitter->sampleCount; i += 1) {
+        fitter->samples[i - mid] = fitter->samples[i];
+        fitter->times[i - mid] = fitter->times[i];
+    }
+    fitter->sampleCount -= mid;
+    fitter->midIndex = 0;
+    fitter->anchorKnot += 1;
+    fitter->anchorTangentFixed = 1;
+    fitter->anchorTangent = fitter->spline->knots[fitter->anchorKnot].tangent;
+}
+
+/* Writes the open knots to the spline (appending one if the middle knot is new), and the first
+ * knot's tangent if it is not committed yet. */
+static void
+cds_spline3__fitter_store(cds_spline_fitter3 *fitter, cds_spline_s32 mid, const cds_spline_vec3 tangents[3]) {
+    cds_spline3 *spline = fitter->spline;
+    const cds_spline_s32 last = fitter->sampleCount-1, openCount = (mid > 0) ? 2 : 1;
+    const cds_spline_s32 haveCount = spline->numKnots-1 - fitter->anchorKnot;
+    cds_spline_knot3 knots[2];
+    cds_spline_r32 times[2];
+    cds_spline_s32 i;
+    cds_spline_error_t error = kCdsSplineErrorNone;
+    CDS_SPLINE_ASSERT(haveCount >= 0 && haveCount <= openCount);
+    knots[0].position = fitter->samples[mid];
+    knots[0].tangent = tangents[1];
+    times[0] = fitter->times[mid];
+    knots[openCount-1].position = fitter->samples[last];
+    knots[openCount-1].tangent = tangents[2];
+    times[openCount-1] = fitter->times[last];
+    if (!fitter->anchorTangentFixed) {
+        cds_spline_knot3 anchor;
+        anchor.position = fitter->samples[0];
+        anchor.tangent = tangents[0];
+        error = cds_spline3_set_knot(spline, fitter->anchorKnot, anchor);
+        CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+    }
+    for(i=0; i<haveCount; i += 1) {
+        error = cds_spline3_set_knot(spline, fitter->anchorKnot+1 + i, knots[i]);
+        CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+    }
+    if (haveCount < openCount) {
+        error = cds_spline3_append_knots(spline, knots + haveCount, openCount - haveCount);
+        CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+    }
+    if (spline->knotTimes != NULL) {
+        error = cds_spline3_set_knot_times(spline, fitter->anchorKnot+1, times, openCount);
+        CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+    }
+    (void)error;
+    fitter->midIndex = mid;
+}
+
+/* Middle knot positions tried per fit, at most */
+#define CDS_SPLINE__FITTER_MID_CANDIDATES 8
+
+/* Fits the window, with the middle knot first halfway along it (by chord length), then at up to
+ * CDS_SPLINE__FITTER_MID_CANDIDATES-1 other samples spread over the window, latest first.
+ * Returns whether some fit is within the bound. */
+static cds_spline_bool32_t
+cds_spline3__fitter_fit(cds_spline_fitter3 *fitter, cds_spline_s32 *outMid, cds_spline_vec3 outTangents[3]) {
+    const cds_spline_r32 maxErrorSq = fitter->maxError*fitter->maxError;
+    const cds_spline_s32 last = fitter->sampleCount-1;
+    cds_spline_s32 preferred, candidateCount, iCandidate;
+    if (last < 2) {
+        *outMid = 0;
+        cds_spline3__fitter_estimate(fitter, 0, outTangents);
+        return cds_spline3__fitter_solve(fitter, 0, outTangents) <= maxErrorSq;
+    }
+    preferred = cds_spline3__fitter_pick_mid(fitter);
+    candidateCount = CDS_SPLINE_MIN(last-1, CDS_SPLINE__FITTER_MID_CANDIDATES-1);
+    for(iCandidate=-1; iCandidate<candidateCount; iCandidate += 1) {
+        const cds_spline_s32 mid = (iCandidate < 0) ? preferred :
+            last-1 - (last-2) * iCandidate / CDS_SPLINE_MAX(candidateCount-1, 1);
+        if (iCandidate >= 0 && mid == preferred)
+            continue;
+        cds_spline3__fitter_estimate(fitter, mid, outTangents);
+        if (cds_spline3__fitter_solve(fitter, mid, outTangents) <= maxErrorSq) {
+            *outMid = mid;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+cds_spline_error_t
+cds_spline3_fitter_push(cds_spline_fitter3 *fitter, cds_spline_vec3 point, cds_spline_r32 time) {
+    cds_spline3 *spline = fitter->spline;
+    cds_spline_s32 n = fitter->sampleCount, mid = 0;
+    cds_spline_vec3 tangents[3];
+    if (spline->knotTimes != NULL && n > 0 && !(time >= fitter->times[n-1]))
+        return kCdsSplineErrorFitterPush_Time;
+    /* a push adds at most one knot */
+    if (spline->numKnots == spline->maxNumKnots)
+        return kCdsSplineErrorFitterPush_MaxNumKnots;
+    if (n == 0) {
+        cds_spline_knot3 knot;
+        cds_spline_error_t error;
+        knot.position = point;
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        error = cds_spline3_append_knots(spline, &knot, 1);
+        CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+        if (spline->knotTimes != NULL) {
+            error = cds_spline3_set_knot_times(spline, spline->numKnots-1, &time, 1);
+            CDS_SPLINE_ASSERT(error == kCdsSplineErrorNone);
+        }
+        (void)error;
+        fitter->samples[0] = point;
+        fitter->times[0] = time;
+        fitter->sampleCount = 1;
+        fitter->anchorKnot = spline->numKnots-1;
+        return kCdsSplineErrorNone;
+    }
+    if (n == fitter->windowSize) {
+        /* a full window has two open segments (windowSize >= 3); commit the first */
+        cds_spline3__fitter_commit(fitter);
+        n = fitter->sampleCount;
+    }
+    fitter->samples[n] = point;
+    fitter->times[n] = time;
+    fitter->sampleCount = n+1;
+    if (cds_spline3__fitter_fit(fitter, &mid, tangents)) {
+        cds_spline3__fitter_store(fitter, mid, tangents);
+        return kCdsSplineErrorNone;
+    }
+    /* No fit keeps the new sample within the bound (which takes at least three samples, so the
+     * previous fit had at least two). Commit the previous fit's middle knot, or fix the first knot's tangent if
+     * it had none, and refit. Failing that, put the middle knot at the previous last knot: with
+     * that knot's tangent, and the chord for the new one, this keeps the previous fit's segment
+     * as it was, so it stays within the bound. */
+    fitter->sampleCount = n;
+    if (fitter->midIndex > 0) {
+        cds_spline3__fitter_commit(fitter);
+    } else {
+        fitter->anchorTangentFixed = 1;
+        fitter->anchorTangent = spline->knots[fitter->anchorKnot].tangent;
+    }
+    n = fitter->sampleCount;
+    fitter->samples[n] = point;
+    fitter->times[n] = time;
+    fitter->sampleCount = n+1;
+    CDS_SPLINE_ASSERT(n+1 >= 3);
+    if (!cds_spline3__fitter_fit(fitter, &mid, tangents)) {
+        mid = n-1;
+        tangents[0] = fitter->anchorTangent;
+        tangents[1] = spline->knots[spline->numKnots-1].tangent;
+        tangents[2] = cds_spline3__sub_scaled(point, 1.0f, fitter->samples[mid]);
+    }
+    cds_spline3__fitter_store(fitter, mid, tangents);
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_fitter_push_many(cds_spline_fitter3 *fitter, const cds_spline_vec3 *points, const cds_spline_r32 *times,
+    cds_spline_s32 pointCount) {
+    cds_spline_s32 i;
+    for(i=0; i<pointCount; i += 1) {
+        const cds_spline_error_t error = cds_spline3_fitter_push(fitter, points[i], (times != NULL) ? times[i] : 0);
+        if (error != kCdsSplineErrorNone)
+            return error;
+    }
+    return kCdsSplineErrorNone;
+}
+
+size_t
+cds_spline3_ring_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount) {
+    (void)interpStyle;
+    if (maxKnotCount <= 0)
+        return 0;
+    /* one matrix slot per knot slot, so that a segment's slot is its first knot's */
+    return (size_t)maxKnotCount * (sizeof(cds_spline_knot3) + sizeof(cds_spline_mat34));
+}
+
+cds_spline_error_t
+cds_spline3_ring_init(cds_spline_ring3 *outRing, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
+    void *buffer, size_t bufferSize) {
+    if (bufferSize < cds_spline3_ring_buffer_size(interpStyle, maxKnotCount))
+        return kCdsSplineErrorRingInit_BufferSize;
+    outRing->segmentMatrices = (cds_spline_mat34*)buffer;
+    outRing->knots = (cds_spline_knot3*)(outRing->segmentMatrices + maxKnotCount);
+    outRing->interpStyle = interpStyle;
+    outRing->tension = 0.5;
+    outRing->numKnots = 0;
+    outRing->maxNumKnots = maxKnotCount;
+    outRing->numSegments = 0;
+    outRing->firstSlot = 0;
+    outRing->origin = 0;
+    return kCdsSplineErrorNone;
+}
+
+static CDS_SPLINE_INLINE cds_spline_s32
+cds_spline3__ring_slot(const cds_spline_ring3 *ring, cds_spline_s32 index) {
+    const cds_spline_s32 slot = ring->firstSlot + index;
+    return (slot >= ring->maxNumKnots) ? slot - ring->maxNumKnots : slot;
+}
+
+/* Segment matrices read their knots as one contiguous run, which the ring may wrap around, so
+ * the knots are gathered first. */
+static void
+cds_spline3__ring_compute_segment(cds_spline_ring3 *ring, cds_spline_s32 segmentIndex) {
+    const cds_spline_s32 knotCount = (ring->interpStyle == kCdsSplineInterpStyleCardinal ||
+        ring->interpStyle == kCdsSplineInterpStyleCentripetalCatmullRom) ? 4 : 2;
+    cds_spline_knot3 knots[4];
+    cds_spline_s32 iKnot;
+    for(iKnot=0; iKnot<knotCount; iKnot += 1) {
+        knots[iKnot] = ring->knots[cds_spline3__ring_slot(ring, segmentIndex + iKnot)];
+    }
+    cds_spline__compute_segment_matrix(3, ring->interpStyle, ring->tension, (const cds_spline_r32*)knots,
+        ring->segmentMatrices[cds_spline3__ring_slot(ring, segmentIndex)].elems);
+}
+
+cds_spline_error_t
+cds_spline3_ring_set_tension(cds_spline_ring3 *ring, cds_spline_r32 tension) {
+    cds_spline_s32 iSeg;
+    if (ring->tension != tension) {
+        ring->tension = tension;
+        CDS_SPLINE__BEGIN_RECOMPUTE(3, ring->interpStyle, ring->numSegments);
+        for(iSeg=0; iSeg<ring->numSegments; iSeg += 1) {
+            cds_spline3__ring_compute_segment(ring, iSeg);
+        }
+        CDS_SPLINE__END_RECOMPUTE(3, ring->interpStyle, ring->numSegments);
+    }
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_ring_push_back(cds_spline_ring3 *ring, cds_spline_knot3 knot) {
+    if (ring->numKnots == ring->maxNumKnots)
+        return kCdsSplineErrorRingPushBack_MaxNumKnots;
+    ring->knots[cds_spline3__ring_slot(ring, ring->numKnots)] = knot;
+    ring->numKnots += 1;
+    if (cds_spline__segment_count(ring->interpStyle, ring->numKnots) > ring->numSegments) {
+        CDS_SPLINE__BEGIN_RECOMPUTE(3, ring->interpStyle, 1);
+        cds_spline3__ring_compute_segment(ring, ring->numSegments);
+        CDS_SPLINE__END_RECOMPUTE(3, ring->interpStyle, 1);
+        ring->numSegments += 1;
+    }
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_ring_pop_front(cds_spline_ring3 *ring, cds_spline_s32 knotCount) {
+    if (knotCount < 0 || knotCount > ring->numKnots)
+        return kCdsSplineErrorRingPopFront_KnotCount;
+    /* the remaining segments keep their slots; only the front moves */
+    ring->firstSlot = (ring->numKnots == knotCount) ? 0 : cds_spline3__ring_slot(ring, knotCount);
+    ring->numKnots -= knotCount;
+    ring->numSegments = cds_spline__segment_count(ring->interpStyle, ring->numKnots);
+    ring->origin += (cds_spline_u64)knotCount;
+    return kCdsSplineErrorNone;
+}
+
+const cds_spline_knot3*
+cds_spline3_ring_knot(const cds_spline_ring3 *ring, cds_spline_s32 knotIndex) {
+    CDS_SPLINE_ASSERT(knotIndex >= 0 && knotIndex < ring->numKnots);
+    return ring->knots + cds_spline3__ring_slot(ring, knotIndex);
+}
+
+static CDS_SPLINE_INLINE const cds_spline_mat34*
+cds_spline3__ring_locate(const cds_spline_ring3 *ring, cds_spline_r32 t, cds_spline_r32 *outU) {
+    cds_spline_s32 segment;
+    cds_spline__get_int_and_frac(ring->numSegments, t, &segment, outU);
+    CDS_SPLINE_ASSERT(segment >= 0 && segment < ring->numSegments);
+    return ring->segmentMatrices + cds_spline3__ring_slot(ring, segment);
+}
+
+cds_spline_vec3
+cds_spline3_ring_eval(const cds_spline_ring3 *ring, cds_spline_r32 t) {
+    cds_spline_r32 u;
+    const cds_spline_mat34 *m;
+    CDS_SPLINE__STAT_ADD(evalCalls, 1);
+    m = cds_spline3__ring_locate(ring, t, &u);
+    return cds_spline3__eval_segment(m, u);
+}
+
+cds_spline_vec3
+cds_spline3_ring_evald(const cds_spline_ring3 *ring, cds_spline_r32 t) {
+    cds_spline_r32 u;
+    const cds_spline_mat34 *m;
+    CDS_SPLINE__STAT_ADD(evaldCalls, 1);
+    m = cds_spline3__ring_locate(ring, t, &u);
+    return cds_spline3__evald_segment(m, u);
+}
+
+cds_spline_vec3
+cds_spline3_ring_evaldd(const cds_spline_ring3 *ring, cds_spline_r32 t) {
+    cds_spline_r32 u;
+    const cds_spline_mat34 *m;
+    CDS_SPLINE__STAT_ADD(evalddCalls, 1);
+    m = cds_spline3__ring_locate(ring, t, &u);
+    return cds_spline3__evaldd_segment(m, u);
+}
+
+/* Slab headers sit at the start of each slab, cache-line aligned; buffers are carved after them
+ * in address order. */
+struct cds_spline_pool__slab {
+    struct cds_spline_pool__slab *next;
+    cds_spline_u8 *cursor;
+    cds_spline_u8 *end;
+};
+
+#define CDS_SPLINE__POOL_SLAB_HEADER_SIZE \
+    CDS_SPLINE_ALIGN_TO(sizeof(struct cds_spline_pool__slab), CDS_SPLINE__CACHE_LINE_SIZE)
+
+/* The smallest class that holds maxKnotCount knots, or -1 if none does */
+static cds_spline_s32
+cds_spline_pool__class(cds_spline_s32 maxKnotCount) {
+    cds_spline_s32 sizeClass = 0;
+    while(sizeClass < CDS_SPLINE_POOL_CLASS_COUNT && (CDS_SPLINE_POOL_MIN_KNOTS << sizeClass) < maxKnotCount)
+        sizeClass += 1;
+    return (sizeClass < CDS_SPLINE_POOL_CLASS_COUNT) ? sizeClass : -1;
+}
+
+/* Pops a freed buffer of the class, or carves a new one from the current slab (moving on to
+ * later slabs as each one fills up). NULL when every slab is full. */
+static void*
+cds_spline_pool__alloc_block(cds_spline_pool *pool, cds_spline_s32 sizeClass) {
+    void *block = pool->freeLists[sizeClass];
+    if (block != NULL) {
+        pool->freeLists[sizeClass] = *(void**)block;
+        return block;
+    }
+    for(; pool->currentSlab != NULL; pool->currentSlab = pool->currentSlab->next) {
+        struct cds_spline_pool__slab *slab = pool->currentSlab;
+        if ((size_t)(slab->end - slab->cursor) >= pool->blockSizes[sizeClass]) {
+            block = slab->cursor;
+            slab->cursor += pool->blockSizes[sizeClass];
+            return block;
+        }
+    }
+    return NULL;
+}
+
+static void
+cds_spline_pool__free_block(cds_spline_pool *pool, cds_spline_s32 sizeClass, void *block) {
+    *(void**)block = pool->freeLists[sizeClass];
+    pool->freeLists[sizeClass] = block;
+}
+
+cds_spline_error_t
+cds_spline_pool_init(cds_spline_pool *outPool, cds_spline_u32 flags) {
+    cds_spline_s32 sizeClass;
+    if (flags & kCdsSplineFlagReadOnly)
+        return kCdsSplineErrorPoolInit_Flags;
+    outPool->firstSlab = outPool->lastSlab = outPool->currentSlab = NULL;
+    for(sizeClass=0; sizeClass<CDS_SPLINE_POOL_CLASS_COUNT; sizeClass += 1) {
+        /* Hermite and Bezier splines need the most matrices, so their size fits every style */
+        size_t size = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, CDS_SPLINE_POOL_MIN_KNOTS << sizeClass, flags);
+        outPool->freeLists[sizeClass] = NULL;
+        outPool->blockSizes[sizeClass] = CDS_SPLINE_ALIGN_TO(size, CDS_SPLINE__CACHE_LINE_SIZE);
+    }
+    outPool->flags = flags;
+    outPool->liveSplines = 0;
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline_pool_add_slab(cds_spline_pool *pool, void *buffer, size_t bufferSize) {
+    cds_spline_u8 *aligned = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)buffer, CDS_SPLINE__CACHE_LINE_SIZE);
+    struct cds_spline_pool__slab *slab = (struct cds_spline_pool__slab*)aligned;
+    if (bufferSize < (size_t)(aligned - (cds_spline_u8*)buffer) + CDS_SPLINE__POOL_SLAB_HEADER_SIZE)
+        return kCdsSplineErrorPoolAddSlab_BufferSize;
+    slab->next = NULL;
+    slab->cursor = aligned + CDS_SPLINE__POOL_SLAB_HEADER_SIZE;
+    slab->end = (cds_spline_u8*)buffer + bufferSize;
+    if (pool->lastSlab != NULL)
+        pool->lastSlab->next = slab;
+    else
+        pool->firstSlab = slab;
+    pool->lastSlab = slab;
+    if (pool->currentSlab == NULL)
+        pool->currentSlab = slab;
+    return kCdsSplineErrorNone;
+}
+
+void
+cds_spline_pool_reset(cds_spline_pool *pool) {
+    struct cds_spline_pool__slab *slab;
+    cds_spline_s32 sizeClass;
+    for(slab=pool->firstSlab; slab != NULL; slab = slab->next) {
+        slab->cursor = (cds_spline_u8*)slab + CDS_SPLINE__POOL_SLAB_HEADER_SIZE;
+    }
+    pool->currentSlab = pool->firstSlab;
+    for(sizeClass=0; sizeClass<CDS_SPLINE_POOL_CLASS_COUNT; sizeClass += 1) {
+        pool->freeLists[sizeClass] = NULL;
+    }
+    pool->liveSplines = 0;
+}
+
+cds_spline_error_t
+cds_spline3_pool_alloc(cds_spline_pool *pool, cds_spline3 *outSpline, cds_spline_interp_style interpStyle,
+    cds_spline_s32 maxKnotCount) {
+    const cds_spline_s32 sizeClass = cds_spline_pool__class(maxKnotCount);
+    void *block;
+    if (sizeClass < 0)
+        return kCdsSplineErrorPoolAlloc_MaxKnotCount;
+    block = cds_spline_pool__alloc_block(pool, sizeClass);
+    if (block == NULL)
+        return kCdsSplineErrorPoolAlloc_OutOfMemory;
+    cds_spline3_init_ex(outSpline, interpStyle, CDS_SPLINE_POOL_MIN_KNOTS << sizeClass, pool->flags, block,
+        pool->blockSizes[sizeClass]);
+    pool->liveSplines += 1;
+    return kCdsSplineErrorNone;
+}
+
+/* Blocks are cache-line aligned, so the segment array (which init places first, aligning it only
+ * for blocked segments) always starts at the block itself. */
+static CDS_SPLINE_INLINE void*
+cds_spline3_pool__block(const cds_spline3 *spline) {
+    return spline->segmentMatrices;
+}
+
+cds_spline_error_t
+cds_spline3_pool_grow(cds_spline_pool *pool, cds_spline3 *spline, cds_spline_s32 maxKnotCount) {
+    const cds_spline_s32 sizeClass = cds_spline_pool__class(maxKnotCount);
+    cds_spline3 grown;
+    cds_spline_s32 iSeg;
+    void *block;
+    if (maxKnotCount <= spline->maxNumKnots)
+        return kCdsSplineErrorNone;
+    if (sizeClass < 0)
+        return kCdsSplineErrorPoolGrow_MaxKnotCount;
+    block = cds_spline_pool__alloc_block(pool, sizeClass);
+    if (block == NULL)
+        return kCdsSplineErrorPoolGrow_OutOfMemory;
+    cds_spline3_flush(spline);
+    cds_spline3_init_ex(&grown, spline->interpStyle, CDS_SPLINE_POOL_MIN_KNOTS << sizeClass, spline->flags, block,
+        pool->blockSizes[sizeClass]);
+    grown.tension = spline->tension;
+    grown.numKnots = spline->numKnots;
+    grown.numSegments = spline->numSegments;
+    grown.editBatchDepth = spline->editBatchDepth;
+    grown.writtenFirst = spline->writtenFirst;
+    grown.writtenLast = spline->writtenLast;
+    grown.editCount = spline->editCount;
+    cds_spline__copy_bytes(grown.knots, spline->knots, spline->numKnots*sizeof(cds_spline_knot3));
+    if (spline->knotTimes != NULL)
+        cds_spline__copy_bytes(grown.knotTimes, spline->knotTimes, spline->numKnots*sizeof(cds_spline_r32));
+    for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+        *cds_spline3__segment(&grown, iSeg) = *cds_spline3__segment(spline, iSeg);
+    }
+    if (spline->arcLengths != NULL) {
+        cds_spline__copy_bytes(grown.segmentLengths, spline->segmentLengths, spline->numSegments*sizeof(cds_spline_r32));
+        cds_spline__copy_bytes(grown.arcLengths, spline->arcLengths, (spline->numSegments+1)*sizeof(cds_spline_r32));
+    }
+    /* The tree has more leaves now, so only the leaves carry over and the rest is refit */
+    if (spline->segmentBounds != NULL && spline->numSegments > 0) {
+        cds_spline__copy_bytes(grown.segmentBounds + grown.boundsLeafCount, spline->segmentBounds + spline->boundsLeafCount,
+            spline->numSegments*sizeof(cds_spline_aabb3));
+        cds_spline3__update_bounds(&grown, 0, spline->numSegments-1);
+    }
+    cds_spline_pool__free_block(pool, cds_spline_pool__class(spline->maxNumKnots), cds_spline3_pool__block(spline));
+    *spline = grown;
+    return kCdsSplineErrorNone;
+}
+
+void
+cds_spline3_pool_free(cds_spline_pool *pool, cds_spline3 *spline) {
+    const cds_spline_s32 sizeClass = cds_spline_pool__class(spline->maxNumKnots);
+    CDS_SPLINE_ASSERT(sizeClass >= 0 && (CDS_SPLINE_POOL_MIN_KNOTS << sizeClass) == spline->maxNumKnots);
+    cds_spline_pool__free_block(pool, sizeClass, cds_spline3_pool__block(spline));
+    pool->liveSplines -= 1;
+    spline->numKnots = spline->numSegments = spline->maxNumKnots = 0;
+}
+
+/* x(u) on a segment is ((m[6]*u + m[4])*u + m[2])*u + m[0], as cds_spline__eval_segment() computes it. */
+static CDS_SPLINE_INLINE cds_spline_r32
+cds_spline2__timing_x(const cds_spline_r32 *m, cds_spline_r32 u) {
+    return ((m[6]*u + m[4])*u + m[2])*u + m[0];
+}
+
+size_t
+cds_spline2_timing_buffer_size(const cds_spline2 *spline) {
+    return (spline->numSegments*CDS_SPLINE_TIMING_SAMPLES + 1) * sizeof(cds_spline_r32);
+}
+
+cds_spline_error_t
+cds_spline2_timing_init(cds_spline_timing2 *outTiming, const cds_spline2 *spline, cds_spline_r32 tolerance,
+    void *buffer, size_t bufferSize) {
+    cds_spline_r32 *sampleX = (cds_spline_r32*)buffer;
+    cds_spline_s32 iSeg, iSample, maxHalvings = 0;
+    if (spline->numSegments < 1)
+        return kCdsSplineErrorTimingInit_SegmentCount;
+    if (!(tolerance > 0))
+        return kCdsSplineErrorTimingInit_Tolerance;
+    if (bufferSize < cds_spline2_timing_buffer_size(spline))
+        return kCdsSplineErrorTimingInit_BufferSize;
+    cds_spline2__flush_pending(spline);
+    for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+        const cds_spline_r32 *m = cds_spline2__segment(spline, iSeg)->elems;
+        /* x'(u) = (3*m[6]*u + 2*m[4])*u + m[2] must not go negative on [0,1]: check its ends and its extremum */
+        const cds_spline_r32 a = 3*m[6], b = 2*m[4], c = m[2];
+        /* |x'| <= maxSlope, so a bracket of width w is within maxSlope*w of the answer in x */
+        const cds_spline_r32 maxSlope = (cds_spline_r32)(fabs(a) + fabs(b) + fabs(c));
+        const cds_spline_r32 slack = -1e-6f * maxSlope;
+        cds_spline_r32 width = 1.0f / CDS_SPLINE_TIMING_SAMPLES;
+        cds_spline_s32 halvings = 0;
+        if (c < slack || a + b + c < slack)
+            return kCdsSplineErrorTimingInit_NotMonotonic;
+        if (a != 0) {
+            const cds_spline_r32 uExtremum = -b / (2*a);
+            if (uExtremum > 0 && uExtremum < 1 && (a*uExtremum + b)*uExtremum + c < slack)
+                return kCdsSplineErrorTimingInit_NotMonotonic;
+        }
+        for(iSample=0; iSample<CDS_SPLINE_TIMING_SAMPLES; iSample += 1) {
+            sampleX[iSeg*CDS_SPLINE_TIMING_SAMPLES + iSample] =
+                cds_spline2__timing_x(m, (cds_spline_r32)iSample / CDS_SPLINE_TIMING_SAMPLES);
+        }
+        /* below 2^-24 the bracket cannot shrink any further in floats */
+        while(maxSlope*width > tolerance && halvings < 24) {
+            width *= 0.5f;
+            halvings += 1;
+        }
+        maxHalvings = CDS_SPLINE_MAX(maxHalvings, halvings);
+    }
+    sampleX[spline->numSegments*CDS_SPLINE_TIMING_SAMPLES] =
+        cds_spline2__timing_x(cds_spline2__segment(spline, spline->numSegments-1)->elems, 1.0f);
+    /* Rounding can leave consecutive samples a hair out of order where the curve is flat */
+    for(iSample=1; iSample<=spline->numSegments*CDS_SPLINE_TIMING_SAMPLES; iSample += 1) {
+        sampleX[iSample] = CDS_SPLINE_MAX(sampleX[iSample], sampleX[iSample-1]);
+    }
+
+    outTiming->spline = spline;
+    outTiming->sampleX = sampleX;
+    outTiming->sampleCount = spline->numSegments*CDS_SPLINE_TIMING_SAMPLES + 1;
+    outTiming->tolerance = tolerance;
+    outTiming->maxIterations = 2*maxHalvings;
+    return kCdsSplineErrorNone;
+}
+
+/* The last sample interval that starts at or before x (x already clamped to the samples' range) */
+static cds_spline_s32
+cds_spline2__timing_search(const cds_spline_timing2 *timing, cds_spline_r32 x) {
+    cds_spline_s32 lo = 0, hi = timing->sampleCount-2;
+    while(lo < hi) {
+        const cds_spline_s32 mid = (lo + hi + 1) / 2;
+        if (timing->sampleX[mid] <= x)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/* Finds t on sample interval iSample, which brackets x. Each iteration evaluates the current
+ * guess, shrinks the bracket to the side holding the root, and takes a Newton step from the
+ * guess unless that step leaves the bracket or the last one shrank it by less than half. */
+static cds_spline_r32
+cds_spline2__timing_refine(const cds_spline_timing2 *timing, cds_spline_s32 iSample, cds_spline_r32 x,
+    cds_spline_s32 *outSegment) {
+    const cds_spline_s32 segment = iSample / CDS_SPLINE_TIMING_SAMPLES;
+    const cds_spline_r32 *m = cds_spline2__segment(timing->spline, segment)->elems;
+    const cds_spline_r32 x0 = timing->sampleX[iSample], x1 = timing->sampleX[iSample+1];
+    cds_spline_r32 lo = (cds_spline_r32)(iSample - segment*CDS_SPLINE_TIMING_SAMPLES) / CDS_SPLINE_TIMING_SAMPLES;
+    cds_spline_r32 hi = lo + 1.0f / CDS_SPLINE_TIMING_SAMPLES;
+    cds_spline_r32 u = (x1 > x0) ? lo + (hi - lo)*((x - x0) / (x1 - x0)) : lo;
+    cds_spline_bool32_t bisect = 0;
+    cds_spline_s32 iIter;
+    u = CDS_SPLINE_MIN(CDS_SPLINE_MAX(u, lo), hi);
+    for(iIter=0; iIter<timing->maxIterations; iIter += 1) {
+        const cds_spline_r32 f = cds_spline2__timing_x(m, u) - x;
+        const cds_spline_r32 width = hi - lo;
+        cds_spline_r32 next;
+        if (fabs(f) <= timing->tolerance)
+            break;
+        if (f < 0)
+            lo = u;
+        else
+            hi = u;
+        next = u - f / ((3*m[6]*u + 2*m[4])*u + m[2]);
+        if (bisect || !(next > lo && next < hi))
+            next = 0.5f*(lo + hi);
+        bisect = (hi - lo > 0.5f*width);
+        u = next;
+    }
+    *outSegment = segment;
+    return u;
+}
+
+cds_spline_r32
+cds_spline2_timing_solve(const cds_spline_timing2 *timing, cds_spline_r32 x) {
+    cds_spline_s32 segment;
+    cds_spline_r32 u;
+    x = CDS_SPLINE_MIN(CDS_SPLINE_MAX(x, timing->sampleX[0]), timing->sampleX[timing->sampleCount-1]);
+    u = cds_spline2__timing_refine(timing, cds_spline2__timing_search(timing, x), x, &segment);
+    return (cds_spline_r32)segment + u;
+}
+
+cds_spline_r32
+cds_spline2_timing_eval(const cds_spline_timing2 *timing, cds_spline_r32 x) {
+    cds_spline_s32 segment;
+    cds_spline_r32 u;
+    x = CDS_SPLINE_MIN(CDS_SPLINE_MAX(x, timing->sampleX[0]), timing->sampleX[timing->sampleCount-1]);
+    u = cds_spline2__timing_refine(timing, cds_spline2__timing_search(timing, x), x, &segment);
+    return cds_spline2__eval_segment(cds_spline2__segment(timing->spline, segment), u).y;
+}
+
+void
+cds_spline2_timing_eval_many(const cds_spline_timing2 *timing, const cds_spline_r32 *x, cds_spline_s32 xCount,
+    cds_spline_r32 *outT, cds_spline_r32 *outY) {
+    const cds_spline_r32 *sampleX = timing->sampleX;
+    const cds_spline_s32 lastInterval = timing->sampleCount-2;
+    cds_spline_s32 iX, iSample = 0, segment;
+    for(iX=0; iX<xCount; iX += 1) {
+        const cds_spline_r32 xi = CDS_SPLINE_MIN(CDS_SPLINE_MAX(x[iX], sampleX[0]), sampleX[lastInterval+1]);
+        cds_spline_r32 u;
+        /* the previous interval, or the one after it, before falling back to a search */
+        if (sampleX[iSample] > xi || (iSample < lastInterval && sampleX[iSample+1] <= xi)) {
+            if (iSample < lastInterval && sampleX[iSample+1] <= xi && sampleX[iSample+2] > xi)
+                iSample += 1;
+            else
+                iSample = cds_spline2__timing_search(timing, xi);
+        }
+        u = cds_spline2__timing_refine(timing, iSample, xi, &segment);
+        if (outT != NULL)
+            outT[iX] = (cds_spline_r32)segment + u;
+        if (outY != NULL)
+            outY[iX] = cds_spline2__eval_segment(cds_spline2__segment(timing->spline, segment), u).y;
+    }
+}
+
+/* Samples per segment that keep the interpolation error within tolerance on every segment, or 0
+ * if there are too many. For a cubic p(u) = a + b*u + c*u^2 + d*u^3, linear interpolation
+ * between samples h apart is off by at most h^2/8 * max|p''|, and p'' = 2c + 6du is largest at an
+ * end of the segment. Quadratic interpolation through samples h apart is off by exactly
+ * d * (u-u0)(u-u1)(u-u2), at most |d| * 2h^3/(3*sqrt(3)). Also returns the bound actually reached,
+ * plus an allowance for float rounding in the samples, the interpolation and the evaluation it
+ * is compared with. */
+static cds_spline_s32
+cds_spline3__bake_resolution(const cds_spline3 *spline, cds_spline_bake_interp interp, cds_spline_r32 tolerance,
+    cds_spline_r32 *outErrorBound) {
+    const cds_spline_r64 cubicPeak = 2.0 / (3.0 * sqrt(3.0));
+    cds_spline_r64 maxCurvature = 0, maxJerk = 0, maxRounding = 0, samples, h, bound;
+    cds_spline_s32 iSeg, c;
+    if (!(tolerance > 0))
+        return 0;
+    for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+        const cds_spline_r32 *m = cds_spline3__segment(spline, iSeg)->elems;
+        cds_spline_r64 curvature = 0, jerk = 0, magnitude[4] = {0, 0, 0, 0};
+        for(c=0; c<3; c += 1) {
+            const cds_spline_r64 p2 = CDS_SPLINE_MAX(fabs(2.0*m[6+c]), fabs(2.0*m[6+c] + 6.0*m[9+c]));
+            curvature += p2*p2;
+            jerk += (cds_spline_r64)m[9+c]*m[9+c];
+            magnitude[0] += (cds_spline_r64)m[0+c]*m[0+c];
+            magnitude[1] += (cds_spline_r64)m[3+c]*m[3+c];
+            magnitude[2] += (cds_spline_r64)m[6+c]*m[6+c];
+            magnitude[3] += (cds_spline_r64)m[9+c]*m[9+c];
+        }
+        maxCurvature = CDS_SPLINE_MAX(maxCurvature, sqrt(curvature));
+        maxJerk = CDS_SPLINE_MAX(maxJerk, sqrt(jerk));
+        /* Horner's rule rounds once per term, and so does u, which also moves along p' */
+        maxRounding = CDS_SPLINE_MAX(maxRounding,
+            sqrt(magnitude[0]) + 2*sqrt(magnitude[1]) + 3*sqrt(magnitude[2]) + 4*sqrt(magnitude[3]));
+    }
+    if (interp == kCdsSplineBakeQuadratic) {
+        samples = 2.0 * ceil(0.5 * ceil(pow(cubicPeak * maxJerk / tolerance, 1.0/3.0)));
+        samples = CDS_SPLINE_MAX(samples, 2.0);
+        h = 1.0 / samples;
+        bound = maxJerk * cubicPeak * h*h*h;
+    } else {
+        samples = CDS_SPLINE_MAX(ceil(sqrt(maxCurvature / (8.0 * tolerance))), 1.0);
+        h = 1.0 / samples;
+        bound = maxCurvature * h*h / 8.0;
+    }
+    if (samples > CDS_SPLINE_BAKE_MAX_SAMPLES_PER_SEGMENT ||
+        samples * spline->numSegments >= (cds_spline_r64)CDS_SPLINE__EMPTY_RANGE_FIRST)
+        return 0;
+    *outErrorBound = (cds_spline_r32)(bound + 16.0 * 1.1920929e-7 /* FLT_EPSILON */ * maxRounding);
+    return (cds_spline_s32)samples;
+}
+
+size_t
+cds_spline3_bake_buffer_size(const cds_spline3 *spline, cds_spline_bake_interp interp, cds_spline_r32 tolerance) {
+    cds_spline_r32 errorBound;
+    const cds_spline_s32 samplesPerSegment = cds_spline3__bake_resolution(spline, interp, tolerance, &errorBound);
+    if (samplesPerSegment == 0)
+        return 0;
+    return ((size_t)spline->numSegments*samplesPerSegment + 1)*sizeof(cds_spline_vec3) + CDS_SPLINE__CACHE_LINE_SIZE-1;
+}
+
+cds_spline_error_t
+cds_spline3_bake(cds_spline_baked3 *outBaked, const cds_spline3 *spline, cds_spline_bake_interp interp,
+    cds_spline_r32 tolerance, void *buffer, size_t bufferSize) {
+    cds_spline_r32 errorBound = 0;
+    cds_spline_s32 samplesPerSegment, iSeg, iSample;
+    cds_spline_vec3 *samples;
+    if (spline->numSegments < 1)
+        return kCdsSplineErrorBake_SegmentCount;
+    cds_spline3__flush_pending(spline);
+    samplesPerSegment = cds_spline3__bake_resolution(spline, interp, tolerance, &errorBound);
+    if (samplesPerSegment == 0)
+        return kCdsSplineErrorBake_Tolerance;
+    if (bufferSize < cds_spline3_bake_buffer_size(spline, interp, tolerance))
+        return kCdsSplineErrorBake_BufferSize;
+    samples = (cds_spline_vec3*)CDS_SPLINE_ALIGN_TO((intptr_t)buffer, CDS_SPLINE__CACHE_LINE_SIZE);
+    for(iSeg=0; iSeg<spline->numSegments; iSeg += 1) {
+        const cds_spline_mat34 *m = cds_spline3__segment(spline, iSeg);
+        for(iSample=0; iSample<samplesPerSegment; iSample += 1) {
+            samples[iSeg*samplesPerSegment + iSample] =
+                cds_spline3__eval_segment(m, (cds_spline_r32)iSample / (cds_spline_r32)samplesPerSegment);
+        }
+    }
+    samples[spline->numSegments*samplesPerSegment] =
+        cds_spline3__eval_segment(cds_spline3__segment(spline, spline->numSegments-1), 1.0f);
+
+    outBaked->spline = spline;
+    outBaked->samples = samples;
+    outBaked->samplesPerSegment = samplesPerSegment;
+    outBaked->sampleCount = spline->numSegments*samplesPerSegment + 1;
+    outBaked->numSegments = spline->numSegments;
+    outBaked->interp = interp;
+    outBaked->errorBound = errorBound;
+    outBaked->editCount = spline->editCount;
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_bool32_t
+cds_spline3_baked_is_current(const cds_spline_baked3 *baked) {
+    return baked->spline->editCount == baked->editCount;
+}
+
+/* t is split into segment and u the way cds_spline3_eval() splits it, so that sample positions
+ * round relative to u rather than to t. */
+static CDS_SPLINE_INLINE cds_spline_vec3
+cds_spline3__baked_eval(const cds_spline_baked3 *baked, cds_spline_r32 t) {
+    const cds_spline_vec3 *s;
+    cds_spline_s32 segment, iSample;
+    cds_spline_r32 u, f;
+    cds_spline_vec3 pos;
+    cds_spline__get_int_and_frac(baked->numSegments, t, &segment, &u);
+    if (baked->interp == kCdsSplineBakeQuadratic) {
+        const cds_spline_s32 pairCount = baked->samplesPerSegment / 2;
+        const cds_spline_r32 local = u * (cds_spline_r32)pairCount;
+        cds_spline_r32 w;
+        iSample = CDS_SPLINE_MIN((cds_spline_s32)local, pairCount-1);
+        f = 2*(local - (cds_spline_r32)iSample);
+        w = 0.5f*f*(f - 1);
+        s = baked->samples + segment*baked->samplesPerSegment + 2*iSample;
+        pos.x = s[0].x + f*(s[1].x - s[0].x) + w*(s[2].x - 2*s[1].x + s[0].x);
+        pos.y = s[0].y + f*(s[1].y - s[0].y) + w*(s[2].y - 2*s[1].y + s[0].y);
+        pos.z = s[0].z + f*(s[1].z - s[0].z) + w*(s[2].z - 2*s[1].z + s[0].z);
+    } else {
+        const cds_spline_r32 local = u * (cds_spline_r32)baked->samplesPerSegment;
+        iSample = CDS_SPLINE_MIN((cds_spline_s32)local, baked->samplesPerSegment-1);
+        f = local - (cds_spline_r32)iSample;
+        s = baked->samples + segment*baked->samplesPerSegment + iSample;
+        pos.x = s[0].x + f*(s[1].x - s[0].x);
+        pos.y = s[0].y + f*(s[1].y - s[0].y);
+        pos.z = s[0].z + f*(s[1].z - s[0].z);
+    }
+    return pos;
+}
+
+cds_spline_vec3
+cds_spline3_baked_eval(const cds_spline_baked3 *baked, cds_spline_r32 t) {
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(baked));
+    return cds_spline3__baked_eval(baked, t);
+}
+
+cds_spline_error_t
+cds_spline3_baked_eval_many(const cds_spline_baked3 *baked, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos) {
+    cds_spline_s32 iT;
+    if (!cds_spline3_baked_is_current(baked))
+        return kCdsSplineErrorBakedEval_Stale;
+    for(iT=0; iT<tCount; iT += 1) {
+        outPos[iT] = cds_spline3__baked_eval(baked, t[iT]);
+    }
+    return kCdsSplineErrorNone;
+}
+
+/* Work is split into about this many tasks per executor thread, so that a slow task (or a thread
+ * that starts late) leaves the others something to pick up. */
+#define CDS_SPLINE__TASKS_PER_THREAD 4
+/* Lower bounds on the work per task; below these the dispatch cost outweighs the work. */
+#define CDS_SPLINE__MIN_SEGMENTS_PER_TASK 16
+#define CDS_SPLINE__MIN_T_GROUPS_PER_TASK 128
+/* eval_many() task boundaries are multiples of this, so every task sees the same SIMD groups
+ * (and therefore takes the same wide/gathered/scalar path for each t) as the serial call. */
+#define CDS_SPLINE__T_GROUP_SIZE 8
+
+static cds_spline_s32
+cds_spline__task_count(const cds_spline_executor *executor, cds_spline_s32 itemCount, cds_spline_s32 minItemsPerTask) {
+    cds_spline_s32 taskCount = 1;
+    if (executor != NULL && executor->parallelFor != NULL && executor->concurrency > 1) {
+        taskCount = executor->concurrency * CDS_SPLINE__TASKS_PER_THREAD;
+        taskCount = CDS_SPLINE_MIN(taskCount, itemCount / minItemsPerTask);
+    }
+    return CDS_SPLINE_MAX(taskCount, 1);
+}
+
+/* Item range [*outFirst..*outLast) of task taskIndex, with itemCount items split as evenly as
+ * possible over taskCount tasks (the first itemCount%taskCount tasks get one extra item). */
+static CDS_SPLINE_INLINE void
+cds_spline__task_range(cds_spline_s32 itemCount, cds_spline_s32 taskCount, cds_spline_s32 taskIndex,
+    cds_spline_s32 *outFirst, cds_spline_s32 *outLast) {
+    const cds_spline_s32 itemsPerTask = itemCount / taskCount, extra = itemCount % taskCount;
+    *outFirst = taskIndex*itemsPerTask + CDS_SPLINE_MIN(taskIndex, extra);
+    *outLast = *outFirst + itemsPerTask + (taskIndex < extra ? 1 : 0);
+}
+
+static void
+cds_spline__parallel_for(const cds_spline_executor *executor, cds_spline_task_func task, void *taskData,
+    cds_spline_s32 taskCount) {
+    cds_spline_s32 iTask;
+    if (taskCount > 1 && executor != NULL && executor->parallelFor != NULL) {
+        executor->parallelFor(executor->context, task, taskData, taskCount);
+        return;
+    }
+    for(iTask=0; iTask<taskCount; iTask += 1) {
+        task(taskData, iTask);
+    }
+}
+
+typedef struct cds_spline3__tessellate_task {
+    const cds_spline3 *spline;
+    cds_spline_s32 stepsPerSegment;
+    cds_spline_s32 reanchorInterval;
+    cds_spline_vec3 *outVerts;
+    cds_spline_s32 taskCount;
+} cds_spline3__tessellate_task;
+
+static void
+cds_spline3__run_tessellate_task(void *taskData, cds_spline_s32 taskIndex) {
+    const cds_spline3__tessellate_task *work = (const cds_spline3__tessellate_task*)taskData;
+    cds_spline_s32 firstSegment, lastSegment;
+    cds_spline__task_range(work->spline->numSegments, work->taskCount, taskIndex, &firstSegment, &lastSegment);
+    cds_spline3__tessellate_segments(work->spline, firstSegment, lastSegment, work->stepsPerSegment,
+        work->reanchorInterval, work->outVerts + (size_t)firstSegment*work->stepsPerSegment);
+}
+
+cds_spline_error_t
+cds_spline3_tessellate_uniform_parallel(const cds_spline3 *spline, cds_spline_s32 stepsPerSegment,
+    cds_spline_s32 reanchorInterval, cds_spline_vec3 *outVerts, cds_spline_s32 maxVerts, cds_spline_s32 *outVertCount,
+    const cds_spline_executor *executor) {
+    cds_spline3__tessellate_task work;
+    cds_spline_s32 vertCount;
+    *outVertCount = 0;
+    if (stepsPerSegment < 1)
+        return kCdsSplineErrorTessellate_StepCount;
+    vertCount = cds_spline3_tessellate_uniform_vertex_count(spline, stepsPerSegment);
+    if (vertCount == 0)
+        return kCdsSplineErrorNone;
+    if (maxVerts < vertCount)
+        return kCdsSplineErrorTessellate_BufferSize;
+    cds_spline3__flush_pending(spline);
+    work.spline = spline;
+    work.stepsPerSegment = stepsPerSegment;
+    work.reanchorInterval = reanchorInterval;
+    work.outVerts = outVerts;
+    work.taskCount = cds_spline__task_count(executor, spline->numSegments, CDS_SPLINE__MIN_SEGMENTS_PER_TASK);
+    cds_spline__parallel_for(executor, cds_spline3__run_tessellate_task, &work, work.taskCount);
+    outVerts[vertCount-1] = cds_spline3_eval(spline, (cds_spline_r32)spline->numSegments);
+    *outVertCount = vertCount;
+    return kCdsSplineErrorNone;
+}
+
+typedef struct cds_spline3__eval_many_task {
+    const cds_spline3 *spline;
+    const cds_spline_r32 *t;
+    cds_spline_s32 tCount;
+    cds_spline_s32 order;
+    cds_spline_vec3 *out;
+    cds_spline_s32 taskCount;
+} cds_spline3__eval_many_task;
+
+static void
+cds_spline3__run_eval_many_task(void *taskData, cds_spline_s32 taskIndex) {
+    const cds_spline3__eval_many_task *work = (const cds_spline3__eval_many_task*)taskData;
+    const cds_spline_s32 groupCount = (work->tCount + CDS_SPLINE__T_GROUP_SIZE-1) / CDS_SPLINE__T_GROUP_SIZE;
+    cds_spline_s32 firstGroup, lastGroup, first, last;
+    cds_spline__task_range(groupCount, work->taskCount, taskIndex, &firstGroup, &lastGroup);
+    first = firstGroup * CDS_SPLINE__T_GROUP_SIZE;
+    last = CDS_SPLINE_MIN(lastGroup * CDS_SPLINE__T_GROUP_SIZE, work->tCount);
+    if (last > first) {
+        cds_spline_vec3 *out = work->out + first;
+        cds_spline3__eval_many(work->spline, work->t + first, last - first, work->order,
+            &out->x, &out->y, &out->z, 3);
+    }
+}
+
+static void
+cds_spline3__eval_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_s32 order, cds_spline_vec3 *out, const cds_spline_executor *executor) {
+    cds_spline3__eval_many_task work;
+    const cds_spline_s32 groupCount = (tCount + CDS_SPLINE__T_GROUP_SIZE-1) / CDS_SPLINE__T_GROUP_SIZE;
+    if (tCount <= 0)
+        return;
+    cds_spline3__flush_pending(spline);
+    work.spline = spline;
+    work.t = t;
+    work.tCount = tCount;
+    work.order = order;
+    work.out = out;
+    work.taskCount = cds_spline__task_count(executor, groupCount, CDS_SPLINE__MIN_T_GROUPS_PER_TASK);
+    cds_spline__parallel_for(executor, cds_spline3__run_eval_many_task, &work, work.taskCount);
+}
+
+void
+cds_spline3_eval_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos, const cds_spline_executor *executor) {
+    cds_spline3__eval_many_parallel(spline, t, tCount, 0, outPos, executor);
+}
+
+void
+cds_spline3_evald_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDPos, const cds_spline_executor *executor) {
+    cds_spline3__eval_many_parallel(spline, t, tCount, 1, outDPos, executor);
+}
+
+void
+cds_spline3_evaldd_many_parallel(const cds_spline3 *spline, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outDDPos, const cds_spline_executor *executor) {
+    cds_spline3__eval_many_parallel(spline, t, tCount, 2, outDDPos, executor);
+}
+
+typedef struct cds_spline3__baked_eval_task {
+    const cds_spline_baked3 *baked;
+    const cds_spline_r32 *t;
+    cds_spline_s32 tCount;
+    cds_spline_vec3 *out;
+    cds_spline_s32 taskCount;
+} cds_spline3__baked_eval_task;
+
+static void
+cds_spline3__run_baked_eval_task(void *taskData, cds_spline_s32 taskIndex) {
+    const cds_spline3__baked_eval_task *work = (const cds_spline3__baked_eval_task*)taskData;
+    const cds_spline_s32 groupCount = (work->tCount + CDS_SPLINE__T_GROUP_SIZE-1) / CDS_SPLINE__T_GROUP_SIZE;
+    cds_spline_s32 firstGroup, lastGroup, iT, last;
+    cds_spline__task_range(groupCount, work->taskCount, taskIndex, &firstGroup, &lastGroup);
+    last = CDS_SPLINE_MIN(lastGroup * CDS_SPLINE__T_GROUP_SIZE, work->tCount);
+    for(iT=firstGroup * CDS_SPLINE__T_GROUP_SIZE; iT<last; iT += 1) {
+        work->out[iT] = cds_spline3__baked_eval(work->baked, work->t[iT]);
+    }
+}
+
+cds_spline_error_t
+cds_spline3_baked_eval_many_parallel(const cds_spline_baked3 *baked, const cds_spline_r32 *t, cds_spline_s32 tCount,
+    cds_spline_vec3 *outPos, const cds_spline_executor *executor) {
+    cds_spline3__baked_eval_task work;
+    const cds_spline_s32 groupCount = (tCount + CDS_SPLINE__T_GROUP_SIZE-1) / CDS_SPLINE__T_GROUP_SIZE;
+    if (!cds_spline3_baked_is_current(baked))
+        return kCdsSplineErrorBakedEval_Stale;
+    if (tCount <= 0)
+        return kCdsSplineErrorNone;
+    work.baked = baked;
+    work.t = t;
+    work.tCount = tCount;
+    work.out = outPos;
+    work.taskCount = cds_spline__task_count(executor, groupCount, CDS_SPLINE__MIN_T_GROUPS_PER_TASK);
+    cds_spline__parallel_for(executor, cds_spline3__run_baked_eval_task, &work, work.taskCount);
+    return kCdsSplineErrorNone;
+}
+
+#if defined(CDS_SPLINE_THREADS)
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+typedef CRITICAL_SECTION cds_spline__mutex;
+typedef CONDITION_VARIABLE cds_spline__cond;
+typedef HANDLE cds_spline__thread;
+#   define CDS_SPLINE__MUTEX_INIT(m)    InitializeCriticalSection(m)
+#   define CDS_SPLINE__MUTEX_DESTROY(m) DeleteCriticalSection(m)
+#   define CDS_SPLINE__MUTEX_LOCK(m)    EnterCriticalSection(m)
+#   define CDS_SPLINE__MUTEX_UNLOCK(m)  LeaveCriticalSection(m)
+#   define CDS_SPLINE__COND_INIT(c)     InitializeConditionVariable(c)
+#   define CDS_SPLINE__COND_DESTROY(c)  ((void)(c))
+#   define CDS_SPLINE__COND_WAIT(c,m)   SleepConditionVariableCS((c), (m), INFINITE)
+#   define CDS_SPLINE__COND_BROADCAST(c) WakeAllConditionVariable(c)
+#   define CDS_SPLINE__ATOMIC_LOAD_S32(p) ((cds_spline_s32)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+#   define CDS_SPLINE__ATOMIC_STORE_S32(p, v) ((void)InterlockedExchange((volatile LONG*)(p), (LONG)(v)))
+#   define CDS_SPLINE__ATOMIC_ADD_S32(p, n) ((void)InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(n)))
+#   define CDS_SPLINE__YIELD() ((void)SwitchToThread())
+#else
+typedef pthread_mutex_t cds_spline__mutex;
+typedef pthread_cond_t cds_spline__cond;
+typedef pthread_t cds_spline__thread;
+#   define CDS_SPLINE__MUTEX_INIT(m)    pthread_mutex_init((m), NULL)
+#   define CDS_SPLINE__MUTEX_DESTROY(m) pthread_mutex_destroy(m)
+#   define CDS_SPLINE__MUTEX_LOCK(m)    pthread_mutex_lock(m)
+#   define CDS_SPLINE__MUTEX_UNLOCK(m)  pthread_mutex_unlock(m)
+#   define CDS_SPLINE__COND_INIT(c)     pthread_cond_init((c), NULL)
+#   define CDS_SPLINE__COND_DESTROY(c)  pthread_cond_destroy(c)
+#   define CDS_SPLINE__COND_WAIT(c,m)   pthread_cond_wait((c), (m))
+#   define CDS_SPLINE__COND_BROADCAST(c) pthread_cond_broadcast(c)
+#   define CDS_SPLINE__ATOMIC_LOAD_S32(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#   define CDS_SPLINE__ATOMIC_STORE_S32(p, v) __atomic_store_n((p), (cds_spline_s32)(v), __ATOMIC_SEQ_CST)
+#   define CDS_SPLINE__ATOMIC_ADD_S32(p, n) ((void)__atomic_fetch_add((p), (cds_spline_s32)(n), __ATOMIC_SEQ_CST))
+#   define CDS_SPLINE__YIELD() ((void)sched_yield())
+#endif
+
+/* One batch runs at a time. Tasks are claimed in index order under the mutex; a batch is done
+ * when tasksRemaining reaches zero, and the submitter (which also claims tasks) waits for that
+ * before returning. batchId lets sleeping workers tell a new batch from a spurious wakeup. */
+struct cds_spline_thread_pool {
+    cds_spline__mutex mutex;
+    cds_spline__cond workReady;
+    cds_spline__cond workDone;
+    cds_spline_task_func task;
+    void *taskData;
+    cds_spline_s32 taskCount;
+    cds_spline_s32 nextTask;
+    cds_spline_s32 tasksRemaining;
+    cds_spline_u32 batchId;
+    cds_spline_bool32_t batchActive;
+    cds_spline_bool32_t shutdown;
+    cds_spline_s32 workerCount;
+    cds_spline__thread *workers;
+};
+
+/* Claims and runs tasks from the current batch until none are left. Called with the mutex held;
+ * returns with it held. */
+static void
+cds_spline_thread_pool__run_tasks(cds_spline_thread_pool *pool) {
+    while(pool->batchActive && pool->nextTask < pool->taskCount) {
+        cds_spline_s32 iTask = pool->nextTask++;
+        cds_spline_task_func task = pool->task;
+        void *taskData = pool->taskData;
+        CDS_SPLINE__MUTEX_UNLOCK(&pool->mutex);
+        task(taskData, iTask);
+        CDS_SPLINE__MUTEX_LOCK(&pool->mutex);
+        if (--pool->tasksRemaining == 0)
+            CDS_SPLINE__COND_BROADCAST(&pool->workDone);
+    }
+}
+
+static void
+cds_spline_thread_pool__worker(cds_spline_thread_pool *pool) {
+    cds_spline_u32 lastBatchId = 0;
+    CDS_SPLINE__MUTEX_LOCK(&pool->mutex);
+    for(;;) {
+        while(!pool->shutdown && (!pool->batchActive || pool->batchId == lastBatchId)) {
+            CDS_SPLINE__COND_WAIT(&pool->workReady, &pool->mutex);
+        }
+        if (pool->shutdown)
+            break;
+        lastBatchId = pool->batchId;
+        cds_spline_thread_pool__run_tasks(pool);
+    }
+    CDS_SPLINE__MUTEX_UNLOCK(&pool->mutex);
+}
+
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+static DWORD WINAPI
+cds_spline_thread_pool__thread_main(LPVOID param) {
+    cds_spline_thread_pool__worker((cds_spline_thread_pool*)param);
+    return 0;
+}
+#else
+static void*
+cds_spline_thread_pool__thread_main(void *param) {
+    cds_spline_thread_pool__worker((cds_spline_thread_pool*)param);
+    return NULL;
+}
+#endif
+
+static void
+cds_spline_thread_pool__parallel_for(void *context, cds_spline_task_func task, void *taskData, cds_spline_s32 taskCount) {
+    cds_spline_thread_pool *pool = (cds_spline_thread_pool*)context;
+    if (taskCount <= 0)
+        return;
+    CDS_SPLINE__MUTEX_LOCK(&pool->mutex);
+    while(pool->batchActive) {
+        CDS_SPLINE__COND_WAIT(&pool->workDone, &pool->mutex);
+    }
+    pool->task = task;
+    pool->taskData = taskData;
+    pool->taskCount = taskCount;
+    pool->nextTask = 0;
+    pool->tasksRemaining = taskCount;
+    pool->batchId += 1;
+    pool->batchActive = 1;
+    CDS_SPLINE__COND_BROADCAST(&pool->workReady);
+    cds_spline_thread_pool__run_tasks(pool);
+    while(pool->tasksRemaining > 0) {
+        CDS_SPLINE__COND_WAIT(&pool->workDone, &pool->mutex);
+    }
+    pool->batchActive = 0;
+    /* wake any submitter queued behind this batch */
+    CDS_SPLINE__COND_BROADCAST(&pool->workDone);
+    CDS_SPLINE__MUTEX_UNLOCK(&pool->mutex);
+}
+
+size_t
+cds_spline_thread_pool_buffer_size(cds_spline_s32 workerCount) {
+    if (workerCount < 0)
+        return 0;
+    return sizeof(cds_spline_thread_pool) + workerCount*sizeof(cds_spline__thread) + sizeof(void*)-1;
+}
+
+cds_spline_error_t
+cds_spline_thread_pool_init(cds_spline_thread_pool **outPool, cds_spline_s32 workerCount, void *buffer, size_t bufferSize) {
+    cds_spline_thread_pool *pool = (cds_spline_thread_pool*)CDS_SPLINE_ALIGN_TO((intptr_t)buffer, sizeof(void*));
+    cds_spline_s32 iWorker;
+    *outPool = NULL;
+    if (workerCount < 0)
+        return kCdsSplineErrorThreadPoolInit_WorkerCount;
+    if (bufferSize < cds_spline_thread_pool_buffer_size(workerCount))
+        return kCdsSplineErrorThreadPoolInit_BufferSize;
+    CDS_SPLINE__MUTEX_INIT(&pool->mutex);
+    CDS_SPLINE__COND_INIT(&pool->workReady);
+    CDS_SPLINE__COND_INIT(&pool->workDone);
+    pool->task = NULL;
+    pool->taskData = NULL;
+    pool->taskCount = 0;
+    pool->nextTask = 0;
+    pool->tasksRemaining = 0;
+    pool->batchId = 0;
+    pool->batchActive = 0;
+    pool->shutdown = 0;
+    pool->workerCount = 0;
+    pool->workers = (cds_spline__thread*)(pool + 1);
+    for(iWorker=0; iWorker<workerCount; iWorker += 1) {
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+        pool->workers[iWorker] = CreateThread(NULL, 0, cds_spline_thread_pool__thread_main, pool, 0, NULL);
+        if (pool->workers[iWorker] == NULL)
+#else
+        if (pthread_create(pool->workers + iWorker, NULL, cds_spline_thread_pool__thread_main, pool) != 0)
+#endif
+        {
+            cds_spline_thread_pool_destroy(pool);
+            return kCdsSplineErrorThreadPoolInit_Thread;
+        }
+        pool->workerCount += 1;
+    }
+    *outPool = pool;
+    return kCdsSplineErrorNone;
+}
+
+void
+cds_spline_thread_pool_destroy(cds_spline_thread_pool *pool) {
+    cds_spline_s32 iWorker;
+    CDS_SPLINE__MUTEX_LOCK(&pool->mutex);
+    pool->shutdown = 1;
+    CDS_SPLINE__COND_BROADCAST(&pool->workReady);
+    CDS_SPLINE__MUTEX_UNLOCK(&pool->mutex);
+    for(iWorker=0; iWorker<pool->workerCount; iWorker += 1) {
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+        WaitForSingleObject(pool->workers[iWorker], INFINITE);
+        CloseHandle(pool->workers[iWorker]);
+#else
+        pthread_join(pool->workers[iWorker], NULL);
+#endif
+    }
+    pool->workerCount = 0;
+    CDS_SPLINE__COND_DESTROY(&pool->workDone);
+    CDS_SPLINE__COND_DESTROY(&pool->workReady);
+    CDS_SPLINE__MUTEX_DESTROY(&pool->mutex);
+}
+
+cds_spline_executor
+cds_spline_thread_pool_executor(cds_spline_thread_pool *pool) {
+    cds_spline_executor executor;
+    executor.parallelFor = cds_spline_thread_pool__parallel_for;
+    executor.context = pool;
+    executor.concurrency = pool->workerCount + 1;
+    return executor;
+}
+
+size_t
+cds_spline3_shared_buffer_size(cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount, cds_spline_u32 flags) {
+    size_t copySize = cds_spline3_buffer_size_ex(interpStyle, maxKnotCount, flags);
+    return 2*CDS_SPLINE_ALIGN_TO(copySize, CDS_SPLINE__CACHE_LINE_SIZE);
+}
+
+cds_spline_error_t
+cds_spline3_shared_init(cds_spline_shared3 *outShared, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
+    cds_spline_u32 flags, void *buffer, size_t bufferSize) {
+    size_t copySize = cds_spline3_shared_buffer_size(interpStyle, maxKnotCount, flags) / 2;
+    cds_spline_s32 iCopy;
+    if (flags & kCdsSplineFlagReadOnly)
+        return kCdsSplineErrorSharedInit_Flags;
+    if (bufferSize < 2*copySize)
+        return kCdsSplineErrorSharedInit_BufferSize;
+    for(iCopy=0; iCopy<2; iCopy += 1) {
+        cds_spline_error_t error = cds_spline3_init_ex(outShared->copies + iCopy, interpStyle, maxKnotCount, flags,
+            (cds_spline_u8*)buffer + iCopy*copySize, copySize);
+        if (error != kCdsSplineErrorNone)
+            return error;
+        outShared->versions[iCopy] = 0;
+        outShared->readerCounts[iCopy][0] = 0;
+    }
+    outShared->published = 0;
+    outShared->writing = 0;
+    outShared->pendingFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;
+    outShared->pendingLast = -1;
+    outShared->version = 0;
+    return kCdsSplineErrorNone;
+}
+
+/* Readers register on a copy, then check that it is still the published one; the writer swaps
+ * the published index, then waits for the old copy's count to drop to zero. All four accesses
+ * are sequentially consistent, so either the reader sees the swap and backs off, or the writer
+ * sees the reader's count and waits for its release. */
+const cds_spline3*
+cds_spline3_shared_acquire(cds_spline_shared3 *shared, cds_spline_u32 *outVersion) {
+    cds_spline_s32 copy;
+    for(;;) {
+        copy = CDS_SPLINE__ATOMIC_LOAD_S32(&shared->published);
+        CDS_SPLINE__ATOMIC_ADD_S32(&shared->readerCounts[copy][0], 1);
+        if (CDS_SPLINE__ATOMIC_LOAD_S32(&shared->published) == copy)
+            break;
+        CDS_SPLINE__ATOMIC_ADD_S32(&shared->readerCounts[copy][0], -1);
+    }
+    if (outVersion != NULL)
+        *outVersion = shared->versions[copy];
+    return shared->copies + copy;
+}
+
+void
+cds_spline3_shared_release(cds_spline_shared3 *shared, const cds_spline3 *snapshot) {
+    cds_spline_s32 copy = (cds_spline_s32)(snapshot - shared->copies);
+    CDS_SPLINE_ASSERT(copy == 0 || copy == 1);
+    CDS_SPLINE__ATOMIC_ADD_S32(&shared->readerCounts[copy][0], -1);
+}
+
+/* Copies what the last publish changed from the published copy to the other one: knots (and knot
+ * times) [firstKnot..lastKnot], the segments that depend on them, the arc length prefix sums from
+ * the first of those segments on, and the bounding volume leaves of those segments along with
+ * their ancestors. Both copies have the same layout, so each array range is copied as is. */
+static void
+cds_spline3__shared_catch_up(cds_spline3 *dst, const cds_spline3 *src, cds_spline_s32 firstKnot,
+    cds_spline_s32 lastKnot) {
+    cds_spline_s32 firstSegment, lastSegment, unused, iSeg, lo, hi;
+    dst->tension = src->tension;
+    dst->numKnots = src->numKnots;
+    dst->numSegments = src->numSegments;
+    firstKnot = CDS_SPLINE_MAX(firstKnot, 0);
+    lastKnot = CDS_SPLINE_MIN(lastKnot, src->maxNumKnots-1);
+    if (firstKnot > lastKnot)
+        return;
+    /* the copy is rewritten under anything baked from it */
+    dst->editCount += 1;
+    cds_spline__copy_bytes(dst->knots + firstKnot, src->knots + firstKnot,
+        (lastKnot-firstKnot+1)*sizeof(cds_spline_knot3));
+    if (src->knotTimes != NULL) {
+        cds_spline__copy_bytes(dst->knotTimes + firstKnot, src->knotTimes + firstKnot,
+            (lastKnot-firstKnot+1)*sizeof(cds_spline_r32));
+    }
+    cds_spline__knot_segment_range(src->interpStyle, firstKnot, &firstSegment, &unused);
+    cds_spline__knot_segment_range(src->interpStyle, lastKnot, &unused, &lastSegment);
+    firstSegment = CDS_SPLINE_MAX(firstSegment, 0);
+    for(iSeg=firstSegment; iSeg<=CDS_SPLINE_MIN(lastSegment, src->numSegments-1); iSeg += 1) {
+        *cds_spline3__segment(dst, iSeg) = *cds_spline3__segment(src, iSeg);
+        if (src->segmentLengths != NULL)
+            dst->segmentLengths[iSeg] = src->segmentLengths[iSeg];
+    }
+    if (src->arcLengths != NULL && firstSegment < src->numSegments) {
+        cds_spline__copy_bytes(dst->arcLengths + firstSegment+1, src->arcLengths + firstSegment+1,
+            (src->numSegments - firstSegment)*sizeof(cds_spline_r32));
+    }
+    /* Leaves of removed segments were cleared by the edit, so they are copied too */
+    lastSegment = CDS_SPLINE_MIN(lastSegment, src->boundsLeafCount-1);
+    if (src->segmentBounds != NULL && firstSegment <= lastSegment) {
+        lo = src->boundsLeafCount + firstSegment;
+        hi = src->boundsLeafCount + lastSegment;
+        for(; lo >= 1; lo /= 2, hi /= 2) {
+            cds_spline__copy_bytes(dst->segmentBounds + lo, src->segmentBounds + lo,
+                (hi-lo+1)*sizeof(cds_spline_aabb3));
+        }
+    }
+}
+
+cds_spline_error_t
+cds_spline3_shared_begin_write(cds_spline_shared3 *shared, cds_spline3 **outSpline) {
+    cds_spline_s32 back = 1 - shared->published;
+    if (shared->writing)
+        return kCdsSplineErrorSharedBeginWrite_Writing;
+    while(CDS_SPLINE__ATOMIC_LOAD_S32(&shared->readerCounts[back][0]) != 0)
+        CDS_SPLINE__YIELD();
+    cds_spline3__shared_catch_up(shared->copies + back, shared->copies + shared->published,
+        shared->pendingFirst, shared->pendingLast);
+    shared->pendingFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;
+    shared->pendingLast = -1;
+    shared->versions[back] = shared->versions[shared->published];
+    shared->writing = 1;
+    cds_spline3_begin_edit(shared->copies + back);
+    *outSpline = shared->copies + back;
+    return kCdsSplineErrorNone;
+}
+
+cds_spline_error_t
+cds_spline3_shared_publish(cds_spline_shared3 *shared) {
+    cds_spline_s32 back = 1 - shared->published;
+    cds_spline3 *spline = shared->copies + back;
+    if (!shared->writing)
+        return kCdsSplineErrorSharedPublish_NoWrite;
+    cds_spline3_end_edit(spline);
+    cds_spline3_flush(spline);
+    shared->pendingFirst = spline->writtenFirst;
+    shared->pendingLast = spline->writtenLast;
+    spline->writtenFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;
+    spline->writtenLast = -1;
+    shared->version += 1;
+    shared->versions[back] = shared->version;
+    shared->writing = 0;
+    CDS_SPLINE__ATOMIC_STORE_S32(&shared->published, back);
+    return kCdsSplineErrorNone;
+}
+#endif /* CDS_SPLINE_THREADS */
+
+
+#endif /*------------ end implementation ------------------------*/
+
+
+
+#if defined(CDS_SPLINE_TEST) /*---------- self-test section -----*/
+
+#include <assert.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+test_nearly_equal(cds_spline_r32 a, cds_spline_r32 b) {
+    return fabs(a-b) <= 1e-5 * (1.0 + fabs(a) + fabs(b));
+}
+
+/* The batch functions must agree with the scalar ones, including clamping, segment
+ * boundaries, and tails shorter than a SIMD register. */
+static void
+test_eval_many(const cds_spline3 *spline) {
+    enum { kNumT = 103 };
+    cds_spline_r32 t[kNumT], outX[kNumT], outY[kNumT], outZ[kNumT];
+    cds_spline_vec3 outAos[kNumT], expected;
+    cds_spline_s32 i, order;
+    srand(1);
+    for(i=0; i<kNumT; ++i) {
+        /* first half sorted (including out-of-range values), second half scattered */
+        if (i < kNumT/2)
+            t[i] = -0.5f + (cds_spline_r32)i * ((cds_spline_r32)spline->numSegments + 1.0f) / (cds_spline_r32)(kNumT/2);
+        else
+            t[i] = (cds_spline_r32)(rand() % 1000) * (cds_spline_r32)spline->numSegments / 999.0f;
+    }
+    for(order=0; order<3; ++order) {
+        switch(order) {
+        case 0:
+            cds_spline3_eval_many(spline, t, kNumT, outAos);
+            cds_spline3_eval_many_soa(spline, t, kNumT, outX, outY, outZ);
+            break;
+        case 1:
+            cds_spline3_evald_many(spline, t, kNumT, outAos);
+            cds_spline3_evald_many_soa(spline, t, kNumT, outX, outY, outZ);
+            break;
+        case 2:
+            cds_spline3_evaldd_many(spline, t, kNumT, outAos);
+            cds_spline3_evaldd_many_soa(spline, t, kNumT, outX, outY, outZ);
+            break;
+        }
+        for(i=0; i<kNumT; ++i) {
+            expected = (order == 0) ? cds_spline3_eval(spline, t[i])
+                : (order == 1) ? cds_spline3_evald(spline, t[i]) : cds_spline3_evaldd(spline, t[i]);
+            CDS_SPLINE_ASSERT(test_nearly_equal(outAos[i].x, expected.x));
+            CDS_SPLINE_ASSERT(test_nearly_equal(outAos[i].y, expected.y));
+            CDS_SPLINE_ASSERT(test_nearly_equal(outAos[i].z, expected.z));
+            CDS_SPLINE_ASSERT(test_nearly_equal(outX[i], expected.x));
+            CDS_SPLINE_ASSERT(test_nearly_equal(outY[i], expected.y));
+            CDS_SPLINE_ASSERT(test_nearly_equal(outZ[i], expected.z));
+        }
+    }
+}
+
+/* Forward-differenced vertices must stay within the documented bound of cds_spline3_eval() */
+static void
+test_tessellate_uniform(const cds_spline3 *spline) {
+    enum { kSteps = 256 };
+    cds_spline_vec3 *verts;
+    cds_spline_s32 vertCount, iVert, iComp, iRow, reanchor, K;
+    cds_spline_error_t err;
+    err = cds_spline3_tessellate_uniform(spline, 0, 0, NULL, 0, &vertCount);
+    CDS_SPLINE_ASSERT(err == kCdsSplineErrorTessellate_StepCount);
+    vertCount = cds_spline3_tessellate_uniform_vertex_count(spline, kSteps);
+    CDS_SPLINE_ASSERT(vertCount == spline->numSegments*kSteps + 1);
+    verts = (cds_spline_vec3*)malloc(vertCount*sizeof(cds_spline_vec3));
+    err = cds_spline3_tessellate_uniform(spline, kSteps, 0, verts, vertCount-1, &vertCount);
+    CDS_SPLINE_ASSERT(err == kCdsSplineErrorTessellate_BufferSize);
+    for(reanchor=0; reanchor<=32; reanchor += 16) {
+        K = (reanchor == 0) ? kSteps : reanchor;
+        err = cds_spline3_tessellate_uniform(spline, kSteps, reanchor, verts,
+            spline->numSegments*kSteps + 1, &vertCount);
+        CDS_SPLINE_ASSERT(err == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(vertCount == spline->numSegments*kSteps + 1);
+        for(iVert=0; iVert<vertCount; ++iVert) {
+            cds_spline_r32 t = (cds_spline_r32)iVert / (cds_spline_r32)kSteps;
+            cds_spline_vec3 expected = cds_spline3_eval(spline, t);
+            const cds_spline_mat34 *m = cds_spline3__segment(spline, CDS_SPLINE_MIN(iVert/kSteps, spline->numSegments-1));
+            for(iComp=0; iComp<3; ++iComp) {
+                double S = 0, bound;
+                for(iRow=0; iRow<4; ++iRow)
+                    S += fabs(m->rows[iRow].elems[iComp]);
+                bound = (8.0*K + 16.0) * S / 16777216.0;
+                CDS_SPLINE_ASSERT(fabs(verts[iVert].elems[iComp] - expected.elems[iComp]) <= bound);
+            }
+        }
+    }
+    free(verts);
+}
+
+/* Arc-length table: lengths must match a dense polyline, survive knot insertion/removal at
+ * any index, and distance->t must invert t->distance. */
+static void
+test_arc_length(void) {
+    cds_spline_knot3 knots[] = {
+        { {{ 0, 0, 0}}, {{ 2, 0, 0}} },
+        { {{ 2, 1, 0}}, {{ 0, 2, 1}} },
+        { {{ 1, 3, 1}}, {{-2, 0, 0}} },
+        { {{ 0, 2, 2}}, {{ 0,-3, 0}} },
+        { {{ 1, 0, 1}}, {{ 3, 0,-1}} },
+    };
+    const cds_spline_s32 knotCount = sizeof(knots) / sizeof(knots[0]);
+    cds_spline3 spline, reference;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, 8, kCdsSplineFlagArcLengthTable);
+    void *buffer = malloc(bufferSize), *referenceBuffer = malloc(bufferSize);
+    cds_spline_s32 iKnot, iSeg, iSamp;
+    cds_spline_error_t err;
+    double polyLength = 0;
+    cds_spline_vec3 prev, pos;
+    err = cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, 8, kCdsSplineFlagArcLengthTable, buffer, bufferSize-1);
+    CDS_SPLINE_ASSERT(err == kCdsSplineErrorInit_BufferSize);
+    err = cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, 8, kCdsSplineFlagArcLengthTable, buffer, bufferSize);
+    CDS_SPLINE_ASSERT(err == kCdsSplineErrorNone);
+    err = cds_spline3_init_ex(&reference, kCdsSplineInterpStyleHermite, 8, kCdsSplineFlagArcLengthTable, referenceBuffer, bufferSize);
+    CDS_SPLINE_ASSERT(err == kCdsSplineErrorNone);
+    /* Build one spline in order, and the other out of order with a temporary extra knot */
+    for(iKnot=0; iKnot<knotCount; ++iKnot)
+        cds_spline3_insert_knot(&reference, iKnot, knots[iKnot]);
+    cds_spline3_insert_knot(&spline, 0, knots[4]);
+    cds_spline3_insert_knot(&spline, 0, knots[1]);
+    cds_spline3_insert_knot(&spline, 1, knots[3]);
+    cds_spline3_insert_knot(&spline, 0, knots[0]);
+    cds_spline3_insert_knot(&spline, 2, knots[0]);
+    cds_spline3_insert_knot(&spline, 3, knots[2]);
+    cds_spline3_remove_knot(&spline, 2);
+    CDS_SPLINE_ASSERT(spline.numSegments == reference.numSegments);
+    for(iSeg=0; iSeg<=spline.numSegments; ++iSeg)
+        CDS_SPLINE_ASSERT(test_nearly_equal(spline.arcLengths[iSeg], reference.arcLengths[iSeg]));
+
+    prev = cds_spline3_eval(&spline, 0);
+    for(iSamp=1; iSamp<=4096; ++iSamp) {
+        pos = cds_spline3_eval(&spline, (cds_spline_r32)spline.numSegments * (cds_spline_r32)iSamp / 4096.0f);
+        polyLength += sqrt((pos.x-prev.x)*(pos.x-prev.x) + (pos.y-prev.y)*(pos.y-prev.y) + (pos.z-prev.z)*(pos.z-prev.z));
+        prev = pos;
+    }
+    CDS_SPLINE_ASSERT(fabs(polyLength - cds_spline3_arc_length(&spline)) < 1e-3 * polyLength);
+
+    for(iSamp=0; iSamp<=100; ++iSamp) {
+        cds_spline_r32 t = (cds_spline_r32)spline.numSegments * (cds_spline_r32)iSamp / 100.0f;
+        cds_spline_r32 d = cds_spline3_t_to_distance(&spline, t);
+        CDS_SPLINE_ASSERT(fabs(cds_spline3_distance_to_t(&spline, d) - t) < 1e-4);
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_distance_to_t(&spline, -1) == 0);
+    CDS_SPLINE_ASSERT(cds_spline3_distance_to_t(&spline, 1e9f) == (cds_spline_r32)spline.numSegments);
+    pos = cds_spline3_eval_by_distance(&spline, 0);
+    CDS_SPLINE_ASSERT(pos.x == knots[0].position.x && pos.y == knots[0].position.y && pos.z == knots[0].position.z);
+
+    free(buffer);
+    free(referenceBuffer);
+}
+
+static cds_spline_knot3
+test_random_knot(cds_spline_r32 scale) {
+    cds_spline_knot3 knot;
+    cds_spline_s32 iComp;
+    for(iComp=0; iComp<3; ++iComp) {
+        knot.position.elems[iComp] = scale * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+        knot.tangent.elems[iComp]  = scale * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+    }
+    return knot;
+}
+
+/* BVH-accelerated closest point queries must match brute force after arbitrary edits, and the
+ * root bounds must contain the whole curve. */
+static void
+test_closest_point(void) {
+    enum { kMaxKnots = 70, kNumQueries = 64 };
+    cds_spline3 spline, bruteSpline;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, kMaxKnots, kCdsSplineFlagBoundingVolumes);
+    size_t bruteBufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleHermite, kMaxKnots);
+    void *buffer = malloc(bufferSize), *bruteBuffer = malloc(bruteBufferSize);
+    cds_spline_vec3 queries[kNumQueries];
+    cds_spline_closest_point3 results[kNumQueries], expected;
+    cds_spline_s32 iKnot, iQuery, iSamp, iComp;
+    srand(1);
+    cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, kMaxKnots, kCdsSplineFlagBoundingVolumes, buffer, bufferSize);
+    cds_spline3_init(&bruteSpline, kCdsSplineInterpStyleHermite, kMaxKnots, bruteBuffer, bruteBufferSize);
+    for(iKnot=0; iKnot<64; ++iKnot) {
+        cds_spline_knot3 knot = test_random_knot(10.0f);
+        knot.position.x += (cds_spline_r32)iKnot;
+        cds_spline3_insert_knot(&spline, iKnot, knot);
+        cds_spline3_insert_knot(&bruteSpline, iKnot, knot);
+    }
+    for(iKnot=0; iKnot<20; ++iKnot) {
+        cds_spline_knot3 knot = test_random_knot(10.0f);
+        cds_spline_s32 index = rand() % spline.numKnots;
+        switch(iKnot % 3) {
+        case 0:
+            cds_spline3_insert_knot(&spline, index, knot);
+            cds_spline3_insert_knot(&bruteSpline, index, knot);
+            break;
+        case 1:
+            cds_spline3_set_knot(&spline, index, knot);
+            cds_spline3_set_knot(&bruteSpline, index, knot);
+            break;
+        case 2:
+            cds_spline3_remove_knot(&spline, index);
+            cds_spline3_remove_knot(&bruteSpline, index);
+            break;
+        }
+    }
+    for(iSamp=0; iSamp<=1000; ++iSamp) {
+        cds_spline_vec3 pos = cds_spline3_eval(&spline, (cds_spline_r32)spline.numSegments * (cds_spline_r32)iSamp / 1000.0f);
+        for(iComp=0; iComp<3; ++iComp) {
+            CDS_SPLINE_ASSERT(pos.elems[iComp] >= spline.segmentBounds[1].min.elems[iComp] - 1e-4f);
+            CDS_SPLINE_ASSERT(pos.elems[iComp] <= spline.segmentBounds[1].max.elems[iComp] + 1e-4f);
+        }
+    }
+    for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+        queries[iQuery] = test_random_knot(80.0f).position;
+        queries[iQuery].x += 32.0f;
+    }
+    cds_spline3_find_closest_points(&spline, queries, kNumQueries, results);
+    for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+        expected = cds_spline3_find_closest_point(&bruteSpline, queries[iQuery]);
+        CDS_SPLINE_ASSERT(fabs(results[iQuery].distance - expected.distance) <= 1e-3f * (1.0f + expected.distance));
+        CDS_SPLINE_ASSERT(fabs(sqrt(cds_spline3__distance_sq(results[iQuery].position, queries[iQuery])) - results[iQuery].distance) < 1e-3f);
+    }
+    free(buffer);
+    free(bruteBuffer);
+}
+
+/* Adaptive tessellation: every piece must stay within tolerance of its chord, straight segments
+ * must not be split at all, and the count-only/short-buffer modes must agree with a full run. */
+static void
+test_tessellate_adaptive(void) {
+    enum { kNumKnots = 12, kMaxSamples = 1<<14, kNumChecks = 16 };
+    const cds_spline_r32 tolerances[] = { 1.0f, 0.1f, 0.01f, 0.001f };
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_sample3 *samples = (cds_spline_sample3*)malloc(kMaxSamples * sizeof(cds_spline_sample3));
+    cds_spline_s32 iKnot, iTol, iSample, iCheck, iComp, sampleCount, countOnly, prevCount = 0;
+    srand(1);
+    CDS_SPLINE_ASSERT(cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, 0.1f, samples, kMaxSamples, &sampleCount) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(sampleCount == 0);
+
+    /* collinear, evenly spaced knots: every segment is a straight line */
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3(2.0f*iKnot, -1.0f*iKnot, 0.5f*iKnot);
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        CDS_SPLINE_ASSERT(cds_spline3_insert_knot(&spline, iKnot, knot) == kCdsSplineErrorNone);
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, 1e-4f, samples, kMaxSamples, &sampleCount) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(sampleCount == spline.numSegments + 1);
+
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot(&spline, iKnot, test_random_knot(10.0f)) == kCdsSplineErrorNone);
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, 0, samples, kMaxSamples, &sampleCount) ==
+        kCdsSplineErrorTessellate_Tolerance);
+    for(iTol=0; iTol<(cds_spline_s32)(sizeof(tolerances)/sizeof(tolerances[0])); ++iTol) {
+        const cds_spline_r32 tolerance = tolerances[iTol];
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, tolerance, NULL, 0, &countOnly) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, tolerance, samples, kMaxSamples, &sampleCount) ==
+            kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(sampleCount == countOnly && sampleCount > prevCount);
+        prevCount = sampleCount;
+        CDS_SPLINE_ASSERT(samples[0].t == 0 && samples[sampleCount-1].t == (cds_spline_r32)spline.numSegments);
+        for(iSample=1; iSample<sampleCount; ++iSample) {
+            const cds_spline_sample3 *a = samples + iSample-1, *b = samples + iSample;
+            CDS_SPLINE_ASSERT(b->t > a->t);
+            for(iCheck=1; iCheck<kNumChecks; ++iCheck) {
+                const cds_spline_r32 f = (cds_spline_r32)iCheck / (cds_spline_r32)kNumChecks;
+                cds_spline_vec3 p = cds_spline3_eval(&spline, a->t + f*(b->t - a->t));
+                double distSq = 0;
+                for(iComp=0; iComp<3; ++iComp) {
+                    const double chord = a->position.elems[iComp] + f*(b->position.elems[iComp] - a->position.elems[iComp]);
+                    distSq += (p.elems[iComp] - chord) * (p.elems[iComp] - chord);
+                }
+                CDS_SPLINE_ASSERT(sqrt(distSq) <= tolerance + 1e-4);
+            }
+        }
+        /* a short buffer still gets a correct prefix and the full count */
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_adaptive(&spline, tolerance, samples, sampleCount/2, &countOnly) ==
+            kCdsSplineErrorTessellate_BufferSize);
+        CDS_SPLINE_ASSERT(countOnly == sampleCount);
+    }
+    free(samples);
+    free(buffer);
+}
+
+/* The blocked layout must be invisible to every query: both layouts see the same edits and must
+ * agree, and the segment array must be cache-line aligned whatever the caller's buffer alignment. */
+static void
+test_blocked_layout(void) {
+    enum { kMaxKnots = 100, kNumSamples = 203 };
+    cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes;
+    cds_spline3 plain, blocked;
+    cds_spline1 blocked1;
+    size_t plainSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kMaxKnots, flags);
+    size_t blockedSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kMaxKnots, flags | kCdsSplineFlagBlockedSegments);
+    size_t blocked1Size = cds_spline1_buffer_size_ex(kCdsSplineInterpStyleCardinal, kMaxKnots, kCdsSplineFlagBlockedSegments);
+    cds_spline_u8 *plainBuffer = (cds_spline_u8*)malloc(plainSize);
+    cds_spline_u8 *blockedBuffer = (cds_spline_u8*)malloc(blockedSize + 4);
+    cds_spline_u8 *blocked1Buffer = (cds_spline_u8*)malloc(blocked1Size + 4);
+    cds_spline_r32 t[kNumSamples];
+    cds_spline_vec3 plainOut[kNumSamples], blockedOut[kNumSamples];
+    cds_spline_s32 iKnot, iSamp, iComp;
+    srand(1);
+    /* deliberately misaligned */
+    CDS_SPLINE_ASSERT(cds_spline3_init_ex(&blocked, kCdsSplineInterpStyleCardinal, kMaxKnots,
+        flags | kCdsSplineFlagBlockedSegments, blockedBuffer + 4, blockedSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline1_init_ex(&blocked1, kCdsSplineInterpStyleCardinal, kMaxKnots,
+        kCdsSplineFlagBlockedSegments, blocked1Buffer + 4, blocked1Size) == kCdsSplineErrorNone);
+    cds_spline3_init_ex(&plain, kCdsSplineInterpStyleCardinal, kMaxKnots, flags, plainBuffer, plainSize);
+    CDS_SPLINE_ASSERT(((intptr_t)blocked.segmentMatrices % 64) == 0 && blocked.segmentStride == 64);
+    CDS_SPLINE_ASSERT(((intptr_t)blocked1.segmentMatrices % 64) == 0 && blocked1.segmentStride == 16);
+    CDS_SPLINE_ASSERT(plain.segmentStride == sizeof(cds_spline_mat34));
+    for(iKnot=0; iKnot<80; ++iKnot) {
+        cds_spline_knot3 knot = test_random_knot(10.0f);
+        cds_spline_s32 index = iKnot ? rand() % (plain.numKnots+1) : 0;
+        cds_spline3_insert_knot(&plain, index, knot);
+        cds_spline3_insert_knot(&blocked, index, knot);
+        if (iKnot % 4 == 3) {
+            index = rand() % plain.numKnots;
+            cds_spline3_remove_knot(&plain, index);
+            cds_spline3_remove_knot(&blocked, index);
+        }
+    }
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        t[iSamp] = (cds_spline_r32)plain.numSegments * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+    }
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        cds_spline_vec3 a = cds_spline3_eval(&plain, t[iSamp]), b = cds_spline3_eval(&blocked, t[iSamp]);
+        CDS_SPLINE_ASSERT(a.x == b.x && a.y == b.y && a.z == b.z);
+        a = cds_spline3_evaldd(&plain, t[iSamp]);
+        b = cds_spline3_evaldd(&blocked, t[iSamp]);
+        CDS_SPLINE_ASSERT(a.x == b.x && a.y == b.y && a.z == b.z);
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_arc_length(&plain) == cds_spline3_arc_length(&blocked));
+    for(iSamp=0; iSamp<8; ++iSamp) {
+        cds_spline_vec3 query = test_random_knot(20.0f).position;
+        CDS_SPLINE_ASSERT(cds_spline3_find_closest_point(&plain, query).t == cds_spline3_find_closest_point(&blocked, query).t);
+    }
+    cds_spline3_eval_many(&plain, t, kNumSamples, plainOut);
+    cds_spline3_eval_many(&blocked, t, kNumSamples, blockedOut);
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        for(iComp=0; iComp<3; ++iComp) {
+            CDS_SPLINE_ASSERT(test_nearly_equal(plainOut[iSamp].elems[iComp], blockedOut[iSamp].elems[iComp]));
+        }
+    }
+    cds_spline3_evald_many(&plain, t, kNumSamples, plainOut);
+    cds_spline3_evald_many(&blocked, t, kNumSamples, blockedOut);
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        for(iComp=0; iComp<3; ++iComp) {
+            CDS_SPLINE_ASSERT(test_nearly_equal(plainOut[iSamp].elems[iComp], blockedOut[iSamp].elems[iComp]));
+        }
+    }
+    free(plainBuffer);
+    free(blockedBuffer);
+    free(blocked1Buffer);
+}
+
+static void
+test_expect_same_knots(const cds_spline3 *a, const cds_spline3 *b) {
+    CDS_SPLINE_ASSERT(a->numKnots == b->numKnots && a->tension == b->tension);
+    CDS_SPLINE_ASSERT(memcmp(a->knots, b->knots, a->numKnots*sizeof(cds_spline_knot3)) == 0);
+    if (a->knotTimes != NULL && b->knotTimes != NULL) {
+        CDS_SPLINE_ASSERT(memcmp(a->knotTimes, b->knotTimes, a->numKnots*sizeof(cds_spline_r32)) == 0);
+    }
+}
+
+static void
+test_expect_same_spline(const cds_spline3 *a, const cds_spline3 *b) {
+    cds_spline_s32 iSeg, iComp;
+    CDS_SPLINE_ASSERT(a->numKnots == b->numKnots && a->numSegments == b->numSegments);
+    for(iSeg=0; iSeg<a->numSegments; ++iSeg) {
+        const cds_spline_mat34 *ma = cds_spline3__segment(a, iSeg), *mb = cds_spline3__segment(b, iSeg);
+        for(iComp=0; iComp<12; ++iComp) {
+            CDS_SPLINE_ASSERT(ma->elems[iComp] == mb->elems[iComp]);
+        }
+        if (a->arcLengths != NULL && b->arcLengths != NULL) {
+            CDS_SPLINE_ASSERT(a->arcLengths[iSeg+1] == b->arcLengths[iSeg+1]);
+        }
+    }
+    if (a->segmentBounds != NULL && b->segmentBounds != NULL) {
+        for(iSeg=1; iSeg<2*a->boundsLeafCount; ++iSeg) {
+            for(iComp=0; iComp<3; ++iComp) {
+                CDS_SPLINE_ASSERT(a->segmentBounds[iSeg].min.elems[iComp] == b->segmentBounds[iSeg].min.elems[iComp]);
+                CDS_SPLINE_ASSERT(a->segmentBounds[iSeg].max.elems[iComp] == b->segmentBounds[iSeg].max.elems[iComp]);
+            }
+        }
+    }
+}
+
+/* Reference centripetal Catmull-Rom segment in double precision, straight from the definition. */
+static void
+test_centripetal_reference(const cds_spline_knot3 *knots, cds_spline_r64 alpha, cds_spline_r64 outM[12]) {
+    cds_spline_r64 t[4], d;
+    cds_spline_s32 i, c;
+    t[0] = 0;
+    for(i=0; i<3; ++i) {
+        d = 0;
+        for(c=0; c<3; ++c) {
+            const cds_spline_r64 delta = (cds_spline_r64)knots[i+1].position.elems[c] - knots[i].position.elems[c];
+            d += delta*delta;
+        }
+        t[i+1] = t[i] + pow(d, alpha*0.5);
+    }
+    for(c=0; c<3; ++c) {
+        const cds_spline_r64 p0 = knots[0].position.elems[c], p1 = knots[1].position.elems[c];
+        const cds_spline_r64 p2 = knots[2].position.elems[c], p3 = knots[3].position.elems[c];
+        const cds_spline_r64 tanA = ((p1-p0)/(t[1]-t[0]) - (p2-p0)/(t[2]-t[0]) + (p2-p1)/(t[2]-t[1])) * (t[2]-t[1]);
+        const cds_spline_r64 tanB = ((p2-p1)/(t[2]-t[1]) - (p3-p1)/(t[3]-t[1]) + (p3-p2)/(t[3]-t[2])) * (t[2]-t[1]);
+        outM[0*3+c] = p1;
+        outM[1*3+c] = tanA;
+        outM[2*3+c] = -3*p1 + 3*p2 - 2*tanA - tanB;
+        outM[3*3+c] =  2*p1 - 2*p2 + tanA + tanB;
+    }
+}
+
+/* Centripetal segments reuse each knot pair's chord across a pass and special-case the common
+ * alphas; every alpha, and every partial recompute, must still match the definition. */
+static void
+test_centripetal(void) {
+    enum { kNumKnots = 40 };
+    const cds_spline_r32 alphas[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f, 1.5f };
+    const cds_spline_s32 numAlphas = sizeof(alphas) / sizeof(alphas[0]);
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCentripetalCatmullRom, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_knot3 knots[kNumKnots];
+    cds_spline_r64 ref[12];
+    cds_spline_s32 iKnot, iAlpha, iSeg, iElem, iEdit;
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        knots[iKnot] = test_random_knot(4.0f);
+        knots[iKnot].position.x += 3.0f * (cds_spline_r32)iKnot;
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_init_from_knots(&spline, kCdsSplineInterpStyleCentripetalCatmullRom, kNumKnots,
+        kCdsSplineFlagNone, knots, kNumKnots, buffer, bufferSize) == kCdsSplineErrorNone);
+    for(iAlpha=0; iAlpha<numAlphas; ++iAlpha) {
+        cds_spline3_set_tension(&spline, alphas[iAlpha]);
+        for(iEdit=0; iEdit<2; ++iEdit) {
+            for(iSeg=0; iSeg<spline.numSegments; ++iSeg) {
+                const cds_spline_mat34 *m = cds_spline3__segment(&spline, iSeg);
+                test_centripetal_reference(knots + iSeg, alphas[iAlpha], ref);
+                for(iElem=0; iElem<12; ++iElem) {
+                    CDS_SPLINE_ASSERT(fabs(m->elems[iElem] - ref[iElem]) <= 1e-4 * (1.0 + fabs(ref[iElem])));
+                }
+            }
+            /* Partial pass: moving one knot recomputes the four segments around it. */
+            knots[17] = test_random_knot(4.0f);
+            knots[17].position.x += 3.0f * 17.0f;
+            cds_spline3_set_knot(&spline, 17, knots[17]);
+        }
+    }
+#if defined(CDS_SPLINE_FAST_MATH)
+    {
+        cds_spline_r32 x, y;
+        for(x=1e-6f; x<1e6f; x *= 1.37f) {
+            for(y=0.05f; y<1.0f; y += 0.05f) {
+                const cds_spline_r64 expected = pow(x, y);
+                CDS_SPLINE_ASSERT(fabs(cds_spline__fast_powf(x, y) - expected) <= 1e-5 * expected);
+            }
+        }
+        CDS_SPLINE_ASSERT(cds_spline__fast_powf(0.0f, 0.3f) == 0.0f);
+    }
+#endif
+    free(buffer);
+}
+
+/* Bulk construction must produce exactly the spline that one-at-a-time insertion does. */
+static void
+test_init_from_knots(void) {
+    enum { kMaxKnots = 50 };
+    cds_spline_interp_style styles[] = {
+        kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom,
+    };
+    cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes;
+    cds_spline_knot3 knots[kMaxKnots];
+    cds_spline_s32 iStyle, iKnot;
+    srand(1);
+    for(iKnot=0; iKnot<kMaxKnots; ++iKnot) {
+        knots[iKnot] = test_random_knot(10.0f);
+    }
+    for(iStyle=0; iStyle<(cds_spline_s32)(sizeof(styles)/sizeof(styles[0])); ++iStyle) {
+        cds_spline3 inserted, bulk;
+        size_t bufferSize = cds_spline3_buffer_size_ex(styles[iStyle], kMaxKnots, flags);
+        void *insertedBuffer = malloc(bufferSize), *bulkBuffer = malloc(bufferSize);
+        cds_spline3_init_ex(&inserted, styles[iStyle], kMaxKnots, flags, insertedBuffer, bufferSize);
+        for(iKnot=0; iKnot<kMaxKnots; ++iKnot) {
+            cds_spline3_insert_knot(&inserted, iKnot, knots[iKnot]);
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_init_from_knots(&bulk, styles[iStyle], kMaxKnots, flags, knots, 2,
+            bulkBuffer, bufferSize) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bulk, knots+2, 0) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bulk, knots+2, 18) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bulk, knots+20, kMaxKnots-19) == kCdsSplineErrorAppendKnots_MaxNumKnots);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bulk, knots+20, -1) == kCdsSplineErrorAppendKnots_KnotCount);
+        CDS_SPLINE_ASSERT(bulk.numKnots == 20);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bulk, knots+20, kMaxKnots-20) == kCdsSplineErrorNone);
+        test_expect_same_spline(&inserted, &bulk);
+        free(insertedBuffer);
+        free(bulkBuffer);
+    }
+}
+
+/* Deferred splines and edit batches must end up exactly where eager updates do, whatever mix of
+ * edits was queued. */
+static void
+test_deferred_updates(void) {
+    enum { kMaxKnots = 64, kNumBatches = 20 };
+    cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes;
+    cds_spline3 eager, deferred, batched;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kMaxKnots, flags);
+    void *eagerBuffer = malloc(bufferSize), *deferredBuffer = malloc(bufferSize), *batchedBuffer = malloc(bufferSize);
+    cds_spline_s32 iBatch, iEdit, iKnot;
+    srand(1);
+    cds_spline3_init_ex(&eager, kCdsSplineInterpStyleCardinal, kMaxKnots, flags, eagerBuffer, bufferSize);
+    cds_spline3_init_ex(&deferred, kCdsSplineInterpStyleCardinal, kMaxKnots, flags | kCdsSplineFlagDeferredUpdates,
+        deferredBuffer, bufferSize);
+    cds_spline3_init_ex(&batched, kCdsSplineInterpStyleCardinal, kMaxKnots, flags, batchedBuffer, bufferSize);
+    CDS_SPLINE_ASSERT(cds_spline3_end_edit(&batched) == kCdsSplineErrorEndEdit_NoBatch);
+    for(iKnot=0; iKnot<32; ++iKnot) {
+        cds_spline_knot3 knot = test_random_knot(10.0f);
+        cds_spline3_insert_knot(&eager, iKnot, knot);
+        cds_spline3_insert_knot(&deferred, iKnot, knot);
+        cds_spline3_insert_knot(&batched, iKnot, knot);
+    }
+    CDS_SPLINE_ASSERT(deferred.dirtyFirst <= deferred.dirtyLast);
+    cds_spline3_flush(&deferred);
+    CDS_SPLINE_ASSERT(deferred.changedFirst > deferred.changedLast);
+    test_expect_same_spline(&eager, &deferred);
+    for(iBatch=0; iBatch<kNumBatches; ++iBatch) {
+        cds_spline3_begin_edit(&batched);
+        cds_spline3_begin_edit(&batched); /* batches nest */
+        for(iEdit=0; iEdit<8; ++iEdit) {
+            cds_spline_knot3 knot = test_random_knot(10.0f);
+            cds_spline_s32 op = rand() % 5, index;
+            if (eager.numKnots <= 4) {
+                op = 0;
+            } else if (eager.numKnots == kMaxKnots) {
+                op = 2;
+            }
+            switch(op) {
+            case 0:
+                index = rand() % (eager.numKnots+1);
+                cds_spline3_insert_knot(&eager, index, knot);
+                cds_spline3_insert_knot(&deferred, index, knot);
+                cds_spline3_insert_knot(&batched, index, knot);
+                break;
+            case 1:
+            case 3:
+                index = rand() % eager.numKnots;
+                cds_spline3_set_knot(&eager, index, knot);
+                cds_spline3_set_knot(&deferred, index, knot);
+                cds_spline3_set_knot(&batched, index, knot);
+                break;
+            case 2:
+                index = rand() % eager.numKnots;
+                cds_spline3_remove_knot(&eager, index);
+                cds_spline3_remove_knot(&deferred, index);
+                cds_spline3_remove_knot(&batched, index);
+                break;
+            default:
+                cds_spline3_set_tension(&eager, (cds_spline_r32)iEdit / 8.0f);
+                cds_spline3_set_tension(&deferred, (cds_spline_r32)iEdit / 8.0f);
+                cds_spline3_set_tension(&batched, (cds_spline_r32)iEdit / 8.0f);
+                break;
+            }
+        }
+        cds_spline3_end_edit(&batched);
+        CDS_SPLINE_ASSERT(batched.changedFirst <= batched.changedLast);
+        CDS_SPLINE_ASSERT(cds_spline3_end_edit(&batched) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(batched.changedFirst > batched.changedLast);
+        test_expect_same_spline(&eager, &batched);
+        /* a query applies the pending edits */
+        if (iBatch % 2) {
+            cds_spline_vec3 a = cds_spline3_eval(&eager, 1.5f), b = cds_spline3_eval(&deferred, 1.5f);
+            CDS_SPLINE_ASSERT(a.x == b.x && a.y == b.y && a.z == b.z);
+            CDS_SPLINE_ASSERT(deferred.changedFirst > deferred.changedLast);
+            test_expect_same_spline(&eager, &deferred);
+        }
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_arc_length(&eager) == cds_spline3_arc_length(&deferred));
+    test_expect_same_spline(&eager, &deferred);
+    free(eagerBuffer);
+    free(deferredBuffer);
+    free(batchedBuffer);
+}
+
+/* Every track of a bank must evaluate like a standalone spline built from the same knots,
+ * including the SIMD tail when the track count isn't a multiple of the register width. */
+static void
+test_spline_bank(void) {
+    enum { kNumKnots = 7, kNumTracks = 37 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleCardinal };
+    cds_spline_s32 dims[] = { 1, 3 };
+    cds_spline_r32 ts[] = { -1.0f, 0.0f, 0.3f, 1.0f, 2.71f, 3.999f, 100.0f };
+    cds_spline_s32 iStyle, iDim, iTrack, iKnot, iT, iComp, iOrder;
+    srand(1);
+    for(iStyle=0; iStyle<2; ++iStyle) {
+        for(iDim=0; iDim<2; ++iDim) {
+            const cds_spline_s32 dim = dims[iDim];
+            cds_spline_bank bank;
+            size_t bankSize = cds_spline_bank_buffer_size(dim, styles[iStyle], kNumKnots, kNumTracks);
+            void *bankBuffer = malloc(bankSize);
+            cds_spline_r32 (*knots)[kNumKnots][6] = (cds_spline_r32(*)[kNumKnots][6])malloc(kNumTracks * sizeof(*knots));
+            cds_spline_r32 *out = (cds_spline_r32*)malloc(kNumTracks * dim * sizeof(cds_spline_r32));
+            CDS_SPLINE_ASSERT(cds_spline_bank_init(&bank, 5, styles[iStyle], kNumKnots, kNumTracks, bankBuffer, bankSize) ==
+                kCdsSplineErrorBankInit_Dimension);
+            CDS_SPLINE_ASSERT(cds_spline_bank_init(&bank, dim, styles[iStyle], kNumKnots, kNumTracks, bankBuffer, bankSize-1) ==
+                kCdsSplineErrorBankInit_BufferSize);
+            CDS_SPLINE_ASSERT(cds_spline_bank_init(&bank, dim, styles[iStyle], kNumKnots, kNumTracks, bankBuffer, bankSize) ==
+                kCdsSplineErrorNone);
+            bank.tension = 0.3f;
+            for(iTrack=0; iTrack<kNumTracks; ++iTrack) {
+                for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+                    for(iComp=0; iComp<6; ++iComp) {
+                        knots[iTrack][iKnot][iComp] = 10.0f * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+                    }
+                }
+                /* dim=1 knots are two floats each; repack in place */
+                for(iKnot=0; dim == 1 && iKnot<kNumKnots; ++iKnot) {
+                    ((cds_spline_r32*)knots[iTrack])[2*iKnot+0] = knots[iTrack][iKnot][0];
+                    ((cds_spline_r32*)knots[iTrack])[2*iKnot+1] = knots[iTrack][iKnot][3];
+                }
+                CDS_SPLINE_ASSERT(cds_spline_bank_set_track(&bank, iTrack, knots[iTrack][0]) == kCdsSplineErrorNone);
+            }
+            CDS_SPLINE_ASSERT(cds_spline_bank_set_track(&bank, kNumTracks, knots[0][0]) == kCdsSplineErrorBankSetTrack_TrackIndex);
+            for(iOrder=0; iOrder<3; ++iOrder) {
+                for(iT=0; iT<(cds_spline_s32)(sizeof(ts)/sizeof(ts[0])); ++iT) {
+                    switch(iOrder) {
+                    case 0: cds_spline_bank_eval(&bank, ts[iT], out); break;
+                    case 1: cds_spline_bank_evald(&bank, ts[iT], out); break;
+                    default: cds_spline_bank_evaldd(&bank, ts[iT], out); break;
+                    }
+                    for(iTrack=0; iTrack<kNumTracks; ++iTrack) {
+                        cds_spline_r32 expected[3];
+                        if (dim == 1) {
+                            cds_spline1 spline;
+                            size_t size = cds_spline1_buffer_size(styles[iStyle], kNumKnots);
+                            void *buffer = malloc(size);
+                            cds_spline_vec1 v;
+                            cds_spline1_init_from_knots(&spline, styles[iStyle], kNumKnots, kCdsSplineFlagNone,
+                                (const cds_spline_knot1*)knots[iTrack], kNumKnots, buffer, size);
+                            cds_spline1_set_tension(&spline, 0.3f);
+                            v = (iOrder == 0) ? cds_spline1_eval(&spline, ts[iT]) :
+                                (iOrder == 1) ? cds_spline1_evald(&spline, ts[iT]) : cds_spline1_evaldd(&spline, ts[iT]);
+                            expected[0] = v.x;
+                            free(buffer);
+                        } else {
+                            cds_spline3 spline;
+                            size_t size = cds_spline3_buffer_size(styles[iStyle], kNumKnots);
+                            void *buffer = malloc(size);
+                            cds_spline_vec3 v;
+                            cds_spline3_init_from_knots(&spline, styles[iStyle], kNumKnots, kCdsSplineFlagNone,
+                                (const cds_spline_knot3*)knots[iTrack], kNumKnots, buffer, size);
+                            cds_spline3_set_tension(&spline, 0.3f);
+                            v = (iOrder == 0) ? cds_spline3_eval(&spline, ts[iT]) :
+                                (iOrder == 1) ? cds_spline3_evald(&spline, ts[iT]) : cds_spline3_evaldd(&spline, ts[iT]);
+                            expected[0] = v.x;
+                            expected[1] = v.y;
+                            expected[2] = v.z;
+                            free(buffer);
+                        }
+                        for(iComp=0; iComp<dim; ++iComp) {
+                            CDS_SPLINE_ASSERT(test_nearly_equal(out[iComp*kNumTracks + iTrack], expected[iComp]));
+                        }
+                    }
+                }
+            }
+            free(bankBuffer);
+            free(knots);
+            free(out);
+        }
+    }
+}
+
+/* Time-keyed queries must match a brute-force reparameterization of the uniform queries with or
+ * without a cursor, keep knot times attached to their knots through edits, and fall back to
+ * time == t without kCdsSplineFlagKnotTimes. */
+static void
+test_knot_times(void) {
+    enum { kNumKnots = 40, kNumTimes = 2000 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleCardinal };
+    cds_spline_r32 times[kNumKnots];
+    cds_spline_s32 iStyle, iKnot, iTime, iComp, iSeg, offset;
+    srand(2);
+    for(iStyle=0; iStyle<2; ++iStyle) {
+        cds_spline3 spline, plain;
+        size_t bufferSize = cds_spline3_buffer_size_ex(styles[iStyle], kNumKnots+1, kCdsSplineFlagKnotTimes);
+        size_t plainSize = cds_spline3_buffer_size(styles[iStyle], kNumKnots);
+        void *buffer = malloc(bufferSize), *plainBuffer = malloc(plainSize);
+        cds_spline_cursor cursor = {0}, plainCursor = {0};
+        cds_spline_knot3 knots[kNumKnots];
+        cds_spline_r32 startTime, endTime, scale;
+        CDS_SPLINE_ASSERT(bufferSize == cds_spline3_buffer_size_ex(styles[iStyle], kNumKnots+1, kCdsSplineFlagNone) +
+            (kNumKnots+1)*sizeof(cds_spline_r32));
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            knots[iKnot] = test_random_knot(10.0f);
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_init_from_knots(&spline, styles[iStyle], kNumKnots+1, kCdsSplineFlagKnotTimes,
+            knots, kNumKnots, buffer, bufferSize) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_init_from_knots(&plain, styles[iStyle], kNumKnots, kCdsSplineFlagNone,
+            knots, kNumKnots, plainBuffer, plainSize) == kCdsSplineErrorNone);
+        offset = (styles[iStyle] == kCdsSplineInterpStyleCardinal) ? 1 : 0;
+
+        /* default times are knot indices; the curve passes knot i+offset at the start of segment i */
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            CDS_SPLINE_ASSERT(spline.knotTimes[iKnot] == (cds_spline_r32)iKnot);
+        }
+        for(iSeg=0; iSeg<spline.numSegments; ++iSeg) {
+            cds_spline_vec3 a = cds_spline3_eval_at_time(&spline, &cursor, (cds_spline_r32)(iSeg + offset) + 0.25f);
+            cds_spline_vec3 b = cds_spline3_eval(&plain, (cds_spline_r32)iSeg + 0.25f);
+            for(iComp=0; iComp<3; ++iComp)
+                CDS_SPLINE_ASSERT(a.elems[iComp] == b.elems[iComp]);
+        }
+
+        /* irregular times */
+        times[0] = -3.0f;
+        for(iKnot=1; iKnot<kNumKnots; ++iKnot) {
+            times[iKnot] = times[iKnot-1] + 0.05f + 4.0f * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&plain, 0, times, kNumKnots) == kCdsSplineErrorSetKnotTimes_Flags);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 1, times, kNumKnots) == kCdsSplineErrorSetKnotTimes_KnotRange);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, -1, times, 1) == kCdsSplineErrorSetKnotTimes_KnotRange);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 0, times, kNumKnots) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(spline.writtenFirst == 0 && spline.writtenLast >= kNumKnots-1);
+        /* rejected (or empty) writes change nothing, so they must not count as written */
+        spline.writtenFirst = CDS_SPLINE__EMPTY_RANGE_FIRST;
+        spline.writtenLast = -1;
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 5, times+7, 1) == kCdsSplineErrorSetKnotTimes_Order);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 5, times+3, 1) == kCdsSplineErrorSetKnotTimes_Order);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 5, times, 0) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(spline.knotTimes[5] == times[5]);
+        CDS_SPLINE_ASSERT(spline.writtenFirst == CDS_SPLINE__EMPTY_RANGE_FIRST && spline.writtenLast == -1);
+        startTime = times[offset];
+        endTime = times[spline.numSegments + offset];
+        for(iTime=0; iTime<kNumTimes; ++iTime) {
+            /* forward playback past both ends, then random access */
+            const cds_spline_r32 time = (iTime < kNumTimes/2)
+                ? startTime - 1.0f + (endTime - startTime + 2.0f) * (cds_spline_r32)iTime / (cds_spline_r32)(kNumTimes/2)
+                : startTime - 1.0f + (endTime - startTime + 2.0f) * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            cds_spline_r32 u = 0, tCursor, tSearch;
+            cds_spline_s32 segment = 0;
+            const cds_spline_mat34 *m;
+            cds_spline_vec3 pos, expectedPos, dpos, expectedDPos, ddpos, expectedDDPos;
+            scale = 1.0f;
+            for(iSeg=0; iSeg<spline.numSegments; ++iSeg) {
+                const cds_spline_r32 t0 = times[iSeg + offset], t1 = times[iSeg + offset + 1];
+                if (time >= t0 || iSeg == 0) {
+                    segment = iSeg;
+                    u = CDS_SPLINE_MIN(CDS_SPLINE_MAX((time - t0) / (t1 - t0), 0.0f), 1.0f);
+                    scale = 1.0f / (t1 - t0);
+                }
+            }
+            m = cds_spline3__segment(&plain, segment);
+            tCursor = cds_spline3_time_to_t(&spline, &cursor, time);
+            tSearch = cds_spline3_time_to_t(&spline, NULL, time);
+            CDS_SPLINE_ASSERT(tCursor == tSearch);
+            CDS_SPLINE_ASSERT(test_nearly_equal(tSearch, (cds_spline_r32)segment + u));
+            pos = cds_spline3_eval_at_time(&spline, &cursor, time);
+            dpos = cds_spline3_evald_at_time(&spline, &cursor, time);
+            ddpos = cds_spline3_evaldd_at_time(&spline, NULL, time);
+            expectedPos = cds_spline3__eval_segment(m, u);
+            expectedDPos = cds_spline3__evald_segment(m, u);
+            expectedDDPos = cds_spline3__evaldd_segment(m, u);
+            for(iComp=0; iComp<3; ++iComp) {
+                CDS_SPLINE_ASSERT(test_nearly_equal(pos.elems[iComp], expectedPos.elems[iComp]));
+                CDS_SPLINE_ASSERT(test_nearly_equal(dpos.elems[iComp], expectedDPos.elems[iComp] * scale));
+                CDS_SPLINE_ASSERT(test_nearly_equal(ddpos.elems[iComp], expectedDDPos.elems[iComp] * scale * scale));
+            }
+            /* without knot times, time is t */
+            CDS_SPLINE_ASSERT(cds_spline3_time_to_t(&plain, &plainCursor, tSearch) == tSearch);
+        }
+
+        /* times follow their knots through inserts and removals */
+        CDS_SPLINE_ASSERT(cds_spline3_insert_knot(&spline, 10, test_random_knot(10.0f)) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(spline.knotTimes[10] == 0.5f * (times[9] + times[10]));
+        CDS_SPLINE_ASSERT(spline.knotTimes[11] == times[10] && spline.knotTimes[kNumKnots] == times[kNumKnots-1]);
+        CDS_SPLINE_ASSERT(cds_spline3_remove_knot(&spline, 10) == kCdsSplineErrorNone);
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            CDS_SPLINE_ASSERT(spline.knotTimes[iKnot] == times[iKnot]);
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(&spline, knots, 1) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(spline.knotTimes[kNumKnots] == times[kNumKnots-1] + 1.0f);
+        free(buffer);
+        free(plainBuffer);
+    }
+}
+
+/* The fused evaluation must reproduce eval/evald/evaldd bit for bit, match a double precision
+ * reference for the tangent, curvature and torsion, and give the same points in batch form. */
+static void
+test_eval_point(void) {
+    enum { kNumKnots = 12, kNumT = 301 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleCardinal,
+        kCdsSplineInterpStyleBezier, kCdsSplineInterpStyleCentripetalCatmullRom };
+    cds_spline_r32 t[kNumT];
+    cds_spline_point3 batch[kNumT];
+    cds_spline_s32 iStyle, iKnot, iT, iComp, iPlanar;
+    srand(1);
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        for(iPlanar=0; iPlanar<2; ++iPlanar) {
+            size_t bufferSize = cds_spline3_buffer_size_ex(styles[iStyle], kNumKnots, kCdsSplineFlagDeferredUpdates);
+            void *buffer = malloc(bufferSize);
+            cds_spline3 spline;
+            CDS_SPLINE_ASSERT(cds_spline3_init_ex(&spline, styles[iStyle], kNumKnots, kCdsSplineFlagDeferredUpdates,
+                buffer, bufferSize) == kCdsSplineErrorNone);
+            for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+                cds_spline_knot3 knot = test_random_knot(10.0f);
+                if (iPlanar) {
+                    knot.position.z = 0;
+                    knot.tangent.z = 0;
+                }
+                CDS_SPLINE_ASSERT(cds_spline3_append_knots(&spline, &knot, 1) == kCdsSplineErrorNone);
+            }
+            /* sorted, then shuffled a little, with a few values outside the spline */
+            for(iT=0; iT<kNumT; ++iT) {
+                t[iT] = ((cds_spline_r32)iT / (cds_spline_r32)(kNumT-1)) * (spline.numSegments + 1.0f) - 0.5f;
+            }
+            for(iT=0; iT<kNumT; iT += 7) {
+                const cds_spline_r32 swap = t[iT];
+                const cds_spline_s32 other = rand() % kNumT;
+                t[iT] = t[other];
+                t[other] = swap;
+            }
+            cds_spline3_eval_points(&spline, t, kNumT, kCdsSplinePointAll, batch);
+            for(iT=0; iT<kNumT; ++iT) {
+                const cds_spline_point3 p = cds_spline3_eval_point(&spline, t[iT], kCdsSplinePointAll);
+                const cds_spline_point3 bare = cds_spline3_eval_point(&spline, t[iT], 0);
+                const cds_spline_vec3 pos = cds_spline3_eval(&spline, t[iT]);
+                const cds_spline_vec3 d = cds_spline3_evald(&spline, t[iT]);
+                const cds_spline_vec3 dd = cds_spline3_evaldd(&spline, t[iT]);
+                const cds_spline_s32 segment = CDS_SPLINE_MIN(CDS_SPLINE_MAX((cds_spline_s32)floor(t[iT]), 0), spline.numSegments-1);
+                const cds_spline_mat34 *m = cds_spline3__segment(&spline, segment);
+                cds_spline_r64 cross[3], crossLen, speed, ddd[3];
+                CDS_SPLINE_ASSERT(memcmp(&p, batch + iT, sizeof(p)) == 0);
+                CDS_SPLINE_ASSERT(memcmp(&p.position, &pos, sizeof(pos)) == 0);
+                CDS_SPLINE_ASSERT(memcmp(&p.d, &d, sizeof(d)) == 0);
+                CDS_SPLINE_ASSERT(memcmp(&p.dd, &dd, sizeof(dd)) == 0);
+                CDS_SPLINE_ASSERT(memcmp(&bare, &p, 3*sizeof(cds_spline_vec3)) == 0);
+                CDS_SPLINE_ASSERT(bare.tangent.x == 0 && bare.tangent.y == 0 && bare.tangent.z == 0);
+                CDS_SPLINE_ASSERT(bare.curvature == 0 && bare.torsion == 0);
+
+                speed = sqrt((cds_spline_r64)d.x*d.x + (cds_spline_r64)d.y*d.y + (cds_spline_r64)d.z*d.z);
+                cross[0] = (cds_spline_r64)d.y*dd.z - (cds_spline_r64)d.z*dd.y;
+                cross[1] = (cds_spline_r64)d.z*dd.x - (cds_spline_r64)d.x*dd.z;
+                cross[2] = (cds_spline_r64)d.x*dd.y - (cds_spline_r64)d.y*dd.x;
+                crossLen = sqrt(cross[0]*cross[0] + cross[1]*cross[1] + cross[2]*cross[2]);
+                for(iComp=0; iComp<3; ++iComp) {
+                    ddd[iComp] = 6.0 * m->elems[9 + iComp];
+                    CDS_SPLINE_ASSERT(fabs(p.tangent.elems[iComp] - d.elems[iComp] / speed) <= 1e-5);
+                }
+                CDS_SPLINE_ASSERT(fabs(p.curvature - crossLen / (speed*speed*speed)) <= 1e-4 * (1.0 + fabs(p.curvature)));
+                if (iPlanar) {
+                    CDS_SPLINE_ASSERT(p.torsion == 0);
+                } else if (crossLen > 1e-3) {
+                    const cds_spline_r64 torsion = (cross[0]*ddd[0] + cross[1]*ddd[1] + cross[2]*ddd[2]) / (crossLen*crossLen);
+                    CDS_SPLINE_ASSERT(fabs(p.torsion - torsion) <= 1e-3 * (1.0 + fabs(torsion)));
+                }
+            }
+            free(buffer);
+        }
+    }
+}
+
+/* Plane crossings must match the sign changes of densely sampled plane distances, and ray hits
+ * must be local minima of the distance to the ray that agree with dense sampling; both must be
+ * the same with and without bounding volume culling. */
+static void
+test_intersect(void) {
+    enum { kNumKnots = 40, kMaxHits = 256, kNumQueries = 48, kDenseSamples = 512 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom };
+    cds_spline_hit3 hits[kMaxHits], culledHits[kMaxHits];
+    cds_spline_knot3 knots[kNumKnots];
+    cds_spline_s32 iStyle, iKnot, iQuery, iHit, iSeg, iSamp, hitCount, culledHitCount;
+    srand(1);
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        cds_spline3 spline, culled;
+        size_t bufferSize = cds_spline3_buffer_size(styles[iStyle], kNumKnots);
+        size_t culledSize = cds_spline3_buffer_size_ex(styles[iStyle], kNumKnots, kCdsSplineFlagBoundingVolumes);
+        void *buffer = malloc(bufferSize), *culledBuffer = malloc(culledSize);
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            knots[iKnot] = test_random_knot(10.0f);
+        }
+        cds_spline3_init_from_knots(&spline, styles[iStyle], kNumKnots, kCdsSplineFlagNone, knots, kNumKnots,
+            buffer, bufferSize);
+        cds_spline3_init_from_knots(&culled, styles[iStyle], kNumKnots, kCdsSplineFlagBoundingVolumes, knots, kNumKnots,
+            culledBuffer, culledSize);
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            /* planes through random points near the curve */
+            cds_spline_vec3 normal = test_random_knot(2.0f).position;
+            const cds_spline_r32 offset = cds_spline3__dot(normal, test_random_knot(6.0f).position);
+            const cds_spline_r32 tolerance = 1e-4f * 10.0f * (cds_spline_r32)sqrt(cds_spline3__dot(normal, normal));
+            cds_spline_s32 crossings = 0;
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&spline, normal, offset, hits, kMaxHits, &hitCount) ==
+                kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&culled, normal, offset, culledHits, kMaxHits, &culledHitCount) ==
+                kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(hitCount == culledHitCount);
+            for(iHit=0; iHit<hitCount; ++iHit) {
+                const cds_spline_vec3 pos = cds_spline3__eval_segment(cds_spline3__segment(&spline, hits[iHit].segment), hits[iHit].u);
+                CDS_SPLINE_ASSERT(hits[iHit].segment == culledHits[iHit].segment && hits[iHit].u == culledHits[iHit].u);
+                CDS_SPLINE_ASSERT(hits[iHit].u >= 0 && hits[iHit].u <= 1);
+                CDS_SPLINE_ASSERT(fabs(cds_spline3__dot(normal, hits[iHit].position) - offset) <= tolerance);
+                CDS_SPLINE_ASSERT(pos.x == hits[iHit].position.x && pos.y == hits[iHit].position.y && pos.z == hits[iHit].position.z);
+                if (iHit > 0) {
+                    CDS_SPLINE_ASSERT(hits[iHit].segment > hits[iHit-1].segment ||
+                        (hits[iHit].segment == hits[iHit-1].segment && hits[iHit].u > hits[iHit-1].u));
+                }
+            }
+            /* every sign change of the sampled distance has a hit inside its sample interval */
+            for(iSeg=0; iSeg<spline.numSegments; ++iSeg) {
+                const cds_spline_mat34 *m = cds_spline3__segment(&spline, iSeg);
+                cds_spline_r32 prev = cds_spline3__dot(normal, cds_spline3__eval_segment(m, 0)) - offset;
+                for(iSamp=1; iSamp<=kDenseSamples; ++iSamp) {
+                    const cds_spline_r32 u = (cds_spline_r32)iSamp / (cds_spline_r32)kDenseSamples;
+                    const cds_spline_r32 d = cds_spline3__dot(normal, cds_spline3__eval_segment(m, u)) - offset;
+                    if ((prev < 0) != (d < 0)) {
+                        cds_spline_bool32_t found = 0;
+                        for(iHit=0; iHit<hitCount; ++iHit) {
+                            found |= hits[iHit].segment == iSeg && hits[iHit].u >= u - 1.001f/kDenseSamples &&
+                                hits[iHit].u <= u + 0.001f/kDenseSamples;
+                        }
+                        CDS_SPLINE_ASSERT(found);
+                        crossings += 1;
+                    }
+                    prev = d;
+                }
+            }
+            CDS_SPLINE_ASSERT(hitCount >= crossings);
+        }
+        /* count-only and short buffers */
+        {
+            const cds_spline_vec3 normal = cds_spline_init_vec3(0, 1, 0);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&spline, normal, 0, hits, kMaxHits, &hitCount) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(hitCount >= 2);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&spline, normal, 0, NULL, 0, &culledHitCount) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(culledHitCount == hitCount);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&spline, normal, 0, culledHits, 1, &culledHitCount) ==
+                kCdsSplineErrorIntersect_BufferSize);
+            CDS_SPLINE_ASSERT(culledHitCount == hitCount && culledHits[0].u == hits[0].u);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_plane(&spline, cds_spline_init_vec3(0, 0, 0), 0, hits, kMaxHits, &hitCount) ==
+                kCdsSplineErrorIntersect_Direction);
+        }
+
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            /* rays from far away, so every point of the spline is in front of the origin */
+            cds_spline_vec3 target = test_random_knot(8.0f).position, dir = test_random_knot(2.0f).position, origin;
+            const cds_spline_r32 radius = 0.2f + 0.5f * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            cds_spline_r32 minDistance = 3.0e38f, bestHitDistance = 3.0e38f;
+            cds_spline3__normalize(&dir);
+            origin = cds_spline3__sub_scaled(target, 100.0f, dir);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_ray(&spline, origin, dir, radius, hits, kMaxHits, &hitCount) ==
+                kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_intersect_ray(&culled, origin, dir, radius, culledHits, kMaxHits, &culledHitCount) ==
+                kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(hitCount == culledHitCount);
+            for(iHit=0; iHit<hitCount; ++iHit) {
+                const cds_spline_r32 t = (cds_spline_r32)hits[iHit].segment + hits[iHit].u;
+                cds_spline_r32 dt;
+                CDS_SPLINE_ASSERT(hits[iHit].segment == culledHits[iHit].segment && hits[iHit].u == culledHits[iHit].u);
+                CDS_SPLINE_ASSERT(hits[iHit].distance <= radius && hits[iHit].rayDistance > 0);
+                /* a local minimum: nearby points are no closer */
+                for(dt=-0.01f; dt<=0.01f; dt+=0.005f) {
+                    const cds_spline_r32 tNear = CDS_SPLINE_MIN(CDS_SPLINE_MAX(t + dt, 0.0f), (cds_spline_r32)spline.numSegments);
+                    const cds_spline_vec3 rel = cds_spline3__sub_scaled(cds_spline3_eval(&spline, tNear), 1.0f, origin);
+                    const cds_spline_vec3 perp = cds_spline3__sub_scaled(rel, cds_spline3__dot(rel, dir), dir);
+                    CDS_SPLINE_ASSERT((cds_spline_r32)sqrt(cds_spline3__dot(perp, perp)) >= hits[iHit].distance - 1e-3f);
+                }
+                bestHitDistance = CDS_SPLINE_MIN(bestHitDistance, hits[iHit].distance);
+            }
+            /* the closest sampled approach is found */
+            for(iSamp=0; iSamp<=kDenseSamples*spline.numSegments/8; ++iSamp) {
+                const cds_spline_r32 t = 8.0f * (cds_spline_r32)iSamp / (cds_spline_r32)kDenseSamples;
+                const cds_spline_vec3 rel = cds_spline3__sub_scaled(cds_spline3_eval(&spline, t), 1.0f, origin);
+                const cds_spline_vec3 perp = cds_spline3__sub_scaled(rel, cds_spline3__dot(rel, dir), dir);
+                minDistance = CDS_SPLINE_MIN(minDistance, (cds_spline_r32)sqrt(cds_spline3__dot(perp, perp)));
+            }
+            if (minDistance < radius - 1e-3f) {
+                CDS_SPLINE_ASSERT(bestHitDistance <= minDistance + 1e-3f);
+            } else if (minDistance > radius + 1e-3f) {
+                CDS_SPLINE_ASSERT(hitCount == 0);
+            }
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_intersect_ray(&spline, knots[0].position, cds_spline_init_vec3(0, 0, 0), 1, hits, kMaxHits,
+            &hitCount) == kCdsSplineErrorIntersect_Direction);
+        CDS_SPLINE_ASSERT(cds_spline3_intersect_ray(&spline, knots[0].position, cds_spline_init_vec3(1, 0, 0), -1, hits, kMaxHits,
+            &hitCount) == kCdsSplineErrorIntersect_Radius);
+        free(buffer);
+        free(culledBuffer);
+    }
+}
+
+/* Pooled splines must behave like individually allocated ones, reuse freed buffers of their
+ * class, keep their content bit for bit when grown, and all come back on reset. */
+static void
+test_pool(void) {
+    enum { kSlabSize = 128*1024, kNumSplines = 24 };
+    const cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes | kCdsSplineFlagKnotTimes;
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom };
+    void *slabs[2];
+    cds_spline_pool pool;
+    cds_spline3 splines[kNumSplines], grown, reference, spare;
+    void *referenceBuffer;
+    cds_spline_knot3 knots[48];
+    cds_spline_r32 times[48];
+    cds_spline_s32 iSpline, iKnot, iSeg, sizeClass;
+    void *block;
+
+    /* cardinal and Catmull-Rom splines have two fewer segments than Hermite and Bezier ones */
+    CDS_SPLINE_ASSERT(cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, 10) + 2*sizeof(cds_spline_mat34) ==
+        cds_spline3_buffer_size(kCdsSplineInterpStyleHermite, 10));
+
+    for(iKnot=0; iKnot<48; ++iKnot) {
+        knots[iKnot].position = cds_spline_init_vec3((cds_spline_r32)iKnot, (cds_spline_r32)sin(0.7*iKnot),
+            (cds_spline_r32)cos(0.3*iKnot));
+        knots[iKnot].tangent = cds_spline_init_vec3(1, (cds_spline_r32)cos(0.7*iKnot), 0);
+        times[iKnot] = 0.5f*(cds_spline_r32)iKnot;
+    }
+    slabs[0] = malloc(kSlabSize);
+    slabs[1] = malloc(kSlabSize);
+    CDS_SPLINE_ASSERT(cds_spline_pool_init(&pool, kCdsSplineFlagReadOnly) == kCdsSplineErrorPoolInit_Flags);
+    CDS_SPLINE_ASSERT(cds_spline_pool_init(&pool, flags) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleHermite, 4) ==
+        kCdsSplineErrorPoolAlloc_OutOfMemory);
+    CDS_SPLINE_ASSERT(cds_spline_pool_add_slab(&pool, slabs[0], 8) == kCdsSplineErrorPoolAddSlab_BufferSize);
+    CDS_SPLINE_ASSERT(cds_spline_pool_add_slab(&pool, slabs[0], kSlabSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleHermite, 0x7FFFFFFF) ==
+        kCdsSplineErrorPoolAlloc_MaxKnotCount);
+    for(sizeClass=0; sizeClass<CDS_SPLINE_POOL_CLASS_COUNT; ++sizeClass) {
+        CDS_SPLINE_ASSERT(pool.blockSizes[sizeClass] >= cds_spline3_buffer_size_ex(kCdsSplineInterpStyleBezier,
+            CDS_SPLINE_POOL_MIN_KNOTS << sizeClass, flags));
+    }
+
+    /* Pooled splines of every style and class evaluate like malloc'd ones */
+    referenceBuffer = malloc(cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, 64, flags));
+    for(iSpline=0; iSpline<kNumSplines; ++iSpline) {
+        const cds_spline_interp_style style = styles[iSpline % 4];
+        const cds_spline_s32 numKnots = 4 + iSpline % 9;
+        CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &splines[iSpline], style, numKnots) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(splines[iSpline].maxNumKnots >= numKnots && splines[iSpline].flags == flags);
+        CDS_SPLINE_ASSERT(((intptr_t)splines[iSpline].segmentMatrices & (CDS_SPLINE__CACHE_LINE_SIZE-1)) == 0);
+        cds_spline3_append_knots(&splines[iSpline], knots + iSpline, numKnots);
+        cds_spline3_set_knot_times(&splines[iSpline], 0, times, numKnots);
+        /* same capacity, so the bounds trees have the same shape */
+        cds_spline3_init_ex(&reference, style, splines[iSpline].maxNumKnots, flags, referenceBuffer,
+            cds_spline3_buffer_size_ex(style, splines[iSpline].maxNumKnots, flags));
+        cds_spline3_append_knots(&reference, knots + iSpline, numKnots);
+        cds_spline3_set_knot_times(&reference, 0, times, numKnots);
+        test_expect_same_spline(&splines[iSpline], &reference);
+    }
+    CDS_SPLINE_ASSERT(pool.liveSplines == kNumSplines);
+
+    /* Freed buffers are reused by the next spline of the same class, whatever its style (splines[5]
+     * holds 9 knots, so it is in the 16-knot class) */
+    block = splines[5].segmentMatrices;
+    cds_spline3_pool_free(&pool, &splines[5]);
+    CDS_SPLINE_ASSERT(pool.liveSplines == kNumSplines-1);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleHermite, 33) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(spare.segmentMatrices != block);
+    cds_spline3_pool_free(&pool, &spare);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &splines[5], kCdsSplineInterpStyleCardinal, 10) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(splines[5].segmentMatrices == block);
+
+    /* Growing relocates the spline without changing it */
+    for(iSpline=0; iSpline<4; ++iSpline) {
+        const cds_spline_s32 numKnots = 4 + iSpline % 9;
+        cds_spline3_init_ex(&reference, splines[iSpline].interpStyle, 64, flags, referenceBuffer,
+            cds_spline3_buffer_size_ex(splines[iSpline].interpStyle, 64, flags));
+        cds_spline3_append_knots(&reference, knots + iSpline, numKnots);
+        cds_spline3_set_knot_times(&reference, 0, times, numKnots);
+        cds_spline3_set_tension(&splines[iSpline], 0.25f);
+        cds_spline3_set_tension(&reference, 0.25f);
+        block = splines[iSpline].segmentMatrices;
+        grown = splines[iSpline];
+        CDS_SPLINE_ASSERT(cds_spline3_pool_grow(&pool, &grown, 2) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(grown.segmentMatrices == block);
+        CDS_SPLINE_ASSERT(cds_spline3_pool_grow(&pool, &grown, 0x7FFFFFFF) == kCdsSplineErrorPoolGrow_MaxKnotCount);
+        CDS_SPLINE_ASSERT(cds_spline3_pool_grow(&pool, &grown, 40) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(grown.maxNumKnots >= 40 && grown.segmentMatrices != block && grown.tension == 0.25f);
+        test_expect_same_knots(&grown, &reference);
+        test_expect_same_spline(&grown, &reference);
+        CDS_SPLINE_ASSERT(grown.knotTimes[numKnots-1] == times[numKnots-1]);
+        /* and it keeps working in its new home */
+        cds_spline3_append_knots(&grown, knots + iSpline + numKnots, 40 - numKnots);
+        cds_spline3_append_knots(&reference, knots + iSpline + numKnots, 40 - numKnots);
+        test_expect_same_spline(&grown, &reference);
+        splines[iSpline] = grown;
+        /* the old buffer went back on its class's free list */
+        CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleBezier, 4 + iSpline % 9) ==
+            kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(spare.segmentMatrices == block);
+        cds_spline3_pool_free(&pool, &spare);
+    }
+
+    /* Allocation moves on to the next slab when the first one fills up */
+    while(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleHermite, 64) == kCdsSplineErrorNone) {
+        CDS_SPLINE_ASSERT((cds_spline_u8*)spare.segmentMatrices + pool.blockSizes[4] <= (cds_spline_u8*)slabs[0] + kSlabSize);
+    }
+    grown = splines[0];
+    CDS_SPLINE_ASSERT(cds_spline3_pool_grow(&pool, &grown, 100) == kCdsSplineErrorPoolGrow_OutOfMemory);
+    CDS_SPLINE_ASSERT(grown.segmentMatrices == splines[0].segmentMatrices && grown.maxNumKnots == splines[0].maxNumKnots);
+    CDS_SPLINE_ASSERT(cds_spline_pool_add_slab(&pool, slabs[1], kSlabSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_grow(&pool, &grown, 100) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT((cds_spline_u8*)grown.segmentMatrices >= (cds_spline_u8*)slabs[1] &&
+        (cds_spline_u8*)grown.segmentMatrices < (cds_spline_u8*)slabs[1] + kSlabSize);
+    test_expect_same_knots(&grown, &splines[0]);
+    /* the bounds tree has a different shape now, but the same segments and root */
+    for(iSeg=0; iSeg<grown.numSegments; ++iSeg) {
+        CDS_SPLINE_ASSERT(memcmp(cds_spline3__segment(&grown, iSeg), cds_spline3__segment(&splines[0], iSeg),
+            sizeof(cds_spline_mat34)) == 0);
+    }
+    CDS_SPLINE_ASSERT(grown.arcLengths[grown.numSegments] == splines[0].arcLengths[splines[0].numSegments]);
+    CDS_SPLINE_ASSERT(memcmp(&grown.segmentBounds[1], &splines[0].segmentBounds[1], sizeof(cds_spline_aabb3)) == 0);
+
+    /* Reset hands out the first slab again from the start */
+    cds_spline_pool_reset(&pool);
+    CDS_SPLINE_ASSERT(pool.liveSplines == 0);
+    CDS_SPLINE_ASSERT(cds_spline3_pool_alloc(&pool, &spare, kCdsSplineInterpStyleHermite, 4) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT((cds_spline_u8*)spare.segmentMatrices - (cds_spline_u8*)slabs[0] < 2*CDS_SPLINE__CACHE_LINE_SIZE);
+    free(referenceBuffer);
+    free(slabs[0]);
+    free(slabs[1]);
+}
+
+/* Solving x -> t on x-monotone timing curves must land within the tolerance in x, including
+ * on ease curves whose x speed drops to zero, and the batched form must match single queries. */
+static void
+test_timing(void) {
+    enum { kNumKnots = 12, kNumQueries = 2000 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleBezier, kCdsSplineInterpStyleHermite };
+    const size_t bufferSize = cds_spline2_buffer_size(kCdsSplineInterpStyleBezier, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_r32 *tableBuffer = (cds_spline_r32*)malloc(kNumKnots*CDS_SPLINE_TIMING_SAMPLES*sizeof(cds_spline_r32));
+    cds_spline_r32 *xs = (cds_spline_r32*)malloc(kNumQueries*sizeof(cds_spline_r32));
+    cds_spline_r32 *ts = (cds_spline_r32*)malloc(kNumQueries*sizeof(cds_spline_r32));
+    cds_spline_r32 *ys = (cds_spline_r32*)malloc(kNumQueries*sizeof(cds_spline_r32));
+    const cds_spline_r32 tolerances[] = { 1e-2f, 1e-4f, 1e-6f };
+    cds_spline_s32 iStyle, iTol, iKnot, iQuery;
+    cds_spline_timing2 timing;
+    cds_spline_knot2 knot;
+    cds_spline2 spline;
+
+    srand(1);
+    for(iStyle=0; iStyle<2; ++iStyle) {
+        cds_spline_r32 x = 0, prevDx = 1.0f;
+        cds_spline2_init(&spline, styles[iStyle], kNumKnots, buffer, bufferSize);
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            /* every third knot eases in and out, with no x speed at all. The x speed is kept small
+             * next to the gaps on both sides, so that the curve stays x-monotone. */
+            const cds_spline_r32 dx = 0.1f + 2.0f*(cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            knot.position = cds_spline_init_vec2(x, 4.0f*((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f));
+            knot.tangent = cds_spline_init_vec2((iKnot % 3 == 0) ? 0.0f : 0.3f*CDS_SPLINE_MIN(dx, prevDx),
+                (cds_spline_r32)(rand() % 3) - 1.0f);
+            cds_spline2_append_knots(&spline, &knot, 1);
+            x += dx;
+            prevDx = dx;
+        }
+        for(iTol=0; iTol<3; ++iTol) {
+            const cds_spline_r32 tolerance = tolerances[iTol];
+            const cds_spline_r32 xMin = spline.knots[0].position.x, xMax = spline.knots[kNumKnots-1].position.x;
+            CDS_SPLINE_ASSERT(cds_spline2_timing_init(&timing, &spline, tolerance, tableBuffer,
+                cds_spline2_timing_buffer_size(&spline)) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(timing.maxIterations > 0 && timing.maxIterations <= 48);
+            for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                /* sorted, with a few out of range at both ends */
+                xs[iQuery] = xMin - 0.5f + (xMax - xMin + 1.0f) * (cds_spline_r32)iQuery / (kNumQueries-1);
+            }
+            for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                const cds_spline_r32 t = cds_spline2_timing_solve(&timing, xs[iQuery]);
+                const cds_spline_r32 xClamped = CDS_SPLINE_MIN(CDS_SPLINE_MAX(xs[iQuery], xMin), xMax);
+                const cds_spline_vec2 pos = cds_spline2_eval(&spline, t);
+                CDS_SPLINE_ASSERT(t >= 0 && t <= (cds_spline_r32)spline.numSegments);
+                /* eval() recomputes u from t, so allow for rounding on top of the tolerance */
+                CDS_SPLINE_ASSERT(fabs(pos.x - xClamped) <= tolerance + 4e-6f * (cds_spline_r32)fabs(xMax));
+                CDS_SPLINE_ASSERT(fabs(cds_spline2_timing_eval(&timing, xs[iQuery]) - pos.y) <= 1e-3f);
+            }
+            cds_spline2_timing_eval_many(&timing, xs, kNumQueries, ts, ys);
+            for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                CDS_SPLINE_ASSERT(ts[iQuery] == cds_spline2_timing_solve(&timing, xs[iQuery]));
+                CDS_SPLINE_ASSERT(ys[iQuery] == cds_spline2_timing_eval(&timing, xs[iQuery]));
+            }
+            /* unsorted, and each output on its own */
+            for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                xs[iQuery] = xMin + (xMax - xMin) * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            }
+            cds_spline2_timing_eval_many(&timing, xs, kNumQueries, ts, NULL);
+            cds_spline2_timing_eval_many(&timing, xs, kNumQueries, NULL, ys);
+            for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                CDS_SPLINE_ASSERT(ts[iQuery] == cds_spline2_timing_solve(&timing, xs[iQuery]));
+                CDS_SPLINE_ASSERT(ys[iQuery] == cds_spline2_timing_eval(&timing, xs[iQuery]));
+            }
+        }
+    }
+
+    /* The knots themselves are hit exactly where the curve is flat in x around them */
+    CDS_SPLINE_ASSERT(cds_spline2_timing_solve(&timing, spline.knots[3].position.x) == 3.0f);
+
+    CDS_SPLINE_ASSERT(cds_spline2_timing_init(&timing, &spline, 0, tableBuffer, cds_spline2_timing_buffer_size(&spline)) ==
+        kCdsSplineErrorTimingInit_Tolerance);
+    CDS_SPLINE_ASSERT(cds_spline2_timing_init(&timing, &spline, 1e-4f, tableBuffer, cds_spline2_timing_buffer_size(&spline)-1) ==
+        kCdsSplineErrorTimingInit_BufferSize);
+    /* a tangent pointing back in x makes the curve double back */
+    knot = spline.knots[5];
+    knot.tangent.x = -1.0f;
+    cds_spline2_set_knot(&spline, 5, knot);
+    CDS_SPLINE_ASSERT(cds_spline2_timing_init(&timing, &spline, 1e-4f, tableBuffer, cds_spline2_timing_buffer_size(&spline)) ==
+        kCdsSplineErrorTimingInit_NotMonotonic);
+    cds_spline2_init(&spline, kCdsSplineInterpStyleBezier, kNumKnots, buffer, bufferSize);
+    cds_spline2_append_knots(&spline, &knot, 1);
+    CDS_SPLINE_ASSERT(cds_spline2_timing_init(&timing, &spline, 1e-4f, tableBuffer, bufferSize) ==
+        kCdsSplineErrorTimingInit_SegmentCount);
+
+    free(ys);
+    free(ts);
+    free(xs);
+    free(tableBuffer);
+    free(buffer);
+}
+
+/* Baked evaluation must stay within the reported error bound of cds_spline3_eval() for every
+ * style and interpolation mode, the batch paths must match single evaluations, and any edit to
+ * the spline must make the table stale. */
+static void
+test_baked(void) {
+    enum { kNumKnots = 9, kNumQueries = 4000 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom };
+    const cds_spline_r32 tolerances[] = { 1e-1f, 1e-2f, 1e-4f };
+    const cds_spline_bake_interp interps[] = { kCdsSplineBakeLinear, kCdsSplineBakeQuadratic };
+    const size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleHermite, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumQueries*sizeof(cds_spline_r32));
+    cds_spline_vec3 *out = (cds_spline_vec3*)malloc(kNumQueries*sizeof(cds_spline_vec3));
+    cds_spline_vec3 *parallelOut = (cds_spline_vec3*)malloc(kNumQueries*sizeof(cds_spline_vec3));
+    void *timedBuffer = malloc(cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagKnotTimes));
+    cds_spline_r32 times[kNumKnots];
+    cds_spline_s32 iStyle, iTol, iInterp, iKnot, iQuery, samplesPerSegment[2];
+    cds_spline_baked3 baked;
+    cds_spline_knot3 knot;
+    cds_spline3 spline;
+    size_t tableSize;
+    void *table;
+
+    srand(1);
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        cds_spline3_init(&spline, styles[iStyle], kNumKnots, buffer, bufferSize);
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            knot = test_random_knot(10.0f);
+            cds_spline3_append_knots(&spline, &knot, 1);
+        }
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            /* including t outside the spline and exactly on samples */
+            t[iQuery] = (iQuery % 4 == 0) ? (cds_spline_r32)(iQuery/4 % 64) / 8.0f :
+                (cds_spline_r32)spline.numSegments * (1.2f*(cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.1f);
+        }
+        for(iTol=0; iTol<3; ++iTol) {
+            for(iInterp=0; iInterp<2; ++iInterp) {
+                cds_spline_r32 maxError = 0;
+                tableSize = cds_spline3_bake_buffer_size(&spline, interps[iInterp], tolerances[iTol]);
+                table = malloc(tableSize);
+                CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, interps[iInterp], tolerances[iTol], table, tableSize) ==
+                    kCdsSplineErrorNone);
+                CDS_SPLINE_ASSERT(((intptr_t)baked.samples & (CDS_SPLINE__CACHE_LINE_SIZE-1)) == 0);
+                CDS_SPLINE_ASSERT(baked.errorBound > 0 && baked.errorBound <= tolerances[iTol] + 1e-3f);
+                CDS_SPLINE_ASSERT(iInterp == 0 || baked.samplesPerSegment % 2 == 0);
+                samplesPerSegment[iInterp] = baked.samplesPerSegment;
+                for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                    const cds_spline_vec3 expected = cds_spline3_eval(&spline, t[iQuery]);
+                    const cds_spline_vec3 actual = cds_spline3_baked_eval(&baked, t[iQuery]);
+                    const cds_spline_vec3 delta = cds_spline_init_vec3(actual.x - expected.x, actual.y - expected.y,
+                        actual.z - expected.z);
+                    maxError = CDS_SPLINE_MAX(maxError, (cds_spline_r32)sqrt(cds_spline3__dot(delta, delta)));
+                }
+                CDS_SPLINE_ASSERT(maxError <= baked.errorBound);
+                CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many(&baked, t, kNumQueries, out) == kCdsSplineErrorNone);
+                CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many_parallel(&baked, t, kNumQueries, parallelOut, NULL) ==
+                    kCdsSplineErrorNone);
+                for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+                    const cds_spline_vec3 single = cds_spline3_baked_eval(&baked, t[iQuery]);
+                    CDS_SPLINE_ASSERT(memcmp(&out[iQuery], &single, sizeof(single)) == 0);
+                    CDS_SPLINE_ASSERT(memcmp(&parallelOut[iQuery], &single, sizeof(single)) == 0);
+                }
+                free(table);
+            }
+            /* the quadratic table never needs more samples, and far fewer for tight tolerances */
+            CDS_SPLINE_ASSERT(samplesPerSegment[1] <= samplesPerSegment[0] + 1);
+            CDS_SPLINE_ASSERT(iTol < 2 || 4*samplesPerSegment[1] < samplesPerSegment[0]);
+        }
+    }
+
+    /* Edits make the table stale; a tension change to the same value is not an edit */
+    tableSize = cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeLinear, 1e-2f);
+    table = malloc(tableSize);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeLinear, 1e-2f, table, tableSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    cds_spline3_set_tension(&spline, spline.tension);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    /* and neither is a rejected edit */
+    CDS_SPLINE_ASSERT(cds_spline3_set_knot(&spline, kNumKnots, knot) == kCdsSplineErrorSetKnot_KnotIndex);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    knot = test_random_knot(10.0f);
+    cds_spline3_set_knot(&spline, 4, knot);
+    CDS_SPLINE_ASSERT(!cds_spline3_baked_is_current(&baked));
+    CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many(&baked, t, kNumQueries, out) == kCdsSplineErrorBakedEval_Stale);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many_parallel(&baked, t, kNumQueries, out, NULL) ==
+        kCdsSplineErrorBakedEval_Stale);
+    /* the edited curve may need a different resolution */
+    free(table);
+    tableSize = cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeLinear, 1e-2f);
+    table = malloc(tableSize);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeLinear, 1e-2f, table, tableSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    cds_spline3_remove_knot(&spline, 0);
+    CDS_SPLINE_ASSERT(!cds_spline3_baked_is_current(&baked));
+    free(table);
+
+    /* An out-of-order set_knot_times is rejected without touching the spline, so the table stays
+     * current and the batch paths keep working */
+    cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagKnotTimes, timedBuffer,
+        cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagKnotTimes));
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        knot = test_random_knot(10.0f);
+        cds_spline3_append_knots(&spline, &knot, 1);
+        times[iKnot] = (cds_spline_r32)iKnot;
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 0, times, kNumKnots) == kCdsSplineErrorNone);
+    tableSize = cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeQuadratic, 1e-2f);
+    table = malloc(tableSize);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeQuadratic, 1e-2f, table, tableSize) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 2, times+5, 1) == kCdsSplineErrorSetKnotTimes_Order);
+    CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 2, times, 2) == kCdsSplineErrorSetKnotTimes_Order);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many(&baked, t, kNumQueries, out) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many_parallel(&baked, t, kNumQueries, out, NULL) == kCdsSplineErrorNone);
+    /* and new knot times leave the curve at every t, and so the table, as it was */
+    times[2] = 2.5f;
+    CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 2, times+2, 1) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    CDS_SPLINE_ASSERT(cds_spline3_baked_eval_many(&baked, t, kNumQueries, out) == kCdsSplineErrorNone);
+    free(table);
+
+    CDS_SPLINE_ASSERT(cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeLinear, 0) == 0);
+    CDS_SPLINE_ASSERT(cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeLinear, 1e-30f) == 0);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeLinear, -1.0f, buffer, bufferSize) ==
+        kCdsSplineErrorBake_Tolerance);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeQuadratic, 1e-2f, buffer,
+        cds_spline3_bake_buffer_size(&spline, kCdsSplineBakeQuadratic, 1e-2f)-1) == kCdsSplineErrorBake_BufferSize);
+    cds_spline3_init(&spline, kCdsSplineInterpStyleHermite, kNumKnots, buffer, bufferSize);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, &spline, kCdsSplineBakeLinear, 1e-2f, out, sizeof(out[0])) ==
+        kCdsSplineErrorBake_SegmentCount);
+
+    free(parallelOut);
+    free(out);
+    free(t);
+    free(timedBuffer);
+    free(buffer);
+}
+
+/* A ring spline must match a cds_spline3 built from the knots it currently holds, through
+ * wraparound, pops of every size and tension changes, while computing one segment per push. */
+static void
+test_ring(void) {
+    enum { kMaxKnots = 13, kNumPushes = 300, kNumSamples = 37 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom };
+    cds_spline_s32 iStyle, iPush, iKnot, iSamp, iComp;
+    srand(1);
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        cds_spline_ring3 ring;
+        cds_spline3 spline;
+        size_t ringSize = cds_spline3_ring_buffer_size(styles[iStyle], kMaxKnots);
+        size_t bufferSize = cds_spline3_buffer_size(styles[iStyle], kMaxKnots);
+        void *ringBuffer = malloc(ringSize), *buffer = malloc(bufferSize);
+        cds_spline_knot3 knots[kMaxKnots];
+        cds_spline_u64 pushed = 0;
+        CDS_SPLINE_ASSERT(cds_spline3_ring_init(&ring, styles[iStyle], kMaxKnots, ringBuffer, ringSize-1) ==
+            kCdsSplineErrorRingInit_BufferSize);
+        CDS_SPLINE_ASSERT(cds_spline3_ring_init(&ring, styles[iStyle], kMaxKnots, ringBuffer, ringSize) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_ring_pop_front(&ring, 1) == kCdsSplineErrorRingPopFront_KnotCount);
+        for(iPush=0; iPush<kNumPushes; ++iPush) {
+            const cds_spline_knot3 knot = test_random_knot(10.0f);
+#if defined(CDS_SPLINE_INSTRUMENT)
+            cds_spline_stats before, after;
+            cds_spline_get_stats(&before);
+#endif
+            if (ring.numKnots == kMaxKnots) {
+                CDS_SPLINE_ASSERT(cds_spline3_ring_push_back(&ring, knot) == kCdsSplineErrorRingPushBack_MaxNumKnots);
+                CDS_SPLINE_ASSERT(cds_spline3_ring_pop_front(&ring, 1 + rand() % kMaxKnots) == kCdsSplineErrorNone);
+            }
+            CDS_SPLINE_ASSERT(cds_spline3_ring_push_back(&ring, knot) == kCdsSplineErrorNone);
+            pushed += 1;
+            CDS_SPLINE_ASSERT(cds_spline3_ring_knot(&ring, ring.numKnots-1)->position.x == knot.position.x);
+#if defined(CDS_SPLINE_INSTRUMENT)
+            cds_spline_get_stats(&after);
+            CDS_SPLINE_ASSERT(after.segmentRecomputes[styles[iStyle]] - before.segmentRecomputes[styles[iStyle]] <= 1);
+#endif
+            if (iPush % 50 == 49)
+                cds_spline3_ring_set_tension(&ring, (iPush % 100 == 49) ? 0.25f : 0.5f);
+            if (rand() % 4 == 0)
+                CDS_SPLINE_ASSERT(cds_spline3_ring_pop_front(&ring, rand() % (ring.numKnots+1)) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(ring.origin + (cds_spline_u64)ring.numKnots == pushed);
+            CDS_SPLINE_ASSERT(ring.numSegments == cds_spline__segment_count(styles[iStyle], ring.numKnots));
+            for(iKnot=0; iKnot<ring.numKnots; ++iKnot) {
+                knots[iKnot] = *cds_spline3_ring_knot(&ring, iKnot);
+            }
+            if (ring.numSegments == 0)
+                continue;
+            cds_spline3_init_from_knots(&spline, styles[iStyle], kMaxKnots, kCdsSplineFlagNone, knots, ring.numKnots,
+                buffer, bufferSize);
+            cds_spline3_set_tension(&spline, ring.tension);
+            for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+                const cds_spline_r32 t = ((cds_spline_r32)ring.numSegments + 1.0f) * (cds_spline_r32)iSamp / (kNumSamples-1) - 0.5f;
+                cds_spline_vec3 a[3], b[3];
+                a[0] = cds_spline3_ring_eval(&ring, t);   b[0] = cds_spline3_eval(&spline, t);
+                a[1] = cds_spline3_ring_evald(&ring, t);  b[1] = cds_spline3_evald(&spline, t);
+                a[2] = cds_spline3_ring_evaldd(&ring, t); b[2] = cds_spline3_evaldd(&spline, t);
+                for(iKnot=0; iKnot<3; ++iKnot) {
+                    for(iComp=0; iComp<3; ++iComp) {
+                        CDS_SPLINE_ASSERT(a[iKnot].elems[iComp] == b[iKnot].elems[iComp]);
+                    }
+                }
+            }
+        }
+        free(ringBuffer);
+        free(buffer);
+    }
+}
+
+/* A bound blob must answer every query exactly like the spline it was written from, point into
+ * the blob instead of copying it, refuse edits, and refuse blobs it cannot trust. */
+static void
+test_blob(void) {
+    enum { kNumKnots = 30, kNumSamples = 101 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleCardinal,
+        kCdsSplineInterpStyleBezier, kCdsSplineInterpStyleCentripetalCatmullRom };
+    const cds_spline_u32 tableFlags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes | kCdsSplineFlagKnotTimes;
+    cds_spline_u32 flagSets[] = { kCdsSplineFlagNone, tableFlags, tableFlags | kCdsSplineFlagBlockedSegments,
+        tableFlags | kCdsSplineFlagDeferredUpdates };
+    cds_spline_knot3 knots[kNumKnots];
+    cds_spline_r32 times[kNumKnots];
+    cds_spline_s32 iStyle, iFlags, iKnot, iSamp, iComp;
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        knots[iKnot] = test_random_knot(10.0f);
+        times[iKnot] = (iKnot == 0) ? 1.0f : times[iKnot-1] + 0.1f + (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+    }
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        for(iFlags=0; iFlags<4; ++iFlags) {
+            const cds_spline_u32 flags = flagSets[iFlags];
+            size_t bufferSize = cds_spline3_buffer_size_ex(styles[iStyle], kNumKnots, flags), blobSize;
+            void *buffer = malloc(bufferSize);
+            cds_spline_u8 *blobBuffer, *copyBuffer, *blob, *copy;
+            cds_spline_cursor cursor = {0}, boundCursor = {0};
+            cds_spline3 spline, bound;
+            cds_spline2 wrongDim;
+            cds_spline_knot3 knot = test_random_knot(1.0f);
+            CDS_SPLINE_ASSERT(cds_spline3_init_from_knots(&spline, styles[iStyle], kNumKnots, flags, knots, kNumKnots-1,
+                buffer, bufferSize) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_set_tension(&spline, 0.25f) == kCdsSplineErrorNone);
+            if (flags & kCdsSplineFlagKnotTimes) {
+                CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&spline, 0, times, kNumKnots-1) == kCdsSplineErrorNone);
+            }
+            /* leaves an edit pending with deferred updates; writing must flush it */
+            CDS_SPLINE_ASSERT(cds_spline3_set_knot(&spline, 3, knots[kNumKnots-1]) == kCdsSplineErrorNone);
+
+            blobSize = cds_spline3_blob_size(&spline);
+            blobBuffer = (cds_spline_u8*)malloc(blobSize + CDS_SPLINE_BLOB_ALIGNMENT);
+            copyBuffer = (cds_spline_u8*)malloc(blobSize + CDS_SPLINE_BLOB_ALIGNMENT + 4);
+            blob = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)blobBuffer, CDS_SPLINE_BLOB_ALIGNMENT);
+            copy = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)copyBuffer, CDS_SPLINE_BLOB_ALIGNMENT);
+            CDS_SPLINE_ASSERT(cds_spline3_write_blob(&spline, blob, blobSize-1) == kCdsSplineErrorWriteBlob_BufferSize);
+            CDS_SPLINE_ASSERT(cds_spline3_write_blob(&spline, blob, blobSize) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, blob, blobSize) == kCdsSplineErrorNone);
+
+            /* zero copy: the arrays live in the blob */
+            CDS_SPLINE_ASSERT((cds_spline_u8*)bound.knots > blob && (cds_spline_u8*)bound.knots < blob + blobSize);
+            CDS_SPLINE_ASSERT((cds_spline_u8*)bound.segmentMatrices > blob && (cds_spline_u8*)bound.segmentMatrices < blob + blobSize);
+            CDS_SPLINE_ASSERT(((intptr_t)bound.segmentMatrices % CDS_SPLINE_BLOB_ALIGNMENT) == 0);
+            CDS_SPLINE_ASSERT(bound.interpStyle == spline.interpStyle && bound.tension == spline.tension);
+            CDS_SPLINE_ASSERT(bound.flags == ((flags & ~(cds_spline_u32)kCdsSplineFlagDeferredUpdates) | kCdsSplineFlagReadOnly));
+            CDS_SPLINE_ASSERT((bound.arcLengths != NULL) == ((flags & kCdsSplineFlagArcLengthTable) != 0));
+            CDS_SPLINE_ASSERT((bound.segmentBounds != NULL) == ((flags & kCdsSplineFlagBoundingVolumes) != 0));
+            CDS_SPLINE_ASSERT((bound.knotTimes != NULL) == ((flags & kCdsSplineFlagKnotTimes) != 0));
+            test_expect_same_spline(&spline, &bound);
+            for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+                const cds_spline_r32 t = (cds_spline_r32)spline.numSegments * (cds_spline_r32)iSamp / (cds_spline_r32)(kNumSamples-1);
+                const cds_spline_r32 time = times[0] - 0.5f + (times[kNumKnots-2] - times[0] + 1.0f) * t / (cds_spline_r32)spline.numSegments;
+                cds_spline_vec3 a[4], b[4];
+                a[0] = cds_spline3_eval(&spline, t);              b[0] = cds_spline3_eval(&bound, t);
+                a[1] = cds_spline3_evald(&spline, t);             b[1] = cds_spline3_evald(&bound, t);
+                a[2] = cds_spline3_evaldd(&spline, t);            b[2] = cds_spline3_evaldd(&bound, t);
+                a[3] = cds_spline3_eval_at_time(&spline, &cursor, time);
+                b[3] = cds_spline3_eval_at_time(&bound, &boundCursor, time);
+                for(iKnot=0; iKnot<4; ++iKnot) {
+                    for(iComp=0; iComp<3; ++iComp) {
+                        CDS_SPLINE_ASSERT(a[iKnot].elems[iComp] == b[iKnot].elems[iComp]);
+                    }
+                }
+            }
+            if (flags & kCdsSplineFlagArcLengthTable) {
+                CDS_SPLINE_ASSERT(cds_spline3_arc_length(&spline) == cds_spline3_arc_length(&bound));
+            }
+            for(iSamp=0; iSamp<8; ++iSamp) {
+                cds_spline_vec3 query = test_random_knot(20.0f).position;
+                CDS_SPLINE_ASSERT(cds_spline3_find_closest_point(&spline, query).t == cds_spline3_find_closest_point(&bound, query).t);
+            }
+
+            /* writing is deterministic, and a bound spline writes back the same blob */
+            CDS_SPLINE_ASSERT(cds_spline3_blob_size(&bound) == blobSize);
+            CDS_SPLINE_ASSERT(cds_spline3_write_blob(&bound, copy, blobSize) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(memcmp(blob, copy, blobSize) == 0);
+
+            /* the bound spline is read-only */
+            CDS_SPLINE_ASSERT(cds_spline3_set_tension(&bound, 0.5f) == kCdsSplineErrorSetTension_ReadOnly);
+            CDS_SPLINE_ASSERT(cds_spline3_insert_knot(&bound, 0, knot) == kCdsSplineErrorInsertKnot_ReadOnly);
+            CDS_SPLINE_ASSERT(cds_spline3_append_knots(&bound, &knot, 1) == kCdsSplineErrorAppendKnots_ReadOnly);
+            CDS_SPLINE_ASSERT(cds_spline3_set_knot(&bound, 0, knot) == kCdsSplineErrorSetKnot_ReadOnly);
+            CDS_SPLINE_ASSERT(cds_spline3_remove_knot(&bound, 0) == kCdsSplineErrorRemoveKnot_ReadOnly);
+            if (flags & kCdsSplineFlagKnotTimes) {
+                CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(&bound, 0, times, 1) == kCdsSplineErrorSetKnotTimes_ReadOnly);
+            }
+            CDS_SPLINE_ASSERT(cds_spline3_flush(&bound) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(memcmp(blob, copy, blobSize) == 0);
+
+            /* validation */
+            memcpy(copy + 4, blob, blobSize);
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy + 4, blobSize) == kCdsSplineErrorBindBlob_Alignment);
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, blob, blobSize-1) == kCdsSplineErrorBindBlob_BlobSize);
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, blob, sizeof(cds_spline_blob_header)-1) == kCdsSplineErrorBindBlob_BlobSize);
+            CDS_SPLINE_ASSERT(cds_spline2_bind_blob(&wrongDim, blob, blobSize) == kCdsSplineErrorBindBlob_Dimension);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->magic += 1;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Magic);
+            ((cds_spline_blob_header*)copy)->magic = 0x43445342; /* CDS_SPLINE_BLOB_MAGIC, byte-swapped */
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_ByteOrder);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->version += 1;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Version);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->numSegments += 1;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Header);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->knotsOffset += CDS_SPLINE_BLOB_ALIGNMENT;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Header);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->numKnots = 0x7FFFFFFF;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Header);
+            memcpy(copy, blob, blobSize);
+            ((cds_spline_blob_header*)copy)->flags |= kCdsSplineFlagDeferredUpdates;
+            CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, copy, blobSize) == kCdsSplineErrorBindBlob_Header);
+
+            free(buffer);
+            free(blobBuffer);
+            free(copyBuffer);
+        }
+    }
+    {
+        /* an empty spline makes a header-only blob */
+        size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, 4, tableFlags);
+        void *buffer = malloc(bufferSize);
+        cds_spline_u8 *blobBuffer, *blob;
+        cds_spline3 spline, bound;
+        size_t blobSize;
+        CDS_SPLINE_ASSERT(cds_spline3_init_ex(&spline, kCdsSplineInterpStyleCardinal, 4, tableFlags, buffer, bufferSize) ==
+            kCdsSplineErrorNone);
+        blobSize = cds_spline3_blob_size(&spline);
+        blobBuffer = (cds_spline_u8*)malloc(blobSize + CDS_SPLINE_BLOB_ALIGNMENT);
+        blob = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)blobBuffer, CDS_SPLINE_BLOB_ALIGNMENT);
+        CDS_SPLINE_ASSERT(cds_spline3_write_blob(&spline, blob, blobSize) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_bind_blob(&bound, blob, blobSize) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(bound.numKnots == 0 && bound.numSegments == 0 && cds_spline3_arc_length(&bound) == 0);
+        free(buffer);
+        free(blobBuffer);
+    }
+}
+
+/* Sweep frames must be orthonormal, follow the spline, and not twist (a planar curve keeps its
+ * out-of-plane normal); streamed tube chunks must join up to the same mesh as a single chunk. */
+static void
+test_sweep(void) {
+    enum { kNumKnots = 9, kRingsPerSegment = 16, kVertsPerRing = 12, kMaxRings = 256, kSubsteps = 256 };
+    const cds_spline_s32 chunkRings[] = { kMaxRings, 2, 3, 7 };
+    const cds_spline_vec3 up = {{0, 0, 1}};
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_sweep3 sweep;
+    cds_spline_frame3 *frames = (cds_spline_frame3*)malloc(kMaxRings * sizeof(cds_spline_frame3));
+    cds_spline_vec3 *allPositions = (cds_spline_vec3*)malloc(kMaxRings*kVertsPerRing * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *positions = (cds_spline_vec3*)malloc(kMaxRings*kVertsPerRing * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *normals = (cds_spline_vec3*)malloc(kMaxRings*kVertsPerRing * sizeof(cds_spline_vec3));
+    cds_spline_u32 *indices = (cds_spline_u32*)malloc(kMaxRings*6*kVertsPerRing * sizeof(cds_spline_u32));
+    cds_spline_vec3 refNormal = up;
+    cds_spline_s32 iKnot, iFrame, iStep, iPass, iChunk, iVert, iIndex, frameCount, vertCount, indexCount, ringCount, totalRings;
+    srand(4);
+    CDS_SPLINE_ASSERT(cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_sweep_init(&sweep, &spline, 0, kVertsPerRing, 1.0f, NULL) ==
+        kCdsSplineErrorSweepInit_RingsPerSegment);
+    CDS_SPLINE_ASSERT(cds_spline3_sweep_init(&sweep, &spline, kRingsPerSegment, 2, 1.0f, NULL) ==
+        kCdsSplineErrorSweepInit_VertsPerRing);
+
+    for(iPass=0; iPass<2; ++iPass) {
+        /* pass 0 is planar (z=0), pass 1 is a random space curve */
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            cds_spline_knot3 knot = test_random_knot(10.0f);
+            if (iPass == 0)
+                knot.position.z = knot.tangent.z = 0;
+            CDS_SPLINE_ASSERT(cds_spline3_insert_knot(&spline, iKnot, knot) == kCdsSplineErrorNone);
+        }
+        totalRings = spline.numSegments*kRingsPerSegment + 1;
+        CDS_SPLINE_ASSERT(totalRings <= kMaxRings);
+        CDS_SPLINE_ASSERT(cds_spline3_sweep_init(&sweep, &spline, kRingsPerSegment, kVertsPerRing, 0.25f, &up) ==
+            kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_sweep_next_frames(&sweep, frames, kMaxRings, &frameCount) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(frameCount == totalRings);
+        CDS_SPLINE_ASSERT(cds_spline3_sweep_next_frames(&sweep, frames, kMaxRings, &frameCount) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(frameCount == 0);
+        cds_spline3_sweep_init(&sweep, &spline, kRingsPerSegment, kVertsPerRing, 0.25f, &up);
+        cds_spline3_sweep_next_frames(&sweep, frames, kMaxRings, &frameCount);
+        for(iFrame=0; iFrame<frameCount; ++iFrame) {
+            const cds_spline_frame3 *f = frames + iFrame;
+            const cds_spline_r32 t = (cds_spline_r32)iFrame / (cds_spline_r32)kRingsPerSegment;
+            cds_spline_vec3 pos = cds_spline3_eval(&spline, t), d = cds_spline3_evald(&spline, t);
+            cds_spline_vec3 b = cds_spline3__cross(f->tangent, f->normal);
+            cds_spline3__normalize(&d);
+            CDS_SPLINE_ASSERT(sqrt(cds_spline3__distance_sq(pos, f->position)) < 1e-4f);
+            CDS_SPLINE_ASSERT(cds_spline3__dot(d, f->tangent) > 0.9999f);
+            CDS_SPLINE_ASSERT(fabs(cds_spline3__dot(f->normal, f->normal) - 1) < 1e-5f);
+            CDS_SPLINE_ASSERT(fabs(cds_spline3__dot(f->normal, f->tangent)) < 1e-5f);
+            CDS_SPLINE_ASSERT(cds_spline3__distance_sq(b, f->binormal) < 1e-10f);
+            if (iPass == 0) {
+                CDS_SPLINE_ASSERT(f->normal.z > 0.9999f);
+            } else {
+                /* compare against a reference frame transported by projection in tiny steps */
+                for(iStep=(iFrame > 0) ? 1 : 0; iStep<=kSubsteps; ++iStep) {
+                    cds_spline_vec3 dRef = cds_spline3_evald(&spline,
+                        ((cds_spline_r32)iFrame - 1.0f + (cds_spline_r32)iStep / kSubsteps) / kRingsPerSegment);
+                    cds_spline3__normalize(&dRef);
+                    refNormal = cds_spline3__sub_scaled(refNormal, cds_spline3__dot(refNormal, dRef), dRef);
+                    cds_spline3__normalize(&refNormal);
+                    if (iFrame == 0)
+                        break;
+                }
+                CDS_SPLINE_ASSERT(cds_spline3__dot(refNormal, f->normal) > 0.999f);
+            }
+        }
+
+        for(iChunk=0; iChunk<(cds_spline_s32)(sizeof(chunkRings)/sizeof(chunkRings[0])); ++iChunk) {
+            const cds_spline_s32 maxVerts = chunkRings[iChunk]*kVertsPerRing;
+            const cds_spline_s32 maxIndices = (chunkRings[iChunk]-1)*6*kVertsPerRing;
+            cds_spline_s32 ringsSoFar = 0;
+            cds_spline3_sweep_init(&sweep, &spline, kRingsPerSegment, kVertsPerRing, 0.25f, &up);
+            CDS_SPLINE_ASSERT(cds_spline3_sweep_next(&sweep, positions, normals, kVertsPerRing*2-1, indices, maxIndices,
+                &vertCount, &indexCount) == kCdsSplineErrorSweepNext_BufferSize);
+            for(;;) {
+                CDS_SPLINE_ASSERT(cds_spline3_sweep_next(&sweep, positions, normals, maxVerts, indices, maxIndices,
+                    &vertCount, &indexCount) == kCdsSplineErrorNone);
+                if (vertCount == 0)
+                    break;
+                ringCount = vertCount / kVertsPerRing;
+                CDS_SPLINE_ASSERT(vertCount % kVertsPerRing == 0 && ringCount >= 2 && vertCount <= maxVerts);
+                CDS_SPLINE_ASSERT(indexCount == (ringCount-1)*6*kVertsPerRing);
+                for(iIndex=0; iIndex<indexCount; ++iIndex) {
+                    CDS_SPLINE_ASSERT(indices[iIndex] < (cds_spline_u32)vertCount);
+                }
+                /* outward winding */
+                {
+                    const cds_spline_vec3 a = positions[indices[0]], b = positions[indices[1]], c = positions[indices[2]];
+                    const cds_spline_vec3 n = cds_spline3__cross(cds_spline3__sub_scaled(b, 1, a), cds_spline3__sub_scaled(c, 1, a));
+                    CDS_SPLINE_ASSERT(cds_spline3__dot(n, normals[indices[0]]) > 0);
+                }
+                for(iVert=0; iVert<vertCount; ++iVert) {
+                    const cds_spline_frame3 *f = frames + ringsSoFar + iVert/kVertsPerRing - (ringsSoFar > 0 ? 1 : 0);
+                    CDS_SPLINE_ASSERT(fabs(sqrt(cds_spline3__distance_sq(positions[iVert], f->position)) - 0.25f) < 1e-5f);
+                    CDS_SPLINE_ASSERT(fabs(cds_spline3__dot(normals[iVert], f->tangent)) < 1e-5f);
+                }
+                if (iChunk == 0) {
+                    memcpy(allPositions, positions, vertCount*sizeof(cds_spline_vec3));
+                } else {
+                    /* the first ring repeats the previous chunk's last ring */
+                    const cds_spline_s32 firstRing = (ringsSoFar > 0) ? ringsSoFar-1 : 0;
+                    CDS_SPLINE_ASSERT(memcmp(allPositions + firstRing*kVertsPerRing, positions,
+                        vertCount*sizeof(cds_spline_vec3)) == 0);
+                }
+                ringsSoFar += ringCount - (ringsSoFar > 0 ? 1 : 0);
+            }
+            CDS_SPLINE_ASSERT(ringsSoFar == totalRings);
+        }
+        while(spline.numKnots > 0) {
+            cds_spline3_remove_knot(&spline, 0);
+        }
+    }
+    free(indices);
+    free(normals);
+    free(positions);
+    free(allPositions);
+    free(frames);
+    free(buffer);
+}
+
+/* Dense samples of a helix with a wobble. */
+static cds_spline_vec3
+test_fitter_curve(cds_spline_r32 s) {
+    return cds_spline_init_vec3(5.0f*(cds_spline_r32)cos(s), 5.0f*(cds_spline_r32)sin(s),
+        0.3f*s + 0.5f*(cds_spline_r32)sin(3.0f*s));
+}
+
+/* Fitted splines must stay within the error bound of every sample, after every push, with far
+ * fewer knots than samples; a small window must keep the bound too, at the cost of more knots. */
+static void
+test_fitter(void) {
+    enum { kNumSamples = 2000, kMaxKnots = 1000, kWindowSize = 64 };
+    const cds_spline_r32 maxError = 0.01f;
+    const cds_spline_s32 windowSizes[] = { kWindowSize, 8 };
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, kMaxKnots,
+        kCdsSplineFlagKnotTimes | kCdsSplineFlagBoundingVolumes);
+    size_t fitterBufferSize = cds_spline3_fitter_buffer_size(kWindowSize);
+    void *buffer = malloc(bufferSize), *fitterBuffer = malloc(fitterBufferSize);
+    cds_spline_vec3 *points = (cds_spline_vec3*)malloc(kNumSamples * sizeof(cds_spline_vec3));
+    cds_spline_r32 *times = (cds_spline_r32*)malloc(kNumSamples * sizeof(cds_spline_r32));
+    cds_spline_fitter3 fitter;
+    cds_spline_knot3 committed;
+    cds_spline_s32 iSample, iCheck, iWindow, iPass, iKnot, knotCount[2][2];
+    for(iSample=0; iSample<kNumSamples; ++iSample) {
+        /* uneven sample spacing */
+        times[iSample] = 0.01f*(cds_spline_r32)iSample + 0.004f*(cds_spline_r32)(iSample % 3);
+        points[iSample] = test_fitter_curve(times[iSample]);
+    }
+
+    cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kMaxKnots, buffer, bufferSize);
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, maxError, kWindowSize, fitterBuffer, fitterBufferSize) ==
+        kCdsSplineErrorFitterInit_InterpStyle);
+    cds_spline3_init(&spline, kCdsSplineInterpStyleHermite, kMaxKnots, buffer, bufferSize);
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, maxError, 2, fitterBuffer, fitterBufferSize) ==
+        kCdsSplineErrorFitterInit_WindowSize);
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, -1.0f, kWindowSize, fitterBuffer, fitterBufferSize) ==
+        kCdsSplineErrorFitterInit_MaxError);
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, maxError, kWindowSize, fitterBuffer, fitterBufferSize-1) ==
+        kCdsSplineErrorFitterInit_BufferSize);
+
+    for(iPass=0; iPass<2; ++iPass) {
+        /* pass 1 also keys the knots to the samples' times */
+        const cds_spline_u32 flags = kCdsSplineFlagBoundingVolumes | (iPass == 1 ? kCdsSplineFlagKnotTimes : 0);
+        for(iWindow=0; iWindow<2; ++iWindow) {
+            CDS_SPLINE_ASSERT(cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, kMaxKnots, flags, buffer,
+                bufferSize) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, maxError, windowSizes[iWindow], fitterBuffer,
+                fitterBufferSize) == kCdsSplineErrorNone);
+            for(iSample=0; iSample<kNumSamples; ++iSample) {
+                const cds_spline_s32 committedIndex = fitter.anchorTangentFixed ? fitter.anchorKnot : -1;
+                if (committedIndex >= 0)
+                    committed = spline.knots[committedIndex];
+                CDS_SPLINE_ASSERT(cds_spline3_fitter_push(&fitter, points[iSample], times[iSample]) == kCdsSplineErrorNone);
+                /* committed knots never change */
+                if (committedIndex >= 0) {
+                    CDS_SPLINE_ASSERT(memcmp(&committed, spline.knots + committedIndex, sizeof(committed)) == 0);
+                }
+                /* the bound holds online; spot-check the samples along the last few segments */
+                if (iSample % 13 == 0 && spline.numSegments > 0) {
+                    for(iCheck=CDS_SPLINE_MAX(iSample-2*kWindowSize, 0); iCheck<=iSample; iCheck += 5) {
+                        const cds_spline_closest_point3 closest = cds_spline3_find_closest_point(&spline, points[iCheck]);
+                        CDS_SPLINE_ASSERT(closest.distance <= maxError*1.001f);
+                    }
+                }
+            }
+            for(iCheck=0; iCheck<kNumSamples; ++iCheck) {
+                const cds_spline_closest_point3 closest = cds_spline3_find_closest_point(&spline, points[iCheck]);
+                CDS_SPLINE_ASSERT(closest.distance <= maxError*1.001f);
+            }
+            CDS_SPLINE_ASSERT(memcmp(&spline.knots[spline.numKnots-1].position, points + kNumSamples-1,
+                sizeof(cds_spline_vec3)) == 0);
+            if (iPass == 1) {
+                /* every knot is a sample, at that sample's time */
+                for(iKnot=0, iCheck=0; iKnot<spline.numKnots; ++iKnot) {
+                    while (iCheck < kNumSamples && memcmp(&spline.knots[iKnot].position, points + iCheck,
+                        sizeof(cds_spline_vec3)) != 0)
+                        iCheck += 1;
+                    CDS_SPLINE_ASSERT(iCheck < kNumSamples && spline.knotTimes[iKnot] == times[iCheck]);
+                }
+            }
+            knotCount[iPass][iWindow] = spline.numKnots;
+        }
+        CDS_SPLINE_ASSERT(knotCount[iPass][0] < kNumSamples/10);
+        CDS_SPLINE_ASSERT(knotCount[iPass][0] < knotCount[iPass][1]);
+    }
+
+    /* errors leave the fitter untouched; a new fitter continues from the spline's last knot */
+    iSample = spline.numKnots;
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_push(&fitter, points[0], times[0]) == kCdsSplineErrorFitterPush_Time);
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_init(&fitter, &spline, maxError, kWindowSize, fitterBuffer, fitterBufferSize) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(fitter.sampleCount == 1 && spline.numKnots == iSample);
+    spline.maxNumKnots = spline.numKnots;
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_push(&fitter, points[0], times[kNumSamples-1] + 1.0f) ==
+        kCdsSplineErrorFitterPush_MaxNumKnots);
+    CDS_SPLINE_ASSERT(fitter.sampleCount == 1 && spline.numKnots == iSample);
+    spline.maxNumKnots = kMaxKnots;
+    CDS_SPLINE_ASSERT(cds_spline3_fitter_push(&fitter, points[0], times[kNumSamples-1] + 1.0f) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(spline.numKnots == iSample+1);
+
+    free(times);
+    free(points);
+    free(fitterBuffer);
+    free(buffer);
+}
+
+/* Runs tasks last-to-first, to check that the parallel results do not depend on task order. */
+static void
+test_reverse_parallel_for(void *context, cds_spline_task_func task, void *taskData, cds_spline_s32 taskCount) {
+    cds_spline_s32 *outMaxTaskCount = (cds_spline_s32*)context;
+    cds_spline_s32 iTask;
+    *outMaxTaskCount = CDS_SPLINE_MAX(*outMaxTaskCount, taskCount);
+    for(iTask=taskCount-1; iTask>=0; --iTask) {
+        task(taskData, iTask);
+    }
+}
+
+/* The parallel front ends must be bit-identical to the serial functions for any executor,
+ * including a spline with edits still pending when the call is made. */
+static void
+test_parallel(void) {
+    enum { kNumKnots = 500, kSteps = 12, kNumT = 20003, kNumExecutors = 4 };
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kNumKnots,
+        kCdsSplineFlagDeferredUpdates);
+    void *buffer = malloc(bufferSize);
+    const cds_spline_s32 maxVerts = kNumKnots*kSteps + 1;
+    cds_spline_vec3 *serialVerts = (cds_spline_vec3*)malloc(maxVerts * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *verts = (cds_spline_vec3*)malloc(maxVerts * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *serialOut = (cds_spline_vec3*)malloc(kNumT * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *out = (cds_spline_vec3*)malloc(kNumT * sizeof(cds_spline_vec3));
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumT * sizeof(cds_spline_r32));
+    cds_spline_executor executors[kNumExecutors];
+    cds_spline_s32 maxTaskCount = 0, iKnot, iT, iExec, iOrder, serialVertCount, vertCount;
+#if defined(CDS_SPLINE_THREADS)
+    cds_spline_thread_pool *pool;
+    size_t poolSize = cds_spline_thread_pool_buffer_size(3);
+    void *poolBuffer = malloc(poolSize);
+    srand(1);
+    CDS_SPLINE_ASSERT(cds_spline_thread_pool_init(&pool, -1, poolBuffer, poolSize) ==
+        kCdsSplineErrorThreadPoolInit_WorkerCount);
+    CDS_SPLINE_ASSERT(cds_spline_thread_pool_init(&pool, 3, poolBuffer, poolSize-sizeof(void*)) ==
+        kCdsSplineErrorThreadPoolInit_BufferSize);
+    CDS_SPLINE_ASSERT(cds_spline_thread_pool_init(&pool, 3, poolBuffer, poolSize) == kCdsSplineErrorNone);
+    executors[3] = cds_spline_thread_pool_executor(pool);
+    CDS_SPLINE_ASSERT(executors[3].concurrency == 4);
+#else
+    executors[3].parallelFor = NULL;
+    executors[3].context = NULL;
+    executors[3].concurrency = 1;
+#endif
+    executors[0].parallelFor = NULL; /* serial */
+    executors[0].context = NULL;
+    executors[0].concurrency = 1;
+    executors[1].parallelFor = test_reverse_parallel_for;
+    executors[1].context = &maxTaskCount;
+    executors[1].concurrency = 3;
+    executors[2].parallelFor = test_reverse_parallel_for;
+    executors[2].context = &maxTaskCount;
+    executors[2].concurrency = 64;
+
+    CDS_SPLINE_ASSERT(cds_spline3_init_ex(&spline, kCdsSplineInterpStyleCardinal, kNumKnots,
+        kCdsSplineFlagDeferredUpdates, buffer, bufferSize) == kCdsSplineErrorNone);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        CDS_SPLINE_ASSERT(cds_spline3_insert_knot(&spline, iKnot, test_random_knot(10.0f)) == kCdsSplineErrorNone);
+    }
+    for(iT=0; iT<kNumT; ++iT) {
+        /* sorted runs with occasional jumps, so both the wide and the scalar paths are exercised */
+        t[iT] = (iT % 1000 < 900) ? (cds_spline_r32)iT * spline.numSegments / kNumT
+            : (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX * (spline.numSegments + 2) - 1.0f;
+    }
+
+    for(iExec=0; iExec<kNumExecutors; ++iExec) {
+        /* leave an edit pending; the parallel call must flush it before splitting work */
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot(&spline, 7*iExec + 3, test_random_knot(10.0f)) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_uniform_parallel(&spline, kSteps, 5, verts, maxVerts, &vertCount,
+            executors + iExec) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_uniform(&spline, kSteps, 5, serialVerts, maxVerts, &serialVertCount) ==
+            kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(vertCount == serialVertCount);
+        CDS_SPLINE_ASSERT(memcmp(verts, serialVerts, vertCount*sizeof(cds_spline_vec3)) == 0);
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_uniform_parallel(&spline, 0, 0, verts, maxVerts, &vertCount,
+            executors + iExec) == kCdsSplineErrorTessellate_StepCount);
+        CDS_SPLINE_ASSERT(cds_spline3_tessellate_uniform_parallel(&spline, kSteps, 0, verts, serialVertCount-1,
+            &vertCount, executors + iExec) == kCdsSplineErrorTessellate_BufferSize);
+
+        for(iOrder=0; iOrder<3; ++iOrder) {
+            CDS_SPLINE_ASSERT(cds_spline3_set_knot(&spline, 11*iOrder + 1, test_random_knot(10.0f)) == kCdsSplineErrorNone);
+            switch(iOrder) {
+            case 0: cds_spline3_eval_many_parallel(&spline, t, kNumT, out, executors + iExec); break;
+            case 1: cds_spline3_evald_many_parallel(&spline, t, kNumT, out, executors + iExec); break;
+            default: cds_spline3_evaldd_many_parallel(&spline, t, kNumT, out, executors + iExec); break;
+            }
+            switch(iOrder) {
+            case 0: cds_spline3_eval_many(&spline, t, kNumT, serialOut); break;
+            case 1: cds_spline3_evald_many(&spline, t, kNumT, serialOut); break;
+            default: cds_spline3_evaldd_many(&spline, t, kNumT, serialOut); break;
+            }
+            CDS_SPLINE_ASSERT(memcmp(out, serialOut, kNumT*sizeof(cds_spline_vec3)) == 0);
+        }
+    }
+    /* make sure the work was actually split */
+    CDS_SPLINE_ASSERT(maxTaskCount > 1);
+
+#if defined(CDS_SPLINE_THREADS)
+    cds_spline_thread_pool_destroy(pool);
+    free(poolBuffer);
+#endif
+    free(t);
+    free(out);
+    free(serialOut);
+    free(verts);
+    free(serialVerts);
+    free(buffer);
+}
+
+#if defined(CDS_SPLINE_THREADS)
+/* Applies one random edit; both splines must end up identical. */
+static void
+test_random_edit(cds_spline3 *a, cds_spline3 *b, cds_spline_s32 minKnots) {
+    const cds_spline_knot3 knot = test_random_knot(10.0f);
+    const cds_spline_s32 op = rand() % 16, knotIndex = (a->numKnots > 0) ? rand() % a->numKnots : 0;
+    if (op < 6 && a->numKnots > 0) {
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot(a, knotIndex, knot) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot(b, knotIndex, knot) == kCdsSplineErrorNone);
+    } else if (op < 9 && a->numKnots < a->maxNumKnots) {
+        CDS_SPLINE_ASSERT(cds_spline3_insert_knot(a, knotIndex, knot) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_insert_knot(b, knotIndex, knot) == kCdsSplineErrorNone);
+    } else if (op < 11 && a->numKnots < a->maxNumKnots) {
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(a, &knot, 1) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_append_knots(b, &knot, 1) == kCdsSplineErrorNone);
+    } else if (op < 14 && a->numKnots > minKnots) {
+        CDS_SPLINE_ASSERT(cds_spline3_remove_knot(a, knotIndex) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_remove_knot(b, knotIndex) == kCdsSplineErrorNone);
+    } else if (op == 14) {
+        const cds_spline_r32 tension = 0.25f * (cds_spline_r32)(rand() % 4);
+        CDS_SPLINE_ASSERT(cds_spline3_set_tension(a, tension) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_set_tension(b, tension) == kCdsSplineErrorNone);
+    } else if (a->knotTimes != NULL && a->numKnots > 0) {
+        /* Respaces the times of a few knots between their neighbors' */
+        cds_spline_r32 times[4], lo, hi;
+        const cds_spline_s32 maxTimeCount = 1 + rand() % 4;
+        const cds_spline_s32 timeCount = CDS_SPLINE_MIN(maxTimeCount, a->numKnots - knotIndex);
+        cds_spline_s32 iTime;
+        lo = (knotIndex > 0) ? a->knotTimes[knotIndex-1] : a->knotTimes[0] - 1.0f;
+        hi = (knotIndex + timeCount < a->numKnots) ? a->knotTimes[knotIndex + timeCount] : lo + (cds_spline_r32)timeCount + 1.0f;
+        for(iTime=0; iTime<timeCount; ++iTime) {
+            times[iTime] = lo + (hi - lo) * (cds_spline_r32)(iTime+1) / (cds_spline_r32)(timeCount+1);
+            times[iTime] = CDS_SPLINE_MIN(CDS_SPLINE_MAX(times[iTime], (iTime > 0) ? times[iTime-1] : lo), hi);
+        }
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(a, knotIndex, times, timeCount) == kCdsSplineErrorNone);
+        CDS_SPLINE_ASSERT(cds_spline3_set_knot_times(b, knotIndex, times, timeCount) == kCdsSplineErrorNone);
+    }
+}
+
+/* After any sequence of edits, each publish must match a plain spline given the same edits, and
+ * the copy handed to the next writer must already match the published one. A snapshot held
+ * across a publish must not change. */
+static void
+test_shared_edits(void) {
+    enum { kMaxKnots = 40, kNumRounds = 300 };
+    cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleCardinal,
+        kCdsSplineInterpStyleBezier, kCdsSplineInterpStyleCentripetalCatmullRom };
+    const cds_spline_u32 tableFlags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes | kCdsSplineFlagKnotTimes;
+    cds_spline_u32 flagSets[] = { kCdsSplineFlagNone, tableFlags, tableFlags | kCdsSplineFlagBlockedSegments,
+        tableFlags | kCdsSplineFlagDeferredUpdates };
+    cds_spline_s32 iStyle, iFlags, iRound, iEdit;
+    srand(1);
+    for(iStyle=0; iStyle<4; ++iStyle) {
+        for(iFlags=0; iFlags<4; ++iFlags) {
+            const cds_spline_u32 flags = flagSets[iFlags];
+            size_t sharedSize = cds_spline3_shared_buffer_size(styles[iStyle], kMaxKnots, flags);
+            size_t refSize = cds_spline3_buffer_size_ex(styles[iStyle], kMaxKnots, flags);
+            void *sharedBuffer = malloc(sharedSize), *refBuffer = malloc(refSize);
+            cds_spline_shared3 shared;
+            cds_spline3 ref, *writer;
+            const cds_spline3 *snapshot;
+            cds_spline_u32 version;
+            CDS_SPLINE_ASSERT(cds_spline3_shared_init(&shared, styles[iStyle], kMaxKnots, flags | kCdsSplineFlagReadOnly,
+                sharedBuffer, sharedSize) == kCdsSplineErrorSharedInit_Flags);
+            CDS_SPLINE_ASSERT(cds_spline3_shared_init(&shared, styles[iStyle], kMaxKnots, flags, sharedBuffer,
+                sharedSize-1) == kCdsSplineErrorSharedInit_BufferSize);
+            CDS_SPLINE_ASSERT(cds_spline3_shared_init(&shared, styles[iStyle], kMaxKnots, flags, sharedBuffer,
+                sharedSize) == kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_init_ex(&ref, styles[iStyle], kMaxKnots, flags, refBuffer, refSize) ==
+                kCdsSplineErrorNone);
+            CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorSharedPublish_NoWrite);
+            snapshot = cds_spline3_shared_acquire(&shared, &version);
+            CDS_SPLINE_ASSERT(version == 0 && snapshot->numKnots == 0);
+            cds_spline3_shared_release(&shared, snapshot);
+
+            for(iRound=0; iRound<kNumRounds; ++iRound) {
+                cds_spline_vec3 held[3];
+                const cds_spline3 *old = cds_spline3_shared_acquire(&shared, &version);
+                const cds_spline_u32 oldVersion = version;
+                const cds_spline_s32 oldKnots = old->numKnots;
+                if (oldKnots > 3) {
+                    held[0] = cds_spline3_eval(old, 0.0f);
+                    held[1] = cds_spline3_evald(old, 0.5f * (cds_spline_r32)old->numSegments);
+                    held[2] = cds_spline3_evaldd(old, (cds_spline_r32)old->numSegments);
+                }
+                CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorNone);
+                CDS_SPLINE_ASSERT(writer != old);
+                CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorSharedBeginWrite_Writing);
+                test_expect_same_knots(writer, old);
+                test_expect_same_spline(writer, old);
+                for(iEdit=rand() % 4; iEdit>=0; --iEdit) {
+                    test_random_edit(writer, &ref, 0);
+                }
+                CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorNone);
+
+                snapshot = cds_spline3_shared_acquire(&shared, &version);
+                CDS_SPLINE_ASSERT(snapshot == writer && version == oldVersion + 1);
+                cds_spline3_flush(&ref);
+                test_expect_same_knots(snapshot, &ref);
+                test_expect_same_spline(snapshot, &ref);
+                cds_spline3_shared_release(&shared, snapshot);
+                /* the old copy is untouched until its holder lets go */
+                CDS_SPLINE_ASSERT(old->numKnots == oldKnots);
+                if (oldKnots > 3) {
+                    cds_spline_vec3 now[3];
+                    now[0] = cds_spline3_eval(old, 0.0f);
+                    now[1] = cds_spline3_evald(old, 0.5f * (cds_spline_r32)old->numSegments);
+                    now[2] = cds_spline3_evaldd(old, (cds_spline_r32)old->numSegments);
+                    CDS_SPLINE_ASSERT(memcmp(held, now, sizeof(held)) == 0);
+                }
+                cds_spline3_shared_release(&shared, old);
+            }
+            free(refBuffer);
+            free(sharedBuffer);
+        }
+    }
+}
+
+typedef struct test_shared_stress {
+    cds_spline_shared3 *shared;
+    cds_spline3 *ref;
+    cds_spline_s32 writerRounds;
+    cds_spline_s32 writerDone;
+    cds_spline_s32 snapshotsChecked;
+} test_shared_stress;
+
+/* Task 0 edits and publishes; the others check that every snapshot they acquire is internally
+ * consistent: each segment matrix must be the one computed from the same snapshot's knots. A
+ * torn read of an in-progress edit would break this for some segment. */
+static void
+test_shared_stress_task(void *taskData, cds_spline_s32 taskIndex) {
+    test_shared_stress *stress = (test_shared_stress*)taskData;
+    if (taskIndex == 0) {
+        cds_spline_s32 iRound, iEdit;
+        for(iRound=0; iRound<stress->writerRounds; ++iRound) {
+            cds_spline3 *writer;
+            CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(stress->shared, &writer) == kCdsSplineErrorNone);
+            for(iEdit=rand() % 4; iEdit>=0; --iEdit) {
+                test_random_edit(writer, stress->ref, 8);
+            }
+            CDS_SPLINE_ASSERT(cds_spline3_shared_publish(stress->shared) == kCdsSplineErrorNone);
+        }
+        CDS_SPLINE__ATOMIC_STORE_S32(&stress->writerDone, 1);
+    } else {
+        cds_spline_u32 lastVersion = 0, version;
+        cds_spline_s32 iCheck = 0, iSeg, iComp;
+        while(iCheck < 16 || !CDS_SPLINE__ATOMIC_LOAD_S32(&stress->writerDone)) {
+            const cds_spline3 *snapshot = cds_spline3_shared_acquire(stress->shared, &version);
+            CDS_SPLINE_ASSERT(version >= lastVersion);
+            CDS_SPLINE_ASSERT(snapshot->numSegments == cds_spline__segment_count(snapshot->interpStyle, snapshot->numKnots));
+            for(iSeg=0; iSeg<snapshot->numSegments; ++iSeg) {
+                cds_spline_r32 m[12];
+                cds_spline__compute_segment_matrix(3, snapshot->interpStyle, snapshot->tension,
+                    snapshot->knots[iSeg].position.elems, m);
+                for(iComp=0; iComp<12; ++iComp) {
+                    CDS_SPLINE_ASSERT(cds_spline3__segment(snapshot, iSeg)->elems[iComp] == m[iComp]);
+                }
+            }
+            if (snapshot->arcLengths != NULL) {
+                CDS_SPLINE_ASSERT(snapshot->arcLengths[snapshot->numSegments] >= 0);
+            }
+            cds_spline3_shared_release(stress->shared, snapshot);
+            lastVersion = version;
+            iCheck += 1;
+        }
+        CDS_SPLINE__ATOMIC_ADD_S32(&stress->snapshotsChecked, iCheck);
+    }
 }
 
-cds_spline_error_t
-cds_spline3_init(cds_spline3 *outSpline, cds_spline_interp_style interpStyle, cds_spline_s32 maxKnotCount,
-    void *buffer, size_t bufferSize) {
-    size_t minBufferSize = cds_spline3_buffer_size(interpStyle, maxKnotCount);
-    if (bufferSize < minBufferSize)
-        return kCdsSplineErrorInit_BufferSize;
-    
-    cds_spline_u8 *bufferNext = (cds_spline_u8*)buffer;
-    outSpline->segmentMatrices = (cds_spline_mat34*)bufferNext;
-    bufferNext += (maxKnotCount-1)*sizeof(cds_spline_mat34);
-    outSpline->knots = (cds_spline_knot3*)bufferNext;
-    bufferNext += maxKnotCount*sizeof(cds_spline_knot3);
-    CDS_SPLINE_ASSERT( (intptr_t)bufferNext - (intptr_t)buffer == (intptr_t)minBufferSize );
-    
-    outSpline->interpStyle = interpStyle;
-    outSpline->tension = 0.5;
-    outSpline->numKnots = 0;
-    outSpline->maxNumKnots = maxKnotCount;
-    outSpline->numSegments = 0;
+static void
+test_shared_stress_run(void) {
+    enum { kMaxKnots = 64, kNumReaders = 4 };
+    const cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes;
+    size_t sharedSize = cds_spline3_shared_buffer_size(kCdsSplineInterpStyleCardinal, kMaxKnots, flags);
+    size_t refSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kMaxKnots, flags);
+    size_t poolSize = cds_spline_thread_pool_buffer_size(kNumReaders);
+    void *sharedBuffer = malloc(sharedSize), *refBuffer = malloc(refSize), *poolBuffer = malloc(poolSize);
+    cds_spline_shared3 shared;
+    cds_spline3 ref, *writer;
+    cds_spline_thread_pool *pool;
+    cds_spline_executor executor;
+    test_shared_stress stress;
+    const cds_spline3 *snapshot;
+    cds_spline_s32 iKnot;
+    srand(1);
+    CDS_SPLINE_ASSERT(cds_spline3_shared_init(&shared, kCdsSplineInterpStyleCardinal, kMaxKnots, flags, sharedBuffer,
+        sharedSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_init_ex(&ref, kCdsSplineInterpStyleCardinal, kMaxKnots, flags, refBuffer, refSize) ==
+        kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorNone);
+    for(iKnot=0; iKnot<kMaxKnots/2; ++iKnot) {
+        const cds_spline_knot3 knot = test_random_knot(10.0f);
+        cds_spline3_append_knots(writer, &knot, 1);
+        cds_spline3_append_knots(&ref, &knot, 1);
+    }
+    CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline_thread_pool_init(&pool, kNumReaders, poolBuffer, poolSize) == kCdsSplineErrorNone);
+    executor = cds_spline_thread_pool_executor(pool);
 
-    return kCdsSplineErrorNone;
+    stress.shared = &shared;
+    stress.ref = &ref;
+    stress.writerRounds = 300;
+    stress.writerDone = 0;
+    stress.snapshotsChecked = 0;
+    executor.parallelFor(executor.context, test_shared_stress_task, &stress, kNumReaders+1);
+    CDS_SPLINE_ASSERT(stress.snapshotsChecked >= 16*kNumReaders);
+
+    snapshot = cds_spline3_shared_acquire(&shared, NULL);
+    test_expect_same_knots(snapshot, &ref);
+    test_expect_same_spline(snapshot, &ref);
+    cds_spline3_shared_release(&shared, snapshot);
+    cds_spline_thread_pool_destroy(pool);
+    free(poolBuffer);
+    free(refBuffer);
+    free(sharedBuffer);
 }
 
-cds_spline_error_t
-cds_spline3_set_tension(cds_spline3 *outSpline, cds_spline_r32 tension) {
-    cds_spline_s32 iSeg;
-    if (outSpline->tension != tension) {
-        outSpline->tension = tension;
-        for(iSeg=0; iSeg<outSpline->numSegments; iSeg += 1) {
-            cds_spline3__compute_segment_matrix(outSpline, iSeg);
-        }
+/* A table baked from a snapshot stays current until a later writer catches that copy up. */
+static void
+test_shared_baked(void) {
+    enum { kNumKnots = 9 };
+    const size_t sharedSize = cds_spline3_shared_buffer_size(kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagNone);
+    void *sharedBuffer = malloc(sharedSize);
+    cds_spline_shared3 shared;
+    cds_spline_baked3 baked;
+    cds_spline_knot3 knot;
+    const cds_spline3 *snapshot;
+    cds_spline3 *writer;
+    cds_spline_u32 version;
+    cds_spline_s32 iKnot;
+    size_t tableSize;
+    void *table;
+
+    srand(1);
+    CDS_SPLINE_ASSERT(cds_spline3_shared_init(&shared, kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagNone,
+        sharedBuffer, sharedSize) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorNone);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        knot = test_random_knot(10.0f);
+        cds_spline3_append_knots(writer, &knot, 1);
     }
-    return kCdsSplineErrorNone;
+    CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorNone);
+
+    snapshot = cds_spline3_shared_acquire(&shared, &version);
+    tableSize = cds_spline3_bake_buffer_size(snapshot, kCdsSplineBakeLinear, 1e-2f);
+    table = malloc(tableSize);
+    CDS_SPLINE_ASSERT(cds_spline3_bake(&baked, snapshot, kCdsSplineBakeLinear, 1e-2f, table, tableSize) ==
+        kCdsSplineErrorNone);
+    cds_spline3_shared_release(&shared, snapshot);
+
+    /* the next writer gets the other copy... */
+    CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(writer != snapshot);
+    knot = test_random_knot(10.0f);
+    cds_spline3_set_knot(writer, 4, knot);
+    CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline3_baked_is_current(&baked));
+    /* ...and the one after it rewrites the baked copy with that edit */
+    CDS_SPLINE_ASSERT(cds_spline3_shared_begin_write(&shared, &writer) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(writer == snapshot);
+    CDS_SPLINE_ASSERT(!cds_spline3_baked_is_current(&baked));
+    CDS_SPLINE_ASSERT(cds_spline3_shared_publish(&shared) == kCdsSplineErrorNone);
+
+    free(table);
+    free(sharedBuffer);
 }
 
-cds_spline_error_t
-cds_spline3_insert_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex, cds_spline_knot3 knot) {
-    cds_spline_s32 iKnot, iSeg;
-    if (outSpline->numKnots == outSpline->maxNumKnots)
-        return kCdsSplineErrorInsertKnot_MaxNumKnots;
-    if (knotIndex < 0 || knotIndex > outSpline->numKnots)
-        return kCdsSplineErrorInsertKnot_KnotIndex;
-    for(iKnot=outSpline->numKnots-1; iKnot>=knotIndex; iKnot -= 1) {
-        outSpline->knots[iKnot] = outSpline->knots[iKnot-1];
-    }
-    for(iSeg=outSpline->numKnots-2; iSeg>=knotIndex; iSeg -= 1) {/* TODO: adjust copy bounds; we're overwriting some of these anyway. */
-        outSpline->segmentMatrices[iSeg] = outSpline->segmentMatrices[iSeg-1];
-    }
-    outSpline->numKnots += 1;
-    switch(outSpline->interpStyle) {
-    case kCdsSplineInterpStyleHermite:
-    case kCdsSplineInterpStyleBezier:
-        outSpline->numSegments = CDS_SPLINE_MAX(outSpline->numKnots-1, 0);
-        break;
-    case kCdsSplineInterpStyleCardinal:
-    case kCdsSplineInterpStyleCentripetalCatmullRom:
-        outSpline->numSegments = CDS_SPLINE_MAX(outSpline->numKnots-3, 0);
-        break;
-    }
-    return cds_spline3_set_knot(outSpline, knotIndex, knot);
+static void
+test_shared(void) {
+    test_shared_edits();
+    test_shared_stress_run();
+    test_shared_baked();
 }
+#endif
 
-cds_spline_error_t
-cds_spline3_set_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex, cds_spline_knot3 knot) {
-    cds_spline_s32 iSeg, firstSegment=-1, lastSegment=-1;
-    if (knotIndex < 0 || knotIndex >= outSpline->numKnots)
-        return kCdsSplineErrorSetKnot_KnotIndex;
-    outSpline->knots[knotIndex] = knot;
-    switch(outSpline->interpStyle) {
-    case kCdsSplineInterpStyleHermite:
-    case kCdsSplineInterpStyleBezier:
-        firstSegment = knotIndex-1;
-        lastSegment = knotIndex;
-        break;
-    case kCdsSplineInterpStyleCardinal:
-    case kCdsSplineInterpStyleCentripetalCatmullRom:
-        firstSegment = knotIndex-3;
-        lastSegment = knotIndex;
-        break;
+/* Every dimension is generated from the same definition, so a lower-dimensional spline must match
+ * the 3D spline built from the same knots with the missing components zeroed, and a 4D spline with
+ * w=0 must match the 3D spline exactly in x,y,z. */
+static void
+test_dimensions(void) {
+    enum { kNumKnots = 9, kNumSamples = 200 };
+    cds_spline_interp_style styles[] = {
+        kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom,
+    };
+    cds_spline_r32 coords[kNumKnots][2][4];
+    cds_spline_s32 iStyle, iDim, iKnot, iSamp, iComp;
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        for(iComp=0; iComp<4; ++iComp) {
+            coords[iKnot][0][iComp] = 10.0f * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+            coords[iKnot][1][iComp] = 10.0f * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+        }
     }
-    for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1) {
-        cds_spline3__compute_segment_matrix(outSpline, iSeg);
+    for(iStyle=0; iStyle<(cds_spline_s32)(sizeof(styles)/sizeof(styles[0])); ++iStyle) {
+        for(iDim=1; iDim<=4; ++iDim) {
+            cds_spline1 spline1;
+            cds_spline2 spline2;
+            cds_spline3 spline3;
+            cds_spline4 spline4;
+            size_t bufferSize3 = cds_spline3_buffer_size(styles[iStyle], kNumKnots);
+            size_t bufferSizeN = cds_spline4_buffer_size(styles[iStyle], kNumKnots);
+            void *buffer3, *bufferN;
+            if (iDim == 3) {
+                continue;
+            }
+            buffer3 = malloc(bufferSize3);
+            bufferN = malloc(bufferSizeN);
+            cds_spline3_init(&spline3, styles[iStyle], kNumKnots, buffer3, bufferSize3);
+            cds_spline1_init(&spline1, styles[iStyle], kNumKnots, bufferN, bufferSizeN);
+            cds_spline2_init(&spline2, styles[iStyle], kNumKnots, bufferN, bufferSizeN);
+            cds_spline4_init(&spline4, styles[iStyle], kNumKnots, bufferN, bufferSizeN);
+            for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+                cds_spline_knot1 knot1;
+                cds_spline_knot2 knot2;
+                cds_spline_knot3 knot3;
+                cds_spline_knot4 knot4;
+                for(iComp=0; iComp<4; ++iComp) {
+                    cds_spline_r32 p = (iComp < iDim && iComp < 3) ? coords[iKnot][0][iComp] : 0.0f;
+                    cds_spline_r32 v = (iComp < iDim && iComp < 3) ? coords[iKnot][1][iComp] : 0.0f;
+                    if (iComp < 1) { knot1.position.elems[iComp] = p; knot1.tangent.elems[iComp] = v; }
+                    if (iComp < 2) { knot2.position.elems[iComp] = p; knot2.tangent.elems[iComp] = v; }
+                    if (iComp < 3) { knot3.position.elems[iComp] = p; knot3.tangent.elems[iComp] = v; }
+                    knot4.position.elems[iComp] = p;
+                    knot4.tangent.elems[iComp] = v;
+                }
+                cds_spline3_insert_knot(&spline3, iKnot, knot3);
+                if (iDim == 1) {
+                    cds_spline1_insert_knot(&spline1, iKnot, knot1);
+                } else if (iDim == 2) {
+                    cds_spline2_insert_knot(&spline2, iKnot, knot2);
+                } else {
+                    cds_spline4_insert_knot(&spline4, iKnot, knot4);
+                }
+            }
+            for(iSamp=0; iSamp<=kNumSamples; ++iSamp) {
+                cds_spline_r32 t = (cds_spline_r32)spline3.numSegments * (cds_spline_r32)iSamp / (cds_spline_r32)kNumSamples;
+                cds_spline_vec3 expected[3];
+                cds_spline_r32 actual[3][4];
+                expected[0] = cds_spline3_eval(&spline3, t);
+                expected[1] = cds_spline3_evald(&spline3, t);
+                expected[2] = cds_spline3_evaldd(&spline3, t);
+                if (iDim == 1) {
+                    cds_spline_vec1 v[3];
+                    v[0] = cds_spline1_eval(&spline1, t);
+                    v[1] = cds_spline1_evald(&spline1, t);
+                    v[2] = cds_spline1_evaldd(&spline1, t);
+                    for(iComp=0; iComp<3; ++iComp) {
+                        actual[iComp][0] = v[iComp].x;
+                    }
+                } else if (iDim == 2) {
+                    cds_spline_vec2 v[3];
+                    v[0] = cds_spline2_eval(&spline2, t);
+                    v[1] = cds_spline2_evald(&spline2, t);
+                    v[2] = cds_spline2_evaldd(&spline2, t);
+                    for(iComp=0; iComp<3; ++iComp) {
+                        actual[iComp][0] = v[iComp].x;
+                        actual[iComp][1] = v[iComp].y;
+                    }
+                } else {
+                    cds_spline_vec4 v[3];
+                    v[0] = cds_spline4_eval(&spline4, t);
+                    v[1] = cds_spline4_evald(&spline4, t);
+                    v[2] = cds_spline4_evaldd(&spline4, t);
+                    for(iComp=0; iComp<3; ++iComp) {
+                        CDS_SPLINE_ASSERT(v[iComp].w == 0.0f);
+                        actual[iComp][0] = v[iComp].x;
+                        actual[iComp][1] = v[iComp].y;
+                        actual[iComp][2] = v[iComp].z;
+                    }
+                }
+                for(iComp=0; iComp<iDim && iComp<3; ++iComp) {
+                    CDS_SPLINE_ASSERT(test_nearly_equal(actual[0][iComp], expected[0].elems[iComp]));
+                    CDS_SPLINE_ASSERT(test_nearly_equal(actual[1][iComp], expected[1].elems[iComp]));
+                    CDS_SPLINE_ASSERT(test_nearly_equal(actual[2][iComp], expected[2].elems[iComp]));
+                }
+            }
+            free(buffer3);
+            free(bufferN);
+        }
     }
-    return kCdsSplineErrorNone;
 }
 
-cds_spline_error_t
-cds_spline3_remove_knot(cds_spline3 *outSpline, cds_spline_s32 knotIndex) {
-    cds_spline_s32 iKnot, iSeg, firstSegment=-1, lastSegment=-1;
-    if (knotIndex < 0 || knotIndex >= outSpline->numKnots)
-        return kCdsSplineErrorRemoveKnot_KnotIndex;
-    for(iKnot=knotIndex; iKnot<outSpline->numKnots-1; iKnot += 1) {
-        outSpline->knots[iKnot] = outSpline->knots[iKnot+1];
-    }
-    for(iSeg=knotIndex; iSeg<outSpline->numKnots-2; iSeg += 1) { /* TODO: adjust copy bounds; we're overwriting mat[ki+1] anyway */
-        outSpline->segmentMatrices[iKnot] = outSpline->segmentMatrices[iKnot+1];
-    }
-    outSpline->numKnots -= 1;
-    switch(outSpline->interpStyle) {
-    case kCdsSplineInterpStyleHermite:
-    case kCdsSplineInterpStyleBezier:
-        outSpline->numSegments = CDS_SPLINE_MAX(outSpline->numKnots-1, 0);
-        firstSegment = knotIndex-1;
-        lastSegment = knotIndex;
-        break;
-    case kCdsSplineInterpStyleCardinal:
-    case kCdsSplineInterpStyleCentripetalCatmullRom:
-        outSpline->numSegments = CDS_SPLINE_MAX(outSpline->numKnots-3, 0);
-        firstSegment = knotIndex-3;
-        lastSegment = knotIndex;
-        break;
+#if defined(__cplusplus) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+/* The C++ wrapper forwards to the C API; it must produce the same curve as calling it directly. */
+static void
+test_cpp_wrapper(void) {
+    typedef cds::spline<2, kCdsSplineInterpStyleCardinal> spline_type;
+    static_assert(spline_type::dimension == 2, "dimension");
+    static_assert(spline_type::segment_count(6) == 3, "cardinal splines need four knots per segment");
+    static_assert(cds::spline<3, kCdsSplineInterpStyleHermite>::segment_count(6) == 5, "hermite splines need two knots per segment");
+    spline_type spline;
+    cds_spline2 reference;
+    size_t bufferSize = spline_type::buffer_size(8);
+    void *buffer = malloc(bufferSize), *referenceBuffer = malloc(bufferSize);
+    cds_spline_s32 iKnot, iSamp;
+    CDS_SPLINE_ASSERT(bufferSize == cds_spline2_buffer_size(kCdsSplineInterpStyleCardinal, 8));
+    CDS_SPLINE_ASSERT(spline.init(8, buffer, bufferSize) == kCdsSplineErrorNone);
+    cds_spline2_init(&reference, kCdsSplineInterpStyleCardinal, 8, referenceBuffer, bufferSize);
+    spline.set_tension(0.25f);
+    cds_spline2_set_tension(&reference, 0.25f);
+    for(iKnot=0; iKnot<6; ++iKnot) {
+        cds_spline_knot2 knot = {};
+        knot.position.x = (cds_spline_r32)iKnot;
+        knot.position.y = (cds_spline_r32)((iKnot * 7) % 5);
+        CDS_SPLINE_ASSERT(spline.insert_knot(iKnot, knot) == kCdsSplineErrorNone);
+        cds_spline2_insert_knot(&reference, iKnot, knot);
     }
-    for(iSeg=firstSegment; iSeg<=lastSegment; iSeg += 1) {
-        cds_spline3__compute_segment_matrix(outSpline, iSeg);
+    CDS_SPLINE_ASSERT(spline.num_segments() == spline_type::segment_count(spline.num_knots()));
+    for(iSamp=0; iSamp<=30; ++iSamp) {
+        cds_spline_r32 t = (cds_spline_r32)iSamp / 10.0f;
+        CDS_SPLINE_ASSERT(spline.eval(t).x == cds_spline2_eval(&reference, t).x);
+        CDS_SPLINE_ASSERT(spline.evald(t).y == cds_spline2_evald(&reference, t).y);
+        CDS_SPLINE_ASSERT(spline.evaldd(t).y == cds_spline2_evaldd(&reference, t).y);
+        CDS_SPLINE_ASSERT(spline.eval_at_time(t).x == cds_spline2_eval_at_time(&reference, NULL, t).x);
     }
-    return kCdsSplineErrorNone;
+    CDS_SPLINE_ASSERT(spline.set_knot_times(0, NULL, 0) == kCdsSplineErrorSetKnotTimes_Flags);
+    free(buffer);
+    free(referenceBuffer);
 }
+#endif
 
-cds_spline_vec3
-cds_spline3_eval(const cds_spline3 *spline, cds_spline_r32 t) {
-    cds_spline_s32 segment;
-    cds_spline_r32 u;
-    cds_spline__get_int_and_frac(spline->numKnots, t, &segment, &u);
-    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);
-    const cds_spline_mat34 *m = spline->segmentMatrices + segment;
-    cds_spline_vec3 pos;
-    pos.x = ((m->m30*u + m->m20)*u + m->m10)*u + m->m00;
-    pos.y = ((m->m31*u + m->m21)*u + m->m11)*u + m->m01;
-    pos.z = ((m->m32*u + m->m22)*u + m->m12)*u + m->m02;
-    return pos;
-}
+#if defined(CDS_SPLINE_INSTRUMENT)
+typedef struct test_hook_log {
+    cds_spline_s32 beginCount, endCount;
+    cds_spline_s32 lastDim, lastSegmentCount;
+    cds_spline_interp_style lastStyle;
+} test_hook_log;
 
-cds_spline_vec3
-cds_spline3_evald(const cds_spline3 *spline, cds_spline_r32 t) {
-    cds_spline_s32 segment;
-    cds_spline_r32 u;
-    cds_spline__get_int_and_frac(spline->numKnots, t, &segment, &u);
-    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);
-    const cds_spline_mat34 *m = spline->segmentMatrices + segment;
-    cds_spline_vec3 dpos;
-    dpos.x = (3*m->m30*u + 2*m->m20)*u + m->m10;
-    dpos.y = (3*m->m31*u + 2*m->m21)*u + m->m11;
-    dpos.z = (3*m->m32*u + 2*m->m22)*u + m->m12;
-    return dpos;
+static void
+test_begin_recompute(void *userData, cds_spline_s32 dim, cds_spline_interp_style interpStyle,
+    cds_spline_s32 segmentCount) {
+    test_hook_log *log = (test_hook_log*)userData;
+    CDS_SPLINE_ASSERT(log->beginCount == log->endCount); /* passes never nest */
+    log->beginCount += 1;
+    log->lastDim = dim;
+    log->lastStyle = interpStyle;
+    log->lastSegmentCount = segmentCount;
 }
 
-cds_spline_vec3
-cds_spline3_evaldd(const cds_spline3 *spline, cds_spline_r32 t) {
-    cds_spline_s32 segment;
-    cds_spline_r32 u;
-    cds_spline__get_int_and_frac(spline->numKnots, t, &segment, &u);
-    CDS_SPLINE_ASSERT(segment >= 0 && segment < spline->numSegments);
-    const cds_spline_mat34 *m = spline->segmentMatrices + segment;
-    cds_spline_vec3 ddpos;
-    ddpos.x = 6*m->m30*u + 2*m->m20;
-    ddpos.y = 6*m->m31*u + 2*m->m21;
-    ddpos.z = 6*m->m32*u + 2*m->m22;
-    return ddpos;
+static void
+test_end_recompute(void *userData, cds_spline_s32 dim, cds_spline_interp_style interpStyle,
+    cds_spline_s32 segmentCount) {
+    test_hook_log *log = (test_hook_log*)userData;
+    CDS_SPLINE_ASSERT(log->beginCount == log->endCount+1);
+    CDS_SPLINE_ASSERT(dim == log->lastDim && interpStyle == log->lastStyle && segmentCount == log->lastSegmentCount);
+    log->endCount += 1;
 }
 
-   
-#endif /*------------ end implementation ------------------------*/
+/* The counters must match the work each call is known to do, and every recompute pass must be
+ * bracketed by exactly one pair of hook calls. */
+static void
+test_instrument(void) {
+    enum { kNumKnots = 10 };
+    cds_spline2 spline;
+    size_t bufferSize = cds_spline2_buffer_size_ex(kCdsSplineInterpStyleCardinal, kNumKnots+1,
+        kCdsSplineFlagDeferredUpdates);
+    void *buffer = malloc(bufferSize);
+    cds_spline_knot2 knots[kNumKnots];
+    cds_spline_stats stats;
+    cds_spline_hooks hooks;
+    test_hook_log log;
+    cds_spline_s32 iKnot;
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        knots[iKnot].position = cds_spline_init_vec2((cds_spline_r32)iKnot, (cds_spline_r32)(iKnot*iKnot));
+        knots[iKnot].tangent = cds_spline_init_vec2(1, 0);
+    }
+    memset(&log, 0, sizeof(log));
+    hooks.beginRecompute = test_begin_recompute;
+    hooks.endRecompute = test_end_recompute;
+    hooks.userData = &log;
+    cds_spline_set_hooks(&hooks);
+    cds_spline_reset_stats();
 
+    /* Immediate updates: init computes all 7 segments in one pass. */
+    CDS_SPLINE_ASSERT(cds_spline2_init_from_knots(&spline, kCdsSplineInterpStyleCardinal, kNumKnots+1, kCdsSplineFlagNone,
+        knots, kNumKnots, buffer, bufferSize) == kCdsSplineErrorNone);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.segmentRecomputes[kCdsSplineInterpStyleCardinal] == 7);
+    CDS_SPLINE_ASSERT(stats.recomputePasses == 1);
+    CDS_SPLINE_ASSERT(log.endCount == 1 && log.lastDim == 2 && log.lastStyle == kCdsSplineInterpStyleCardinal);
+    CDS_SPLINE_ASSERT(log.lastSegmentCount == 7);
 
+    /* Inserting at knot 3 shifts knots 3..9 and segments 3..6 up one slot. */
+    cds_spline_reset_stats();
+    CDS_SPLINE_ASSERT(cds_spline2_insert_knot(&spline, 3, knots[0]) == kCdsSplineErrorNone);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.knotShifts == 7 && stats.segmentShifts == 4);
+    CDS_SPLINE_ASSERT(stats.recomputePasses == 1 && log.endCount == 2);
+    CDS_SPLINE_ASSERT(stats.segmentRecomputes[kCdsSplineInterpStyleCardinal] == (cds_spline_u64)log.lastSegmentCount);
+    CDS_SPLINE_ASSERT(cds_spline2_remove_knot(&spline, 3) == kCdsSplineErrorNone);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.knotShifts == 14 && stats.segmentShifts == 8);
 
-#if defined(CDS_SPLINE_TEST) /*---------- self-test section -----*/
+    /* A batch of edits is one pass, run by the flush. */
+    cds_spline_reset_stats();
+    CDS_SPLINE_ASSERT(cds_spline2_begin_edit(&spline) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline2_set_knot(&spline, 4, knots[1]) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(cds_spline2_set_knot(&spline, 5, knots[2]) == kCdsSplineErrorNone);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.recomputePasses == 0 && log.endCount == 3);
+    CDS_SPLINE_ASSERT(cds_spline2_end_edit(&spline) == kCdsSplineErrorNone);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.recomputePasses == 1 && log.endCount == 4);
+    CDS_SPLINE_ASSERT(stats.segmentRecomputes[kCdsSplineInterpStyleCardinal] == 5); /* segments 1..5 */
 
-#include <assert.h>
+    /* Evaluation counts; only t outside [0..numSegments] counts as clamped. */
+    cds_spline_reset_stats();
+    cds_spline2_eval(&spline, 0.0f);
+    cds_spline2_eval(&spline, 7.0f);
+    cds_spline2_eval(&spline, -0.5f);
+    cds_spline2_evald(&spline, 9.0f);
+    cds_spline2_evaldd(&spline, 3.5f);
+    cds_spline2_eval_at_time(&spline, NULL, 1.0f);
+    cds_spline_get_stats(&stats);
+    CDS_SPLINE_ASSERT(stats.evalCalls == 4 && stats.evaldCalls == 1 && stats.evalddCalls == 1);
+    CDS_SPLINE_ASSERT(stats.clampedT == 2);
+    CDS_SPLINE_ASSERT(stats.recomputePasses == 0 && stats.knotShifts == 0);
 
-#include <malloc.h>
-#include <stdio.h>
-#include <stdlib.h>
+    cds_spline_set_hooks(NULL);
+    CDS_SPLINE_ASSERT(cds_spline2_set_knot(&spline, 0, knots[3]) == kCdsSplineErrorNone);
+    CDS_SPLINE_ASSERT(log.endCount == 4);
+    cds_spline_reset_stats();
+    free(buffer);
+}
+#endif
 
 int main() {
     cds_spline_s32 iKnot, iSamp;
@@ -678,6 +8237,37 @@ int main() {
         cds_spline_vec3 pos = cds_spline3_eval(&spline, u);
         printf("u=%.3f pos=[%11.8f %11.8f]\n", u, pos.x, pos.y);
     }
+    test_eval_many(&spline);
+    test_tessellate_uniform(&spline);
+    test_tessellate_adaptive();
+    test_arc_length();
+    test_closest_point();
+    test_intersect();
+    test_dimensions();
+    test_blocked_layout();
+    test_init_from_knots();
+    test_centripetal();
+    test_deferred_updates();
+    test_knot_times();
+    test_sweep();
+    test_blob();
+    test_ring();
+    test_fitter();
+    test_spline_bank();
+    test_parallel();
+#if defined(CDS_SPLINE_THREADS)
+    test_shared();
+#endif
+    test_eval_point();
+    test_pool();
+    test_timing();
+    test_baked();
+#if defined(CDS_SPLINE_INSTRUMENT)
+    test_instrument();
+#endif
+#if defined(__cplusplus) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+    test_cpp_wrapper();
+#endif
 
     free(buffer);
     return 0;
@@ -685,3 +8275,1097 @@ int main() {
 
 #endif /*------------------- end self-test section ------------*/
 
+#if defined(CDS_SPLINE_BENCH) /*---------- benchmark section -----*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+
+static double
+bench_seconds(void) {
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+#endif
+}
+
+static cds_spline_r32
+bench_random_r32(cds_spline_r32 scale) {
+    return scale * ((cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX - 0.5f);
+}
+
+/* Random-t evaluation throughput of the default and blocked (kCdsSplineFlagBlockedSegments) segment
+ * layouts. Random t defeats the prefetcher, so once the segment array outgrows the cache each eval
+ * costs one miss per touched cache line. */
+static void
+bench_segment_layouts(void) {
+    enum { kNumSamples = 1<<20, kNumRepeats = 4 };
+    const cds_spline_s32 knotCounts[] = { 16, 1024, 65536, 1<<20 };
+    const cds_spline_u32 layouts[] = { kCdsSplineFlagNone, kCdsSplineFlagBlockedSegments };
+    const char *layoutNames[] = { "default", "blocked" };
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumSamples * sizeof(cds_spline_r32));
+    cds_spline_vec3 *out = (cds_spline_vec3*)malloc(kNumSamples * sizeof(cds_spline_vec3));
+    cds_spline_s32 iCount, iLayout, iKnot, iSamp, iRep;
+    cds_spline_r32 checksum = 0;
+    printf("%-10s %-8s %14s %14s\n", "knots", "layout", "eval Mev/s", "eval_many Mev/s");
+    for(iCount=0; iCount<(cds_spline_s32)(sizeof(knotCounts)/sizeof(knotCounts[0])); ++iCount) {
+        for(iLayout=0; iLayout<2; ++iLayout) {
+            cds_spline3 spline;
+            size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, knotCounts[iCount], layouts[iLayout]);
+            void *buffer = malloc(bufferSize);
+            double start, evalTime, evalManyTime;
+            cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, knotCounts[iCount], layouts[iLayout], buffer, bufferSize);
+            srand(1);
+            for(iKnot=0; iKnot<knotCounts[iCount]; ++iKnot) {
+                cds_spline_knot3 knot;
+                knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+                knot.tangent = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+                cds_spline3_insert_knot(&spline, iKnot, knot);
+            }
+            for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+                t[iSamp] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            }
+            start = bench_seconds();
+            for(iRep=0; iRep<kNumRepeats; ++iRep) {
+                for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+                    out[iSamp] = cds_spline3_eval(&spline, t[iSamp]);
+                }
+                checksum += out[iRep].y;
+            }
+            evalTime = bench_seconds() - start;
+            start = bench_seconds();
+            for(iRep=0; iRep<kNumRepeats; ++iRep) {
+                cds_spline3_eval_many(&spline, t, kNumSamples, out);
+                checksum += out[iRep].y;
+            }
+            evalManyTime = bench_seconds() - start;
+            printf("%-10d %-8s %14.1f %14.1f\n", knotCounts[iCount], layoutNames[iLayout],
+                1e-6 * kNumRepeats * kNumSamples / evalTime, 1e-6 * kNumRepeats * kNumSamples / evalManyTime);
+            free(buffer);
+        }
+    }
+    printf("(checksum %g)\n", (double)checksum);
+    free(t);
+    free(out);
+}
+
+/* One shared t per frame across many independent tracks: a loop over separate cds_spline3 objects
+ * versus one cds_spline_bank. */
+static void
+bench_spline_bank(void) {
+    enum { kNumTracks = 10000, kNumKnots = 32, kNumFrames = 200 };
+    cds_spline3 *splines = (cds_spline3*)malloc(kNumTracks * sizeof(cds_spline3));
+    void **buffers = (void**)malloc(kNumTracks * sizeof(void*));
+    cds_spline_knot3 knots[kNumKnots];
+    cds_spline_bank bank;
+    size_t splineSize = cds_spline3_buffer_size(kCdsSplineInterpStyleHermite, kNumKnots);
+    size_t bankSize = cds_spline_bank_buffer_size(3, kCdsSplineInterpStyleHermite, kNumKnots, kNumTracks);
+    void *bankBuffer = malloc(bankSize);
+    cds_spline_r32 *out = (cds_spline_r32*)malloc(3 * kNumTracks * sizeof(cds_spline_r32));
+    cds_spline_s32 iTrack, iKnot, iFrame;
+    cds_spline_r32 checksum = 0;
+    double start, loopTime, bankTime;
+    cds_spline_bank_init(&bank, 3, kCdsSplineInterpStyleHermite, kNumKnots, kNumTracks, bankBuffer, bankSize);
+    for(iTrack=0; iTrack<kNumTracks; ++iTrack) {
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            knots[iKnot].position = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+            knots[iKnot].tangent = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+        }
+        buffers[iTrack] = malloc(splineSize);
+        cds_spline3_init_from_knots(splines + iTrack, kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagNone,
+            knots, kNumKnots, buffers[iTrack], splineSize);
+        cds_spline_bank_set_track(&bank, iTrack, &knots[0].position.x);
+    }
+    start = bench_seconds();
+    for(iFrame=0; iFrame<kNumFrames; ++iFrame) {
+        cds_spline_r32 t = (cds_spline_r32)(kNumKnots-1) * (cds_spline_r32)iFrame / (cds_spline_r32)kNumFrames;
+        for(iTrack=0; iTrack<kNumTracks; ++iTrack) {
+            cds_spline_vec3 pos = cds_spline3_eval(splines + iTrack, t);
+            out[iTrack] = pos.x;
+            out[kNumTracks + iTrack] = pos.y;
+            out[2*kNumTracks + iTrack] = pos.z;
+        }
+        checksum += out[iFrame];
+    }
+    loopTime = bench_seconds() - start;
+    start = bench_seconds();
+    for(iFrame=0; iFrame<kNumFrames; ++iFrame) {
+        cds_spline_r32 t = (cds_spline_r32)(kNumKnots-1) * (cds_spline_r32)iFrame / (cds_spline_r32)kNumFrames;
+        cds_spline_bank_eval(&bank, t, out);
+        checksum += out[iFrame];
+    }
+    bankTime = bench_seconds() - start;
+    printf("\n%-24s %14s\n", "tracks at shared t", "Mtrack-evals/s");
+    printf("%-24s %14.1f\n", "cds_spline3 loop", 1e-6 * kNumTracks * kNumFrames / loopTime);
+    printf("%-24s %14.1f\n", "cds_spline_bank", 1e-6 * kNumTracks * kNumFrames / bankTime);
+    printf("(checksum %g)\n", (double)checksum);
+    for(iTrack=0; iTrack<kNumTracks; ++iTrack) {
+        free(buffers[iTrack]);
+    }
+    free(buffers);
+    free(splines);
+    free(bankBuffer);
+    free(out);
+}
+
+/* Sequential playback of a long keyframe track with irregular knot times: binary search on every
+ * lookup versus a cursor carried from one lookup to the next. */
+static void
+bench_knot_times(void) {
+    enum { kNumKnots = 1<<16, kNumSamples = 1<<22 };
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagKnotTimes);
+    void *buffer = malloc(bufferSize);
+    cds_spline_r32 *times = (cds_spline_r32*)malloc(kNumKnots * sizeof(cds_spline_r32));
+    cds_spline_cursor cursor = {0};
+    cds_spline_s32 iKnot, iSamp;
+    cds_spline_r32 checksum = 0, duration;
+    double start, searchTime, cursorTime;
+    cds_spline3_init_ex(&spline, kCdsSplineInterpStyleHermite, kNumKnots, kCdsSplineFlagKnotTimes, buffer, bufferSize);
+    srand(1);
+    times[0] = 0;
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+        cds_spline3_insert_knot(&spline, iKnot, knot);
+        if (iKnot > 0)
+            times[iKnot] = times[iKnot-1] + 0.5f + bench_random_r32(0.8f);
+    }
+    cds_spline3_set_knot_times(&spline, 0, times, kNumKnots);
+    duration = times[kNumKnots-1];
+    start = bench_seconds();
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        checksum += cds_spline3_eval_at_time(&spline, NULL, duration * (cds_spline_r32)iSamp / kNumSamples).x;
+    }
+    searchTime = bench_seconds() - start;
+    start = bench_seconds();
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        checksum += cds_spline3_eval_at_time(&spline, &cursor, duration * (cds_spline_r32)iSamp / kNumSamples).x;
+    }
+    cursorTime = bench_seconds() - start;
+    printf("\n%-24s %14s\n", "keyframe playback", "Mev/s");
+    printf("%-24s %14.1f\n", "binary search", 1e-6 * kNumSamples / searchTime);
+    printf("%-24s %14.1f\n", "cursor", 1e-6 * kNumSamples / cursorTime);
+    printf("(checksum %g)\n", (double)checksum);
+    free(times);
+    free(buffer);
+}
+
+/* Position, derivatives, curvature and torsion at sorted t values: three separate eval calls
+ * with the geometry done by the caller, then cds_spline3_eval_point() and _eval_points(). */
+static void
+bench_eval_point(void) {
+    enum { kNumKnots = 4096, kNumT = 1<<20, kChunk = 256 };
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumT * sizeof(cds_spline_r32));
+    cds_spline_point3 points[kChunk];
+    cds_spline3 spline;
+    cds_spline_s32 iKnot, iT;
+    cds_spline_r32 checksum = 0;
+    double start, separateTime, fusedTime, batchTime;
+    cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize);
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        cds_spline3_append_knots(&spline, &knot, 1);
+    }
+    for(iT=0; iT<kNumT; ++iT) {
+        t[iT] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)iT / (cds_spline_r32)kNumT;
+    }
+    start = bench_seconds();
+    for(iT=0; iT<kNumT; ++iT) {
+        const cds_spline_vec3 pos = cds_spline3_eval(&spline, t[iT]);
+        const cds_spline_vec3 d = cds_spline3_evald(&spline, t[iT]);
+        const cds_spline_vec3 dd = cds_spline3_evaldd(&spline, t[iT]);
+        const cds_spline_vec3 ddd = cds_spline3__sub_scaled(cds_spline3_evaldd(&spline, t[iT] + 0.001f), 1.0f, dd);
+        const cds_spline_vec3 dxdd = cds_spline3__cross(d, dd);
+        const cds_spline_r32 speed = (cds_spline_r32)sqrt(cds_spline3__dot(d, d));
+        const cds_spline_r32 crossSq = cds_spline3__dot(dxdd, dxdd);
+        const cds_spline_r32 curvature = (cds_spline_r32)sqrt(crossSq) / (speed*speed*speed);
+        const cds_spline_r32 torsion = cds_spline3__dot(dxdd, ddd) * 1000.0f / crossSq;
+        checksum += pos.x + d.x / speed + curvature + torsion;
+    }
+    separateTime = bench_seconds() - start;
+    start = bench_seconds();
+    for(iT=0; iT<kNumT; ++iT) {
+        const cds_spline_point3 p = cds_spline3_eval_point(&spline, t[iT], kCdsSplinePointAll);
+        checksum += p.position.x + p.tangent.x + p.curvature + p.torsion;
+    }
+    fusedTime = bench_seconds() - start;
+    /* in cache-sized chunks, as a path follower consuming the points would */
+    start = bench_seconds();
+    for(iT=0; iT<kNumT; iT += kChunk) {
+        cds_spline_s32 iPoint;
+        cds_spline3_eval_points(&spline, t + iT, kChunk, kCdsSplinePointAll, points);
+        for(iPoint=0; iPoint<kChunk; ++iPoint) {
+            checksum += points[iPoint].position.x + points[iPoint].tangent.x + points[iPoint].curvature + points[iPoint].torsion;
+        }
+    }
+    batchTime = bench_seconds() - start;
+    printf("\n%-40s %10s\n", "point + curvature + torsion", "ns/point");
+    printf("%-40s %10.2f\n", "eval + evald + evaldd (x2), by hand", 1e9 * separateTime / kNumT);
+    printf("%-40s %10.2f\n", "cds_spline3_eval_point", 1e9 * fusedTime / kNumT);
+    printf("%-40s %10.2f\n", "cds_spline3_eval_points", 1e9 * batchTime / kNumT);
+    printf("(checksum %g)\n", (double)checksum);
+    free(t);
+    free(buffer);
+}
+
+/* Many small, short-lived splines: a malloc per spline against a pool carved from one slab,
+ * creating them all, then repeatedly destroying and recreating a random half. Only buffer
+ * management is timed; filling the splines costs the same either way. */
+static void
+bench_pool(void) {
+    enum { kNumSplines = 20000, kNumRounds = 20, kMaxKnots = 16 };
+    const size_t slabSize = (size_t)kNumSplines * 1280;
+    void *slab = malloc(slabSize);
+    void **buffers = (void**)malloc(kNumSplines * sizeof(void*));
+    cds_spline3 *splines = (cds_spline3*)malloc(kNumSplines * sizeof(cds_spline3));
+    cds_spline_s32 *knotCounts = (cds_spline_s32*)malloc(kNumSplines * sizeof(cds_spline_s32));
+    cds_spline_s32 *order = (cds_spline_s32*)malloc(kNumRounds * kNumSplines/2 * sizeof(cds_spline_s32));
+    cds_spline_pool pool;
+    cds_spline_s32 iSpline, iOp;
+    size_t mallocBytes = 0, poolBytes;
+    double start, mallocTime, poolTime;
+    srand(1);
+    for(iSpline=0; iSpline<kNumSplines; ++iSpline) {
+        knotCounts[iSpline] = 4 + rand() % (kMaxKnots-3);
+        mallocBytes += cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, knotCounts[iSpline]);
+    }
+    for(iOp=0; iOp<kNumRounds * kNumSplines/2; ++iOp) {
+        order[iOp] = rand() % kNumSplines;
+    }
+
+    start = bench_seconds();
+    for(iSpline=0; iSpline<kNumSplines; ++iSpline) {
+        const size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, knotCounts[iSpline]);
+        buffers[iSpline] = malloc(bufferSize);
+        cds_spline3_init(&splines[iSpline], kCdsSplineInterpStyleCardinal, knotCounts[iSpline], buffers[iSpline], bufferSize);
+    }
+    for(iOp=0; iOp<kNumRounds * kNumSplines/2; ++iOp) {
+        const cds_spline_s32 i = order[iOp], numKnots = knotCounts[(i + iOp) % kNumSplines];
+        const size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, numKnots);
+        free(buffers[i]);
+        buffers[i] = malloc(bufferSize);
+        cds_spline3_init(&splines[i], kCdsSplineInterpStyleCardinal, numKnots, buffers[i], bufferSize);
+    }
+    for(iSpline=0; iSpline<kNumSplines; ++iSpline) {
+        free(buffers[iSpline]);
+    }
+    mallocTime = bench_seconds() - start;
+
+    start = bench_seconds();
+    cds_spline_pool_init(&pool, 0);
+    cds_spline_pool_add_slab(&pool, slab, slabSize);
+    for(iSpline=0; iSpline<kNumSplines; ++iSpline) {
+        cds_spline3_pool_alloc(&pool, &splines[iSpline], kCdsSplineInterpStyleCardinal, knotCounts[iSpline]);
+    }
+    for(iOp=0; iOp<kNumRounds * kNumSplines/2; ++iOp) {
+        const cds_spline_s32 i = order[iOp], numKnots = knotCounts[(i + iOp) % kNumSplines];
+        cds_spline3_pool_free(&pool, &splines[i]);
+        cds_spline3_pool_alloc(&pool, &splines[i], kCdsSplineInterpStyleCardinal, numKnots);
+    }
+    poolBytes = (size_t)(pool.firstSlab->cursor - (cds_spline_u8*)slab);
+    cds_spline_pool_reset(&pool);
+    poolTime = bench_seconds() - start;
+
+    printf("\n%-40s %10s\n", "small spline churn (4-16 knots)", "ns/spline");
+    printf("%-40s %10.2f\n", "malloc + init, free", 1e9 * mallocTime / (kNumSplines + kNumRounds * kNumSplines/2));
+    printf("%-40s %10.2f\n", "pool alloc, pool free", 1e9 * poolTime / (kNumSplines + kNumRounds * kNumSplines/2));
+    printf("(%.0f bytes/spline requested, %.0f carved from the slab)\n", (double)mallocBytes / kNumSplines,
+        (double)poolBytes / kNumSplines);
+    free(order);
+    free(knotCounts);
+    free(splines);
+    free(buffers);
+    free(slab);
+}
+
+/* Evaluating a timing curve by x: a hand-written bisection over cds_spline2_eval() against the
+ * timing table, one query at a time and batched over consecutive animation frames. */
+static void
+bench_timing(void) {
+    enum { kNumKnots = 64, kNumX = 1<<20 };
+    const cds_spline_r32 tolerance = 1e-5f;
+    size_t bufferSize = cds_spline2_buffer_size(kCdsSplineInterpStyleBezier, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    void *tableBuffer;
+    cds_spline_r32 *x = (cds_spline_r32*)malloc(kNumX * sizeof(cds_spline_r32));
+    cds_spline_r32 *y = (cds_spline_r32*)malloc(kNumX * sizeof(cds_spline_r32));
+    cds_spline2 spline;
+    cds_spline_timing2 timing;
+    cds_spline_s32 iKnot, iX;
+    cds_spline_r32 checksum = 0, xEnd;
+    double start, bisectTime, solveTime, batchTime;
+    cds_spline2_init(&spline, kCdsSplineInterpStyleBezier, kNumKnots, buffer, bufferSize);
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot2 knot;
+        knot.position = cds_spline_init_vec2((cds_spline_r32)iKnot, bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec2(0.42f, bench_random_r32(1));
+        cds_spline2_append_knots(&spline, &knot, 1);
+    }
+    tableBuffer = malloc(cds_spline2_timing_buffer_size(&spline));
+    cds_spline2_timing_init(&timing, &spline, tolerance, tableBuffer, cds_spline2_timing_buffer_size(&spline));
+    xEnd = spline.knots[kNumKnots-1].position.x;
+    for(iX=0; iX<kNumX; ++iX) {
+        x[iX] = xEnd * (cds_spline_r32)iX / (cds_spline_r32)kNumX;
+    }
+    start = bench_seconds();
+    for(iX=0; iX<kNumX; ++iX) {
+        cds_spline_r32 lo = 0, hi = (cds_spline_r32)spline.numSegments, t = 0;
+        cds_spline_vec2 pos = cds_spline2_eval(&spline, t);
+        while(hi - lo > 1e-6f * (cds_spline_r32)spline.numSegments) {
+            t = 0.5f*(lo + hi);
+            pos = cds_spline2_eval(&spline, t);
+            if (fabs(pos.x - x[iX]) <= tolerance)
+                break;
+            if (pos.x < x[iX])
+                lo = t;
+            else
+                hi = t;
+        }
+        checksum += pos.y;
+    }
+    bisectTime = bench_seconds() - start;
+    start = bench_seconds();
+    for(iX=0; iX<kNumX; ++iX) {
+        checksum += cds_spline2_timing_eval(&timing, x[iX]);
+    }
+    solveTime = bench_seconds() - start;
+    start = bench_seconds();
+    cds_spline2_timing_eval_many(&timing, x, kNumX, NULL, y);
+    batchTime = bench_seconds() - start;
+    for(iX=0; iX<kNumX; ++iX) {
+        checksum += y[iX];
+    }
+    printf("\n%-40s %10s\n", "timing curve x -> y (tolerance 1e-5)", "ns/query");
+    printf("%-40s %10.2f\n", "bisection over cds_spline2_eval", 1e9 * bisectTime / kNumX);
+    printf("%-40s %10.2f\n", "cds_spline2_timing_eval", 1e9 * solveTime / kNumX);
+    printf("%-40s %10.2f\n", "cds_spline2_timing_eval_many", 1e9 * batchTime / kNumX);
+    printf("(%d iterations at most; checksum %g)\n", timing.maxIterations, (double)checksum);
+    free(y);
+    free(x);
+    free(tableBuffer);
+    free(buffer);
+}
+
+/* Hot read-only evaluation: the cubic segments against baked tables at a tolerance of 1e-3,
+ * with random t, one at a time and batched. */
+static void
+bench_baked(void) {
+    enum { kNumKnots = 256, kNumT = 1<<20 };
+    const cds_spline_r32 tolerance = 1e-3f;
+    const cds_spline_bake_interp interps[] = { kCdsSplineBakeLinear, kCdsSplineBakeQuadratic };
+    const char *names[] = { "linear", "quad" };
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumT * sizeof(cds_spline_r32));
+    cds_spline_vec3 *out = (cds_spline_vec3*)malloc(kNumT * sizeof(cds_spline_vec3));
+    cds_spline3 spline;
+    cds_spline_s32 iKnot, iT, iInterp;
+    cds_spline_r32 checksum = 0;
+    double start, evalTime, manyTime;
+    cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize);
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        cds_spline3_append_knots(&spline, &knot, 1);
+    }
+    for(iT=0; iT<kNumT; ++iT) {
+        t[iT] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+    }
+    printf("\n%-40s %10s %10s %10s\n", "baked evaluation (tolerance 1e-3)", "ns/eval", "ns/many", "KB");
+    start = bench_seconds();
+    for(iT=0; iT<kNumT; ++iT) {
+        checksum += cds_spline3_eval(&spline, t[iT]).x;
+    }
+    evalTime = bench_seconds() - start;
+    start = bench_seconds();
+    cds_spline3_eval_many(&spline, t, kNumT, out);
+    manyTime = bench_seconds() - start;
+    checksum += out[kNumT-1].x;
+    printf("%-40s %10.2f %10.2f %10.1f\n", "cds_spline3_eval", 1e9 * evalTime / kNumT, 1e9 * manyTime / kNumT,
+        (double)bufferSize / 1024);
+    for(iInterp=0; iInterp<2; ++iInterp) {
+        const size_t tableSize = cds_spline3_bake_buffer_size(&spline, interps[iInterp], tolerance);
+        void *table = malloc(tableSize);
+        cds_spline_baked3 baked;
+        char label[64];
+        cds_spline3_bake(&baked, &spline, interps[iInterp], tolerance, table, tableSize);
+        start = bench_seconds();
+        for(iT=0; iT<kNumT; ++iT) {
+            checksum += cds_spline3_baked_eval(&baked, t[iT]).x;
+        }
+        evalTime = bench_seconds() - start;
+        start = bench_seconds();
+        cds_spline3_baked_eval_many(&baked, t, kNumT, out);
+        manyTime = bench_seconds() - start;
+        checksum += out[kNumT-1].x;
+        sprintf(label, "baked %s, %d/segment, bound %.2g", names[iInterp], baked.samplesPerSegment, (double)baked.errorBound);
+        printf("%-40s %10.2f %10.2f %10.1f\n", label, 1e9 * evalTime / kNumT, 1e9 * manyTime / kNumT,
+            (double)tableSize / 1024);
+        free(table);
+    }
+    printf("(checksum %g)\n", (double)checksum);
+    free(out);
+    free(t);
+    free(buffer);
+}
+
+/* A sliding window of knots: append one knot and drop the oldest, with a cds_spline3
+ * (append_knots + remove_knot(0)) and with a ring spline (push_back + pop_front). */
+static void
+bench_ring_window(void) {
+    const cds_spline_s32 windowSizes[] = { 64, 1024, 16384 };
+    enum { kNumUpdates = 1<<16 };
+    cds_spline_knot3 *knots = (cds_spline_knot3*)malloc(kNumUpdates * sizeof(cds_spline_knot3));
+    cds_spline_s32 iWindow, iUpdate;
+    cds_spline_r32 checksum = 0;
+    srand(1);
+    for(iUpdate=0; iUpdate<kNumUpdates; ++iUpdate) {
+        knots[iUpdate].position = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+        knots[iUpdate].tangent = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+    }
+    printf("\n%-24s %14s %14s\n", "sliding window (ns/op)", "spline", "ring");
+    for(iWindow=0; iWindow<(cds_spline_s32)(sizeof(windowSizes)/sizeof(windowSizes[0])); ++iWindow) {
+        const cds_spline_s32 windowSize = windowSizes[iWindow];
+        size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, windowSize+1);
+        size_t ringSize = cds_spline3_ring_buffer_size(kCdsSplineInterpStyleCardinal, windowSize+1);
+        void *buffer = malloc(bufferSize), *ringBuffer = malloc(ringSize);
+        cds_spline3 spline;
+        cds_spline_ring3 ring;
+        double start, splineTime, ringTime;
+        cds_spline3_init_from_knots(&spline, kCdsSplineInterpStyleCardinal, windowSize+1, kCdsSplineFlagNone, knots,
+            windowSize, buffer, bufferSize);
+        cds_spline3_ring_init(&ring, kCdsSplineInterpStyleCardinal, windowSize+1, ringBuffer, ringSize);
+        for(iUpdate=0; iUpdate<windowSize; ++iUpdate) {
+            cds_spline3_ring_push_back(&ring, knots[iUpdate]);
+        }
+        start = bench_seconds();
+        for(iUpdate=0; iUpdate<kNumUpdates; ++iUpdate) {
+            cds_spline3_append_knots(&spline, knots + iUpdate, 1);
+            cds_spline3_remove_knot(&spline, 0);
+            checksum += cds_spline3_eval(&spline, (cds_spline_r32)spline.numSegments).x;
+        }
+        splineTime = bench_seconds() - start;
+        start = bench_seconds();
+        for(iUpdate=0; iUpdate<kNumUpdates; ++iUpdate) {
+            cds_spline3_ring_push_back(&ring, knots[iUpdate]);
+            cds_spline3_ring_pop_front(&ring, 1);
+            checksum += cds_spline3_ring_eval(&ring, (cds_spline_r32)ring.numSegments).x;
+        }
+        ringTime = bench_seconds() - start;
+        printf("%-24d %14.1f %14.1f\n", windowSize, 1e9 * splineTime / kNumUpdates, 1e9 * ringTime / kNumUpdates);
+        free(ringBuffer);
+        free(buffer);
+    }
+    printf("(checksum %g)\n", (double)checksum);
+    free(knots);
+}
+
+/* Plane and ray queries per second against a long spline, with and without bounding volume
+ * culling. Planes are axis-aligned clip planes at random heights; rays are random picking rays
+ * through points near the curve. */
+static void
+bench_intersect(void) {
+    enum { kNumKnots = 4096, kNumQueries = 1<<12, kMaxHits = 1<<12 };
+    const cds_spline_u32 flags[] = { kCdsSplineFlagNone, kCdsSplineFlagBoundingVolumes };
+    const char *flagNames[] = { "all segments", "bounds" };
+    cds_spline_hit3 *hits = (cds_spline_hit3*)malloc(kMaxHits * sizeof(cds_spline_hit3));
+    cds_spline_vec3 *points = (cds_spline_vec3*)malloc(kNumQueries * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *dirs = (cds_spline_vec3*)malloc(kNumQueries * sizeof(cds_spline_vec3));
+    cds_spline_s32 iFlags, iKnot, iQuery, hitCount, totalHits = 0;
+    printf("\n%-24s %14s %14s\n", "intersection (Mq/s)", "plane", "ray");
+    for(iFlags=0; iFlags<2; ++iFlags) {
+        cds_spline3 spline;
+        size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, kNumKnots, flags[iFlags]);
+        void *buffer = malloc(bufferSize);
+        double start, planeTime, rayTime;
+        cds_spline3_init_ex(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, flags[iFlags], buffer, bufferSize);
+        srand(1);
+        for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+            cds_spline_knot3 knot;
+            knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+            knot.tangent = cds_spline_init_vec3(0, 0, 0);
+            cds_spline3_append_knots(&spline, &knot, 1);
+        }
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            points[iQuery] = cds_spline3_eval(&spline, (cds_spline_r32)spline.numSegments * (0.5f + bench_random_r32(1)));
+            dirs[iQuery] = cds_spline_init_vec3(bench_random_r32(1), bench_random_r32(1), 1);
+            points[iQuery].x -= 100.0f*dirs[iQuery].x;
+            points[iQuery].y -= 100.0f*dirs[iQuery].y;
+            points[iQuery].z -= 100.0f;
+        }
+        start = bench_seconds();
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            cds_spline3_intersect_plane(&spline, cds_spline_init_vec3(1, 0, 0), (cds_spline_r32)(iQuery % kNumKnots) + 0.5f,
+                hits, kMaxHits, &hitCount);
+            totalHits += hitCount;
+        }
+        planeTime = bench_seconds() - start;
+        start = bench_seconds();
+        for(iQuery=0; iQuery<kNumQueries; ++iQuery) {
+            cds_spline3_intersect_ray(&spline, points[iQuery], dirs[iQuery], 0.1f, hits, kMaxHits, &hitCount);
+            totalHits += hitCount;
+        }
+        rayTime = bench_seconds() - start;
+        printf("%-24s %14.3f %14.3f\n", flagNames[iFlags], 1e-6 * kNumQueries / planeTime, 1e-6 * kNumQueries / rayTime);
+        free(buffer);
+    }
+    printf("(hits %d)\n", totalHits);
+    free(dirs);
+    free(points);
+    free(hits);
+}
+
+/* Load cost per spline: rebuilding from knots with insert_knot() (as level loading used to),
+ * rebuilding in bulk with init_from_knots(), and binding a prebuilt blob. */
+static void
+bench_blob_load(void) {
+    const cds_spline_s32 knotCounts[] = { 16, 256, 4096, 65536 };
+    const cds_spline_u32 flags = kCdsSplineFlagArcLengthTable | kCdsSplineFlagBoundingVolumes;
+    cds_spline_s32 iCount, iKnot, iRep;
+    cds_spline_r32 checksum = 0;
+    printf("\n%-12s %16s %16s %16s\n", "blob load", "insert us", "bulk us", "bind us");
+    for(iCount=0; iCount<(cds_spline_s32)(sizeof(knotCounts)/sizeof(knotCounts[0])); ++iCount) {
+        const cds_spline_s32 numKnots = knotCounts[iCount];
+        const cds_spline_s32 numRepeats = CDS_SPLINE_MAX((1<<18) / numKnots, 4);
+        size_t bufferSize = cds_spline3_buffer_size_ex(kCdsSplineInterpStyleCardinal, numKnots, flags), blobSize;
+        void *buffer = malloc(bufferSize);
+        cds_spline_knot3 *knots = (cds_spline_knot3*)malloc(numKnots * sizeof(cds_spline_knot3));
+        cds_spline_u8 *blobBuffer, *blob;
+        cds_spline3 spline;
+        double start, insertTime, bulkTime, bindTime;
+        srand(1);
+        for(iKnot=0; iKnot<numKnots; ++iKnot) {
+            knots[iKnot].position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+            knots[iKnot].tangent = cds_spline_init_vec3(0, 0, 0);
+        }
+        start = bench_seconds();
+        for(iRep=0; iRep<numRepeats; ++iRep) {
+            cds_spline3_init_ex(&spline, kCdsSplineInterpStyleCardinal, numKnots, flags, buffer, bufferSize);
+            for(iKnot=0; iKnot<numKnots; ++iKnot) {
+                cds_spline3_insert_knot(&spline, iKnot, knots[iKnot]);
+            }
+            checksum += cds_spline3_arc_length(&spline);
+        }
+        insertTime = bench_seconds() - start;
+        start = bench_seconds();
+        for(iRep=0; iRep<numRepeats; ++iRep) {
+            cds_spline3_init_from_knots(&spline, kCdsSplineInterpStyleCardinal, numKnots, flags, knots, numKnots,
+                buffer, bufferSize);
+            checksum += cds_spline3_arc_length(&spline);
+        }
+        bulkTime = bench_seconds() - start;
+        blobSize = cds_spline3_blob_size(&spline);
+        blobBuffer = (cds_spline_u8*)malloc(blobSize + CDS_SPLINE_BLOB_ALIGNMENT);
+        blob = (cds_spline_u8*)CDS_SPLINE_ALIGN_TO((intptr_t)blobBuffer, CDS_SPLINE_BLOB_ALIGNMENT);
+        cds_spline3_write_blob(&spline, blob, blobSize);
+        start = bench_seconds();
+        for(iRep=0; iRep<numRepeats; ++iRep) {
+            cds_spline3_bind_blob(&spline, blob, blobSize);
+            checksum += cds_spline3_arc_length(&spline);
+        }
+        bindTime = bench_seconds() - start;
+        printf("%-12d %16.2f %16.2f %16.3f\n", numKnots, 1e6 * insertTime / numRepeats, 1e6 * bulkTime / numRepeats,
+            1e6 * bindTime / numRepeats);
+        free(blobBuffer);
+        free(knots);
+        free(buffer);
+    }
+    printf("(checksum %g)\n", (double)checksum);
+}
+
+/* Regression suite: every scalar eval and edit entry point, for each interpolation style, knot
+ * counts from 4 to 1M, and sequential and random t. Each case doubles its op count until a run
+ * takes at least BENCH_MIN_SECONDS, and reports that run. Results are written as CSV, or as a JSON
+ * array with --json, one record per case:
+ *   op, style, knots, pattern, ops, ns_per_op, ops_per_sec
+ */
+#define BENCH_MIN_SECONDS 0.02
+/* Insert/remove cases run in batches of at most 1/BENCH_EDIT_BATCH_DIVISOR of the knot count
+ * (restoring the spline between batches, untimed), so the knot count being measured stays
+ * within a few percent of the nominal one. BENCH_EDIT_SLACK is the extra capacity they need. */
+#define BENCH_EDIT_BATCH_DIVISOR 16
+#define BENCH_EDIT_SLACK 4096
+#define BENCH_T_COUNT (1<<16)
+
+typedef struct bench_case {
+    cds_spline3 *spline;
+    const cds_spline_r32 *t; /* BENCH_T_COUNT values */
+    cds_spline_s32 position; /* knot index for insert/remove: 0 front, 1 middle, 2 back */
+    cds_spline_s32 editBatch; /* insert/remove ops per timed batch */
+    double timerOverhead; /* seconds, subtracted from each timed batch */
+    cds_spline_r32 checksum;
+} bench_case;
+
+/* Runs opCount operations and returns the time they took */
+typedef double (*bench_case_func)(bench_case *c, cds_spline_s32 opCount);
+
+static double
+bench_case_eval(bench_case *c, cds_spline_s32 opCount) {
+    double start = bench_seconds();
+    cds_spline_s32 iOp;
+    for(iOp=0; iOp<opCount; ++iOp) {
+        c->checksum += cds_spline3_eval(c->spline, c->t[iOp & (BENCH_T_COUNT-1)]).x;
+    }
+    return bench_seconds() - start;
+}
+
+static double
+bench_case_evald(bench_case *c, cds_spline_s32 opCount) {
+    double start = bench_seconds();
+    cds_spline_s32 iOp;
+    for(iOp=0; iOp<opCount; ++iOp) {
+        c->checksum += cds_spline3_evald(c->spline, c->t[iOp & (BENCH_T_COUNT-1)]).x;
+    }
+    return bench_seconds() - start;
+}
+
+static double
+bench_case_evaldd(bench_case *c, cds_spline_s32 opCount) {
+    double start = bench_seconds();
+    cds_spline_s32 iOp;
+    for(iOp=0; iOp<opCount; ++iOp) {
+        c->checksum += cds_spline3_evaldd(c->spline, c->t[iOp & (BENCH_T_COUNT-1)]).x;
+    }
+    return bench_seconds() - start;
+}
+
+static cds_spline_s32
+bench_edit_index(const bench_case *c, cds_spline_s32 numKnots) {
+    return (c->position == 0) ? 0 : (c->position == 1) ? numKnots/2 : numKnots;
+}
+
+/* Inserts and removes batch knots, timing only the inserts (or only the removals). */
+static double
+bench_insert_remove_batch(bench_case *c, cds_spline_s32 batch, cds_spline_bool32_t timeRemovals) {
+    cds_spline_knot3 knot = c->spline->knots[c->spline->numKnots/2];
+    double start = 0, elapsed;
+    cds_spline_s32 iOp;
+    if (!timeRemovals)
+        start = bench_seconds();
+    for(iOp=0; iOp<batch; ++iOp) {
+        cds_spline3_insert_knot(c->spline, bench_edit_index(c, c->spline->numKnots), knot);
+    }
+    if (!timeRemovals)
+        elapsed = bench_seconds() - start;
+    else
+        start = bench_seconds();
+    for(iOp=0; iOp<batch; ++iOp) {
+        cds_spline3_remove_knot(c->spline, bench_edit_index(c, c->spline->numKnots-1));
+    }
+    if (timeRemovals)
+        elapsed = bench_seconds() - start;
+    return elapsed - c->timerOverhead;
+}
+
+static double
+bench_case_insert_remove(bench_case *c, cds_spline_s32 opCount, cds_spline_bool32_t timeRemovals) {
+    double elapsed = 0;
+    cds_spline_s32 done;
+    for(done=0; done<opCount; done += c->editBatch) {
+        elapsed += bench_insert_remove_batch(c, CDS_SPLINE_MIN(c->editBatch, opCount-done), timeRemovals);
+    }
+    return elapsed;
+}
+
+static double
+bench_case_insert_knot(bench_case *c, cds_spline_s32 opCount) {
+    return bench_case_insert_remove(c, opCount, 0);
+}
+
+static double
+bench_case_remove_knot(bench_case *c, cds_spline_s32 opCount) {
+    return bench_case_insert_remove(c, opCount, 1);
+}
+
+static double
+bench_case_set_knot(bench_case *c, cds_spline_s32 opCount) {
+    double start = bench_seconds();
+    cds_spline_s32 iOp;
+    for(iOp=0; iOp<opCount; ++iOp) {
+        /* t[] doubles as a source of knot indices */
+        const cds_spline_s32 knotIndex = CDS_SPLINE_MIN(c->spline->numKnots-1, (cds_spline_s32)(
+            c->t[iOp & (BENCH_T_COUNT-1)] / (cds_spline_r32)c->spline->numSegments * (cds_spline_r32)c->spline->numKnots));
+        cds_spline_knot3 knot = c->spline->knots[knotIndex];
+        knot.position.y += 1.0f;
+        cds_spline3_set_knot(c->spline, knotIndex, knot);
+    }
+    return bench_seconds() - start;
+}
+
+static double
+bench_case_set_tension(bench_case *c, cds_spline_s32 opCount) {
+    double start = bench_seconds();
+    cds_spline_s32 iOp;
+    for(iOp=0; iOp<opCount; ++iOp) {
+        /* alternate, so that every call really changes the tension */
+        cds_spline3_set_tension(c->spline, (iOp & 1) ? 0.5f : 0.25f);
+    }
+    return bench_seconds() - start;
+}
+
+static void
+bench_suite_report(cds_spline_bool32_t json, cds_spline_bool32_t *first, const char *op, const char *style,
+    cds_spline_s32 knots, const char *pattern, cds_spline_s32 ops, double seconds) {
+    const double nsPerOp = 1e9 * seconds / (double)ops;
+    if (json) {
+        printf("%s\n  {\"op\": \"%s\", \"style\": \"%s\", \"knots\": %d, \"pattern\": \"%s\", \"ops\": %d, "
+            "\"ns_per_op\": %.2f, \"ops_per_sec\": %.0f}", *first ? "[" : ",", op, style, knots, pattern, ops,
+            nsPerOp, 1e9 / nsPerOp);
+    } else {
+        if (*first)
+            printf("op,style,knots,pattern,ops,ns_per_op,ops_per_sec\n");
+        printf("%s,%s,%d,%s,%d,%.2f,%.0f\n", op, style, knots, pattern, ops, nsPerOp, 1e9 / nsPerOp);
+    }
+    *first = 0;
+}
+
+static void
+bench_suite(cds_spline_bool32_t json) {
+    const cds_spline_interp_style styles[] = { kCdsSplineInterpStyleHermite, kCdsSplineInterpStyleBezier,
+        kCdsSplineInterpStyleCardinal, kCdsSplineInterpStyleCentripetalCatmullRom };
+    const char *styleNames[] = { "hermite", "bezier", "cardinal", "catmull_rom" };
+    const cds_spline_s32 knotCounts[] = { 4, 16, 256, 4096, 65536, 1<<20 };
+    struct { const char *name; bench_case_func func; cds_spline_bool32_t usesT; cds_spline_bool32_t isInsertRemove; } ops[] = {
+        { "eval",        bench_case_eval,        1, 0 },
+        { "evald",       bench_case_evald,       1, 0 },
+        { "evaldd",      bench_case_evaldd,      1, 0 },
+        { "insert_knot", bench_case_insert_knot, 0, 1 },
+        { "remove_knot", bench_case_remove_knot, 0, 1 },
+        { "set_knot",    bench_case_set_knot,    0, 0 },
+        { "set_tension", bench_case_set_tension, 0, 0 },
+    };
+    const char *patternNames[] = { "sequential", "random" };
+    const char *positionNames[] = { "front", "middle", "back" };
+    cds_spline_r32 *t[2];
+    cds_spline_bool32_t first = 1;
+    cds_spline_s32 iStyle, iCount, iKnot, iOp, iPattern, iT, opCount;
+    cds_spline_r32 checksum = 0;
+    double timerOverhead, start;
+    start = bench_seconds();
+    for(iT=0; iT<1000; ++iT) {
+        bench_seconds();
+    }
+    timerOverhead = (bench_seconds() - start) / 1000.0;
+    t[0] = (cds_spline_r32*)malloc(BENCH_T_COUNT * sizeof(cds_spline_r32));
+    t[1] = (cds_spline_r32*)malloc(BENCH_T_COUNT * sizeof(cds_spline_r32));
+    for(iStyle=0; iStyle<(cds_spline_s32)(sizeof(styles)/sizeof(styles[0])); ++iStyle) {
+        for(iCount=0; iCount<(cds_spline_s32)(sizeof(knotCounts)/sizeof(knotCounts[0])); ++iCount) {
+            const cds_spline_s32 numKnots = knotCounts[iCount];
+            cds_spline3 spline;
+            size_t bufferSize = cds_spline3_buffer_size(styles[iStyle], numKnots + BENCH_EDIT_SLACK);
+            void *buffer = malloc(bufferSize);
+            bench_case c;
+            cds_spline3_init(&spline, styles[iStyle], numKnots + BENCH_EDIT_SLACK, buffer, bufferSize);
+            srand(1);
+            for(iKnot=0; iKnot<numKnots; ++iKnot) {
+                cds_spline_knot3 knot;
+                knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+                knot.tangent = cds_spline_init_vec3(bench_random_r32(10), bench_random_r32(10), bench_random_r32(10));
+                cds_spline3_append_knots(&spline, &knot, 1);
+            }
+            /* sequential t sweeps the whole spline once per BENCH_T_COUNT evals */
+            for(iT=0; iT<BENCH_T_COUNT; ++iT) {
+                t[0][iT] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)iT / (cds_spline_r32)BENCH_T_COUNT;
+                t[1][iT] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)rand() / (cds_spline_r32)RAND_MAX;
+            }
+            c.spline = &spline;
+            c.editBatch = CDS_SPLINE_MIN(CDS_SPLINE_MAX(numKnots / BENCH_EDIT_BATCH_DIVISOR, 1), BENCH_EDIT_SLACK);
+            c.timerOverhead = timerOverhead;
+            c.checksum = 0;
+            for(iOp=0; iOp<(cds_spline_s32)(sizeof(ops)/sizeof(ops[0])); ++iOp) {
+                const cds_spline_s32 variantCount = ops[iOp].usesT ? 2 : ops[iOp].isInsertRemove ? 3 : 1;
+                for(iPattern=0; iPattern<variantCount; ++iPattern) {
+                    const char *variantName = ops[iOp].usesT ? patternNames[iPattern]
+                        : ops[iOp].isInsertRemove ? positionNames[iPattern] : "random";
+                    double seconds;
+                    c.t = t[ops[iOp].usesT ? iPattern : 1];
+                    c.position = iPattern;
+                    for(opCount=1; ; opCount *= 2) {
+                        seconds = ops[iOp].func(&c, opCount);
+                        if (seconds >= BENCH_MIN_SECONDS || opCount >= (1<<30))
+                            break;
+                    }
+                    bench_suite_report(json, &first, ops[iOp].name, styleNames[iStyle], numKnots, variantName,
+                        opCount, seconds);
+                }
+            }
+            checksum += c.checksum;
+            free(buffer);
+        }
+    }
+    if (json)
+        printf("\n]\n");
+    fprintf(stderr, "(checksum %g)\n", (double)checksum);
+    free(t[0]);
+    free(t[1]);
+}
+
+#if defined(CDS_SPLINE_THREADS)
+static cds_spline_s32
+bench_hardware_threads(void) {
+#if defined(CDS_SPLINE_PLATFORM_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (cds_spline_s32)info.dwNumberOfProcessors;
+#else
+    return (cds_spline_s32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+typedef struct bench_shared_readers {
+    cds_spline_shared3 *shared; /* NULL: readers and the writer share one spline under a mutex */
+    cds_spline3 *locked;
+    cds_spline__mutex mutex;
+    const cds_spline_r32 *t;
+    double duration;
+    cds_spline_s32 done;
+    cds_spline_s32 evalBatches;
+    cds_spline_s32 publishes;
+    cds_spline_r32 checksums[64];
+} bench_shared_readers;
+
+enum { kBenchSharedBatch = 256 };
+
+static void
+bench_shared_readers_task(void *taskData, cds_spline_s32 taskIndex) {
+    bench_shared_readers *bench = (bench_shared_readers*)taskData;
+    if (taskIndex == 0) {
+        const double start = bench_seconds();
+        cds_spline_s32 publishes = 0;
+        while(bench_seconds() - start < bench->duration) {
+            cds_spline_knot3 knot;
+            cds_spline3 *spline = bench->locked;
+            knot.position = cds_spline_init_vec3((cds_spline_r32)publishes, bench_random_r32(10), bench_random_r32(10));
+            knot.tangent = cds_spline_init_vec3(0, 0, 0);
+            if (bench->shared != NULL) {
+                cds_spline3_shared_begin_write(bench->shared, &spline);
+                cds_spline3_set_knot(spline, rand() % spline->numKnots, knot);
+                cds_spline3_shared_publish(bench->shared);
+            } else {
+                CDS_SPLINE__MUTEX_LOCK(&bench->mutex);
+                cds_spline3_set_knot(spline, rand() % spline->numKnots, knot);
+                CDS_SPLINE__MUTEX_UNLOCK(&bench->mutex);
+            }
+            publishes += 1;
+        }
+        bench->publishes = publishes;
+        CDS_SPLINE__ATOMIC_STORE_S32(&bench->done, 1);
+    } else {
+        cds_spline_r32 checksum = 0;
+        cds_spline_s32 batches = 0, iT;
+        while(!CDS_SPLINE__ATOMIC_LOAD_S32(&bench->done)) {
+            const cds_spline3 *spline;
+            if (bench->shared != NULL) {
+                spline = cds_spline3_shared_acquire(bench->shared, NULL);
+            } else {
+                CDS_SPLINE__MUTEX_LOCK(&bench->mutex);
+                spline = bench->locked;
+            }
+            for(iT=0; iT<kBenchSharedBatch; ++iT) {
+                checksum += cds_spline3_eval(spline, bench->t[iT]).y;
+            }
+            if (bench->shared != NULL) {
+                cds_spline3_shared_release(bench->shared, spline);
+            } else {
+                CDS_SPLINE__MUTEX_UNLOCK(&bench->mutex);
+            }
+            batches += 1;
+        }
+        CDS_SPLINE__ATOMIC_ADD_S32(&bench->evalBatches, batches);
+        bench->checksums[taskIndex % 64] += checksum;
+    }
+}
+
+/* One writer editing a knot in a loop while readers evaluate batches of points, with the spline
+ * behind a mutex and as a cds_spline_shared3. Reports reader throughput and writer updates. */
+static void
+bench_shared_spline(void) {
+    enum { kNumKnots = 4096 };
+    const cds_spline_s32 maxReaders = CDS_SPLINE_MIN(CDS_SPLINE_MAX(2*bench_hardware_threads(), 4), 32);
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    size_t sharedSize = cds_spline3_shared_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots, kCdsSplineFlagNone);
+    size_t poolSize = cds_spline_thread_pool_buffer_size(maxReaders);
+    void *buffer = malloc(bufferSize), *sharedBuffer = malloc(sharedSize), *poolBuffer = malloc(poolSize);
+    cds_spline_r32 t[kBenchSharedBatch], checksum = 0;
+    cds_spline3 locked, *writer;
+    cds_spline_shared3 shared;
+    bench_shared_readers bench;
+    cds_spline_s32 readerCount, iKnot, iMode, iT;
+    cds_spline3_init(&locked, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize);
+    cds_spline3_shared_init(&shared, kCdsSplineInterpStyleCardinal, kNumKnots, kCdsSplineFlagNone, sharedBuffer, sharedSize);
+    cds_spline3_shared_begin_write(&shared, &writer);
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        cds_spline3_append_knots(&locked, &knot, 1);
+        cds_spline3_append_knots(writer, &knot, 1);
+    }
+    cds_spline3_shared_publish(&shared);
+    for(iT=0; iT<kBenchSharedBatch; ++iT) {
+        t[iT] = (cds_spline_r32)locked.numSegments * (0.5f + bench_random_r32(1));
+    }
+    CDS_SPLINE__MUTEX_INIT(&bench.mutex);
+    printf("\n%-8s %16s %16s %16s %16s\n", "readers", "mutex Mev/s", "mutex edits/s", "shared Mev/s", "shared edits/s");
+    for(readerCount=1; readerCount<=maxReaders; readerCount *= 2) {
+        cds_spline_thread_pool *pool;
+        cds_spline_executor executor;
+        if (cds_spline_thread_pool_init(&pool, readerCount, poolBuffer, poolSize) != kCdsSplineErrorNone) {
+            printf("%-8d (failed to start threads)\n", readerCount);
+            break;
+        }
+        executor = cds_spline_thread_pool_executor(pool);
+        printf("%-8d", readerCount);
+        for(iMode=0; iMode<2; ++iMode) {
+            bench.shared = (iMode == 1) ? &shared : NULL;
+            bench.locked = &locked;
+            bench.t = t;
+            bench.duration = 0.25;
+            bench.done = 0;
+            bench.evalBatches = 0;
+            bench.publishes = 0;
+            memset(bench.checksums, 0, sizeof(bench.checksums));
+            executor.parallelFor(executor.context, bench_shared_readers_task, &bench, readerCount+1);
+            printf(" %16.1f %16.0f", 1e-6 * bench.evalBatches * kBenchSharedBatch / bench.duration,
+                bench.publishes / bench.duration);
+            for(iT=0; iT<64; ++iT) {
+                checksum += bench.checksums[iT];
+            }
+        }
+        printf("\n");
+        cds_spline_thread_pool_destroy(pool);
+    }
+    printf("(checksum %g)\n", (double)checksum);
+    CDS_SPLINE__MUTEX_DESTROY(&bench.mutex);
+    free(poolBuffer);
+    free(sharedBuffer);
+    free(buffer);
+}
+
+/* Throughput of the parallel front ends on the built-in pool, from 1 thread (the caller alone) up
+ * to twice the hardware thread count. Every run is compared against the serial output. */
+static void
+bench_parallel_scaling(void) {
+    enum { kNumKnots = 1<<16, kSteps = 16, kNumSamples = 1<<22, kNumRepeats = 4 };
+    const cds_spline_s32 maxThreads = CDS_SPLINE_MAX(2*bench_hardware_threads(), 4);
+    const cds_spline_s32 maxVerts = kNumKnots*kSteps + 1;
+    cds_spline3 spline;
+    size_t bufferSize = cds_spline3_buffer_size(kCdsSplineInterpStyleCardinal, kNumKnots);
+    void *buffer = malloc(bufferSize);
+    size_t poolSize = cds_spline_thread_pool_buffer_size(maxThreads-1);
+    void *poolBuffer = malloc(poolSize);
+    cds_spline_vec3 *serialVerts = (cds_spline_vec3*)malloc(maxVerts * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *verts = (cds_spline_vec3*)malloc(maxVerts * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *serialOut = (cds_spline_vec3*)malloc(kNumSamples * sizeof(cds_spline_vec3));
+    cds_spline_vec3 *out = (cds_spline_vec3*)malloc(kNumSamples * sizeof(cds_spline_vec3));
+    cds_spline_r32 *t = (cds_spline_r32*)malloc(kNumSamples * sizeof(cds_spline_r32));
+    cds_spline_s32 iKnot, iSamp, iRep, threadCount, vertCount;
+    double start, tessTime, evalTime;
+    cds_spline3_init(&spline, kCdsSplineInterpStyleCardinal, kNumKnots, buffer, bufferSize);
+    srand(1);
+    for(iKnot=0; iKnot<kNumKnots; ++iKnot) {
+        cds_spline_knot3 knot;
+        knot.position = cds_spline_init_vec3((cds_spline_r32)iKnot, bench_random_r32(10), bench_random_r32(10));
+        knot.tangent = cds_spline_init_vec3(0, 0, 0);
+        cds_spline3_insert_knot(&spline, iKnot, knot);
+    }
+    for(iSamp=0; iSamp<kNumSamples; ++iSamp) {
+        t[iSamp] = (cds_spline_r32)spline.numSegments * (cds_spline_r32)iSamp / (cds_spline_r32)kNumSamples;
+    }
+    cds_spline3_tessellate_uniform(&spline, kSteps, 0, serialVerts, maxVerts, &vertCount);
+    cds_spline3_eval_many(&spline, t, kNumSamples, serialOut);
+    printf("\n%-8s %16s %16s %10s\n", "threads", "tessellate Mv/s", "eval_many Mev/s", "identical");
+    for(threadCount=1; threadCount<=maxThreads; ++threadCount) {
+        cds_spline_thread_pool *pool;
+        cds_spline_executor executor;
+        cds_spline_bool32_t identical;
+        if (cds_spline_thread_pool_init(&pool, threadCount-1, poolBuffer, poolSize) != kCdsSplineErrorNone) {
+            printf("%-8d (failed to start threads)\n", threadCount);
+            break;
+        }
+        executor = cds_spline_thread_pool_executor(pool);
+        start = bench_seconds();
+        for(iRep=0; iRep<kNumRepeats; ++iRep) {
+            cds_spline3_tessellate_uniform_parallel(&spline, kSteps, 0, verts, maxVerts, &vertCount, &executor);
+        }
+        tessTime = bench_seconds() - start;
+        start = bench_seconds();
+        for(iRep=0; iRep<kNumRepeats; ++iRep) {
+            cds_spline3_eval_many_parallel(&spline, t, kNumSamples, out, &executor);
+        }
+        evalTime = bench_seconds() - start;
+        identical = memcmp(verts, serialVerts, vertCount*sizeof(cds_spline_vec3)) == 0 &&
+            memcmp(out, serialOut, kNumSamples*sizeof(cds_spline_vec3)) == 0;
+        printf("%-8d %16.1f %16.1f %10s\n", threadCount, 1e-6 * kNumRepeats * vertCount / tessTime,
+            1e-6 * kNumRepeats * kNumSamples / evalTime, identical ? "yes" : "NO");
+        cds_spline_thread_pool_destroy(pool);
+    }
+    free(t);
+    free(out);
+    free(serialOut);
+    free(verts);
+    free(serialVerts);
+    free(poolBuffer);
+    free(buffer);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    cds_spline_bool32_t suiteOnly = 0, json = 0;
+    int iArg;
+    for(iArg=1; iArg<argc; ++iArg) {
+        if (strcmp(argv[iArg], "--suite") == 0) {
+            suiteOnly = 1;
+        } else if (strcmp(argv[iArg], "--json") == 0) {
+            json = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--suite] [--json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!suiteOnly) {
+        bench_segment_layouts();
+        bench_spline_bank();
+        bench_knot_times();
+        bench_blob_load();
+        bench_intersect();
+        bench_ring_window();
+        bench_eval_point();
+        bench_pool();
+        bench_timing();
+        bench_baked();
+#if defined(CDS_SPLINE_THREADS)
+        bench_parallel_scaling();
+        bench_shared_spline();
+#else
+        printf("\n(build with -DCDS_SPLINE_THREADS for the parallel scaling and shared spline benchmarks)\n");
+#endif
+        printf("\n");
+    }
+    bench_suite(json);
+    return 0;
+}
+
+#endif /*------------------- end benchmark section ------------*/